@@ -39,6 +39,7 @@
 #include "clixon_config.h" /* generated by config & autoconf */
 #endif
 
+#define _GNU_SOURCE /* for memfd_create */
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -53,6 +54,8 @@
 #include <sys/stat.h>
 #include <sys/time.h>
 #include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/mman.h>
 #include <sys/param.h>
 #include <sys/types.h>
 #include <netinet/in.h>
@@ -67,26 +70,51 @@
 #include <clixon/clixon.h>
 
 #include "clixon_backend_handle.h"
+#include "clixon_backend_statedata.h"
 #include "backend_plugin.h"
 #include "backend_commit.h"
 #include "backend_client.h"
 #include "backend_handle.h"
+#include "backend_privcand.h"
+#include "backend_worker.h"
+#include "backend_sched.h"
 
-/*! Find client by session-id 
- * @param[in] ce_list   List of clients
- * @param[in] id        Session id
+/*
+ * Constants
  */
-static struct client_entry *
-ce_find_byid(struct client_entry *ce_list,
-	     uint32_t            id)
-{
-    struct client_entry *ce;
+/* Input buffer is read in chunks of this size */
+#define CLIENT_IBUF_SIZE 4096
 
-    for (ce = ce_list; ce; ce = ce->ce_next)
-	if (ce->ce_id == id)
-	    return ce;
-    return NULL;
-}
+/* Input buffer larger than this is released when empty */
+#define CLIENT_IBUF_KEEP (16*CLIENT_IBUF_SIZE)
+
+/* Max number of queued messages written in one call */
+#define CLIENT_IOV_MAX 64
+
+/* Initial size of a shared memory reply, doubled when full */
+#define CLIENT_SHM_SIZE 65536
+
+/* Do not raise SIGPIPE on write to a closed socket, return EPIPE instead */
+#ifdef MSG_NOSIGNAL
+#define CLIENT_MSG_NOSIGNAL MSG_NOSIGNAL
+#else
+#define CLIENT_MSG_NOSIGNAL 0
+#endif
+
+/*
+ * Types
+ */
+/* Reply written to shared memory, see client_shm_create */
+struct client_shm{
+    int    cs_fd;   /* Memory file descriptor */
+    char  *cs_map;  /* Shared mapping of the memory file, or NULL */
+    size_t cs_size; /* Size of memory file and mapping */
+    size_t cs_len;  /* Bytes written to mapping */
+};
+
+static int from_client_output(int s, void *arg);
+static int client_shm_create(cxobj *xreply, int32_t depth, size_t min, cbuf *cb, int *fd);
+static int client_output_add(struct client_entry *ce, cbuf *cb, int fd, int notify);
 
 /*! Stream callback for netconf stream notification (RFC 5277)
  * @param[in]  h     Clicon handle
@@ -101,24 +129,37 @@ ce_event_cb(clicon_handle h,
 	    cxobj        *event,
 	    void         *arg)
 {
+    int                  retval = -1;
     struct client_entry *ce = (struct client_entry *)arg;
+    cbuf                *cb = NULL;
     
     clicon_debug(1, "%s op:%d", __FUNCTION__, op);
     switch (op){
     case 1:
-	/* Risk of recursion here */
+	/* Subscription removed by stream, eg stoptime passed. Not called when the
+	 * client removes its own subscriptions, see stream_ss_delete_owner */
 	if (ce->ce_s)
 	    backend_client_rm(h, ce);
 	break;
     default:
-	if (send_msg_notify_xml(h, ce->ce_s, event) < 0){
-	    if (errno == ECONNRESET || errno == EPIPE){
-		clicon_log(LOG_WARNING, "client %d reset", ce->ce_nr);
-	    }
-	    break;
+	if ((cb = cbuf_new()) == NULL){
+	    clicon_err(OE_PLUGIN, errno, "cbuf_new");
+	    goto done;
+	}
+	if (clicon_xml2cbuf(cb, event, 0, 0, -1) < 0)
+	    goto done;
+	if (backend_client_send(ce, cb, 1) < 0){
+	    cb = NULL;
+	    goto done;
 	}
+	cb = NULL;
+	break;
     }
-    return 0;
+    retval = 0;
+ done:
+    if (cb)
+	cbuf_free(cb);
+    return retval;
 }
 
 /*! Remove client entry state
@@ -132,25 +173,21 @@ int
 backend_client_rm(clicon_handle        h, 
 		  struct client_entry *ce)
 {
-    struct client_entry   *c;
-    struct client_entry   *c0;
-    struct client_entry  **ce_prev;
-
     clicon_debug(1, "%s", __FUNCTION__);
-    /* for all streams: XXX better to do it top-level? */
-    stream_ss_delete_all(h, ce_event_cb, (void*)ce);
-    c0 = backend_client_list(h);
-    ce_prev = &c0; /* this points to stack and is not real backpointer */
-    for (c = *ce_prev; c; c = c->ce_next){
-	if (c == ce){
-	    if (ce->ce_s){
-		clixon_event_unreg_fd(ce->ce_s, from_client);
-		close(ce->ce_s);
-		ce->ce_s = 0;
-	    }
-	    break;
-	}
-	ce_prev = &c->ce_next;
+    /* Own subscriptions only, and without callback, ie no recursion via ce_event_cb */
+    stream_ss_delete_owner(h, &ce->ce_subscription);
+    backend_worker_detach(ce);
+    backend_sched_rm(ce);
+    /* Session may end without close-session: remove its private candidate, if any.
+     * Continue removing the client also if this fails */
+    privcand_free(h, ce->ce_id);
+    if (ce->ce_s){
+	if (!ce->ce_paused)
+	    clixon_event_unreg_fd(ce->ce_s, from_client);
+	if (ce->ce_out && !ce->ce_closing)
+	    clixon_event_unreg_fd_write(ce->ce_s, from_client_output);
+	close(ce->ce_s);
+	ce->ce_s = 0;
     }
     return backend_client_delete(h, ce); /* actually purge it */
 }
@@ -390,41 +427,333 @@ client_statedata(clicon_handle h,
     goto done;
 }
 
+/*! Parse reply encoding attributes of a get or get-config request
+ *
+ * Clixon extensions: encoding (xml|json) and pretty (true|false) attributes on 
+ * <get> and <get-config>
+ * @param[in]  xe      Request: <get> or <get-config>
+ * @retval     0       XML
+ * @retval     1       JSON
+ * @retval     2       Pretty-printed JSON
+ */
+static int
+client_encoding_parse(cxobj *xe)
+{
+    char *attr;
+
+    if ((attr = xml_find_value(xe, "encoding")) == NULL ||
+	strcmp(attr, "json") != 0)
+	return 0;
+    if ((attr = xml_find_value(xe, "pretty")) != NULL &&
+	strcmp(attr, "true") == 0)
+	return 2;
+    return 1;
+}
+
+/*! Make get or get-config reply of the RFC 7951 JSON encoding of a data tree
+ *
+ * The reply is not XML but a raw JSON payload: CLICON_MSG_JSON_MAGIC followed by
+ * the JSON text, which is empty if there is no data or xpath selects nothing.
+ * The JSON is thus neither escaped as XML character data here, nor parsed as XML 
+ * by the client.
+ * @param[in]  xt     Data tree, or NULL
+ * @param[in]  nsc    Namespace context of xpath
+ * @param[in]  xpath  XPath of request, or NULL
+ * @param[in]  pretty Pretty-print JSON
+ * @param[out] cbret  Reply
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @see xml2json_cbuf_xpath  Same encoding as restconf
+ * @see clicon_rpc_get_json  Client side
+ */
+static int
+client_get_json(cxobj *xt,
+		cvec  *nsc,
+		char  *xpath,
+		int    pretty,
+		cbuf  *cbret)
+{
+    cbuf_append_str(cbret, CLICON_MSG_JSON_MAGIC);
+    if (xt && xml2json_cbuf_xpath(cbret, xt, nsc, xpath, pretty) < 0)
+	return -1;
+    return 0;
+}
+
+/*! Make get or get-config reply of an XML tree
+ * If CLICON_BACKEND_REPLY_CHUNK is set or the client accepts a binary or shared 
+ * memory reply, the reply tree is handed over to be sent to the client, otherwise
+ * it is printed to cbret.
+ * If JSON is requested, the reply is the JSON encoding of the data in cbret, unless
+ * depth is limited, see client_get_json.
+ * @param[in]     h      Clicon handle
+ * @param[in]     ce     Client entry, or NULL if reply must be in cbret
+ * @param[in,out] xret   Data tree, or NULL. Set to NULL if taken over by ce
+ * @param[in]     depth  Nr of levels to print, -1 is all
+ * @param[in]     nsc    Namespace context of xpath
+ * @param[in]     xpath  XPath of request, or NULL
+ * @param[in]     json   0: XML, 1: JSON, 2: pretty-printed JSON, see client_encoding_parse
+ * @param[out]    cbret  Reply, if not streamed
+ * @retval        0      OK
+ * @retval       -1      Error
+ */
+static int
+client_get_reply(clicon_handle        h,
+		 struct client_entry *ce,
+		 cxobj              **xret,
+		 int32_t              depth,
+		 cvec                *nsc,
+		 char                *xpath,
+		 int                  json,
+		 cbuf                *cbret)
+{
+    int    retval = -1;
+    cxobj *xreply = NULL;
+
+    if (*xret && xml_name_set(*xret, "data") < 0)
+	goto done;
+    if (json && depth == -1){
+	if (client_get_json(*xret, nsc, xpath, json == 2, cbret) < 0)
+	    goto done;
+	goto ok;
+    }
+    if (*xret && ce && depth != 0 && !backend_worker_child() && 
+	(ce->ce_binary || ce->ce_shm ||
+	 clicon_option_int(h, "CLICON_BACKEND_REPLY_CHUNK") > 0)){
+	if ((xreply = xml_new("rpc-reply", NULL, CX_ELMNT)) == NULL)
+	    goto done;
+	if (xmlns_set(xreply, NULL, NETCONF_BASE_NAMESPACE) < 0)
+	    goto done;
+	if (xml_addsub(xreply, *xret) < 0)
+	    goto done;
+	*xret = NULL;
+	if (ce->ce_reply_xml)
+	    xml_free(ce->ce_reply_xml);
+	ce->ce_reply_xml = xreply;
+	/* Top levels are rpc-reply and data, so add 2 to depth if significant */
+	ce->ce_reply_depth = depth>0?depth+2:depth;
+	xreply = NULL;
+	goto ok;
+    }
+    cprintf(cbret, "<rpc-reply xmlns=\"%s\">", NETCONF_BASE_NAMESPACE);
+    if (*xret == NULL)
+	cprintf(cbret, "<data/>");
+    else{
+	/* Top level is data, so add 1 to depth if significant */
+	if (clicon_xml2cbuf(cbret, *xret, 0, 0, depth>0?depth+1:depth) < 0)
+	    goto done;
+    }
+    cprintf(cbret, "</rpc-reply>");
+ ok:
+    retval = 0;
+ done:
+    if (xreply)
+	xml_free(xreply);
+    return retval;
+}
+
+/*! Queue a whole reply XML tree to a client, in binary encoding if accepted
+ * @param[in]  ce     Client entry
+ * @param[in]  xreply Reply XML tree, consumed by this function (also on error)
+ * @param[in]  depth  Limit levels of child resources: -1 is all, see clixon_xml2bin
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @see backend_client_send_xml  XML text in frames
+ */
+static int
+client_send_tree(struct client_entry *ce,
+		 cxobj               *xreply,
+		 int32_t              depth)
+{
+    int      retval = -1;
+    cbuf    *cb = NULL;
+    uint32_t min;
+    int      fd = -1;
+    int      ret = 0;
+
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    min = clicon_option_int(ce->ce_handle, "CLICON_BACKEND_SHM_THRESHOLD");
+    if (ce->ce_binary){
+	if (clixon_xml2bin(cb, xreply, depth) < 0)
+	    goto done;
+	/* Pass large binary reply in shared memory if the client accepts it */
+	if (ce->ce_shm && min && cbuf_len(cb) + 1 >= min &&
+	    client_shm_create(NULL, 0, 0, cb, &fd) < 0)
+	    goto done;
+    }
+    else {
+	/* Print directly to shared memory if the client accepts it */
+	if (ce->ce_shm && min &&
+	    (ret = client_shm_create(xreply, depth, min, cb, &fd)) < 0)
+	    goto done;
+	if (ret == 0 && clicon_xml2cbuf(cb, xreply, 0, 0, depth) < 0)
+	    goto done;
+    }
+    retval = client_output_add(ce, cb, fd, 0); /* cb and fd consumed */
+    cb = NULL;
+ done:
+    if (cb)
+	cbuf_free(cb);
+    xml_free(xreply);
+    return retval;
+}
+
+/*! Parse list pagination attributes of a get or get-config request
+ *
+ * Clixon extensions: offset, limit, direction (forwards|backwards), where and
+ * cursor attributes on <get> and <get-config>
+ * @param[in]  xe      Request: <get> or <get-config>
+ * @param[out] pg      Pagination parameters, strings point into xe
+ * @param[out] paged   Set if any pagination attribute is given
+ * @param[out] cbret   Error reply if bad attribute
+ * @retval     1       OK
+ * @retval     0       Bad attribute, error reply in cbret
+ * @retval    -1       Error
+ */
+static int
+client_page_parse(cxobj       *xe,
+		  clixon_page *pg,
+		  int         *paged,
+		  cbuf        *cbret)
+{
+    int   retval = -1;
+    char *attr;
+    char *reason = NULL;
+    int   ret;
+
+    memset(pg, 0, sizeof(*pg));
+    *paged = 0;
+    if ((attr = xml_find_value(xe, "offset")) != NULL){
+	if ((ret = parse_uint32(attr, &pg->pg_offset, &reason)) < 0){
+	    clicon_err(OE_XML, errno, "parse_uint32");
+	    goto done;
+	}
+	if (ret == 0){
+	    if (netconf_bad_attribute(cbret, "application",
+				      "offset", "Unrecognized value of offset attribute") < 0)
+		goto done;
+	    goto fail;
+	}
+	*paged = 1;
+    }
+    if ((attr = xml_find_value(xe, "limit")) != NULL){
+	if ((ret = parse_uint32(attr, &pg->pg_limit, &reason)) < 0){
+	    clicon_err(OE_XML, errno, "parse_uint32");
+	    goto done;
+	}
+	if (ret == 0){
+	    if (netconf_bad_attribute(cbret, "application",
+				      "limit", "Unrecognized value of limit attribute") < 0)
+		goto done;
+	    goto fail;
+	}
+	*paged = 1;
+    }
+    if ((attr = xml_find_value(xe, "direction")) != NULL){
+	if (strcmp(attr, "backwards") == 0)
+	    pg->pg_backwards = 1;
+	else if (strcmp(attr, "forwards") != 0){
+	    if (netconf_bad_attribute(cbret, "application",
+				      "direction", "Unrecognized value of direction attribute") < 0)
+		goto done;
+	    goto fail;
+	}
+	*paged = 1;
+    }
+    if ((pg->pg_where = xml_find_value(xe, "where")) != NULL)
+	*paged = 1;
+    if ((pg->pg_cursor = xml_find_value(xe, "cursor")) != NULL)
+	*paged = 1;
+    retval = 1;
+ done:
+    if (reason)
+	free(reason);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Add next page cursor as attribute of reply data
+ * @param[in]  xret   Reply data tree
+ * @param[in]  next   Cursor of next page, or NULL
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+client_page_next(cxobj *xret,
+		 char  *next)
+{
+    cxobj *xa;
+
+    if (xret == NULL || next == NULL)
+	return 0;
+    if ((xa = xml_new("next-cursor", xret, CX_ATTR)) == NULL)
+	return -1;
+    if (xml_value_set(xa, next) < 0)
+	return -1;
+    return 0;
+}
+
 /*! Retrieve all or part of a specified configuration.
  * 
  * Function reused from both from_client_get() and from_client_get_config
+ * @param[in]  h       Clicon handle
+ * @param[in]  ce      Client entry, reply may be streamed to it
  * @param[in]  yspec
  * @param[in]  db
  * @param[in]  xpath
  * @param[in]  username
  * @param[in]  content
  * @param[in]  depth
+ * @param[in]  pg      List pagination parameters, or NULL
+ * @param[in]  json    Reply encoding, see client_encoding_parse
  * @param[out] cbret   Return xml tree, eg <rpc-reply>..., <rpc-error.. 
  * @retval     0       OK
  * @retval    -1       Error
  * @see from_client_get
  */
 static int
-client_get_config_only(clicon_handle h,
-		       cvec         *nsc,
-		       yang_stmt    *yspec,
-		       char         *db,
-		       char         *xpath,
-		       char         *username,
-		       int32_t       depth,
-		       cbuf         *cbret)
+client_get_config_only(clicon_handle        h,
+		       struct client_entry *ce,
+		       cvec                *nsc,
+		       yang_stmt           *yspec,
+		       char                *db,
+		       char                *xpath,
+		       char                *username,
+		       int32_t              depth,
+		       clixon_page         *pg,
+		       int                  json,
+		       cbuf                *cbret)
 {
     int     retval = -1;
     cxobj  *xret = NULL;
     cxobj  *xnacm = NULL;
     cxobj **xvec = NULL;
     size_t  xlen;    
+    char   *next = NULL;
+    int     ret;
 
     /* Note xret can be pruned by nacm below (and change name),
      * so zero-copy cant be used
      * Also, must use external namespace context here due to <filter stmt
      */
-    if (xmldb_get0(h, db, YB_MODULE, nsc, xpath, 1, &xret, NULL) < 0) {
+    if (pg != NULL){
+	if ((ret = xmldb_get_page(h, db, nsc, xpath, pg, username, &xret, &next)) < 0){
+	    if (netconf_operation_failed(cbret, "application", "read registry")< 0)
+		goto done;
+	    goto ok;
+	}
+	if (ret == 0){
+	    if (netconf_bad_attribute(cbret, "application",
+				      "cursor", "Invalid cursor") < 0)
+		goto done;
+	    goto ok;
+	}
+    }
+    else if (xmldb_get0(h, db, YB_MODULE, nsc, xpath, 1, &xret, NULL) < 0) {
 	if (netconf_operation_failed(cbret, "application", "read registry")< 0)
 	    goto done;
 	goto ok;
@@ -438,19 +767,15 @@ client_get_config_only(clicon_handle h,
 	if (nacm_datanode_read(h, xret, xvec, xlen, username, xnacm) < 0) 
 	    goto done;
     }
-    cprintf(cbret, "<rpc-reply xmlns=\"%s\">", NETCONF_BASE_NAMESPACE);
-    if (xret==NULL)
-	cprintf(cbret, "<data/>");
-    else{
-	if (xml_name_set(xret, "data") < 0)
-	    goto done;
-	if (clicon_xml2cbuf(cbret, xret, 0, 0, depth>0?depth+1:depth) < 0)
-	    goto done;
-    }
-    cprintf(cbret, "</rpc-reply>");
+    if (client_page_next(xret, next) < 0)
+	goto done;
+    if (client_get_reply(h, ce, &xret, depth, nsc, xpath, json, cbret) < 0)
+	goto done;
  ok:
     retval = 0;
  done:
+    if (next)
+	free(next);
     if (xvec)
 	free(xvec);
     if (xret)
@@ -477,6 +802,7 @@ from_client_get_config(clicon_handle h,
 		       void         *regarg)
 {
     int        retval = -1;
+    struct client_entry *ce = (struct client_entry *)arg;
     char      *db;
     cxobj     *xfilter;
     char      *xpath = NULL;
@@ -489,6 +815,8 @@ from_client_get_config(clicon_handle h,
     char      *attr;
     char      *xpath0;
     cvec      *nsc1 = NULL;
+    clixon_page pg;
+    int        paged = 0;
     
     username = clicon_username_get(h);
     if ((yspec =  clicon_dbspec_yang(h)) == NULL){
@@ -509,6 +837,13 @@ from_client_get_config(clicon_handle h,
 	    goto done;
 	goto ok;
     }
+    /* Private candidate: read this session's candidate */
+    if (strcmp(db, "candidate") == 0 && privcand_enabled(h)){
+	if ((ret = privcand_db(h, ce->ce_id, &db, cbret)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto ok;
+    }
     if ((xfilter = xml_find(xe, "filter")) != NULL){
 	if ((xpath0 = xml_find_value(xfilter, "select"))==NULL)
 	    xpath0="/";
@@ -539,7 +874,13 @@ from_client_get_config(clicon_handle h,
 	    goto ok;
 	}
     }
-    if ((ret = client_get_config_only(h, nsc, yspec, db, xpath, username, -1, cbret)) < 0)
+    /* Clixon extensions: list pagination */
+    if ((ret = client_page_parse(xe, &pg, &paged, cbret)) < 0)
+	goto done;
+    if (ret == 0)
+	goto ok;
+    if ((ret = client_get_config_only(h, ce, nsc, yspec, db, xpath, username, -1,
+				      paged?&pg:NULL, paged?0:client_encoding_parse(xe), cbret)) < 0)
 	goto done;
  ok:
     retval = 0;
@@ -587,6 +928,7 @@ from_client_edit_config(clicon_handle h,
     char               *attr;
     int                 autocommit = 0;
     char               *val = NULL;
+    int                 privcand;
 
     username = clicon_username_get(h);
     if ((yspec =  clicon_dbspec_yang(h)) == NULL){
@@ -608,8 +950,10 @@ from_client_edit_config(clicon_handle h,
 	    goto done;
 	goto ok;
     }
+    /* A private candidate is only edited by its own session, no lock needed */
+    privcand = strcmp(target, "candidate") == 0 && privcand_enabled(h);
     /* Check if target locked by other client */
-    iddb = xmldb_islocked(h, target);
+    iddb = privcand?0:xmldb_islocked(h, target);
     if (iddb && myid != iddb){
 	cprintf(cbx, "<session-id>%u</session-id>", iddb);
 	if (netconf_lock_denied(cbret, cbuf_get(cbx), "Operation failed, lock is already held") < 0)
@@ -666,7 +1010,11 @@ from_client_edit_config(clicon_handle h,
      */
     if (xml_sort_recurse(xc) < 0)
 	goto done;
-    if ((ret = xmldb_put(h, target, operation, xc, username, cbret)) < 0){
+    if (privcand)
+	ret = privcand_edit(h, myid, operation, xc, username, cbret);
+    else
+	ret = xmldb_put(h, target, operation, xc, username, cbret);
+    if (ret < 0){
 	clicon_debug(1, "%s ERROR PUT", __FUNCTION__);	
 	if (netconf_operation_failed(cbret, "protocol", clicon_err_reason)< 0)
 	    goto done;
@@ -674,13 +1022,30 @@ from_client_edit_config(clicon_handle h,
     }
     if (ret == 0)
 	goto ok;
-    xmldb_modified_set(h, target, 1); /* mark as dirty */
+    if (!privcand)
+	xmldb_modified_set(h, target, 1); /* mark as dirty */
     /* Clixon extension: autocommit */
     if ((attr = xml_find_value(xn, "autocommit")) != NULL &&
 	strcmp(attr,"true")==0)
 	autocommit = 1;
     /* If autocommit option is set or requested by client */
-    if (clicon_autocommit(h) || autocommit) {
+    if (privcand && (clicon_autocommit(h) || autocommit)) {
+	if ((ret = privcand_commit(h, myid, cbret)) < 0){
+	    if (netconf_operation_failed(cbret, "application", clicon_err_reason)< 0)
+		goto done;
+	    privcand_discard(h, myid);
+	    goto ok;
+	}
+	if (ret == 0){ /* discard */
+	    if (privcand_discard(h, myid) < 0){
+		if (netconf_operation_failed(cbret, "application", clicon_err_reason)< 0)
+		    goto done;
+		goto ok;
+	    }
+	    goto ok;
+	}
+    }
+    else if (clicon_autocommit(h) || autocommit) {
 	if ((ret = candidate_commit(h, "candidate", cbret)) < 0){ /* Assume validation fail, nofatal */
 	    if (netconf_operation_failed(cbret, "application", clicon_err_reason)< 0)
 		goto done;
@@ -749,6 +1114,7 @@ from_client_copy_config(clicon_handle h,
     uint32_t iddb;
     uint32_t myid = ce->ce_id;
     cbuf    *cbx = NULL; /* Assist cbuf */
+    int      ret;
     
     if ((source = netconf_db_find(xe, "source")) == NULL){
 	if (netconf_missing_element(cbret, "protocol", "source", NULL) < 0)
@@ -784,6 +1150,25 @@ from_client_copy_config(clicon_handle h,
 	    goto done;
 	goto ok;
     }
+    if (privcand_enabled(h)){
+	if (strcmp(source, "candidate") == 0){
+	    if ((ret = privcand_db(h, myid, &source, cbret)) < 0)
+		goto done;
+	    if (ret == 0)
+		goto ok;
+	}
+	if (strcmp(target, "candidate") == 0){
+	    if ((ret = privcand_replace(h, myid, source, clicon_username_get(h), cbret)) < 0){
+		if (netconf_operation_failed(cbret, "application", clicon_err_reason)< 0)
+		    goto done;
+		goto ok;
+	    }
+	    if (ret == 0)
+		goto ok;
+	    cprintf(cbret, "<rpc-reply xmlns=\"%s\"><ok/></rpc-reply>", NETCONF_BASE_NAMESPACE);
+	    goto ok;
+	}
+    }
     if (xmldb_copy(h, source, target) < 0){
 	if (netconf_operation_failed(cbret, "application", clicon_err_reason)< 0)
 	    goto done;
@@ -821,6 +1206,7 @@ from_client_delete_config(clicon_handle h,
     uint32_t             iddb;
     uint32_t             myid = ce->ce_id;
     cbuf                *cbx = NULL; /* Assist cbuf */
+    int                  ret;
 
     if ((target = netconf_db_find(xe, "target")) == NULL ||
 	strcmp(target, "running")==0){
@@ -846,6 +1232,17 @@ from_client_delete_config(clicon_handle h,
 	    goto done;
 	goto ok;
     }
+    if (strcmp(target, "candidate") == 0 && privcand_enabled(h)){
+	if ((ret = privcand_replace(h, myid, NULL, clicon_username_get(h), cbret)) < 0){
+	    if (netconf_operation_failed(cbret, "protocol", clicon_err_reason)< 0)
+		goto done;
+	    goto ok;
+	}
+	if (ret == 0)
+	    goto ok;
+	cprintf(cbret, "<rpc-reply xmlns=\"%s\"><ok/></rpc-reply>", NETCONF_BASE_NAMESPACE);
+	goto ok;
+    }
     if (xmldb_delete(h, target) < 0){
 	if (netconf_operation_failed(cbret, "protocol", clicon_err_reason)< 0)
 	    goto done;
@@ -905,6 +1302,11 @@ from_client_lock(clicon_handle h,
 	    goto done;
 	goto ok;
     }
+    /* A private candidate is implicitly locked by its session */
+    if (strcmp(db, "candidate") == 0 && privcand_enabled(h)){
+	cprintf(cbret, "<rpc-reply xmlns=\"%s\"><ok/></rpc-reply>", NETCONF_BASE_NAMESPACE);
+	goto ok;
+    }
     /*
      * A lock MUST not be granted if either of the following conditions is true:
      * 1) A lock is already held by any NETCONF session or another entity.
@@ -975,6 +1377,10 @@ from_client_unlock(clicon_handle h,
 	    goto done;
 	goto ok;
     }
+    if (strcmp(db, "candidate") == 0 && privcand_enabled(h)){
+	cprintf(cbret, "<rpc-reply xmlns=\"%s\"><ok/></rpc-reply>", NETCONF_BASE_NAMESPACE);
+	goto ok;
+    }
     iddb = xmldb_islocked(h, db);
     /* 
      * An unlock operation will not succeed if any of the following
@@ -1045,6 +1451,11 @@ from_client_get(clicon_handle h,
     cxobj          *xerr = NULL;
     int             ret;
     char           *reason = NULL;
+    struct client_entry *ce = (struct client_entry *)arg;
+    clixon_page     pg;
+    int             paged = 0;
+    char           *next = NULL;
+    int             json;
     
     clicon_debug(1, "%s", __FUNCTION__);
     username = clicon_username_get(h);
@@ -1086,8 +1497,16 @@ from_client_get(clicon_handle h,
 	    goto ok;
 	}
     }
+    /* Clixon extensions: list pagination */
+    if ((ret = client_page_parse(xe, &pg, &paged, cbret)) < 0)
+	goto done;
+    if (ret == 0)
+	goto ok;
+    /* Clixon extensions: reply encoding, paged replies are XML */
+    json = paged?0:client_encoding_parse(xe);
     if (content == CONTENT_CONFIG){ /* config only, no state */
-	if (client_get_config_only(h, nsc, yspec, "running", xpath, username, depth, cbret) < 0)
+	if (client_get_config_only(h, ce, nsc, yspec, "running", xpath, username, depth,
+				   paged?&pg:NULL, json, cbret) < 0)
 	    goto done;
 	goto ok;
     }
@@ -1158,8 +1577,30 @@ from_client_get(clicon_handle h,
     /* Code complex to filter out anything that is outside of xpath 
      * Actually this is a safety catch, should really be done in plugins
      * and modules_state functions.
+     * If paged, only the entries of the page are kept
      */
-    if (xpath_vec(xret, nsc, "%s", &xvec, &xlen, xpath?xpath:"/") < 0)
+    xnacm = clicon_nacm_cache(h);
+    if (paged){
+	/* Entries the user may not read are not counted by offset and limit, and
+	 * not used as cursor: NACM read validation before the page is selected */
+	if (xnacm != NULL){
+	    if (xpath_vec(xret, nsc, "%s", &xvec, &xlen, xpath?xpath:"/") < 0)
+		goto done;
+	    if (nacm_datanode_read(h, xret, xvec, xlen, username, xnacm) < 0) 
+		goto done;
+	    free(xvec);
+	    xvec = NULL;
+	}
+	if ((ret = clixon_page_select(xret, nsc, xpath, &pg, &xvec, &xlen, &next)) < 0)
+	    goto done;
+	if (ret == 0){
+	    if (netconf_bad_attribute(cbret, "application",
+				      "cursor", "Invalid cursor") < 0)
+		goto done;
+	    goto ok;
+	}
+    }
+    else if (xpath_vec(xret, nsc, "%s", &xvec, &xlen, xpath?xpath:"/") < 0)
 	goto done;
     /* If vectors are specified then mark the nodes found and
      * then filter out everything else,
@@ -1169,43 +1610,42 @@ from_client_get(clicon_handle h,
 	for (i=0; i<xlen; i++)
 	    xml_flag_set(xvec[i], XML_FLAG_MARK);
     }
-    if (xvec){
-	free(xvec);
-	xvec = NULL;
-    }
 
     /* Remove everything that is not marked */
     if (!xml_flag(xret, XML_FLAG_MARK))
 	if (xml_tree_prune_flagged_sub(xret, XML_FLAG_MARK, 1, NULL) < 0)
 	    goto done;
+    /* A backwards page is returned in page order: move entries last in turn */
+    if (paged && pg.pg_backwards)
+	for (i=0; i<xlen; i++)
+	    if (xml_addsub(xml_parent(xvec[i]), xvec[i]) < 0)
+		goto done;
+    if (xvec){
+	free(xvec);
+	xvec = NULL;
+    }
     /* reset flag */
     if (xml_apply(xret, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset, (void*)XML_FLAG_MARK) < 0)
 	goto done;
 
-    /* Pre-NACM access step */
-    xnacm = clicon_nacm_cache(h);
-    if (xnacm != NULL){ /* Do NACM validation */
+    /* Pre-NACM access step, if paged already done */
+    if (xnacm != NULL && !paged){ /* Do NACM validation */
 	if (xpath_vec(xret, nsc, "%s", &xvec, &xlen, xpath?xpath:"/") < 0)
 	    goto done;
 	/* NACM datanode/module read validation */
 	if (nacm_datanode_read(h, xret, xvec, xlen, username, xnacm) < 0) 
 	    goto done;
     }
-    cprintf(cbret, "<rpc-reply xmlns=\"%s\">", NETCONF_BASE_NAMESPACE);     /* OK */
-    if (xret==NULL)
-	cprintf(cbret, "<data/>");
-    else{
-	if (xml_name_set(xret, "data") < 0)
-	    goto done;
-	/* Top level is data, so add 1 to depth if significant */
-	if (clicon_xml2cbuf(cbret, xret, 0, 0, depth>0?depth+1:depth) < 0)
-	    goto done;
-    }
-    cprintf(cbret, "</rpc-reply>");
+    if (client_page_next(xret, next) < 0)
+	goto done;
+    if (client_get_reply(h, ce, &xret, depth, nsc, xpath, json, cbret) < 0)
+	goto done;
  ok:
     retval = 0;
  done:
     clicon_debug(1, "%s retval:%d", __FUNCTION__, retval);
+    if (next)
+	free(next);
     if (reason)
 	free(reason);
     if (xerr)
@@ -1241,7 +1681,9 @@ from_client_close_session(clicon_handle h,
     uint32_t             id = ce->ce_id;
 
     xmldb_unlock_all(h, id);
-    stream_ss_delete_all(h, ce_event_cb, (void*)ce);
+    stream_ss_delete_owner(h, &ce->ce_subscription);
+    if (privcand_free(h, id) < 0)
+	return -1;
     cprintf(cbret, "<rpc-reply xmlns=\"%s\"><ok/></rpc-reply>", NETCONF_BASE_NAMESPACE);
     return 0;
 }
@@ -1288,12 +1730,14 @@ from_client_kill_session(clicon_handle h,
 	goto done;
     }
     /* may or may not be in active client list, probably not */
-    if ((ce = ce_find_byid(backend_client_list(h), id)) != NULL){
+    if ((ce = backend_client_find(h, id)) != NULL){
 	xmldb_unlock_all(h, id);
 	backend_client_rm(h, ce);
     }
     if (xmldb_islocked(h, db) == id)
 	xmldb_unlock(h, db);
+    if (privcand_free(h, id) < 0)
+	goto done;
     cprintf(cbret, "<rpc-reply xmlns=\"%s\"><ok/></rpc-reply>", NETCONF_BASE_NAMESPACE);
  ok:
     retval = 0;
@@ -1339,6 +1783,7 @@ from_client_create_subscription(clicon_handle h,
     struct timeval       start;
     struct timeval       stop;
     cvec                *nsc = NULL;
+    struct stream_subscription *ss;
     
     if ((nsc = xml_nsctx_init(NULL, EVENT_RFC5277_NAMESPACE)) == NULL)
 	goto done;
@@ -1378,10 +1823,11 @@ from_client_create_subscription(clicon_handle h,
 	goto ok;
     }
     /* Add subscriber to stream - to make notifications for this client */
-    if (stream_ss_add(h, stream, selector,
-		      starttime?&start:NULL, stoptime?&stop:NULL,
-		      ce_event_cb, (void*)ce) < 0)
+    if ((ss = stream_ss_add(h, stream, selector,
+			    starttime?&start:NULL, stoptime?&stop:NULL,
+			    ce_event_cb, (void*)ce)) == NULL)
 	goto done;
+    stream_ss_owner(ss, &ce->ce_subscription);
     /* Replay of this stream to specific subscription according to start and 
      * stop (if present). 
      * RFC 5277: If <startTime> is not present, this is not a replay
@@ -1487,6 +1933,8 @@ from_client_stats(clicon_handle h,
 	goto done;
     if (clixon_stats_get_db(h, "startup", cbret) < 0)
 	goto done;
+    if (clixon_statedata_cache_stats(h, cbret) < 0)
+	goto done;
     cprintf(cbret, "</rpc-reply>");
     retval = 0;
  done:
@@ -1540,7 +1988,8 @@ from_client_restart_plugin(clicon_handle h,
     return retval;
 }
 
-/*!
+/*! Internal hello from client: assign session-id
+ * If the client has binary encoding as capability, announce that it is supported.
  * @retval     0       OK
  * @retval    -1       Error
  */
@@ -1553,6 +2002,10 @@ from_client_hello(clicon_handle       h,
 {
     int      retval = -1;
     uint32_t id;
+    cxobj   *xcaps;
+    cxobj   *xc = NULL;
+    char    *b;
+    int      binary = 0;
 
     if (clicon_session_id_get(h, &id) < 0){
 	clicon_err(OE_NETCONF, ENOENT, "session_id not set");
@@ -1560,8 +2013,16 @@ from_client_hello(clicon_handle       h,
     }
     id++;
     clicon_session_id_set(h, id);
-    cprintf(cbret, "<hello xmlns=\"%s\"><session-id>%u</session-id></hello>",
-	    NETCONF_BASE_NAMESPACE, id);
+    if ((xcaps = xml_find_type(x, NULL, "capabilities", CX_ELMNT)) != NULL)
+	while ((xc = xml_child_each(xcaps, xc, CX_ELMNT)) != NULL)
+	    if ((b = xml_body(xc)) != NULL && strcmp(b, CLIXON_BINARY_CAPABILITY) == 0)
+		binary++;
+    cprintf(cbret, "<hello xmlns=\"%s\">", NETCONF_BASE_NAMESPACE);
+    /* Replies may be binary encoded, see CLICON_MSG_BINARY */
+    if (binary)
+	cprintf(cbret, "<capabilities><capability>%s</capability></capabilities>",
+		CLIXON_BINARY_CAPABILITY);
+    cprintf(cbret, "<session-id>%u</session-id></hello>", id);
     retval = 0;
  done:
     return retval;
@@ -1594,6 +2055,7 @@ from_client_msg(clicon_handle        h,
     yang_stmt           *ymod;
     cxobj               *xnacm = NULL;
     cxobj               *xret = NULL;
+    cxobj               *xreply;
     uint32_t             id;
     enum nacm_credentials_t creds;
     char                *rpcname;
@@ -1674,7 +2136,7 @@ from_client_msg(clicon_handle        h,
 	    goto done;
 	goto reply;
     }
-    ce->ce_id = id;
+    backend_client_id_set(h, ce, id);
     if ((ret = xml_yang_validate_rpc(h, x, &xret)) < 0)
 	goto done;
     if (ret == 0){
@@ -1682,6 +2144,11 @@ from_client_msg(clicon_handle        h,
 	    goto done;
 	goto reply;
     }
+    /* Read-only request may be served by a worker which replies instead */
+    if ((ret = backend_worker_start(h, ce, x)) < 0)
+	goto done;
+    if (ret == 1)
+	goto ok;
     xe = NULL;
     username = xml_find_value(x, "username");
     /* May be used by callbacks, etc */
@@ -1720,7 +2187,7 @@ from_client_msg(clicon_handle        h,
 	    if (ret == 0) /* credentials fail */
 		goto reply;
 	    /* NACM rpc operation exec validation */
-	    if ((ret = nacm_rpc(rpc, module, username, xnacm, cbret)) < 0)
+	    if ((ret = nacm_rpc(h, rpc, module, username, xnacm, cbret)) < 0)
 		goto done;
 	    if (ret == 0) /* Not permitted and cbret set */
 		goto reply;
@@ -1745,33 +2212,44 @@ from_client_msg(clicon_handle        h,
 	}
     } /* while */
  reply:
+    /* Reply tree from get or get-config is sent whole if binary encoded or in shared
+     * memory, otherwise streamed, unless an error reply is made */
+    if (ce->ce_reply_xml){
+	if (cbuf_len(cbret) == 0){
+	    xreply = ce->ce_reply_xml;
+	    ce->ce_reply_xml = NULL;
+	    if (ce->ce_binary || ce->ce_shm){
+		if (client_send_tree(ce, xreply, ce->ce_reply_depth) < 0)
+		    goto done;
+	    }
+	    else if (backend_client_send_xml(ce, xreply, ce->ce_reply_depth) < 0)
+		goto done;
+	    goto ok;
+	}
+	xml_free(ce->ce_reply_xml);
+	ce->ce_reply_xml = NULL;
+    }
     if (cbuf_len(cbret) == 0)
 	if (netconf_operation_failed(cbret, "application", clicon_errno?clicon_err_reason:"unknown")< 0)
 	    goto done;
     clicon_debug(1, "%s cbret:%s", __FUNCTION__, cbuf_get(cbret));
     /* XXX problem here is that cbret has not been parsed so may contain 
        parse errors */
-    if (send_msg_reply(ce->ce_s, cbuf_get(cbret), cbuf_len(cbret)+1) < 0){
-	switch (errno){
-	case EPIPE:
-	    /* man (2) write: 
-	     * EPIPE  fd is connected to a pipe or socket whose reading end is 
-	     * closed.  When this happens the writing process will also receive 
-	     * a SIGPIPE signal. 
-	     * In Clixon this means a client, eg restconf, netconf or cli closes
-	     * the (UNIX domain) socket.
-	     */
-	case ECONNRESET:
-	    clicon_log(LOG_WARNING, "client rpc reset");
-	    break;
-	default:
-	    goto done;
-	}
+    if (backend_worker_child())
+	backend_worker_reply(cbret); /* Does not return */
+    if (backend_client_send(ce, cbret, 0) < 0){
+	cbret = NULL;
+	goto done;
     }
-    // ok:
+    cbret = NULL;
+ ok:
     retval = 0;
   done:  
     clicon_debug(1, "%s retval:%d", __FUNCTION__, retval);
+    if (ce->ce_reply_xml){ /* Not sent due to error */
+	xml_free(ce->ce_reply_xml);
+	ce->ce_reply_xml = NULL;
+    }
     if (xnacm){
 	xml_free(xnacm);
 	if (clicon_nacm_cache_set(h, NULL) < 0)
@@ -1788,10 +2266,724 @@ from_client_msg(clicon_handle        h,
 	clicon_log(LOG_NOTICE, "%s: Internal error: No clicon_err call on RPC error (message: %s)",
 		   __FUNCTION__, rpc?rpc:"");
     //    clicon_debug(1, "%s retval:%d", __FUNCTION__, retval);
+    if (backend_worker_child()) /* Error in worker */
+	backend_worker_reply(NULL);
     return retval;// -1 here terminates backend
 }
 
-/*! An internal clicon message has arrived from a client. Receive and dispatch.
+/*! Free output queue of a client
+ * @param[in]  ce   Client entry
+ */
+int
+backend_client_output_free(struct client_entry *ce)
+{
+    struct client_output *co;
+
+    while ((co = ce->ce_out) != NULL){
+	ce->ce_out = co->co_next;
+	if (co->co_cb)
+	    cbuf_free(co->co_cb);
+	if (co->co_stream)
+	    xml_stream_free(co->co_stream);
+	if (co->co_xml)
+	    xml_free(co->co_xml);
+	if (co->co_fd != -1)
+	    close(co->co_fd);
+	free(co);
+    }
+    ce->ce_outlast = NULL;
+    ce->ce_outoff = 0;
+    ce->ce_outlen = 0;
+    return 0;
+}
+
+/*! Stop all output to a client after a send error, and wait for eof
+ * Queued output is discarded and the socket is shut down. The client entry is
+ * removed when eof is read, since it is unsafe to remove it here: this may be
+ * called from within request processing or stream notification of the client.
+ * @param[in]  ce   Client entry
+ */
+static int
+client_output_close(struct client_entry *ce)
+{
+    if (ce->ce_out && !ce->ce_closing)
+	clixon_event_unreg_fd_write(ce->ce_s, from_client_output);
+    ce->ce_closing = 1;
+    backend_client_output_free(ce);
+    shutdown(ce->ce_s, SHUT_RDWR);
+    if (ce->ce_paused){
+	ce->ce_paused = 0;
+	if (clixon_event_reg_fd(ce->ce_s, from_client, (void*)ce, "local netconf client socket") < 0)
+	    return -1;
+    }
+    return 0;
+}
+
+/*! Print next chunk of a streamed reply as a frame
+ * All frames but the last have the CLICON_MSG_MORE flag set
+ * @param[in]  h    Clicon handle
+ * @param[in]  ce   Client entry
+ * @param[in]  co   Streamed reply in output queue
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+client_output_chunk(clicon_handle         h,
+		    struct client_entry  *ce,
+		    struct client_output *co)
+{
+    int ret;
+
+    cbuf_reset(co->co_cb);
+    if ((ret = xml_stream_cbuf(co->co_stream, co->co_cb,
+			       clicon_option_int(h, "CLICON_BACKEND_REPLY_CHUNK"))) < 0)
+	return -1;
+    if (ret == 0){ /* Last frame */
+	xml_stream_free(co->co_stream);
+	co->co_stream = NULL;
+	xml_free(co->co_xml);
+	co->co_xml = NULL;
+	co->co_len = sizeof(co->co_hdr) + cbuf_len(co->co_cb) + 1; /* Include null-termination */
+	co->co_hdr[0] = htonl(co->co_len);
+    }
+    else{
+	co->co_len = sizeof(co->co_hdr) + cbuf_len(co->co_cb);
+	co->co_hdr[0] = htonl(co->co_len | CLICON_MSG_MORE);
+    }
+    ce->ce_outlen += co->co_len;
+    return 0;
+}
+
+/*! Write as much as possible of the output queue of a client without blocking
+ * Several queued messages are written in one call using a scatter/gather vector.
+ * A streamed reply is printed one frame at a time when the previous frame has
+ * been written, later messages wait until all of it is written. With 
+ * CLICON_BACKEND_SCHEDULER, at most one frame is printed in each call.
+ * @param[in]  ce   Client entry
+ * @retval     0    OK, ce_out is NULL if all is written
+ * @retval    -1    Error
+ */
+static int
+client_output_flush(struct client_entry *ce)
+{
+    struct iovec          iov[2*CLIENT_IOV_MAX];
+    struct msghdr         mh = {0,};
+    struct cmsghdr       *cmsg;
+    char                  ctrl[CMSG_SPACE(sizeof(int))];
+    struct client_output *co;
+    size_t                off;
+    size_t                hlen;
+    ssize_t               n;
+    int                   yield;
+    int                   frames = 0;
+
+    yield = clicon_option_bool(ce->ce_handle, "CLICON_BACKEND_SCHEDULER");
+    while (ce->ce_out != NULL){
+	mh.msg_iov = iov;
+	mh.msg_iovlen = 0;
+	mh.msg_control = NULL;
+	mh.msg_controllen = 0;
+	off = ce->ce_outoff;
+	for (co = ce->ce_out; co && mh.msg_iovlen+2 <= 2*CLIENT_IOV_MAX; co = co->co_next){
+	    if (co->co_stream && co->co_len == 0){
+		/* Print one frame per output event, to let other requests in */
+		if (yield && frames > 0)
+		    break;
+		if (client_output_chunk(ce->ce_handle, ce, co) < 0)
+		    return -1;
+		frames++;
+	    }
+	    /* A file descriptor is received with the first byte of a write, so the 
+	     * message passing it must start a write */
+	    if (co->co_fd != -1){
+		if (mh.msg_iovlen > 0)
+		    break;
+		memset(ctrl, 0, sizeof(ctrl));
+		mh.msg_control = ctrl;
+		mh.msg_controllen = sizeof(ctrl);
+		cmsg = CMSG_FIRSTHDR(&mh);
+		cmsg->cmsg_level = SOL_SOCKET;
+		cmsg->cmsg_type = SCM_RIGHTS;
+		cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+		memcpy(CMSG_DATA(cmsg), &co->co_fd, sizeof(int));
+	    }
+	    hlen = sizeof(co->co_hdr);
+	    if (off < hlen){
+		iov[mh.msg_iovlen].iov_base = (char*)co->co_hdr + off;
+		iov[mh.msg_iovlen++].iov_len = hlen - off;
+		off = 0;
+	    }
+	    else
+		off -= hlen;
+	    iov[mh.msg_iovlen].iov_base = cbuf_get(co->co_cb) + off;
+	    iov[mh.msg_iovlen++].iov_len = co->co_len - hlen - off;
+	    off = 0;
+	    if (co->co_stream) /* More frames of this message follow */
+		break;
+	}
+	if (mh.msg_iovlen == 0) /* Yield, next frame is printed on next output event */
+	    break;
+	/* As writev but without SIGPIPE if the client has closed the socket */
+	if ((n = sendmsg(ce->ce_s, &mh, CLIENT_MSG_NOSIGNAL)) < 0){
+	    if (errno == EINTR)
+		continue;
+	    if (errno == EAGAIN || errno == EWOULDBLOCK)
+		break;
+	    if (errno == EPIPE || errno == ECONNRESET){
+		/* In Clixon this means a client, eg restconf, netconf or cli 
+		 * closes the (UNIX domain) socket. */
+		clicon_log(LOG_WARNING, "client %d reset", ce->ce_nr);
+		return client_output_close(ce);
+	    }
+	    clicon_err(OE_PROTO, errno, "sendmsg");
+	    return -1;
+	}
+	ce->ce_outlen -= n;
+	n += ce->ce_outoff;
+	if (mh.msg_control){ /* Passed, the client has its own reference */
+	    close(ce->ce_out->co_fd);
+	    ce->ce_out->co_fd = -1;
+	}
+	while ((co = ce->ce_out) != NULL && n >= co->co_len){
+	    n -= co->co_len;
+	    if (co->co_stream){ /* Frame written, print next */
+		co->co_len = 0;
+		break;
+	    }
+	    ce->ce_out = co->co_next;
+	    ce->ce_stat_out++;
+	    cbuf_free(co->co_cb);
+	    free(co);
+	}
+	if (ce->ce_out == NULL)
+	    ce->ce_outlast = NULL;
+	ce->ce_outoff = n;
+    }
+    return 0;
+}
+
+/*! Append a message to the output queue of a client, and send if queue was empty
+ * @param[in]  ce   Client entry
+ * @param[in]  co   Message
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+client_output_queue(struct client_entry  *ce,
+		    struct client_output *co)
+{
+    if (ce->ce_outlast)
+	ce->ce_outlast->co_next = co;
+    else
+	ce->ce_out = co;
+    ce->ce_outlast = co;
+    /* If queue was empty, try to send directly, otherwise wait for output event */
+    if (ce->ce_out == co){
+	if (client_output_flush(ce) < 0)
+	    return -1;
+	if (ce->ce_out != NULL &&
+	    clixon_event_reg_fd_write(ce->ce_s, from_client_output, (void*)ce,
+				      "local netconf client output") < 0)
+	    return -1;
+    }
+    return 0;
+}
+
+#ifdef HAVE_MEMFD_CREATE
+/*! Extend a shared memory reply to hold len more bytes
+ * The memory file is extended with ftruncate, at least doubling its size, and
+ * mapped anew. The contents are kept in the file.
+ * @param[in]  cs   Shared memory reply
+ * @param[in]  len  Number of bytes to add
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+client_shm_reserve(struct client_shm *cs,
+		   size_t             len)
+{
+    size_t size;
+    void  *map;
+
+    if (cs->cs_len + len <= cs->cs_size)
+	return 0;
+    size = cs->cs_size ? 2*cs->cs_size : CLIENT_SHM_SIZE;
+    while (size < cs->cs_len + len)
+	size *= 2;
+    if (ftruncate(cs->cs_fd, size) < 0){
+	clicon_err(OE_UNIX, errno, "ftruncate");
+	return -1;
+    }
+    if (cs->cs_map){
+	munmap(cs->cs_map, cs->cs_size);
+	cs->cs_map = NULL;
+    }
+    if ((map = mmap(NULL, size, PROT_READ|PROT_WRITE, MAP_SHARED, cs->cs_fd, 0)) == MAP_FAILED){
+	clicon_err(OE_UNIX, errno, "mmap");
+	return -1;
+    }
+    cs->cs_map = map;
+    cs->cs_size = size;
+    return 0;
+}
+
+/*! Write callback appending to a shared memory reply, see clicon_xml2write_cb
+ * @param[in]  arg  Shared memory reply (struct client_shm)
+ * @param[in]  buf  Bytes to append
+ * @param[in]  len  Number of bytes
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+client_shm_write(void       *arg,
+		 const char *buf,
+		 size_t      len)
+{
+    struct client_shm *cs = (struct client_shm *)arg;
+
+    if (client_shm_reserve(cs, len) < 0)
+	return -1;
+    memcpy(cs->cs_map + cs->cs_len, buf, len);
+    cs->cs_len += len;
+    return 0;
+}
+#endif /* HAVE_MEMFD_CREATE */
+
+/*! Put a reply in shared memory and replace it with a descriptor
+ * The memory file is extended with ftruncate and mapped, and the reply tree is 
+ * printed straight into the mapping. Then the file is truncated to the length 
+ * of the reply and sealed, so that the client can map it read-only.
+ * @param[in]     xreply Reply XML tree, or NULL if the reply is the text in cb
+ * @param[in]     depth  Limit levels of child resources of xreply, see clicon_xml2cbuf
+ * @param[in]     min    Reply tree shorter than this is put in cb as text instead
+ * @param[in,out] cb     Reply body: struct clicon_msg_shm if in shared memory
+ * @param[out]    fd     Shared memory file descriptor, or -1 if reply is text in cb
+ * @retval        1      OK, reply in cb
+ * @retval        0      Shared memory not supported, cb unchanged
+ * @retval       -1      Error
+ */
+static int
+client_shm_create(cxobj  *xreply,
+		  int32_t depth,
+		  size_t  min,
+		  cbuf   *cb,
+		  int    *fd)
+{
+#ifdef HAVE_MEMFD_CREATE
+    int                   retval = -1;
+    struct client_shm     cs = {-1, NULL, 0, 0};
+    struct clicon_msg_shm ms;
+
+    *fd = -1;
+    if ((cs.cs_fd = memfd_create("clixon-reply", MFD_CLOEXEC|MFD_ALLOW_SEALING)) < 0){
+	if (errno == ENOSYS){ /* Send on socket instead */
+	    retval = 0;
+	    goto done;
+	}
+	clicon_err(OE_UNIX, errno, "memfd_create");
+	goto done;
+    }
+    if (xreply){
+	if (clicon_xml2write_cb(xreply, 0, 0, depth, client_shm_write, &cs) < 0)
+	    goto done;
+    }
+    else if (client_shm_write(&cs, cbuf_get(cb), cbuf_len(cb)) < 0)
+	goto done;
+    if (client_shm_write(&cs, "", 1) < 0) /* Include null-termination */
+	goto done;
+    if (xreply && cs.cs_len < min){ /* Short reply: send on socket */
+	if (cbuf_append_buf(cb, cs.cs_map, cs.cs_len - 1) < 0){
+	    clicon_err(OE_UNIX, errno, "cbuf_append_buf");
+	    goto done;
+	}
+	goto ok;
+    }
+    munmap(cs.cs_map, cs.cs_size);
+    cs.cs_map = NULL;
+    if (ftruncate(cs.cs_fd, cs.cs_len) < 0){
+	clicon_err(OE_UNIX, errno, "ftruncate");
+	goto done;
+    }
+#ifdef F_ADD_SEALS
+    if (fcntl(cs.cs_fd, F_ADD_SEALS, F_SEAL_SHRINK|F_SEAL_GROW|F_SEAL_WRITE|F_SEAL_SEAL) < 0){
+	clicon_err(OE_UNIX, errno, "fcntl F_ADD_SEALS");
+	goto done;
+    }
+#endif
+    memcpy(ms.ms_magic, CLICON_MSG_SHM_MAGIC, sizeof(ms.ms_magic));
+    ms.ms_len = htonl(cs.cs_len);
+    cbuf_reset(cb);
+    cbuf_append_buf(cb, &ms, sizeof(ms));
+    clicon_debug(1, "%s reply len=%zu in shared memory", __FUNCTION__, cs.cs_len);
+    *fd = cs.cs_fd;
+    cs.cs_fd = -1;
+ ok:
+    retval = 1;
+ done:
+    if (cs.cs_map)
+	munmap(cs.cs_map, cs.cs_size);
+    if (cs.cs_fd != -1)
+	close(cs.cs_fd);
+    return retval;
+#else /* HAVE_MEMFD_CREATE */
+    *fd = -1; /* Send on socket instead */
+    return 0;
+#endif /* HAVE_MEMFD_CREATE */
+}
+
+/*! Queue a message to a client and send as much as possible
+ * @param[in]  ce     Client entry
+ * @param[in]  cb     Message body, consumed by this function (also on error)
+ * @param[in]  fd     Shared memory passed with message, or -1. Closed on error
+ * @param[in]  notify Set if notification, otherwise reply
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @see backend_client_send
+ */
+static int
+client_output_add(struct client_entry *ce,
+		  cbuf                *cb,
+		  int                  fd,
+		  int                  notify)
+{
+    int                   retval = -1;
+    struct client_output *co;
+    uint32_t              max;
+
+    if (ce->ce_closing || ce->ce_s == 0){
+	cbuf_free(cb);
+	if (fd != -1)
+	    close(fd);
+	return 0;
+    }
+    max = clicon_option_int(ce->ce_handle, "CLICON_BACKEND_OUTPUT_MAX");
+    if (notify && max && ce->ce_outlen >= max){
+	clicon_log(LOG_WARNING, "client %d output queue full (%zu bytes), closing", 
+		   ce->ce_nr, ce->ce_outlen);
+	cbuf_free(cb);
+	return client_output_close(ce);
+    }
+    if ((co = malloc(sizeof(*co))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	cbuf_free(cb);
+	if (fd != -1)
+	    close(fd);
+	goto done;
+    }
+    memset(co, 0, sizeof(*co));
+    co->co_fd = fd;
+    co->co_cb = cb;
+    co->co_len = sizeof(co->co_hdr) + cbuf_len(cb) + 1; /* Include null-termination */
+    co->co_hdr[0] = htonl(co->co_len); /* op_len */
+    co->co_hdr[1] = 0;                 /* op_id */
+    clicon_debug(2, "%s: queue msg len=%zu", __FUNCTION__, co->co_len);
+    ce->ce_outlen += co->co_len;
+    if (client_output_queue(ce, co) < 0)
+	goto done;
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Queue a reply or notification to a client and send as much as possible
+ * Output is written when the socket is writable, see from_client_output.
+ * Replies are always queued, but if the output queue exceeds 
+ * CLICON_BACKEND_OUTPUT_MAX, no more requests are read from the client until
+ * the queue has drained.  A notification that does not fit in the queue 
+ * means the client does not keep up with the stream, and it is disconnected.
+ * @param[in]  ce     Client entry
+ * @param[in]  cb     Message body, consumed by this function (also on error)
+ * @param[in]  notify Set if notification, otherwise reply
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+int
+backend_client_send(struct client_entry *ce,
+		    cbuf                *cb,
+		    int                  notify)
+{
+    uint32_t min;
+    int      fd = -1;
+
+    if (ce->ce_closing || ce->ce_s == 0){
+	cbuf_free(cb);
+	return 0;
+    }
+    /* Pass large reply in shared memory if the client accepts it */
+    min = clicon_option_int(ce->ce_handle, "CLICON_BACKEND_SHM_THRESHOLD");
+    if (!notify && ce->ce_shm && min && cbuf_len(cb) + 1 >= min &&
+	client_shm_create(NULL, 0, 0, cb, &fd) < 0){
+	cbuf_free(cb);
+	return -1;
+    }
+    return client_output_add(ce, cb, fd, notify);
+}
+
+/*! Queue a reply XML tree to a client, printed and sent in frames
+ * The reply is printed in chunks of CLICON_BACKEND_REPLY_CHUNK bytes only when
+ * the previous chunk has been written, so that the whole reply is not kept in
+ * memory as text.
+ * @param[in]  ce     Client entry
+ * @param[in]  xreply Reply XML tree, consumed by this function (also on error)
+ * @param[in]  depth  Limit levels of child resources: -1 is all, see clicon_xml2cbuf
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @see backend_client_send
+ */
+int
+backend_client_send_xml(struct client_entry *ce,
+			cxobj               *xreply,
+			int32_t              depth)
+{
+    int                   retval = -1;
+    struct client_output *co = NULL;
+
+    if (ce->ce_closing || ce->ce_s == 0){
+	xml_free(xreply);
+	return 0;
+    }
+    if ((co = malloc(sizeof(*co))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	xml_free(xreply);
+	goto done;
+    }
+    memset(co, 0, sizeof(*co));
+    co->co_fd = -1;
+    co->co_xml = xreply;
+    if ((co->co_cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    if ((co->co_stream = xml_stream_new(xreply, depth)) == NULL)
+	goto done;
+    /* co_len is 0 until first frame is printed */
+    if (client_output_queue(ce, co) < 0){
+	co = NULL;
+	goto done;
+    }
+    co = NULL;
+    retval = 0;
+ done:
+    if (co){
+	if (co->co_cb)
+	    cbuf_free(co->co_cb);
+	xml_free(co->co_xml);
+	free(co);
+    }
+    return retval;
+}
+
+/*! Check if no more requests should be read from a client
+ * @param[in]  ce   Client entry
+ * @param[in]  max  CLICON_BACKEND_OUTPUT_MAX
+ * @retval     1    Output queue is full, a worker serves a request of the client,
+ *                  or a request of the client is queued in the scheduler
+ * @retval     0    No
+ */
+static int
+client_input_blocked(struct client_entry *ce,
+		     uint32_t             max)
+{
+    return ce->ce_worker != NULL || ce->ce_sched || (max && ce->ce_outlen >= max);
+}
+
+/*! Get first message in the input buffer of a client, if it is complete
+ * Stop all input from the client if the message length is invalid.
+ * @param[in]  ce   Client entry
+ * @param[out] msgp Complete message, or NULL
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+client_input_msg(struct client_entry *ce,
+		 struct clicon_msg  **msgp)
+{
+    struct clicon_msg *msg;
+    uint32_t           mlen;
+
+    *msgp = NULL;
+    if (ce->ce_closing || ce->ce_ilen < sizeof(struct clicon_msg))
+	return 0;
+    msg = (struct clicon_msg *)ce->ce_ibuf;
+    mlen = ntohl(msg->op_len) & ~(CLICON_MSG_BINARY|CLICON_MSG_SHM);
+    if (mlen < sizeof(struct clicon_msg) || (mlen & CLICON_MSG_MORE)){
+	clicon_log(LOG_WARNING, "client %d: invalid message length %u", ce->ce_nr, mlen);
+	ce->ce_ilen = 0;
+	return client_output_close(ce);
+    }
+    if (ce->ce_ilen < mlen) /* Partial message, wait for more */
+	return 0;
+    *msgp = msg;
+    return 0;
+}
+
+/*! Process a complete message first in the input buffer of a client
+ * @param[in]  h    Clicon handle
+ * @param[in]  ce   Client entry
+ * @param[in]  msg  Message, see client_input_msg
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+client_input_request(clicon_handle        h,
+		     struct client_entry *ce,
+		     struct clicon_msg   *msg)
+{
+    uint32_t mlen;
+
+    mlen = ntohl(msg->op_len);
+    ce->ce_binary = (mlen & CLICON_MSG_BINARY) != 0;
+    ce->ce_shm = (mlen & CLICON_MSG_SHM) != 0 && clicon_sock_family(h) == AF_UNIX;
+    mlen &= ~(CLICON_MSG_BINARY|CLICON_MSG_SHM);
+    clicon_debug(2, "%s: rcv msg len=%u", __FUNCTION__, mlen);
+    ce->ce_stat_in++;
+    if (from_client_msg(h, ce, msg) < 0)
+	return -1;
+    /* Move next message first in buffer to keep it aligned */
+    ce->ce_ilen -= mlen;
+    if (ce->ce_ilen)
+	memmove(ce->ce_ibuf, ce->ce_ibuf + mlen, ce->ce_ilen);
+    /* Release large buffer after a large message */
+    if (ce->ce_ilen == 0 && ce->ce_isize > CLIENT_IBUF_KEEP){
+	free(ce->ce_ibuf);
+	ce->ce_ibuf = NULL;
+	ce->ce_isize = 0;
+    }
+    return 0;
+}
+
+/*! Dispatch all complete messages in the input buffer of a client
+ * Stop reading from the client if its output queue is full or a worker serves
+ * its request.
+ * With CLICON_BACKEND_SCHEDULER, the client is instead queued in the scheduler
+ * and reading stops until its first request has been served.
+ * @param[in]  h    Clicon handle
+ * @param[in]  ce   Client entry
+ * @retval     0    OK
+ * @retval    -1    Error
+ * @see backend_client_input_serve
+ */
+static int
+client_input_dispatch(clicon_handle        h,
+		      struct client_entry *ce)
+{
+    int                retval = -1;
+    struct clicon_msg *msg;
+    uint32_t           max;
+    int                sched;
+
+    max = clicon_option_int(h, "CLICON_BACKEND_OUTPUT_MAX");
+    sched = clicon_option_bool(h, "CLICON_BACKEND_SCHEDULER");
+    while (!ce->ce_paused){
+	if (client_input_msg(ce, &msg) < 0)
+	    goto done;
+	if (msg == NULL)
+	    break;
+	if (sched){
+	    if (backend_sched_add(h, ce, msg) < 0)
+		goto done;
+	}
+	else if (client_input_request(h, ce, msg) < 0)
+	    goto done;
+	if (!ce->ce_closing && client_input_blocked(ce, max)){
+	    clicon_debug(2, "%s client %d stop input", __FUNCTION__, ce->ce_nr);
+	    clixon_event_unreg_fd(ce->ce_s, from_client);
+	    ce->ce_paused = 1;
+	}
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Serve first request of a client queued by the scheduler, and continue reading
+ * @param[in]  h    Clicon handle
+ * @param[in]  ce   Client entry, removed from scheduler
+ * @retval     0    OK
+ * @retval    -1    Error
+ * @see backend_sched_add
+ */
+int
+backend_client_input_serve(clicon_handle        h,
+			   struct client_entry *ce)
+{
+    int                retval = -1;
+    struct clicon_msg *msg;
+
+    if (client_input_msg(ce, &msg) < 0)
+	goto done;
+    if (msg && client_input_request(h, ce, msg) < 0)
+	goto done;
+    if (backend_client_input_resume(h, ce) < 0)
+	goto done;
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Continue reading requests from a client if stopped and no longer blocked
+ * @param[in]  h    Clicon handle
+ * @param[in]  ce   Client entry
+ * @retval     0    OK
+ * @retval    -1    Error
+ * @see client_input_blocked
+ */
+int
+backend_client_input_resume(clicon_handle        h,
+			    struct client_entry *ce)
+{
+    int      retval = -1;
+    uint32_t max;
+
+    max = clicon_option_int(h, "CLICON_BACKEND_OUTPUT_MAX");
+    if (ce->ce_paused && !client_input_blocked(ce, max)){
+	clicon_debug(1, "%s client %d resume input", __FUNCTION__, ce->ce_nr);
+	if (clixon_event_reg_fd(ce->ce_s, from_client, (void*)ce, "local netconf client socket") < 0)
+	    goto done;
+	ce->ce_paused = 0;
+	/* Requests may already be buffered, and will then not generate input events */
+	if (client_input_dispatch(h, ce) < 0)
+	    goto done;
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Output is possible on client socket. Send queued messages.
+ * If all is sent, stop waiting for output. If input was stopped due to a full
+ * output queue and the queue has drained, continue reading requests.
+ * @param[in]   s    Socket to client
+ * @param[in]   arg  Client entry
+ * @retval      0    OK
+ * @retval     -1    Error, terminates backend
+ */
+static int
+from_client_output(int   s,
+		   void *arg)
+{
+    int                  retval = -1;
+    struct client_entry *ce = (struct client_entry *)arg;
+    clicon_handle        h = ce->ce_handle;
+
+    if (client_output_flush(ce) < 0)
+	goto done;
+    if (ce->ce_closing) /* Output stopped by flush */
+	goto ok;
+    if (ce->ce_out == NULL)
+	clixon_event_unreg_fd_write(s, from_client_output);
+    if (backend_client_input_resume(h, ce) < 0)
+	goto done;
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Input is available on client socket. Read and dispatch complete messages.
+ * The socket is non-blocking, messages are read incrementally into a per-client
+ * input buffer and dispatched when complete. Several pipelined messages may be
+ * dispatched at once.
  * @param[in]   s    Socket where message arrived. read from this.
  * @param[in]   arg  Client entry (from).
  * @retval      0    OK
@@ -1803,25 +2995,49 @@ from_client(int   s,
 	    void* arg)
 {
     int                  retval = -1;
-    struct clicon_msg   *msg = NULL;
     struct client_entry *ce = (struct client_entry *)arg;
     clicon_handle        h = ce->ce_handle;
-    int                  eof;
+    size_t               size;
+    uint32_t             mlen;
+    char                *buf;
+    ssize_t              n;
 
     clicon_debug(1, "%s", __FUNCTION__);
-    // assert(s == ce->ce_s);
-    if (clicon_msg_rcv(ce->ce_s, &msg, &eof) < 0)
-	goto done;
-    if (eof)
-	backend_client_rm(h, ce); 
-    else
-	if (from_client_msg(h, ce, msg) < 0)
+    /* Make room for a complete message if its length is known, else for a chunk */
+    size = ce->ce_ilen + CLIENT_IBUF_SIZE;
+    if (ce->ce_ilen >= sizeof(struct clicon_msg)){
+	mlen = ntohl(((struct clicon_msg *)ce->ce_ibuf)->op_len) & ~CLICON_MSG_FLAGS;
+	if (mlen > size)
+	    size = mlen;
+    }
+    if (size > ce->ce_isize){
+	if ((buf = realloc(ce->ce_ibuf, size)) == NULL){
+	    clicon_err(OE_UNIX, errno, "realloc");
+	    goto done;
+	}
+	ce->ce_ibuf = buf;
+	ce->ce_isize = size;
+    }
+    if ((n = read(s, ce->ce_ibuf + ce->ce_ilen, ce->ce_isize - ce->ce_ilen)) < 0){
+	if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+	    goto ok;
+	if (errno != ECONNRESET){
+	    clicon_err(OE_PROTO, errno, "read");
 	    goto done;
+	}
+	n = 0;
+    }
+    if (n == 0){ /* eof */
+	backend_client_rm(h, ce);
+	goto ok;
+    }
+    ce->ce_ilen += n;
+    if (client_input_dispatch(h, ce) < 0)
+	goto done;
+ ok:
     retval = 0;
   done:
     clicon_debug(1, "%s retval=%d", __FUNCTION__, retval);
-    if (msg)
-	free(msg);
     return retval; /* -1 here terminates backend */
 }
 
@@ -38,20 +38,58 @@
 /*
  * Types
  */ 
+struct backend_worker; /* see backend_worker.c */
+
+/*
+ * A message queued for output to a client.
+ * Header and body are written with writev, the body is the (null-terminated)
+ * reply or notification buffer.
+ * A streamed reply is an XML tree printed to co_cb one frame at a time.
+ */
+struct client_output{
+    struct client_output *co_next;    /* Next message in output queue */
+    uint32_t              co_hdr[2];  /* Message header (struct clicon_msg) */
+    cbuf                 *co_cb;      /* Message body, or current frame if streamed */
+    size_t                co_len;     /* Total length of message incl header */
+    xml_stream_t         *co_stream;  /* Streamed reply: remaining frames, else NULL */
+    cxobj                *co_xml;     /* Streamed reply: XML tree */
+    int                   co_fd;      /* Shared memory passed with message, else -1 */
+};
+
 /*
  * Client entry.
  * Keep state about every connected client.
  */
 struct client_entry{
     struct client_entry  *ce_next;    /* The clients linked list */
+    struct client_entry **ce_prevp;   /* Pointer to this entry in clients list */
+    struct client_entry  *ce_id_next; /* Next client in session id hash bucket */
     struct sockaddr       ce_addr;    /* The clients (UNIX domain) address */
     int                   ce_s;       /* stream socket to client */
     int                   ce_nr;      /* Client number (for dbg/tracing) */
     int                   ce_stat_in; /* Nr of received msgs from client */
     int                   ce_stat_out;/* Nr of sent msgs to client */
     int                   ce_id;      /* Session id */
+    int                   ce_hashed;  /* In session id hash table, ie ce_id is set */
     char                 *ce_username;/* Translated from peer user cred */
     clicon_handle         ce_handle;  /* clicon config handle (all clients have same?) */
+    char                 *ce_ibuf;    /* Input buffer of partly received messages */
+    size_t                ce_ilen;    /* Length of data in ce_ibuf */
+    size_t                ce_isize;   /* Allocated size of ce_ibuf */
+    struct client_output *ce_out;     /* Queue of messages to send to client */
+    struct client_output *ce_outlast; /* Last message of output queue */
+    size_t                ce_outoff;  /* Sent bytes of first message in queue */
+    size_t                ce_outlen;  /* Total length of queued messages */
+    int                   ce_paused;  /* Input stopped, see client_input_blocked */
+    int                   ce_closing; /* Output failed, discard output until eof */
+    struct backend_worker *ce_worker; /* Worker serving a request, see backend_worker.c */
+    cxobj                *ce_reply_xml;   /* Reply to stream, set by rpc callback */
+    int32_t               ce_reply_depth; /* Depth of ce_reply_xml to print */
+    int                   ce_binary;      /* Request accepts binary reply (CLICON_MSG_BINARY) */
+    int                   ce_shm;         /* Request accepts shared memory reply (CLICON_MSG_SHM) */
+    int                   ce_sched;       /* Queued in scheduler, see backend_sched.c */
+    struct client_entry  *ce_sched_next;  /* Next client in scheduler queue */
+    struct stream_subscription *ce_subscription; /* Subscriptions of client, see stream_ss_owner */
 };
 
 
@@ -60,6 +98,11 @@ struct client_entry{
  */ 
 int backend_client_rm(clicon_handle h, struct client_entry *ce);
 int from_client(int fd, void *arg);
+int backend_client_send(struct client_entry *ce, cbuf *cb, int notify);
+int backend_client_send_xml(struct client_entry *ce, cxobj *xreply, int32_t depth);
+int backend_client_output_free(struct client_entry *ce);
+int backend_client_input_resume(clicon_handle h, struct client_entry *ce);
+int backend_client_input_serve(clicon_handle h, struct client_entry *ce);
 int backend_rpc_init(clicon_handle h);
 
 #endif  /* _BACKEND_CLIENT_H_ */
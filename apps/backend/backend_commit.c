@@ -70,6 +70,7 @@
 #include "backend_handle.h"
 #include "backend_commit.h"
 #include "backend_client.h"
+#include "backend_privcand.h"
 
 /*! Key values are checked for validity independent of user-defined callbacks
  *
@@ -102,8 +103,17 @@ generic_validate(clicon_handle       h,
     cbuf      *cb = NULL;
     yang_stmt *yp;
 
-    /* All entries */
-    if ((ret = xml_yang_validate_all_top(h, td->td_target, xret)) < 0) 
+    /* All entries, or if there is a (valid) source, only those affected by changes */
+    if (td->td_src != NULL &&
+	clicon_option_bool(h, "CLICON_VALIDATE_INCREMENTAL"))
+	ret = xml_yang_validate_changes(h, td->td_target,
+					td->td_dvec, td->td_dlen,
+					td->td_avec, td->td_alen,
+					td->td_tcvec, td->td_clen,
+					xret);
+    else
+	ret = xml_yang_validate_all_top(h, td->td_target, xret);
+    if (ret < 0) 
 	goto done;
     if (ret == 0)
 	goto fail;
@@ -465,6 +475,7 @@ from_validate_common(clicon_handle       h,
     int         i;
     cxobj      *xn;
     int         ret;
+    int         dirty;
     
     if ((yspec = clicon_dbspec_yang(h)) == NULL){
 	clicon_err(OE_FATAL, 0, "No DB_SPEC");
@@ -473,28 +484,48 @@ from_validate_common(clicon_handle       h,
     /* This is the state we are going to */
     if (xmldb_get0(h, candidate, YB_MODULE, NULL, "/", 0, &td->td_target, NULL) < 0)
 	goto done;
-
-    /* Clear flags xpath for get */
-    xml_apply0(td->td_target, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset,
-	       (void*)(XML_FLAG_MARK|XML_FLAG_CHANGE));
     /* 2. Parse xml trees 
      * This is the state we are going from */
     if (xmldb_get0(h, "running", YB_MODULE, NULL, "/", 0, &td->td_src, NULL) < 0)
 	goto done;
-    /* Clear flags xpath for get */
-    xml_apply0(td->td_src, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset,
-	       (void*)(XML_FLAG_MARK|XML_FLAG_CHANGE));
+    /* If candidate has valid dirty marks, only modified subtrees are traversed */
+    dirty = xmldb_dirty_get(h, candidate);
+    /* Clear flags xpath for get
+     * Only the top node and nodes modified by edits may have flags, see xmldb_get0_clear */
+    if (dirty){
+	xml_flag_reset_dirty(td->td_target, XML_FLAG_MARK|XML_FLAG_CHANGE);
+	xml_flag_reset(td->td_src, XML_FLAG_MARK|XML_FLAG_CHANGE);
+    }
+    else {
+	xml_apply0(td->td_target, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset,
+		   (void*)(XML_FLAG_MARK|XML_FLAG_CHANGE));
+	xml_apply0(td->td_src, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset,
+		   (void*)(XML_FLAG_MARK|XML_FLAG_CHANGE));
+    }
     /* 3. Compute differences */
-    if (xml_diff(yspec, 
-		 td->td_src,
-		 td->td_target,
-		 &td->td_dvec,      /* removed: only in running */
-		 &td->td_dlen,
-		 &td->td_avec,      /* added: only in candidate */
-		 &td->td_alen,
-		 &td->td_scvec,     /* changed: original values */
-		 &td->td_tcvec,     /* changed: wanted values */
-		 &td->td_clen) < 0)
+    if (dirty){
+	if (xml_diff_dirty(yspec, 
+			   td->td_src,
+			   td->td_target,
+			   &td->td_dvec,      /* removed: only in running */
+			   &td->td_dlen,
+			   &td->td_avec,      /* added: only in candidate */
+			   &td->td_alen,
+			   &td->td_scvec,     /* changed: original values */
+			   &td->td_tcvec,     /* changed: wanted values */
+			   &td->td_clen) < 0)
+	    goto done;
+    }
+    else if (xml_diff(yspec, 
+		      td->td_src,
+		      td->td_target,
+		      &td->td_dvec,      /* removed: only in running */
+		      &td->td_dlen,
+		      &td->td_avec,      /* added: only in candidate */
+		      &td->td_alen,
+		      &td->td_scvec,     /* changed: original values */
+		      &td->td_tcvec,     /* changed: wanted values */
+		      &td->td_clen) < 0)
 	goto done;
     if (clicon_debug_get()>1)
 	transaction_print(stderr, td);
@@ -671,7 +702,11 @@ from_client_commit(clicon_handle h,
 	    goto done;
 	goto ok;
     }
-    if ((ret = candidate_commit(h, "candidate", cbret)) < 0){ /* Assume validation fail, nofatal */
+    if (privcand_enabled(h))
+	ret = privcand_commit(h, myid, cbret);
+    else
+	ret = candidate_commit(h, "candidate", cbret);
+    if (ret < 0){ /* Assume validation fail, nofatal */
 	clicon_debug(1, "Commit candidate failed");
 	if (ret < 0)
 	    if (netconf_operation_failed(cbret, "application", clicon_err_reason)< 0)
@@ -713,6 +748,16 @@ from_client_discard_changes(clicon_handle h,
     uint32_t             iddb;
     cbuf                *cbx = NULL; /* Assist cbuf */
     
+    /* Private candidate: revert this session's candidate only */
+    if (privcand_enabled(h)){
+	if (privcand_discard(h, myid) < 0){
+	    if (netconf_operation_failed(cbret, "application", clicon_err_reason)< 0)
+		goto done;
+	    goto ok;
+	}
+	cprintf(cbret, "<rpc-reply xmlns=\"%s\"><ok/></rpc-reply>", NETCONF_BASE_NAMESPACE);
+	goto ok;
+    }
     /* Check if target locked by other client */
     iddb = xmldb_islocked(h, "candidate");
     if (iddb && myid != iddb){
@@ -785,6 +830,7 @@ from_client_validate(clicon_handle h,
 		     void         *regarg)
 {
     int                 retval = -1;
+    struct client_entry *ce = (struct client_entry *)arg;
     transaction_data_t *td = NULL;
     int                 ret;
     char               *db;
@@ -795,6 +841,12 @@ from_client_validate(clicon_handle h,
 	    goto done;
 	goto ok;
     }
+    if (strcmp(db, "candidate") == 0 && privcand_enabled(h)){
+	if ((ret = privcand_db(h, ce->ce_id, &db, cbret)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto ok;
+    }
     clicon_debug(1, "Validate %s",  db);
 
     /* 1. Start transaction */
@@ -53,4 +53,8 @@ struct client_entry *backend_client_list(clicon_handle h);
 
 int backend_client_delete(clicon_handle h, struct client_entry *ce);
 
+struct client_entry *backend_client_find(clicon_handle h, uint32_t id);
+
+int backend_client_id_set(clicon_handle h, struct client_entry *ce, uint32_t id);
+
 #endif  /* _BACKEND_HANDLE_H_ */
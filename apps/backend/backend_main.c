@@ -68,12 +68,14 @@
 #include <clixon/clixon.h>
 
 #include "clixon_backend_handle.h"
+#include "clixon_backend_statedata.h"
 #include "backend_socket.h"
 #include "backend_client.h"
 #include "backend_plugin.h"
 #include "backend_commit.h"
 #include "backend_handle.h"
 #include "backend_startup.h"
+#include "backend_privcand.h"
 
 /* Command line options to be passed to getopt(3) */
 #define BACKEND_OPTS "hD:f:E:l:d:p:b:Fza:u:P:1qs:c:U:g:y:o:"
@@ -99,6 +101,10 @@ backend_terminate(clicon_handle h)
     clicon_debug(1, "%s", __FUNCTION__);
     if ((ss = clicon_socket_get(h)) != -1)
 	close(ss);
+    /* Remove private candidates and their datastores */
+    privcand_free_all(h);
+    /* Free validation dependency index */
+    xml_yang_validate_deps_free(h);
     /* Disconnect datastore */
     xmldb_disconnect(h);
     /* Clear module state caches */
@@ -117,16 +123,20 @@ backend_terminate(clicon_handle h)
 	yspec_free(yspec);
     if ((nsctx = clicon_nsctx_global_get(h)) != NULL)
 	cvec_free(nsctx);
+    nacm_compiled_clear(h);
     if ((x = clicon_nacm_ext(h)) != NULL)
 	xml_free(x);
     if ((x = clicon_conf_xml(h)) != NULL)
 	xml_free(x);
     stream_publish_exit();
+    clixon_statedata_cache_free(h);
     clixon_plugin_exit_all(h);
     /* Delete all backend plugin RPC callbacks */
     rpc_callback_delete_all(h);
     /* Delete all backend plugin upgrade callbacks */
     upgrade_callback_delete_all(h); 
+    /* Delete all backend plugin state data providers */
+    clixon_statedata_provider_delete_all(h);
     xpath_optimize_exit();
 
     if (pidfile)
@@ -50,8 +50,12 @@
 #include <errno.h>
 #include <signal.h>
 #include <syslog.h>
+#include <inttypes.h>
+#include <poll.h>
 #include <sys/types.h>
 #include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
 #include <sys/param.h>
 #include <netinet/in.h>
 
@@ -62,6 +66,7 @@
 #include <clixon/clixon.h>
 
 #include "clixon_backend_transaction.h"
+#include "clixon_backend_statedata.h"
 #include "backend_plugin.h"
 #include "backend_commit.h"
 
@@ -275,9 +280,415 @@ clixon_plugin_statedata_one(clixon_plugin  *cp,
     goto done;
 }
 
-/*! Go through all backend statedata callbacks and collect state data
+/*! Bind state data of one plugin or provider to yang, and clean and add defaults
+ * @param[in]     name    Name of plugin or provider
+ * @param[in]     yspec   Yang spec
+ * @param[in]     x       State XML tree of plugin
+ * @param[in,out] xret    Replaced with netconf-error if invalid
+ * @retval       -1       Error
+ * @retval        0       Invalid state data (xret set with netconf-error)
+ * @retval        1       OK
+ */
+static int
+clixon_plugin_statedata_bind(const char *name,
+			     yang_stmt  *yspec,
+			     cxobj      *x,
+			     cxobj     **xret)
+{
+    int    retval = -1;
+    int    ret;
+    cxobj *xerr = NULL;
+
+#if 1
+    if (clicon_debug_get())
+	clicon_log_xml(LOG_DEBUG, x, "%s STATE:", __FUNCTION__);
+#endif
+    /* XXX: ret == 0 invalid yang binding should be handled as internal error */
+    if ((ret = xml_bind_yang(x, YB_MODULE, yspec, &xerr)) < 0)
+	goto done;
+    if (ret == 0){
+	if (clixon_netconf_internal_error(xerr,
+					  ". Internal error, state callback returned invalid XML from plugin: ",
+					  (char*)name) < 0)
+	    goto done;
+	xml_free(*xret);
+	*xret = xerr;
+	xerr = NULL;
+	goto fail;
+    }
+    if (xml_sort_recurse(x) < 0)
+	goto done;
+    /* Mark non-presence containers as XML_FLAG_DEFAULT */
+    if (xml_apply(x, CX_ELMNT, xml_nopresence_default_mark, (void*)XML_FLAG_DEFAULT) < 0)
+	goto done;
+    /* Clear XML tree of defaults */
+    if (xml_tree_prune_flagged(x, XML_FLAG_DEFAULT, 1) < 0)
+	goto done;
+    /* clear mark and change */
+    xml_apply0(x, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset,
+	       (void*)(0xffff));
+    if (xml_default_recurse(x, 1) < 0)
+	goto done;
+    retval = 1;
+ done:
+    if (xerr)
+	xml_free(xerr);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Call state data provider
+ * As clixon_plugin_statedata_one but for a provider registered with
+ * clixon_statedata_register()
+ * @param[in]  sp      State data provider
+ * @param[in]  h       clicon handle
+ * @param[in]  nsc     Namespace context
+ * @param[in]  xpath   String with XPATH syntax. or NULL for all
+ * @param[out] xp      If retval=1, state tree created and returned: <config>...
+ * @retval    -1       Fatal error
+ * @retval     0       Statedata callback failed. no XML tree returned
+ * @retval     1       OK
+ */
+static int
+clixon_statedata_provider_one(statedata_provider *sp,
+			      clicon_handle       h,
+			      cvec               *nsc,
+			      char               *xpath,
+			      cxobj             **xp)
+{
+    int    retval = -1;
+    cxobj *x = NULL;
+
+    if ((x = xml_new("config", NULL, CX_ELMNT)) == NULL)
+	goto done;
+    if (sp->sp_callback(h, nsc, xpath, x, sp->sp_arg) < 0){
+	if (clicon_errno < 0) 
+	    clicon_log(LOG_WARNING, "%s: Internal error: State provider %s returned -1 but did not make a clicon_err call",
+		       __FUNCTION__, sp->sp_fnstr);
+	xml_free(x);
+	goto fail;  /* Dont quit here on user callbacks */
+    }
+    *xp = x;
+    retval = 1;
+ done:
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! State data of one plugin or provider in a get
+ * @see clixon_plugin_statedata_all
+ */
+struct statedata_job{
+    clixon_plugin      *sj_cp;     /* Plugin, or NULL if sj_sp */
+    statedata_provider *sj_sp;     /* State data provider, or NULL if sj_cp */
+    const char         *sj_name;   /* Name of plugin or provider */
+    uint32_t            sj_flags;  /* CLIXON_PLUGIN_PARALLEL, CLIXON_PLUGIN_NOCACHE */
+    int                 sj_cached; /* State data was taken from cache */
+    int                 sj_ok;     /* Callback returned state data (or none) */
+    cxobj              *sj_x;      /* State data, NULL if none */
+    int64_t             sj_ttl;    /* Cache TTL set by callback, or -1 */
+    char               *sj_reason; /* Error reason if callback failed */
+    pid_t               sj_pid;    /* Process calling the callback in parallel, or 0 */
+    int                 sj_fd;     /* Read end of result pipe from process */
+    cbuf               *sj_cb;     /* Result read so far from process */
+};
+
+/*! Call statedata callback of a plugin or provider in this process
+ * @param[in]     h      clicon handle
+ * @param[in,out] sj     Job: sets sj_ok, sj_x, sj_ttl and sj_reason
+ * @param[in]     nsc    Namespace context
+ * @param[in]     xpath  String with XPATH syntax. or NULL for all
+ * @retval       -1      Error
+ * @retval        0      OK
+ */
+static int
+statedata_job_call(clicon_handle         h,
+		   struct statedata_job *sj,
+		   cvec                 *nsc,
+		   char                 *xpath)
+{
+    int ret;
+
+    clixon_statedata_cache_ttl_pop(h);
+    if (sj->sj_cp)
+	ret = clixon_plugin_statedata_one(sj->sj_cp, h, nsc, xpath, &sj->sj_x);
+    else
+	ret = clixon_statedata_provider_one(sj->sj_sp, h, nsc, xpath, &sj->sj_x);
+    if (ret < 0)
+	return -1;
+    sj->sj_ttl = clixon_statedata_cache_ttl_pop(h);
+    if ((sj->sj_ok = ret) == 0 &&
+	(sj->sj_reason = strdup(clicon_err_reason)) == NULL){
+	clicon_err(OE_UNIX, errno, "strdup");
+	return -1;
+    }
+    return 0;
+}
+
+/*! Write all of a buffer to a file descriptor
+ * @param[in]  fd    File descriptor
+ * @param[in]  buf   Buffer
+ * @param[in]  len   Length of buffer
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+statedata_job_write(int         fd,
+		    const char *buf,
+		    size_t      len)
+{
+    ssize_t n;
+
+    while (len > 0){
+	if ((n = write(fd, buf, len)) < 0){
+	    if (errno == EINTR)
+		continue;
+	    return -1;
+	}
+	buf += n;
+	len -= n;
+    }
+    return 0;
+}
+
+/*! Call statedata callback of a plugin or provider in a forked process
+ * The process sends the result on a pipe: a line with ok flag and cache TTL,
+ * followed by state data as XML, or the error reason if the callback failed.
+ * @param[in]     h      clicon handle
+ * @param[in,out] sj     Job: sets sj_pid, sj_fd and sj_cb
+ * @param[in]     nsc    Namespace context
+ * @param[in]     xpath  String with XPATH syntax. or NULL for all
+ * @retval       -1      Error
+ * @retval        0      OK
+ * @see statedata_job_read  for reading the result
+ */
+static int
+statedata_job_fork(clicon_handle         h,
+		   struct statedata_job *sj,
+		   cvec                 *nsc,
+		   char                 *xpath)
+{
+    int    retval = -1;
+    int    fd[2] = {-1, -1};
+    cbuf  *cb = NULL;
+    cxobj *xc;
+
+    if ((sj->sj_cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    if (pipe(fd) < 0){
+	clicon_err(OE_UNIX, errno, "pipe");
+	goto done;
+    }
+    if ((sj->sj_pid = fork()) < 0){
+	sj->sj_pid = 0;
+	clicon_err(OE_UNIX, errno, "fork");
+	goto done;
+    }
+    if (sj->sj_pid == 0){ /* Child */
+	close(fd[0]);
+	if (statedata_job_call(h, sj, nsc, xpath) < 0 ||
+	    (cb = cbuf_new()) == NULL)
+	    _exit(1);
+	cprintf(cb, "%d %" PRId64 "\n", sj->sj_ok, sj->sj_ttl);
+	if (sj->sj_ok == 0)
+	    cprintf(cb, "%s", sj->sj_reason);
+	else if (sj->sj_x){
+	    xc = NULL;
+	    while ((xc = xml_child_each(sj->sj_x, xc, CX_ELMNT)) != NULL)
+		if (clicon_xml2cbuf(cb, xc, 0, 0, -1) < 0)
+		    _exit(1);
+	}
+	if (statedata_job_write(fd[1], cbuf_get(cb), cbuf_len(cb)) < 0)
+	    _exit(1);
+	_exit(0);
+    }
+    close(fd[1]);
+    fd[1] = -1;
+    sj->sj_fd = fd[0];
+    fd[0] = -1;
+    clicon_debug(1, "%s %s pid %d", __FUNCTION__, sj->sj_name, sj->sj_pid);
+    retval = 0;
+ done:
+    if (fd[0] != -1)
+	close(fd[0]);
+    if (fd[1] != -1)
+	close(fd[1]);
+    return retval;
+}
+
+/*! Result of a forked process has been read, parse it
+ * @param[in,out] sj     Job: sets sj_ok, sj_x, sj_ttl and sj_reason
+ * @param[in]     status Exit status of process
+ * @retval       -1      Error
+ * @retval        0      OK
+ */
+static int
+statedata_job_read(struct statedata_job *sj,
+		   int                   status)
+{
+    char *str;
+    char *p;
+    int   ok;
+
+    str = cbuf_get(sj->sj_cb);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 ||
+	(p = strchr(str, '\n')) == NULL ||
+	sscanf(str, "%d %" SCNd64, &ok, &sj->sj_ttl) != 2){
+	sj->sj_ok = 0;
+	p = "State callback process failed";
+    }
+    else if ((sj->sj_ok = ok) == 1){
+	p++;
+	if ((sj->sj_x = xml_new("config", NULL, CX_ELMNT)) == NULL)
+	    return -1;
+	if (*p && clixon_xml_parse_string(p, YB_NONE, NULL, &sj->sj_x, NULL) < 0)
+	    return -1;
+	return 0;
+    }
+    else
+	p++;
+    if ((sj->sj_reason = strdup(p)) == NULL){
+	clicon_err(OE_UNIX, errno, "strdup");
+	return -1;
+    }
+    return 0;
+}
+
+/*! Wait for all forked processes of a get to finish, or for timeout
+ * A process that has not finished in time is killed and its job fails.
+ * @param[in]     jobs     Jobs
+ * @param[in]     njobs    Number of jobs
+ * @param[in]     timeout  Timeout in ms, 0 means no timeout
+ * @retval       -1        Error
+ * @retval        0        OK
+ */
+static int
+statedata_job_wait(struct statedata_job *jobs,
+		   int                   njobs,
+		   uint32_t              timeout)
+{
+    int                   retval = -1;
+    struct pollfd        *fds = NULL;
+    int                   nfds;
+    int                   i;
+    int                   j;
+    struct timeval        now;
+    struct timeval        deadline;
+    struct timeval        t;
+    int                   ms;
+    ssize_t               n;
+    char                  buf[4096];
+    int                   status;
+    struct statedata_job *sj;
+
+    if ((fds = calloc(njobs, sizeof(*fds))) == NULL){
+	clicon_err(OE_UNIX, errno, "calloc");
+	goto done;
+    }
+    gettimeofday(&now, NULL);
+    t.tv_sec = timeout/1000;
+    t.tv_usec = (timeout%1000)*1000;
+    timeradd(&now, &t, &deadline);
+    while (1){
+	nfds = 0;
+	for (i=0; i<njobs; i++)
+	    if (jobs[i].sj_pid > 0){
+		fds[nfds].fd = jobs[i].sj_fd;
+		fds[nfds].events = POLLIN;
+		fds[nfds].revents = 0;
+		nfds++;
+	    }
+	if (nfds == 0)
+	    break;
+	ms = -1;
+	if (timeout){
+	    gettimeofday(&now, NULL);
+	    if (timercmp(&now, &deadline, <)){
+		timersub(&deadline, &now, &t);
+		ms = t.tv_sec*1000 + t.tv_usec/1000 + 1;
+	    }
+	    else
+		ms = 0;
+	}
+	if ((n = poll(fds, nfds, ms)) < 0){
+	    if (errno == EINTR)
+		continue;
+	    clicon_err(OE_UNIX, errno, "poll");
+	    goto done;
+	}
+	if (n == 0){ /* Timeout: kill remaining processes */
+	    for (i=0; i<njobs; i++){
+		sj = &jobs[i];
+		if (sj->sj_pid <= 0)
+		    continue;
+		clicon_log(LOG_WARNING, "%s: State callback of %s timed out after %u ms",
+			   __FUNCTION__, sj->sj_name, timeout);
+		kill(sj->sj_pid, SIGKILL);
+		while (waitpid(sj->sj_pid, &status, 0) < 0 && errno == EINTR)
+		    ;
+		sj->sj_pid = 0;
+		close(sj->sj_fd);
+		sj->sj_ok = 0;
+		snprintf(buf, sizeof(buf), "Timeout after %u ms", timeout);
+		if ((sj->sj_reason = strdup(buf)) == NULL){
+		    clicon_err(OE_UNIX, errno, "strdup");
+		    goto done;
+		}
+	    }
+	    break;
+	}
+	for (j=0; j<nfds; j++){
+	    if (fds[j].revents == 0)
+		continue;
+	    for (i=0; i<njobs; i++)
+		if (jobs[i].sj_pid > 0 && jobs[i].sj_fd == fds[j].fd)
+		    break;
+	    sj = &jobs[i];
+	    if ((n = read(sj->sj_fd, buf, sizeof(buf))) < 0){
+		if (errno == EINTR)
+		    continue;
+		clicon_err(OE_UNIX, errno, "read");
+		goto done;
+	    }
+	    if (n > 0){
+		cbuf_append_buf(sj->sj_cb, buf, n);
+		continue;
+	    }
+	    /* Process has finished */
+	    close(sj->sj_fd);
+	    status = 0;
+	    while (waitpid(sj->sj_pid, &status, 0) < 0 && errno == EINTR)
+		;
+	    sj->sj_pid = 0;
+	    if (statedata_job_read(sj, status) < 0)
+		goto done;
+	}
+    }
+    retval = 0;
+ done:
+    if (fds)
+	free(fds);
+    return retval;
+}
+
+/*! Go through all backend statedata callbacks and providers and collect state data
  * This is internal system call, plugin is invoked (does not call) this function
- * Backend plugins can register 
+ * Backend plugins can register a ca_statedata callback, which is always called,
+ * and state data providers of subtrees, which are only called if their subtree
+ * intersects xpath, see clixon_statedata_register().
+ * State data is taken from the state data cache if cached, see
+ * CLICON_BACKEND_STATE_CACHE_TTL.
+ * If more than one callback is called, callbacks of plugins and providers with
+ * the CLIXON_PLUGIN_PARALLEL flag are called in forked processes, concurrently
+ * with each other and with the remaining callbacks, which are called here. Their
+ * results are merged when all have finished, or CLICON_BACKEND_STATE_TIMEOUT 
+ * has passed. State data is merged in plugin order regardless.
  * @param[in]     h       clicon handle
  * @param[in]     yspec   Yang spec
  * @param[in]     nsc     Namespace context
@@ -295,25 +706,87 @@ clixon_plugin_statedata_all(clicon_handle    h,
 			    char            *xpath,
 			    cxobj          **xret)
 {
-    int             retval = -1;
-    int             ret;
-    cxobj          *x = NULL;
-    clixon_plugin  *cp = NULL;
-    cbuf           *cberr = NULL; 
-    cxobj          *xerr = NULL;
+    int                   retval = -1;
+    int                   ret;
+    clixon_plugin        *cp = NULL;
+    statedata_provider   *sp = NULL;
+    struct statedata_job *jobs = NULL;
+    struct statedata_job *sj;
+    int                   njobs = 0;
+    int                   nmiss = 0;
+    int                   nfork = 0;
+    int                   i;
+    cbuf                 *cberr = NULL; 
+    cxobj                *xerr = NULL;
     
     clicon_debug(1, "%s", __FUNCTION__);
-    while ((cp = clixon_plugin_each(h, cp)) != NULL) {
-	if ((ret = clixon_plugin_statedata_one(cp, h, nsc, xpath, &x)) < 0)
+    /* Count callbacks and allocate a job for each */
+    while ((cp = clixon_plugin_each(h, cp)) != NULL)
+	if (cp->cp_api.ca_statedata != NULL)
+	    njobs++;
+    while ((sp = clixon_statedata_provider_each(h, sp, nsc, xpath)) != NULL)
+	njobs++;
+    if (njobs == 0)
+	goto ok;
+    if ((jobs = calloc(njobs, sizeof(*jobs))) == NULL){
+	clicon_err(OE_UNIX, errno, "calloc");
+	goto done;
+    }
+    i = 0;
+    while ((cp = clixon_plugin_each(h, cp)) != NULL)
+	if (cp->cp_api.ca_statedata != NULL){
+	    jobs[i].sj_cp = cp;
+	    jobs[i].sj_name = cp->cp_name;
+	    jobs[i++].sj_flags = cp->cp_api.ca_flags;
+	}
+    while (i < njobs && (sp = clixon_statedata_provider_each(h, sp, nsc, xpath)) != NULL){
+	jobs[i].sj_sp = sp;
+	jobs[i].sj_name = sp->sp_fnstr;
+	jobs[i++].sj_flags = sp->sp_flags;
+    }
+    njobs = i;
+    /* Take state data from cache */
+    for (i=0; i<njobs; i++){
+	sj = &jobs[i];
+	sj->sj_ttl = -1;
+	if ((sj->sj_flags & CLIXON_PLUGIN_NOCACHE) == 0){
+	    if ((ret = clixon_statedata_cache_get(h, sj->sj_name, nsc, xpath, &sj->sj_x)) < 0)
+		goto done;
+	    sj->sj_cached = sj->sj_ok = ret;
+	}
+	if (!sj->sj_cached)
+	    nmiss++;
+    }
+    /* Start parallel callbacks, then call the others here */
+    for (i=0; i<njobs && nmiss > 1; i++){
+	sj = &jobs[i];
+	if (sj->sj_cached || (sj->sj_flags & CLIXON_PLUGIN_PARALLEL) == 0)
+	    continue;
+	if (statedata_job_fork(h, sj, nsc, xpath) < 0)
+	    goto done;
+	nfork++;
+    }
+    for (i=0; i<njobs; i++){
+	sj = &jobs[i];
+	if (sj->sj_cached || sj->sj_cb != NULL)
+	    continue;
+	if (statedata_job_call(h, sj, nsc, xpath) < 0)
 	    goto done;
-	if (ret == 0){
+    }
+    if (nfork &&
+	statedata_job_wait(jobs, njobs,
+			   clicon_option_int(h, "CLICON_BACKEND_STATE_TIMEOUT")) < 0)
+	goto done;
+    /* Bind, cache and merge state data in plugin order */
+    for (i=0; i<njobs; i++){
+	sj = &jobs[i];
+	if (!sj->sj_ok){
 	    if ((cberr = cbuf_new()) == NULL){
 		clicon_err(OE_UNIX, errno, "cbuf_new");
 		goto done;
 	    }
-	    /* error reason should be in clicon_err_reason */
 	    cprintf(cberr, "Internal error, state callback in plugin %s returned invalid XML: %s",
-		    cp->cp_name, clicon_err_reason);
+		    sj->sj_name, sj->sj_reason);
 	    if (netconf_operation_failed_xml(&xerr, "application", cbuf_get(cberr)) < 0)
 		goto done;
 	    xml_free(*xret);
@@ -321,60 +794,56 @@ clixon_plugin_statedata_all(clicon_handle    h,
 	    xerr = NULL;
 	    goto fail;
 	}
-	if (x == NULL)
-	    continue;
-	if (xml_child_nr(x) == 0){
-	    xml_free(x);
-	    x = NULL;
-	    continue;
-	}
-#if 1
-	if (clicon_debug_get())
-	    clicon_log_xml(LOG_DEBUG, x, "%s STATE:", __FUNCTION__);
-#endif
-	/* XXX: ret == 0 invalid yang binding should be handled as internal error */
-	if ((ret = xml_bind_yang(x, YB_MODULE, yspec, &xerr)) < 0)
-	    goto done;
-	if (ret == 0){
-	    if (clixon_netconf_internal_error(xerr,
-					      ". Internal error, state callback returned invalid XML from plugin: ",
-					      cp->cp_name) < 0)
-		goto done;
-	    xml_free(*xret);
-	    *xret = xerr;
-	    xerr = NULL;
-	    goto fail;
+	if (!sj->sj_cached){
+	    if (sj->sj_x && xml_child_nr(sj->sj_x) == 0){
+		xml_free(sj->sj_x);
+		sj->sj_x = NULL;
+	    }
+	    if (sj->sj_x){
+		if ((ret = clixon_plugin_statedata_bind(sj->sj_name, yspec, sj->sj_x, xret)) < 0)
+		    goto done;
+		if (ret == 0)
+		    goto fail;
+	    }
+	    if ((sj->sj_flags & CLIXON_PLUGIN_NOCACHE) == 0){
+		if (sj->sj_ttl >= 0 &&
+		    clixon_statedata_cache_ttl(h, sj->sj_ttl) < 0)
+		    goto done;
+		if (clixon_statedata_cache_put(h, sj->sj_name, nsc, xpath, sj->sj_x) < 0)
+		    goto done;
+	    }
 	}
-	if (xml_sort_recurse(x) < 0)
-	    goto done;
-	/* Mark non-presence containers as XML_FLAG_DEFAULT */
-	if (xml_apply(x, CX_ELMNT, xml_nopresence_default_mark, (void*)XML_FLAG_DEFAULT) < 0)
-	    goto done;
-	/* Clear XML tree of defaults */
-	if (xml_tree_prune_flagged(x, XML_FLAG_DEFAULT, 1) < 0)
-	    goto done;
-        /* clear mark and change */
-	xml_apply0(x, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset,
-		   (void*)(0xffff));
-	if (xml_default_recurse(x, 1) < 0)
-	    goto done;
-	if ((ret = netconf_trymerge(x, yspec, xret)) < 0)
+	if (sj->sj_x == NULL)
+	    continue;
+	if ((ret = netconf_trymerge(sj->sj_x, yspec, xret)) < 0)
 	    goto done;
 	if (ret == 0)
 	    goto fail;
-	if (x){
-	    xml_free(x);
-	    x = NULL;
-	}
-    } /* while plugin */
+    }
+ ok:
     retval = 1;
  done:
     if (xerr)
 	xml_free(xerr);
     if (cberr)
 	cbuf_free(cberr);
-    if (x)
-	xml_free(x);
+    for (i=0; i<njobs && jobs; i++){
+	sj = &jobs[i];
+	if (sj->sj_pid > 0){
+	    kill(sj->sj_pid, SIGKILL);
+	    while (waitpid(sj->sj_pid, NULL, 0) < 0 && errno == EINTR)
+		;
+	    close(sj->sj_fd);
+	}
+	if (sj->sj_cb)
+	    cbuf_free(sj->sj_cb);
+	if (sj->sj_x)
+	    xml_free(sj->sj_x);
+	if (sj->sj_reason)
+	    free(sj->sj_reason);
+    }
+    if (jobs)
+	free(jobs);
     return retval;
  fail:
     retval = 0;
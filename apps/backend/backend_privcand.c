@@ -0,0 +1,729 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2020 Olof Hagsand and Rubicon Communications, LLC(Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2,
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ * Per-session private candidate datastores
+ * Enabled with option CLICON_XMLDB_PRIVATE_CANDIDATE.
+ *
+ * Each session editing "candidate" gets its own private candidate, branched from
+ * running. A private candidate is kept as a log of edit-config requests, together
+ * with a copy of running when it was branched (the base). Private candidates
+ * branched from the same running share one base. The private datastore is not
+ * written until it is actually needed.
+ * The log is materialized into a datastore named candidate-<session-id> the first
+ * time the private candidate is read, validated or committed. After that, new
+ * edits are applied directly to the materialized datastore as well as logged.
+ * If running changes (someone else commits), the private candidate is rebased:
+ * it is re-materialized from the new running by replaying the log. If running has
+ * changed under any node of the log since the base, replaying would silently
+ * overwrite the other commit, and this is reported to the client as a conflict.
+ * The same applies to an edit that cannot be replayed (eg create of an object that
+ * now exists).
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <syslog.h>
+#include <sys/stat.h>
+#include <sys/param.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clicon */
+#include <clixon/clixon.h>
+
+#include "backend_commit.h"
+#include "backend_privcand.h"
+
+/*
+ * Types
+ */
+/* One logged edit-config request on a private candidate */
+struct privcand_edit {
+    qelem_t             pe_qelem;    /* List header */
+    enum operation_type pe_op;       /* Default operation */
+    cxobj              *pe_xml;      /* Copy of <config> modification tree */
+    char               *pe_username; /* User making the edit (for NACM) */
+};
+
+/* Copy of one generation of running, shared by private candidates based on it */
+struct privcand_base {
+    int                   pb_refcnt;  /* Number of private candidates using it */
+    uint64_t              pb_gen;     /* Running generation */
+    cxobj                *pb_xml;     /* Copy of running */
+};
+
+/* Private candidate of one session */
+struct privcand {
+    qelem_t               pc_qelem;   /* List header */
+    uint32_t              pc_id;      /* Session id */
+    char                 *pc_db;      /* Name of private datastore, eg candidate-17 */
+    struct privcand_edit *pc_edits;   /* Edits since branched from running */
+    int                   pc_materialized; /* Log has been applied to pc_db */
+    uint64_t              pc_rgen;    /* Running generation when materialized */
+    struct privcand_base *pc_base;    /* Running the log is based on */
+};
+
+/*
+ * Variables
+ */
+/* List of private candidates, one per session that has edited candidate */
+static struct privcand *privcand_list = NULL;
+
+/* Base of the current running generation, if any private candidate uses it */
+static struct privcand_base *privcand_base_cur = NULL;
+
+/*! Check if private candidates are enabled
+ * @param[in]  h   Clicon handle
+ * @retval     1   Each session has its own private candidate
+ * @retval     0   All sessions share one candidate (standard NETCONF)
+ */
+int
+privcand_enabled(clicon_handle h)
+{
+    return clicon_option_bool(h, "CLICON_XMLDB_PRIVATE_CANDIDATE");
+}
+
+/*! Find private candidate of session
+ * @param[in]  id  Session id
+ * @retval     pc  Private candidate
+ * @retval     NULL Not found, the session has not edited its candidate
+ */
+static struct privcand *
+privcand_find(uint32_t id)
+{
+    struct privcand *pc;
+
+    if ((pc = privcand_list) != NULL)
+	do {
+	    if (pc->pc_id == id)
+		return pc;
+	    pc = NEXTQ(struct privcand *, pc);
+	} while (pc && pc != privcand_list);
+    return NULL;
+}
+
+/*! Get base of the current running generation
+ *
+ * Running is only copied the first time a private candidate is branched from, or
+ * rebased on, a new generation of running. Private candidates that follow share
+ * the copy.
+ * @param[in]  h   Clicon handle
+ * @retval     pb  Base, release with privcand_base_put
+ * @retval     NULL Error
+ */
+static struct privcand_base *
+privcand_base_get(clicon_handle h)
+{
+    struct privcand_base *pb;
+    uint64_t              gen;
+
+    gen = xmldb_gen_get(h, "running");
+    if ((pb = privcand_base_cur) != NULL && pb->pb_gen == gen){
+	pb->pb_refcnt++;
+	return pb;
+    }
+    if ((pb = malloc(sizeof(*pb))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	return NULL;
+    }
+    memset(pb, 0, sizeof(*pb));
+    pb->pb_gen = gen;
+    if (xmldb_get0(h, "running", YB_MODULE, NULL, "/", 1, &pb->pb_xml, NULL) < 0){
+	free(pb);
+	return NULL;
+    }
+    pb->pb_refcnt = 1;
+    privcand_base_cur = pb;
+    return pb;
+}
+
+/*! Release base of a private candidate, free it when no longer used
+ * @param[in]  pb  Base, or NULL
+ */
+static void
+privcand_base_put(struct privcand_base *pb)
+{
+    if (pb == NULL || --pb->pb_refcnt > 0)
+	return;
+    if (privcand_base_cur == pb)
+	privcand_base_cur = NULL;
+    if (pb->pb_xml)
+	xml_free(pb->pb_xml);
+    free(pb);
+}
+
+/*! Create new private candidate for session, branched from running
+ * @param[in]  h   Clicon handle
+ * @param[in]  id  Session id
+ * @retval     pc  Private candidate
+ * @retval     NULL Error
+ */
+static struct privcand *
+privcand_new(clicon_handle h,
+	     uint32_t      id)
+{
+    struct privcand *pc;
+    cbuf            *cb = NULL;
+
+    if ((pc = malloc(sizeof(*pc))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    memset(pc, 0, sizeof(*pc));
+    pc->pc_id = id;
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    cprintf(cb, "candidate-%u", id);
+    if ((pc->pc_db = strdup(cbuf_get(cb))) == NULL){
+	clicon_err(OE_UNIX, errno, "strdup");
+	goto done;
+    }
+    if ((pc->pc_base = privcand_base_get(h)) == NULL)
+	goto done;
+    ADDQ(pc, privcand_list);
+ done:
+    if (cb)
+	cbuf_free(cb);
+    if (pc && pc->pc_base == NULL){
+	if (pc->pc_db)
+	    free(pc->pc_db);
+	free(pc);
+	pc = NULL;
+    }
+    return pc;
+}
+
+/*! Check if two XML subtrees are equal, including all bodies
+ * @param[in]  x0  First subtree, or NULL
+ * @param[in]  x1  Second subtree, or NULL
+ * @retval     1   Equal
+ * @retval     0   Not equal
+ */
+static int
+privcand_tree_equal(cxobj *x0,
+		    cxobj *x1)
+{
+    cxobj *x0c;
+    cxobj *x1c;
+    char  *b0;
+    char  *b1;
+
+    if (x0 == NULL || x1 == NULL)
+	return x0 == x1;
+    b0 = xml_body(x0);
+    b1 = xml_body(x1);
+    if ((b0 == NULL) != (b1 == NULL) ||
+	(b0 && strcmp(b0, b1) != 0))
+	return 0;
+    x0c = xml_child_each(x0, NULL, CX_ELMNT);
+    x1c = xml_child_each(x1, NULL, CX_ELMNT);
+    while (x0c && x1c){
+	if (xml_cmp(x0c, x1c, 0, 0, NULL) != 0 ||
+	    !privcand_tree_equal(x0c, x1c))
+	    return 0;
+	x0c = xml_child_each(x0, x0c, CX_ELMNT);
+	x1c = xml_child_each(x1, x1c, CX_ELMNT);
+    }
+    return x0c == x1c;
+}
+
+/*! Check if running has changed under the nodes of a logged edit
+ *
+ * Walk the edit tree and the corresponding nodes of the base and of the current
+ * running. Where the edit sets a value, or replaces, creates or deletes a subtree,
+ * the base and running subtrees must be equal, otherwise replaying the edit would
+ * overwrite changes made by others.
+ * @param[in]  xe    Edit tree node
+ * @param[in]  xb    Corresponding node in base, or NULL
+ * @param[in]  xr    Corresponding node in current running, or NULL
+ * @param[in]  op    Operation inherited from parent of xe
+ * @param[out] xcp   Node in base or running that has changed, if conflict
+ * @retval    -1     Error
+ * @retval     0     Conflict, xcp set
+ * @retval     1     OK, no conflict
+ */
+static int
+privcand_edit_conflict(cxobj              *xe,
+		       cxobj              *xb,
+		       cxobj              *xr,
+		       enum operation_type op,
+		       cxobj             **xcp)
+{
+    cxobj *xec = NULL;
+    cxobj *xbc;
+    cxobj *xrc;
+    char  *opstr;
+    int    ret;
+
+    if (xb == NULL && xr == NULL)
+	return 1;
+    if ((opstr = xml_find_type_value(xe, NULL, "operation", CX_ATTR)) != NULL &&
+	xml_operation(opstr, &op) < 0)
+	return -1;
+    if (op == OP_REPLACE || op == OP_CREATE || op == OP_DELETE || op == OP_REMOVE ||
+	xml_child_nr_type(xe, CX_ELMNT) == 0){
+	if (privcand_tree_equal(xb, xr))
+	    return 1;
+	*xcp = xr ? xr : xb;
+	return 0;
+    }
+    while ((xec = xml_child_each(xe, xec, CX_ELMNT)) != NULL){
+	xbc = xrc = NULL;
+	if (xb && match_base_child(xb, xec, xml_spec(xec), &xbc) < 0)
+	    return -1;
+	if (xr && match_base_child(xr, xec, xml_spec(xec), &xrc) < 0)
+	    return -1;
+	if ((ret = privcand_edit_conflict(xec, xbc, xrc, op, xcp)) <= 0)
+	    return ret;
+    }
+    return 1;
+}
+
+/*! Check if running has changed under any node of the edit log since its base
+ *
+ * Only the nodes of the edit log are looked up in the base and in running, see
+ * privcand_edit_conflict. If none has changed, the base is moved to the current
+ * running.
+ * @param[in]  h      Clicon handle
+ * @param[in]  pc     Private candidate
+ * @param[out] cbret  Error message if conflict
+ * @retval    -1      Error
+ * @retval     0      Conflict, cbret set
+ * @retval     1      OK
+ */
+static int
+privcand_rebase_check(clicon_handle    h,
+		      struct privcand *pc,
+		      cbuf            *cbret)
+{
+    int                   retval = -1;
+    struct privcand_edit *pe;
+    cxobj                *xr = NULL;
+    cxobj                *xc = NULL;
+    char                 *xpath = NULL;
+    cbuf                 *cb = NULL;
+    struct privcand_base *pb;
+    int                   ret;
+
+    if (pc->pc_base->pb_gen == xmldb_gen_get(h, "running"))
+	goto ok;
+    if (xmldb_get0(h, "running", YB_MODULE, NULL, "/", 0, &xr, NULL) < 0)
+	goto done;
+    if ((pe = pc->pc_edits) != NULL)
+	do {
+	    if ((ret = privcand_edit_conflict(pe->pe_xml, pc->pc_base->pb_xml, xr,
+					      pe->pe_op, &xc)) < 0)
+		goto done;
+	    if (ret == 0){
+		clicon_log(LOG_NOTICE, "%s: session %u private candidate conflicts with running",
+			   __FUNCTION__, pc->pc_id);
+		if (xml2xpath(xc, &xpath) < 0)
+		    goto done;
+		if ((cb = cbuf_new()) == NULL){
+		    clicon_err(OE_UNIX, errno, "cbuf_new");
+		    goto done;
+		}
+		cprintf(cb, "Private candidate conflicts with running: %s has been changed by another session", xpath);
+		if (netconf_operation_failed(cbret, "application", cbuf_get(cb)) < 0)
+		    goto done;
+		goto fail;
+	    }
+	    pe = NEXTQ(struct privcand_edit *, pe);
+	} while (pe && pe != pc->pc_edits);
+    if (xmldb_get0_clear(h, xr) < 0)
+	goto done;
+    xmldb_get0_free(h, &xr);
+    if ((pb = privcand_base_get(h)) == NULL)
+	goto done;
+    privcand_base_put(pc->pc_base);
+    pc->pc_base = pb;
+ ok:
+    retval = 1;
+ done:
+    if (cb)
+	cbuf_free(cb);
+    if (xpath)
+	free(xpath);
+    if (xr){
+	xmldb_get0_clear(h, xr);
+	xmldb_get0_free(h, &xr);
+    }
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Apply the edit log of a private candidate to its datastore, if needed
+ *
+ * If the private candidate is already materialized and running has not changed
+ * since, this is a no-op. Otherwise running is copied to the private datastore and
+ * all logged edits are replayed on top of it, ie the private candidate is rebased
+ * on the current running.
+ * @param[in]  h      Clicon handle
+ * @param[in]  pc     Private candidate
+ * @param[out] cbret  Error message if conflict
+ * @retval    -1      Error
+ * @retval     0      Conflict: an edit could not be applied on current running, cbret set
+ * @retval     1      OK
+ */
+static int
+privcand_materialize(clicon_handle    h,
+		     struct privcand *pc,
+		     cbuf            *cbret)
+{
+    int                   retval = -1;
+    struct privcand_edit *pe;
+    cxobj                *x = NULL;
+    int                   ret;
+
+    if (pc->pc_materialized &&
+	pc->pc_rgen == xmldb_gen_get(h, "running"))
+	goto ok;
+    clicon_debug(1, "%s %s", __FUNCTION__, pc->pc_db);
+    pc->pc_materialized = 0;
+    if ((ret = privcand_rebase_check(h, pc, cbret)) < 0)
+	goto done;
+    if (ret == 0)
+	goto fail;
+    if (xmldb_copy(h, "running", pc->pc_db) < 0)
+	goto done;
+    if ((pe = pc->pc_edits) != NULL)
+	do {
+	    /* xmldb_put may modify the tree, keep the log intact */
+	    if ((x = xml_dup(pe->pe_xml)) == NULL)
+		goto done;
+	    if ((ret = xmldb_put(h, pc->pc_db, pe->pe_op, x, pe->pe_username, cbret)) < 0)
+		goto done;
+	    if (ret == 0){
+		clicon_log(LOG_NOTICE, "%s: session %u private candidate conflicts with running",
+			   __FUNCTION__, pc->pc_id);
+		goto fail;
+	    }
+	    xml_free(x);
+	    x = NULL;
+	    pe = NEXTQ(struct privcand_edit *, pe);
+	} while (pe && pe != pc->pc_edits);
+    pc->pc_materialized = 1;
+    pc->pc_rgen = xmldb_gen_get(h, "running");
+ ok:
+    retval = 1;
+ done:
+    if (x)
+	xml_free(x);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Edit the private candidate of a session
+ *
+ * The edit is logged. If the private candidate is materialized and up-to-date with
+ * running, the edit is also applied to the private datastore directly, so that
+ * errors are reported immediately. Otherwise errors are reported when the private
+ * candidate is used.
+ * @param[in]  h        Clicon handle
+ * @param[in]  id       Session id
+ * @param[in]  op       Default operation
+ * @param[in]  xc       Modification tree, top-level <config>, yang bound and sorted
+ * @param[in]  username User making the edit
+ * @param[out] cbret    Error message if edit fails
+ * @retval    -1        Error
+ * @retval     0        Edit failed, cbret set
+ * @retval     1        OK
+ * @see xmldb_put  with same semantics for shared datastores
+ */
+int
+privcand_edit(clicon_handle       h,
+	      uint32_t            id,
+	      enum operation_type op,
+	      cxobj              *xc,
+	      char               *username,
+	      cbuf               *cbret)
+{
+    int                   retval = -1;
+    struct privcand      *pc;
+    struct privcand_edit *pe = NULL;
+    int                   ret;
+
+    if ((pc = privcand_find(id)) == NULL &&
+	(pc = privcand_new(h, id)) == NULL)
+	goto done;
+    if ((pe = malloc(sizeof(*pe))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    memset(pe, 0, sizeof(*pe));
+    pe->pe_op = op;
+    if ((pe->pe_xml = xml_dup(xc)) == NULL)
+	goto done;
+    if (username && (pe->pe_username = strdup(username)) == NULL){
+	clicon_err(OE_UNIX, errno, "strdup");
+	goto done;
+    }
+    if (pc->pc_materialized &&
+	pc->pc_rgen == xmldb_gen_get(h, "running")){
+	if ((ret = xmldb_put(h, pc->pc_db, op, xc, username, cbret)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto fail;
+    }
+    ADDQ(pe, pc->pc_edits);
+    pe = NULL;
+    retval = 1;
+ done:
+    if (pe){
+	if (pe->pe_xml)
+	    xml_free(pe->pe_xml);
+	if (pe->pe_username)
+	    free(pe->pe_username);
+	free(pe);
+    }
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Get name of datastore holding the private candidate of a session
+ *
+ * If the session has not edited its candidate, it is identical to running.
+ * @param[in]  h      Clicon handle
+ * @param[in]  id     Session id
+ * @param[out] db     Name of datastore to use instead of "candidate"
+ * @param[out] cbret  Error message if conflict
+ * @retval    -1      Error
+ * @retval     0      Conflict, the private candidate cannot be rebased on running, cbret set
+ * @retval     1      OK, db set
+ */
+int
+privcand_db(clicon_handle h,
+	    uint32_t      id,
+	    char        **db,
+	    cbuf         *cbret)
+{
+    int              retval = -1;
+    struct privcand *pc;
+    int              ret;
+
+    if ((pc = privcand_find(id)) == NULL){
+	*db = "running";
+	goto ok;
+    }
+    if ((ret = privcand_materialize(h, pc, cbret)) < 0)
+	goto done;
+    if (ret == 0)
+	goto fail;
+    *db = pc->pc_db;
+ ok:
+    retval = 1;
+ done:
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Commit the private candidate of a session to running
+ *
+ * The private candidate is first rebased on the current running, then committed in
+ * a regular transaction. On success the private candidate is removed, and the
+ * next edit branches a new one from running.
+ * @param[in]  h      Clicon handle
+ * @param[in]  id     Session id
+ * @param[out] cbret  Error message if conflict or validation fails
+ * @retval    -1      Error
+ * @retval     0      Conflict or validation failed, cbret set
+ * @retval     1      OK
+ * @see candidate_commit
+ */
+int
+privcand_commit(clicon_handle h,
+		uint32_t      id,
+		cbuf         *cbret)
+{
+    int              retval = -1;
+    struct privcand *pc;
+    int              ret;
+
+    if ((pc = privcand_find(id)) == NULL)
+	goto ok; /* Nothing edited */
+    if ((ret = privcand_materialize(h, pc, cbret)) < 0)
+	goto done;
+    if (ret == 0)
+	goto fail;
+    if ((ret = candidate_commit(h, pc->pc_db, cbret)) < 0)
+	goto done;
+    if (ret == 0)
+	goto fail;
+    if (privcand_free(h, id) < 0)
+	goto done;
+ ok:
+    retval = 1;
+ done:
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Revert the private candidate of a session to running
+ * @param[in]  h   Clicon handle
+ * @param[in]  id  Session id
+ * @retval     0   OK
+ * @retval    -1   Error
+ */
+int
+privcand_discard(clicon_handle h,
+		 uint32_t      id)
+{
+    return privcand_free(h, id);
+}
+
+/*! Replace the private candidate of a session with the contents of a datastore
+ *
+ * Used by copy-config and delete-config with candidate as target.
+ * @param[in]  h        Clicon handle
+ * @param[in]  id       Session id
+ * @param[in]  src      Source datastore, or NULL for an empty candidate
+ * @param[in]  username User making the edit
+ * @param[out] cbret    Error message if edit fails
+ * @retval    -1        Error
+ * @retval     0        Edit failed, cbret set
+ * @retval     1        OK
+ */
+int
+privcand_replace(clicon_handle h,
+		 uint32_t      id,
+		 char         *src,
+		 char         *username,
+		 cbuf         *cbret)
+{
+    int    retval = -1;
+    cxobj *xt = NULL;
+
+    if (privcand_discard(h, id) < 0)
+	goto done;
+    /* A discarded private candidate is identical to running */
+    if (src && strcmp(src, "running") == 0)
+	goto ok;
+    if (src){
+	if (xmldb_get0(h, src, YB_MODULE, NULL, "/", 1, &xt, NULL) < 0)
+	    goto done;
+	if (xmldb_get0_clear(h, xt) < 0) /* Remove default values */
+	    goto done;
+    }
+    else if ((xt = xml_new("config", NULL, CX_ELMNT)) == NULL)
+	goto done;
+    retval = privcand_edit(h, id, OP_REPLACE, xt, username, cbret);
+    goto done;
+ ok:
+    retval = 1;
+ done:
+    if (xt)
+	xml_free(xt);
+    return retval;
+}
+
+/*! Free a private candidate, its edit log and its datastore
+ * @param[in]  h   Clicon handle
+ * @param[in]  id  Session id
+ * @retval     0   OK
+ * @retval    -1   Error
+ */
+int
+privcand_free(clicon_handle h,
+	      uint32_t      id)
+{
+    int                   retval = -1;
+    struct privcand      *pc;
+    struct privcand_edit *pe;
+    char                 *dbfile = NULL;
+    struct stat           st;
+
+    if ((pc = privcand_find(id)) == NULL)
+	goto ok;
+    DELQ(pc, privcand_list, struct privcand *);
+    while ((pe = pc->pc_edits) != NULL){
+	DELQ(pe, pc->pc_edits, struct privcand_edit *);
+	if (pe->pe_xml)
+	    xml_free(pe->pe_xml);
+	if (pe->pe_username)
+	    free(pe->pe_username);
+	free(pe);
+    }
+    privcand_base_put(pc->pc_base);
+    /* Remove cache, db element and file of private datastore */
+    if (xmldb_clear(h, pc->pc_db) < 0)
+	goto done;
+    if (clicon_hash_lookup(clicon_db_elmnt(h), pc->pc_db) != NULL &&
+	clicon_hash_del(clicon_db_elmnt(h), pc->pc_db) < 0)
+	goto done;
+    if (xmldb_db2file(h, pc->pc_db, &dbfile) < 0)
+	goto done;
+    if (lstat(dbfile, &st) == 0)
+	unlink(dbfile);
+    free(pc->pc_db);
+    free(pc);
+ ok:
+    retval = 0;
+ done:
+    if (dbfile)
+	free(dbfile);
+    return retval;
+}
+
+/*! Free all private candidates, eg on backend exit
+ * @param[in]  h   Clicon handle
+ * @retval     0   OK
+ * @retval    -1   Error
+ */
+int
+privcand_free_all(clicon_handle h)
+{
+    while (privcand_list != NULL)
+	if (privcand_free(h, privcand_list->pc_id) < 0)
+	    return -1;
+    return 0;
+}
@@ -0,0 +1,373 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2020 Olof Hagsand and Rubicon Communications, LLC(Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2,
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ * Backend request scheduler
+ * Enabled with option CLICON_BACKEND_SCHEDULER.
+ *
+ * Without the scheduler, requests are dispatched as soon as they are read, and
+ * all pipelined requests of a client are dispatched at once. Clients sending many
+ * or large requests then delay short requests of other clients, including control
+ * requests such as lock or kill-session.
+ * With the scheduler, a client with a complete request is instead queued, and no
+ * more input is read from it until the request has been served. Queued requests 
+ * are served one at a time from a zero timeout, so that input from all clients is
+ * read between two requests. The request served is the first queued of the 
+ * highest priority class:
+ *   1. control: hello, lock, unlock, close-session, kill-session, etc
+ *   2. write:   edit-config, commit, etc, and all application rpcs
+ *   3. read:    get, get-config, validate
+ * Clients are served round-robin within a class. A lower class is served first
+ * if it has waited for SCHED_WAIT_MAX requests, so that it is not starved.
+ * A request is still served to completion. Streamed replies yield after each
+ * frame, see client_output_flush, and long reads can be served by workers, see
+ * CLICON_BACKEND_WORKERS.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <errno.h>
+#include <syslog.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/socket.h>
+#include <sys/param.h>
+#include <netinet/in.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clicon */
+#include <clixon/clixon.h>
+
+#include "backend_client.h"
+#include "backend_sched.h"
+
+/*
+ * Constants
+ */
+/* Max number of requests of higher classes served while a class waits */
+#define SCHED_WAIT_MAX 16
+
+/* Max length of an operation name used for classification */
+#define SCHED_NAMELEN 64
+
+/*
+ * Types
+ */
+/* Priority class of a request, in priority order */
+enum sched_class{
+    SCHED_CONTROL = 0,
+    SCHED_WRITE,
+    SCHED_READ,
+    SCHED_NR       /* Number of classes */
+};
+
+/* Queue of clients with a request of one class, linked by ce_sched_next */
+struct sched_queue{
+    struct client_entry *sq_first;
+    struct client_entry *sq_last;
+    int                  sq_wait;  /* Requests served while the queue was waiting */
+};
+
+/*
+ * Internal variables
+ */
+/* Operations with other than the write class */
+static const map_str2int sched_class_map[] = {
+    {"hello",               SCHED_CONTROL},
+    {"lock",                SCHED_CONTROL},
+    {"unlock",              SCHED_CONTROL},
+    {"close-session",       SCHED_CONTROL},
+    {"kill-session",        SCHED_CONTROL},
+    {"create-subscription", SCHED_CONTROL},
+    {"ping",                SCHED_CONTROL},
+    {"debug",               SCHED_CONTROL},
+    {"get",                 SCHED_READ},
+    {"get-config",          SCHED_READ},
+    {"validate",            SCHED_READ},
+    {"stats",               SCHED_READ},
+    {NULL,                  -1}
+};
+
+/* Queues indexed by class */
+static struct sched_queue _sched[SCHED_NR] = {{0,},};
+
+/* Set if the scheduler timeout is registered */
+static int _sched_armed = 0;
+
+static int sched_run(int fd, void *arg);
+
+/*! Find next start element in an XML message, skipping declarations and comments
+ * @param[in]  s    Position in message
+ * @param[in]  end  End of message
+ * @retval     p    First character of element name
+ * @retval     NULL No start element found
+ */
+static char *
+sched_element(char *s,
+	      char *end)
+{
+    while (s < end){
+	if (isspace(*s))
+	    s++;
+	else if (*s != '<' || s+1 >= end || *(s+1) == '/')
+	    return NULL;
+	else if (*(s+1) == '?' || *(s+1) == '!'){
+	    while (s < end && *s != '>')
+		s++;
+	    s++;
+	}
+	else
+	    return s+1;
+    }
+    return NULL;
+}
+
+/*! Copy element name at a position in an XML message without prefix
+ * @param[in]  s    First character of element name
+ * @param[in]  end  End of message
+ * @param[out] name Buffer of size SCHED_NAMELEN, empty if name is too long
+ * @retval     p    Position after element name
+ */
+static char *
+sched_name(char *s,
+	   char *end,
+	   char *name)
+{
+    int i = 0;
+
+    while (s < end && !isspace(*s) && *s != '>' && *s != '/' && *s != '\0'){
+	if (*s == ':')
+	    i = 0;
+	else if (i < SCHED_NAMELEN)
+	    name[i++] = *s;
+	s++;
+    }
+    if (i == SCHED_NAMELEN)
+	i = 0;
+    name[i] = '\0';
+    return s;
+}
+
+/*! Get priority class of a request from the operation name
+ * The message is not parsed, only the name of the operation element is found,
+ * eg lock in <rpc><lock>... A message that cannot be classified is a write.
+ * @param[in]  msg  Complete message
+ * @retval     c    Priority class
+ */
+static enum sched_class
+sched_class(struct clicon_msg *msg)
+{
+    char *s;
+    char *end;
+    char  name[SCHED_NAMELEN+1];
+    char  quote = 0;
+    int   c;
+
+    end = (char*)msg + (ntohl(msg->op_len) & ~CLICON_MSG_FLAGS);
+    if ((s = sched_element(msg->op_body, end)) == NULL)
+	return SCHED_WRITE;
+    s = sched_name(s, end, name);
+    if (strcmp(name, "rpc") == 0){
+	/* Skip attributes to end of start tag */
+	for (; s < end && (quote || *s != '>'); s++)
+	    if (*s == '"' || *s == '\''){
+		if (quote == 0)
+		    quote = *s;
+		else if (quote == *s)
+		    quote = 0;
+	    }
+	if (s >= end || *(s-1) == '/')
+	    return SCHED_WRITE;
+	if ((s = sched_element(s+1, end)) == NULL)
+	    return SCHED_WRITE;
+	sched_name(s, end, name);
+    }
+    if ((c = clicon_str2int(sched_class_map, name)) < 0)
+	return SCHED_WRITE;
+    return c;
+}
+
+/*! Register zero timeout to serve next request, if any and not registered
+ * @param[in]  h    Clicon handle
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+sched_arm(clicon_handle h)
+{
+    struct timeval t;
+    int            c;
+
+    if (_sched_armed)
+	return 0;
+    for (c=0; c<SCHED_NR; c++)
+	if (_sched[c].sq_first)
+	    break;
+    if (c == SCHED_NR)
+	return 0;
+    gettimeofday(&t, NULL);
+    if (clixon_event_reg_timeout(t, sched_run, h, "backend scheduler") < 0)
+	return -1;
+    _sched_armed = 1;
+    return 0;
+}
+
+/*! Select queue of next request to serve
+ * @retval     c    Class of queue
+ * @retval    -1    All queues are empty
+ */
+static int
+sched_select(void)
+{
+    int c;
+    int sel = -1;
+
+    for (c=0; c<SCHED_NR; c++){
+	if (_sched[c].sq_first == NULL)
+	    continue;
+	if (sel == -1 || _sched[c].sq_wait >= SCHED_WAIT_MAX)
+	    sel = c;
+	if (_sched[c].sq_wait >= SCHED_WAIT_MAX)
+	    break;
+    }
+    if (sel == -1)
+	return -1;
+    for (c=0; c<SCHED_NR; c++)
+	if (c == sel)
+	    _sched[c].sq_wait = 0;
+	else if (_sched[c].sq_first)
+	    _sched[c].sq_wait++;
+    return sel;
+}
+
+/*! Scheduler timeout: serve the next request
+ * @param[in]  fd   Not used
+ * @param[in]  arg  Clicon handle
+ * @retval     0    OK
+ * @retval    -1    Error, terminates backend
+ */
+static int
+sched_run(int   fd,
+	  void *arg)
+{
+    clicon_handle        h = (clicon_handle)arg;
+    struct sched_queue  *sq;
+    struct client_entry *ce;
+    int                  c;
+
+    _sched_armed = 0;
+    if ((c = sched_select()) < 0)
+	return 0;
+    sq = &_sched[c];
+    ce = sq->sq_first;
+    if ((sq->sq_first = ce->ce_sched_next) == NULL)
+	sq->sq_last = NULL;
+    ce->ce_sched_next = NULL;
+    ce->ce_sched = 0;
+    clicon_debug(2, "%s client %d class %d", __FUNCTION__, ce->ce_nr, c);
+    if (backend_client_input_serve(h, ce) < 0)
+	return -1;
+    return sched_arm(h);
+}
+
+/*! Queue a client with a complete request to be served by the scheduler
+ * No more input should be read from the client until the request is served.
+ * @param[in]  h    Clicon handle
+ * @param[in]  ce   Client entry
+ * @param[in]  msg  Complete request first in input buffer of client
+ * @retval     0    OK
+ * @retval    -1    Error
+ * @see backend_client_input_serve
+ */
+int
+backend_sched_add(clicon_handle        h,
+		  struct client_entry *ce,
+		  struct clicon_msg   *msg)
+{
+    struct sched_queue *sq;
+
+    if (ce->ce_sched)
+	return 0;
+    sq = &_sched[sched_class(msg)];
+    if (sq->sq_last)
+	sq->sq_last->ce_sched_next = ce;
+    else
+	sq->sq_first = ce;
+    sq->sq_last = ce;
+    ce->ce_sched_next = NULL;
+    ce->ce_sched = 1;
+    return sched_arm(h);
+}
+
+/*! Remove a client from the scheduler, if queued
+ * @param[in]  ce   Client entry
+ */
+int
+backend_sched_rm(struct client_entry *ce)
+{
+    struct sched_queue  *sq;
+    struct client_entry *c;
+    struct client_entry *prev;
+    int                  i;
+
+    if (ce->ce_sched == 0)
+	return 0;
+    for (i=0; i<SCHED_NR; i++){
+	sq = &_sched[i];
+	prev = NULL;
+	for (c = sq->sq_first; c; c = c->ce_sched_next){
+	    if (c == ce)
+		break;
+	    prev = c;
+	}
+	if (c == NULL)
+	    continue;
+	if (prev)
+	    prev->ce_sched_next = ce->ce_sched_next;
+	else
+	    sq->sq_first = ce->ce_sched_next;
+	if (sq->sq_last == ce)
+	    sq->sq_last = prev;
+	break;
+    }
+    ce->ce_sched_next = NULL;
+    ce->ce_sched = 0;
+    return 0;
+}
@@ -0,0 +1,400 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2020 Olof Hagsand and Rubicon Communications, LLC(Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2,
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ * Backend workers for read-only requests
+ * Enabled with option CLICON_BACKEND_WORKERS.
+ *
+ * The backend serves all requests in one event loop, so a long-running read,
+ * eg a get of a large state subtree, delays all other clients. Such requests can
+ * instead be served by a worker: a process forked from the backend that handles
+ * the request and sends the reply back over a pipe, and then exits.
+ * The worker has a copy-on-write snapshot of the backend, including the datastore
+ * cache, pinned at the time the request is read. Several workers may run
+ * concurrently on different cores, while the backend continues to serve other
+ * requests, including edits, commits and locks, which are always made by the 
+ * backend itself.
+ * Requests of one client are still served in order: no more requests are read
+ * from a client while a worker serves it.
+ * get-config is always served by a worker if one is available. get and validate
+ * call plugin callbacks, and are only served by workers if all plugins with
+ * such callbacks have set the CLIXON_PLUGIN_WORKER flag, declaring that the
+ * callbacks may run in a worker process, ie that they do not need to change
+ * backend state.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <syslog.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <sys/socket.h>
+#include <sys/param.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clicon */
+#include <clixon/clixon.h>
+
+#include "clixon_backend_statedata.h"
+#include "backend_client.h"
+#include "backend_worker.h"
+
+/*
+ * Constants
+ */
+/* Size of chunks read from worker reply pipe */
+#define WORKER_BUFSIZE 65536
+
+/*
+ * Types
+ */
+/* A running worker, as seen from the backend */
+struct backend_worker{
+    struct backend_worker *w_next;   /* Next running worker */
+    clicon_handle          w_h;      /* Clicon handle */
+    pid_t                  w_pid;    /* Worker process id */
+    int                    w_fd;     /* Read end of reply pipe */
+    struct client_entry   *w_ce;     /* Client served, NULL if it has closed */
+    cbuf                  *w_cb;     /* Reply read so far */
+};
+
+/*
+ * Internal variables
+ */
+/* List of running workers (in backend) */
+static struct backend_worker *_workers = NULL;
+
+/* Number of running workers (in backend) */
+static int _workers_nr = 0;
+
+/* Write end of reply pipe (in worker), -1 in backend */
+static int _worker_fd = -1;
+
+static int worker_input(int s, void *arg);
+
+/*! Check if all plugins with a callback may run it in a worker
+ * @param[in]  h         Clicon handle
+ * @param[in]  statedata Check statedata callbacks
+ * @param[in]  trans     Check transaction callbacks
+ * @retval     1         Yes, all plugins (and state data providers) have set
+ *                       CLIXON_PLUGIN_WORKER, or have no such callback
+ * @retval     0         No
+ */
+static int
+worker_plugins_ok(clicon_handle h,
+		  int           statedata,
+		  int           trans)
+{
+    clixon_plugin      *cp = NULL;
+    clixon_plugin_api  *api;
+    statedata_provider *sp = NULL;
+
+    while ((cp = clixon_plugin_each(h, cp)) != NULL) {
+	api = &cp->cp_api;
+	if (api->ca_flags & CLIXON_PLUGIN_WORKER)
+	    continue;
+	if (statedata && api->ca_statedata)
+	    return 0;
+	if (trans && (api->ca_trans_begin || api->ca_trans_validate ||
+		      api->ca_trans_complete || api->ca_trans_end ||
+		      api->ca_trans_abort))
+	    return 0;
+    }
+    if (statedata)
+	while ((sp = clixon_statedata_provider_each(h, sp, NULL, NULL)) != NULL)
+	    if ((sp->sp_flags & CLIXON_PLUGIN_WORKER) == 0)
+		return 0;
+    return 1;
+}
+
+/*! Check if a request can be served by a worker
+ * @param[in]  h      Clicon handle
+ * @param[in]  xrpc   The rpc element of the request
+ * @retval     1      Yes, request is read-only
+ * @retval     0      No
+ */
+static int
+worker_request_ok(clicon_handle h,
+		  cxobj        *xrpc)
+{
+    cxobj *xe;
+    char  *name;
+    char  *ns = NULL;
+
+    if (xml_child_nr_type(xrpc, CX_ELMNT) != 1)
+	return 0;
+    xe = xml_child_i_type(xrpc, 0, CX_ELMNT);
+    if (xml2ns(xe, xml_prefix(xe), &ns) < 0 || ns == NULL ||
+	strcmp(ns, NETCONF_BASE_NAMESPACE) != 0)
+	return 0;
+    name = xml_name(xe);
+    if (strcmp(name, "get-config") == 0)
+	return 1;
+    if (strcmp(name, "get") == 0)
+	return worker_plugins_ok(h, 1, 0);
+    if (strcmp(name, "validate") == 0)
+	return worker_plugins_ok(h, 0, 1);
+    return 0;
+}
+
+/*! Free a worker struct in backend
+ */
+static int
+worker_free(struct backend_worker *w)
+{
+    if (w->w_cb)
+	cbuf_free(w->w_cb);
+    free(w);
+    return 0;
+}
+
+/*! Worker has exited: send its reply to the client and continue reading requests
+ * @param[in]  w   Worker
+ * @retval     0   OK
+ * @retval    -1   Error
+ */
+static int
+worker_done(struct backend_worker *w)
+{
+    int                     retval = -1;
+    struct backend_worker **wp;
+    struct client_entry    *ce;
+    int                     status = 0;
+
+    clixon_event_unreg_fd(w->w_fd, worker_input);
+    close(w->w_fd);
+    while (waitpid(w->w_pid, &status, 0) < 0 && errno == EINTR)
+	;
+    for (wp = &_workers; *wp; wp = &(*wp)->w_next)
+	if (*wp == w){
+	    *wp = w->w_next;
+	    break;
+	}
+    _workers_nr--;
+    if ((ce = w->w_ce) != NULL){
+	ce->ce_worker = NULL;
+	if (!WIFEXITED(status) || WEXITSTATUS(status) != 0 || cbuf_len(w->w_cb) == 0){
+	    clicon_log(LOG_WARNING, "%s: worker %d for client %d failed", 
+		       __FUNCTION__, w->w_pid, ce->ce_nr);
+	    cbuf_reset(w->w_cb);
+	    if (netconf_operation_failed(w->w_cb, "application", "Backend worker failed") < 0)
+		goto done;
+	}
+	if (backend_client_send(ce, w->w_cb, 0) < 0){
+	    w->w_cb = NULL;
+	    goto done;
+	}
+	w->w_cb = NULL;
+	if (backend_client_input_resume(w->w_h, ce) < 0)
+	    goto done;
+    }
+    retval = 0;
+ done:
+    worker_free(w);
+    return retval;
+}
+
+/*! Reply data is available from a worker
+ * @param[in]  s    Read end of reply pipe
+ * @param[in]  arg  Worker
+ * @retval     0    OK
+ * @retval    -1    Error, terminates backend
+ */
+static int
+worker_input(int   s,
+	     void *arg)
+{
+    struct backend_worker *w = (struct backend_worker *)arg;
+    static char            buf[WORKER_BUFSIZE+1];
+    ssize_t                n;
+
+    if ((n = read(s, buf, WORKER_BUFSIZE)) < 0){
+	if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+	    return 0;
+	clicon_err(OE_UNIX, errno, "read");
+	return -1;
+    }
+    if (n == 0) /* Worker has exited */
+	return worker_done(w);
+    buf[n] = '\0';
+    cbuf_append_str(w->w_cb, buf);
+    return 0;
+}
+
+/*! Serve a request by a worker if it is read-only and a worker is available
+ * In the backend, the worker is started and no more requests are read from the
+ * client until the worker has replied.
+ * In the worker, the caller continues processing the request and replies with
+ * backend_worker_reply().
+ * @param[in]  h     Clicon handle
+ * @param[in]  ce    Client entry
+ * @param[in]  xrpc  The rpc element of the request
+ * @retval     1     Request is served by a worker (in backend)
+ * @retval     0     Process request here (in worker, or no worker was started)
+ * @retval    -1     Error
+ */
+int
+backend_worker_start(clicon_handle        h,
+		     struct client_entry *ce,
+		     cxobj               *xrpc)
+{
+    int                    retval = -1;
+    struct backend_worker *w = NULL;
+    int                    fd[2] = {-1, -1};
+    int                    max;
+
+    if (_worker_fd != -1 || ce->ce_worker != NULL)
+	goto noworker;
+    if ((max = clicon_option_int(h, "CLICON_BACKEND_WORKERS")) <= 0 || 
+	_workers_nr >= max)
+	goto noworker;
+    if (worker_request_ok(h, xrpc) == 0)
+	goto noworker;
+    if ((w = malloc(sizeof(*w))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    memset(w, 0, sizeof(*w));
+    if ((w->w_cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    if (pipe(fd) < 0){
+	clicon_err(OE_UNIX, errno, "pipe");
+	goto done;
+    }
+    if ((w->w_pid = fork()) < 0){
+	clicon_err(OE_UNIX, errno, "fork");
+	goto done;
+    }
+    if (w->w_pid == 0){ /* Worker */
+	close(fd[0]);
+	fd[0] = -1;
+	_worker_fd = fd[1];
+	fd[1] = -1;
+	goto noworker;
+    }
+    /* Backend */
+    close(fd[1]);
+    fd[1] = -1;
+    w->w_h = h;
+    w->w_fd = fd[0];
+    fd[0] = -1;
+    w->w_ce = ce;
+    if (fcntl(w->w_fd, F_SETFL, O_NONBLOCK) < 0){
+	clicon_err(OE_UNIX, errno, "fcntl");
+	goto done;
+    }
+    if (clixon_event_reg_fd(w->w_fd, worker_input, (void*)w, "backend worker") < 0)
+	goto done;
+    clicon_debug(1, "%s worker %d for client %d", __FUNCTION__, w->w_pid, ce->ce_nr);
+    w->w_next = _workers;
+    _workers = w;
+    _workers_nr++;
+    ce->ce_worker = w;
+    w = NULL;
+    retval = 1;
+ done:
+    if (fd[0] != -1)
+	close(fd[0]);
+    if (fd[1] != -1)
+	close(fd[1]);
+    if (w){
+	if (w->w_fd > 0)
+	    close(w->w_fd);
+	worker_free(w);
+    }
+    return retval;
+ noworker:
+    retval = 0;
+    goto done;
+}
+
+/*! Check if this process is a worker
+ * @retval  1  This is a worker
+ * @retval  0  This is the backend
+ */
+int
+backend_worker_child(void)
+{
+    return _worker_fd != -1;
+}
+
+/*! Send reply from worker to backend and exit the worker
+ * @param[in]  cbret  Reply, or NULL on error
+ * @note Does not return
+ */
+void
+backend_worker_reply(cbuf *cbret)
+{
+    char   *buf;
+    size_t  len;
+    ssize_t n;
+
+    if (cbret == NULL || cbuf_len(cbret) == 0)
+	_exit(1);
+    buf = cbuf_get(cbret);
+    len = cbuf_len(cbret);
+    while (len > 0){
+	if ((n = write(_worker_fd, buf, len)) < 0){
+	    if (errno == EINTR)
+		continue;
+	    _exit(1);
+	}
+	buf += n;
+	len -= n;
+    }
+    _exit(0);
+}
+
+/*! Client is removed while served by a worker, discard the reply
+ * @param[in]  ce   Client entry
+ */
+int
+backend_worker_detach(struct client_entry *ce)
+{
+    if (ce->ce_worker){
+	ce->ce_worker->w_ce = NULL;
+	ce->ce_worker = NULL;
+    }
+    return 0;
+}
@@ -50,6 +50,7 @@ extern "C" {
 /* Common code (API and Backend daemon) */
 #include <clixon/clixon_backend_handle.h>
 #include <clixon/clixon_backend_transaction.h>
+#include <clixon/clixon_backend_statedata.h>
 
 #endif /* _CLIXON_BACKEND_H_ */
 
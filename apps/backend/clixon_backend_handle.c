@@ -70,6 +70,9 @@
 
 #define handle(h) (assert(clicon_handle_check(h)==0),(struct backend_handle *)(h))
 
+/* Initial size of session id hash table of clients */
+#define CLIENT_HASH_SIZE 64
+
 /* Clicon_handle for backends.
  * First part of this is header, same for clicon_handle and cli_handle.
  * Access functions for common fields are found in clicon lib: clicon_options.[ch]
@@ -92,6 +95,9 @@ struct backend_handle {
     /* ------ end of common handle ------ */
     struct client_entry     *bh_ce_list;   /* The client list */
     int                      bh_ce_nr;     /* Number of clients, just increment */
+    size_t                   bh_ce_len;    /* Number of clients in client list */
+    struct client_entry    **bh_ce_hash;   /* Clients hashed by session id */
+    size_t                   bh_ce_hsize;  /* Size of bh_ce_hash, power of 2 */
 };
 
 /*! Creates and returns a clicon config handle for other CLICON API calls
@@ -109,6 +115,7 @@ backend_handle_init(void)
 int
 backend_handle_exit(clicon_handle h)
 {
+    struct backend_handle *bh = handle(h);
     struct client_entry   *ce;
 
     /* only delete client structs, not close sockets, etc, see backend_client_rm WHY NOT? */
@@ -119,10 +126,89 @@ backend_handle_exit(clicon_handle h)
 	}
 	backend_client_delete(h, ce);
     }
+    if (bh->bh_ce_hash)
+	free(bh->bh_ce_hash);
     clicon_handle_exit(h); /* frees h and options (and streams) */
     return 0;
 }
 
+/*! Get hash bucket of a session id
+ * @param[in]  bh  Backend handle
+ * @param[in]  id  Session id
+ */
+static struct client_entry **
+client_hash_bucket(struct backend_handle *bh,
+		   uint32_t               id)
+{
+    return &bh->bh_ce_hash[id & (bh->bh_ce_hsize-1)];
+}
+
+/*! Remove client from session id hash table, if it is there
+ * @param[in]  bh  Backend handle
+ * @param[in]  ce  Client entry
+ */
+static void
+client_hash_rm(struct backend_handle *bh,
+	       struct client_entry   *ce)
+{
+    struct client_entry **cp;
+
+    if (!ce->ce_hashed)
+	return;
+    ce->ce_hashed = 0;
+    for (cp = client_hash_bucket(bh, ce->ce_id); *cp; cp = &(*cp)->ce_id_next)
+	if (*cp == ce){
+	    *cp = ce->ce_id_next;
+	    break;
+	}
+    ce->ce_id_next = NULL;
+}
+
+/*! Add client to session id hash table
+ * @param[in]  bh  Backend handle
+ * @param[in]  ce  Client entry
+ */
+static void
+client_hash_add(struct backend_handle *bh,
+		struct client_entry   *ce)
+{
+    struct client_entry **cp;
+
+    cp = client_hash_bucket(bh, ce->ce_id);
+    ce->ce_id_next = *cp;
+    *cp = ce;
+    ce->ce_hashed = 1;
+}
+
+/*! Double size of session id hash table if it has as many clients as buckets
+ * @param[in]  bh  Backend handle
+ * @retval     0   OK
+ * @retval    -1   Error
+ */
+static int
+client_hash_grow(struct backend_handle *bh)
+{
+    struct client_entry **hash;
+    struct client_entry  *ce;
+    size_t                hsize;
+
+    if (bh->bh_ce_len < bh->bh_ce_hsize)
+	return 0;
+    hsize = bh->bh_ce_hsize ? 2*bh->bh_ce_hsize : CLIENT_HASH_SIZE;
+    if ((hash = calloc(hsize, sizeof(*hash))) == NULL){
+	clicon_err(OE_UNIX, errno, "calloc");
+	return -1;
+    }
+    if (bh->bh_ce_hash)
+	free(bh->bh_ce_hash);
+    bh->bh_ce_hash = hash;
+    bh->bh_ce_hsize = hsize;
+    for (ce = bh->bh_ce_list; ce; ce = ce->ce_next)
+	if (ce->ce_hashed)
+	    client_hash_add(bh, ce);
+    return 0;
+}
+
 /*! Add new client, typically frontend such as cli, netconf, restconf
  * @param[in]  h        Clicon handle
  * @param[in]  addr     Address of client
@@ -136,6 +222,8 @@ backend_client_add(clicon_handle    h,
     struct backend_handle *bh = handle(h);
     struct client_entry   *ce;
 
+    if (client_hash_grow(bh) < 0)
+	return NULL;
     if ((ce = (struct client_entry *)malloc(sizeof(*ce))) == NULL){
 	clicon_err(OE_PLUGIN, errno, "malloc");
 	return NULL;
@@ -143,8 +231,11 @@ backend_client_add(clicon_handle    h,
     memset(ce, 0, sizeof(*ce));
     ce->ce_nr = bh->bh_ce_nr++; /* Session-id ? */
     memcpy(&ce->ce_addr, addr, sizeof(*addr));
-    ce->ce_next = bh->bh_ce_list;
+    if ((ce->ce_next = bh->bh_ce_list) != NULL)
+	ce->ce_next->ce_prevp = &ce->ce_next;
+    ce->ce_prevp = &bh->bh_ce_list;
     bh->bh_ce_list = ce;
+    bh->bh_ce_len++;
     return ce;
 }
 
@@ -160,7 +251,51 @@ backend_client_list(clicon_handle h)
     return bh->bh_ce_list;
 }
 
+/*! Find client by session id
+ * @param[in]  h   Clicon handle
+ * @param[in]  id  Session id
+ * @retval     ce  Client entry, the one whose session id was set last if several
+ * @retval     NULL Not found
+ */
+struct client_entry *
+backend_client_find(clicon_handle h,
+		    uint32_t      id)
+{
+    struct backend_handle *bh = handle(h);
+    struct client_entry   *ce;
+
+    if (bh->bh_ce_hash == NULL)
+	return NULL;
+    for (ce = *client_hash_bucket(bh, id); ce; ce = ce->ce_id_next)
+	if (ce->ce_id == id)
+	    return ce;
+    return NULL;
+}
+
+/*! Set session id of client
+ * The client is added to the session id hash table when its session id is first set,
+ * so that a new client is not found by the initial session id 0.
+ * @param[in]  h   Clicon handle
+ * @param[in]  ce  Client entry
+ * @param[in]  id  Session id
+ */
+int
+backend_client_id_set(clicon_handle        h,
+		      struct client_entry *ce,
+		      uint32_t             id)
+{
+    struct backend_handle *bh = handle(h);
+
+    if (!ce->ce_hashed || ce->ce_id != id){
+	client_hash_rm(bh, ce);
+	ce->ce_id = id;
+	client_hash_add(bh, ce);
+    }
+    return 0;
+}
+
 /*! Actually remove client from client list
+ * Also removes all notification subscriptions of the client.
  * @param[in]  h   Clicon handle
  * @param[in]  ce  Client handle
  * @see backend_client_rm which is more high-level
@@ -169,21 +304,23 @@ int
 backend_client_delete(clicon_handle        h,
 		      struct client_entry *ce)
 {
-    struct client_entry   *c;
-    struct client_entry  **ce_prev;
     struct backend_handle *bh = handle(h);
 
-    ce_prev = &bh->bh_ce_list;
-    for (c = *ce_prev; c; c = c->ce_next){
-	if (c == ce){
-	    *ce_prev = c->ce_next;
-	    if (ce->ce_username)
-		free(ce->ce_username);
-	    free(ce);
-	    break;
-	}
-	ce_prev = &c->ce_next;
-    }
+    if (ce->ce_prevp == NULL) /* Not in list */
+	return 0;
+    if ((*ce->ce_prevp = ce->ce_next) != NULL)
+	ce->ce_next->ce_prevp = ce->ce_prevp;
+    client_hash_rm(bh, ce);
+    bh->bh_ce_len--;
+    stream_ss_delete_owner(h, &ce->ce_subscription);
+    if (ce->ce_username)
+	free(ce->ce_username);
+    if (ce->ce_ibuf)
+	free(ce->ce_ibuf);
+    if (ce->ce_reply_xml)
+	xml_free(ce->ce_reply_xml);
+    backend_client_output_free(ce);
+    free(ce);
     return 0;
 }
 
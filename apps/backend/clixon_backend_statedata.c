@@ -0,0 +1,800 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2020 Olof Hagsand and Rubicon Communications, LLC(Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2,
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ * State data cache
+ * Enabled with option CLICON_BACKEND_STATE_CACHE_TTL.
+ *
+ * State data of each plugin is cached per xpath and namespace context of the
+ * request, after it has been bound to yang and default values added. A get with 
+ * the same xpath within the TTL uses a copy of the cached tree instead of calling
+ * the statedata callback of the plugin.
+ * A plugin may:
+ *  - opt out of caching by setting CLIXON_PLUGIN_NOCACHE in ca_flags,
+ *  - set the TTL of the state data it returns, in its statedata callback, with
+ *    clixon_statedata_cache_ttl(),
+ *  - invalidate cached state data when it changes, with 
+ *    clixon_statedata_cache_invalidate().
+ * Hits and misses are shown by the stats rpc.
+ *
+ * State data providers
+ * Instead of (or in addition to) a ca_statedata callback, which is called on every
+ * get, a plugin may register providers of state data for specific subtrees with
+ * clixon_statedata_register(). A provider is only called if its subtree intersects
+ * the xpath of the request. Providers are cached as plugins, by function name.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <inttypes.h>
+#include <errno.h>
+#include <syslog.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/param.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clicon */
+#include <clixon/clixon.h>
+
+#include "clixon_backend_statedata.h"
+
+/*
+ * Constants
+ */
+/* Max number of cached entries. When full, expired entries are removed, and
+ * new entries are not cached if none have expired */
+#define STATEDATA_CACHE_MAX 1024
+
+/*
+ * Types
+ */
+/* Cached state data of one plugin for one xpath */
+struct statedata_entry{
+    cxobj          *se_xml;    /* State data, or NULL if plugin returned none */
+    struct timeval  se_expire; /* Cached until this time */
+};
+
+/* State data cache of a backend */
+struct statedata_cache{
+    clicon_hash_t  *sc_hash;   /* Entries keyed by plugin, xpath and namespaces */
+    size_t          sc_len;    /* Number of entries */
+    uint64_t        sc_hits;   /* Number of lookups found in cache */
+    uint64_t        sc_misses; /* Number of lookups not found in cache */
+    int64_t         sc_ttl;    /* TTL set by plugin in current callback, or -1 */
+};
+
+/*! Get state data cache of a backend, optionally create it
+ * @param[in]  h       Clicon handle
+ * @param[in]  create  Create cache if it does not exist
+ * @retval     sc      State data cache
+ * @retval     NULL    No cache, or error if create
+ */
+static struct statedata_cache *
+statedata_cache(clicon_handle h,
+		int           create)
+{
+    clicon_hash_t          *cdat = clicon_data(h);
+    struct statedata_cache *sc = NULL;
+    void                   *p;
+
+    if ((p = clicon_hash_value(cdat, "statedata_cache", NULL)) != NULL)
+	return *(struct statedata_cache **)p;
+    if (!create)
+	return NULL;
+    if ((sc = malloc(sizeof(*sc))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto err;
+    }
+    memset(sc, 0, sizeof(*sc));
+    sc->sc_ttl = -1;
+    if ((sc->sc_hash = clicon_hash_init()) == NULL)
+	goto err;
+    /* It is the pointer to sc that should be copied by hash */
+    if (clicon_hash_add(cdat, "statedata_cache", &sc, sizeof(sc)) == NULL)
+	goto err;
+    return sc;
+ err:
+    if (sc){
+	if (sc->sc_hash)
+	    clicon_hash_free(sc->sc_hash);
+	free(sc);
+    }
+    return NULL;
+}
+
+/*! Get list of state data providers of a backend
+ * @param[in]  h    Clicon handle
+ * @retval     sp   First provider of circular list
+ * @retval     NULL No providers
+ */
+static statedata_provider *
+statedata_provider_list(clicon_handle h)
+{
+    void *p;
+
+    if ((p = clicon_hash_value(clicon_data(h), "statedata_providers", NULL)) != NULL)
+	return *(statedata_provider **)p;
+    return NULL;
+}
+
+/*! Set list of state data providers of a backend
+ * @param[in]  h    Clicon handle
+ * @param[in]  sp   First provider of circular list, or NULL for no providers
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+statedata_provider_list_set(clicon_handle       h,
+			    statedata_provider *sp)
+{
+    clicon_hash_t *cdat = clicon_data(h);
+
+    if (sp == NULL){
+	clicon_hash_del(cdat, "statedata_providers");
+	return 0;
+    }
+    /* It is the pointer to sp that should be copied by hash */
+    if (clicon_hash_add(cdat, "statedata_providers", &sp, sizeof(sp)) == NULL)
+	return -1;
+    return 0;
+}
+
+/*! Check if state data may be cached
+ * @param[in]  h    Clicon handle
+ * @retval     1    Yes
+ * @retval     0    No, caching is disabled
+ */
+static int
+statedata_cacheable(clicon_handle h)
+{
+    return clicon_option_int(h, "CLICON_BACKEND_STATE_CACHE_TTL") > 0;
+}
+
+/*! Print cache key of state data of a plugin or provider for an xpath
+ * @param[in]  cb     Buffer
+ * @param[in]  name   Name of plugin or provider
+ * @param[in]  nsc    Namespace context of xpath
+ * @param[in]  xpath  XPath, or NULL
+ */
+static int
+statedata_key(cbuf       *cb,
+	      const char *name,
+	      cvec       *nsc,
+	      char       *xpath)
+{
+    cg_var *cv = NULL;
+
+    cprintf(cb, "%s\n%s\n", name, xpath?xpath:"");
+    while ((cv = cvec_each(nsc, cv)) != NULL)
+	cprintf(cb, "%s=%s\n", cv_name_get(cv)?cv_name_get(cv):"", cv_string_get(cv));
+    return 0;
+}
+
+/*! Remove and free a cache entry
+ * @param[in]  sc   State data cache
+ * @param[in]  key  Key of entry
+ */
+static int
+statedata_entry_rm(struct statedata_cache *sc,
+		   char                   *key)
+{
+    struct statedata_entry *se;
+    void                   *p;
+
+    if ((p = clicon_hash_value(sc->sc_hash, key, NULL)) == NULL)
+	return 0;
+    se = *(struct statedata_entry **)p;
+    if (se->se_xml)
+	xml_free(se->se_xml);
+    free(se);
+    clicon_hash_del(sc->sc_hash, key);
+    sc->sc_len--;
+    return 0;
+}
+
+/*! Remove entries matching plugin and xpath, or all expired entries
+ * @param[in]  sc      State data cache
+ * @param[in]  plugin  Name of plugin, or NULL for all 
+ * @param[in]  xpath   XPath, or NULL for all
+ * @param[in]  now     Remove expired entries only, or NULL
+ */
+static int
+statedata_purge(struct statedata_cache *sc,
+		const char             *plugin,
+		const char             *xpath,
+		struct timeval         *now)
+{
+    int                     retval = -1;
+    char                  **keys = NULL;
+    size_t                  klen;
+    size_t                  i;
+    size_t                  len;
+    char                   *k;
+    struct statedata_entry *se;
+
+    if (clicon_hash_keys(sc->sc_hash, &keys, &klen) < 0)
+	goto done;
+    for (i=0; i<klen; i++){
+	k = keys[i];
+	if (plugin){
+	    len = strlen(plugin);
+	    if (strncmp(k, plugin, len) != 0 || k[len] != '\n')
+		continue;
+	    k += len+1;
+	    if (xpath){
+		len = strlen(xpath);
+		if (strncmp(k, xpath, len) != 0 || k[len] != '\n')
+		    continue;
+	    }
+	}
+	if (now){
+	    se = *(struct statedata_entry **)clicon_hash_value(sc->sc_hash, keys[i], NULL);
+	    if (timercmp(now, &se->se_expire, <))
+		continue;
+	}
+	if (statedata_entry_rm(sc, keys[i]) < 0)
+	    goto done;
+    }
+    retval = 0;
+ done:
+    if (keys)
+	free(keys);
+    return retval;
+}
+
+/*! Set TTL of state data returned by a plugin statedata callback
+ * Call from the statedata callback to override CLICON_BACKEND_STATE_CACHE_TTL
+ * for the xpath of the request.
+ * @param[in]  h    Clicon handle
+ * @param[in]  ttl  Time to live in ms, 0 means not cached
+ * @retval     0    OK
+ * @retval    -1    Error
+ * @code
+ *   int
+ *   example_statedata(clicon_handle h, cvec *nsc, char *xpath, cxobj *xstate)
+ *   {
+ *     ...
+ *     clixon_statedata_cache_ttl(h, 10000); // Counters may be 10 seconds old
+ *   }
+ * @endcode
+ */
+int
+clixon_statedata_cache_ttl(clicon_handle h,
+			   uint32_t      ttl)
+{
+    struct statedata_cache *sc;
+
+    if ((sc = statedata_cache(h, 1)) == NULL)
+	return -1;
+    sc->sc_ttl = ttl;
+    return 0;
+}
+
+/*! Get and clear TTL set by a statedata callback with clixon_statedata_cache_ttl
+ * Used when state data is not put in the cache directly after the callback
+ * @param[in]  h    Clicon handle
+ * @retval     ttl  TTL in ms set by callback
+ * @retval    -1    No TTL was set
+ */
+int64_t
+clixon_statedata_cache_ttl_pop(clicon_handle h)
+{
+    struct statedata_cache *sc;
+    int64_t                 ttl;
+
+    if ((sc = statedata_cache(h, 0)) == NULL)
+	return -1;
+    ttl = sc->sc_ttl;
+    sc->sc_ttl = -1;
+    return ttl;
+}
+
+/*! Invalidate cached state data, eg when a plugin knows its state has changed
+ * @param[in]  h       Clicon handle
+ * @param[in]  plugin  Name of plugin (file name without extension) or of provider
+ *                     (callback function name), or NULL for all
+ * @param[in]  xpath   Invalidate state data cached for this xpath only, or NULL
+ *                     for all. Only used if plugin is given.
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+int
+clixon_statedata_cache_invalidate(clicon_handle h,
+				  const char   *plugin,
+				  const char   *xpath)
+{
+    struct statedata_cache *sc;
+
+    if ((sc = statedata_cache(h, 0)) == NULL)
+	return 0;
+    return statedata_purge(sc, plugin, xpath, NULL);
+}
+
+/*! Get cached state data of a plugin or provider
+ * @param[in]  h      Clicon handle
+ * @param[in]  name   Name of plugin or provider
+ * @param[in]  nsc    Namespace context of xpath
+ * @param[in]  xpath  XPath of request, or NULL
+ * @param[out] xp     Copy of cached state data, or NULL if none, free with xml_free
+ * @retval     1      Found in cache
+ * @retval     0      Not found, call the plugin and then clixon_statedata_cache_put
+ * @retval    -1      Error
+ */
+int
+clixon_statedata_cache_get(clicon_handle h,
+			   const char   *name,
+			   cvec         *nsc,
+			   char         *xpath,
+			   cxobj       **xp)
+{
+    int                     retval = -1;
+    struct statedata_cache *sc;
+    struct statedata_entry *se;
+    cbuf                   *cb = NULL;
+    struct timeval          now;
+    void                   *p;
+
+    *xp = NULL;
+    if (!statedata_cacheable(h))
+	goto miss;
+    if ((sc = statedata_cache(h, 1)) == NULL)
+	goto done;
+    sc->sc_ttl = -1;
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    statedata_key(cb, name, nsc, xpath);
+    if ((p = clicon_hash_value(sc->sc_hash, cbuf_get(cb), NULL)) != NULL){
+	se = *(struct statedata_entry **)p;
+	gettimeofday(&now, NULL);
+	if (timercmp(&now, &se->se_expire, <)){
+	    if (se->se_xml && (*xp = xml_dup(se->se_xml)) == NULL)
+		goto done;
+	    sc->sc_hits++;
+	    retval = 1;
+	    goto done;
+	}
+	if (statedata_entry_rm(sc, cbuf_get(cb)) < 0)
+	    goto done;
+    }
+    sc->sc_misses++;
+ miss:
+    retval = 0;
+ done:
+    if (cb)
+	cbuf_free(cb);
+    return retval;
+}
+
+/*! Cache state data returned by a plugin or provider
+ * @param[in]  h      Clicon handle
+ * @param[in]  name   Name of plugin or provider
+ * @param[in]  nsc    Namespace context of xpath
+ * @param[in]  xpath  XPath of request, or NULL
+ * @param[in]  x      State data, bound to yang, or NULL if none. Is copied
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @see clixon_statedata_cache_get
+ */
+int
+clixon_statedata_cache_put(clicon_handle h,
+			   const char   *name,
+			   cvec         *nsc,
+			   char         *xpath,
+			   cxobj        *x)
+{
+    int                     retval = -1;
+    struct statedata_cache *sc;
+    struct statedata_entry *se = NULL;
+    cbuf                   *cb = NULL;
+    struct timeval          now;
+    struct timeval          t;
+    uint32_t                ttl;
+
+    if (!statedata_cacheable(h) || (sc = statedata_cache(h, 0)) == NULL)
+	goto ok;
+    if (sc->sc_ttl >= 0)
+	ttl = sc->sc_ttl;
+    else
+	ttl = clicon_option_int(h, "CLICON_BACKEND_STATE_CACHE_TTL");
+    sc->sc_ttl = -1;
+    if (ttl == 0)
+	goto ok;
+    gettimeofday(&now, NULL);
+    if (sc->sc_len >= STATEDATA_CACHE_MAX){
+	if (statedata_purge(sc, NULL, NULL, &now) < 0)
+	    goto done;
+	if (sc->sc_len >= STATEDATA_CACHE_MAX)
+	    goto ok;
+    }
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    statedata_key(cb, name, nsc, xpath);
+    if (statedata_entry_rm(sc, cbuf_get(cb)) < 0)
+	goto done;
+    if ((se = malloc(sizeof(*se))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    memset(se, 0, sizeof(*se));
+    if (x && (se->se_xml = xml_dup(x)) == NULL)
+	goto done;
+    t.tv_sec = ttl/1000;
+    t.tv_usec = (ttl%1000)*1000;
+    timeradd(&now, &t, &se->se_expire);
+    if (clicon_hash_add(sc->sc_hash, cbuf_get(cb), &se, sizeof(se)) == NULL)
+	goto done;
+    se = NULL;
+    sc->sc_len++;
+ ok:
+    retval = 0;
+ done:
+    if (se){
+	if (se->se_xml)
+	    xml_free(se->se_xml);
+	free(se);
+    }
+    if (cb)
+	cbuf_free(cb);
+    return retval;
+}
+
+/*! Print state data cache statistics as XML
+ * @param[in]  h    Clicon handle
+ * @param[out] cb   Buffer
+ * @see clixon-lib.yang stats rpc
+ */
+int
+clixon_statedata_cache_stats(clicon_handle h,
+			     cbuf         *cb)
+{
+    struct statedata_cache *sc;
+
+    if ((sc = statedata_cache(h, 0)) == NULL)
+	return 0;
+    cprintf(cb, "<statedata-cache>");
+    cprintf(cb, "<entries>%zu</entries>", sc->sc_len);
+    cprintf(cb, "<hits>%" PRIu64 "</hits>", sc->sc_hits);
+    cprintf(cb, "<misses>%" PRIu64 "</misses>", sc->sc_misses);
+    cprintf(cb, "</statedata-cache>");
+    return 0;
+}
+
+/*! Free state data cache
+ * @param[in]  h    Clicon handle
+ */
+int
+clixon_statedata_cache_free(clicon_handle h)
+{
+    struct statedata_cache *sc;
+
+    if ((sc = statedata_cache(h, 0)) == NULL)
+	return 0;
+    statedata_purge(sc, NULL, NULL, NULL);
+    clicon_hash_free(sc->sc_hash);
+    free(sc);
+    clicon_hash_del(clicon_data(h), "statedata_cache");
+    return 0;
+}
+
+/*! Register a state data provider for a subtree
+ * Use the clixon_statedata_register() macro, which sets fnstr.
+ * @param[in]  h      Clicon handle
+ * @param[in]  cb     Callback called with the state data tree of the request
+ * @param[in]  fnstr  Stringified function name, identifies the provider in the cache
+ * @param[in]  arg    Domain-specific argument to send to callback
+ * @param[in]  ns     Namespace of the nodes of path
+ * @param[in]  path   Schema node path of subtree, eg /interfaces-state or 
+ *                    /routing-state/ribs. Prefixes are not used.
+ * @param[in]  flags  CLIXON_PLUGIN_WORKER, CLIXON_PLUGIN_NOCACHE and/or 
+ *                    CLIXON_PLUGIN_PARALLEL
+ * @retval     0      OK
+ * @retval    -1      Error
+ * @code
+ *   clixon_statedata_register(h, if_state, NULL,
+ *                             "urn:ietf:params:xml:ns:yang:ietf-interfaces",
+ *                             "/interfaces-state", 0);
+ * @endcode
+ */
+int
+clixon_statedata_reg_fn(clicon_handle       h,
+			clixon_statedata_cb cb,
+			const char         *fnstr,
+			void               *arg,
+			const char         *ns,
+			const char         *path,
+			uint32_t            flags)
+{
+    int                 retval = -1;
+    statedata_provider *sp = NULL;
+    statedata_provider *splist;
+    char              **vec = NULL;
+    int                 nvec = 0;
+    int                 i;
+
+    if (ns == NULL || path == NULL || path[0] != '/'){
+	clicon_err(OE_PLUGIN, EINVAL, "%s: namespace and absolute path expected", fnstr);
+	goto done;
+    }
+    if ((sp = malloc(sizeof(*sp))) == NULL) {
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    memset(sp, 0, sizeof(*sp));
+    sp->sp_callback = cb;
+    sp->sp_fnstr = fnstr;
+    sp->sp_arg = arg;
+    sp->sp_flags = flags;
+    if ((sp->sp_namespace = strdup(ns)) == NULL){
+	clicon_err(OE_UNIX, errno, "strdup");
+	goto done;
+    }
+    /* Skip empty names, eg leading and trailing '/' */
+    if ((vec = clicon_strsep((char*)path, "/", &nvec)) == NULL)
+	goto done;
+    if ((sp->sp_path = calloc(nvec+1, sizeof(char*))) == NULL){
+	clicon_err(OE_UNIX, errno, "calloc");
+	goto done;
+    }
+    for (i=0; i<nvec; i++){
+	if (strlen(vec[i]) == 0)
+	    continue;
+	if ((sp->sp_path[sp->sp_len++] = strdup(vec[i])) == NULL){
+	    clicon_err(OE_UNIX, errno, "strdup");
+	    goto done;
+	}
+    }
+    splist = statedata_provider_list(h);
+    ADDQ(sp, splist);
+    sp = NULL;
+    if (statedata_provider_list_set(h, splist) < 0)
+	goto done;
+    retval = 0;
+ done:
+    if (vec)
+	free(vec);
+    if (sp){
+	for (i=0; i<sp->sp_len; i++)
+	    free(sp->sp_path[i]);
+	if (sp->sp_path)
+	    free(sp->sp_path);
+	if (sp->sp_namespace)
+	    free(sp->sp_namespace);
+	free(sp);
+    }
+    return retval;
+}
+
+/*! Delete all state data providers
+ * @param[in]  h    Clicon handle
+ */
+int
+clixon_statedata_provider_delete_all(clicon_handle h)
+{
+    statedata_provider *sp;
+    statedata_provider *splist;
+    int                 i;
+
+    splist = statedata_provider_list(h);
+    while ((sp = splist) != NULL) {
+	DELQ(sp, splist, statedata_provider *);
+	for (i=0; i<sp->sp_len; i++)
+	    free(sp->sp_path[i]);
+	free(sp->sp_path);
+	free(sp->sp_namespace);
+	free(sp);
+    }
+    return statedata_provider_list_set(h, NULL);
+}
+
+/*! Skip an xpath predicate, string literal or parenthesis
+ * @param[in]  s    Pointer to '[', '(', '"' or '\''
+ * @retval     s    Pointer to character after the matching close, or to end of string
+ */
+static char *
+statedata_xpath_skip(char *s)
+{
+    char q;
+    int  depth = 0;
+
+    do {
+	switch (*s){
+	case '"':
+	case '\'':
+	    q = *s++;
+	    while (*s && *s != q)
+		s++;
+	    break;
+	case '[':
+	case '(':
+	    depth++;
+	    break;
+	case ']':
+	case ')':
+	    depth--;
+	    break;
+	}
+	if (*s)
+	    s++;
+    } while (*s && depth > 0);
+    return s;
+}
+
+/*! Check if one location path of an xpath may select nodes of a provider subtree
+ * Steps are compared with the path of the provider until one of them ends:
+ * the location path then selects the subtree, a node in it, or an ancestor of it.
+ * Predicates are skipped, ie /a[name='x'] is compared as /a.
+ * Paths that cannot be compared this way, eg relative paths, paths with // or
+ * axes, are assumed to intersect.
+ * @param[in]     sp     Provider
+ * @param[in]     nsc    Namespace context of xpath
+ * @param[in,out] xp     Start of location path, set to next '|' or end of xpath
+ * @retval        1      May intersect
+ * @retval        0      Does not intersect
+ */
+static int
+statedata_xpath_step_match(statedata_provider *sp,
+			   cvec               *nsc,
+			   char              **xp)
+{
+    int     match = 1;
+    char   *s = *xp;
+    char   *name;
+    char   *local;
+    char   *ns;
+    char    prefix[64];
+    size_t  len;
+    int     i = 0;
+
+    s += strspn(s, " \t\n");
+    if (*s != '/')
+	goto skip;
+    while (*s == '/'){
+	s++;
+	if (*s == '/' || i >= sp->sp_len)
+	    goto skip;
+	name = s;
+	len = strcspn(s, "/[| \t\n");
+	s += len;
+	if (len == 0)      /* The xpath "/" */
+	    goto skip;
+	if (*name == '.' || *name == '@' || memchr(name, '(', len) != NULL)
+	    goto skip;
+	if ((local = memchr(name, ':', len)) != NULL){
+	    if (local[1] == ':') /* Axis */
+		goto skip;
+	    local++;
+	    if ((size_t)(local - name) > sizeof(prefix))
+		goto skip;
+	    memcpy(prefix, name, local - name - 1);
+	    prefix[local - name - 1] = '\0';
+	    ns = xml_nsctx_get(nsc, prefix);
+	}
+	else{
+	    local = name;
+	    ns = xml_nsctx_get(nsc, NULL);
+	}
+	len -= local - name;
+	if (len != 1 || *local != '*'){ /* Wildcards match any node */
+	    if (strlen(sp->sp_path[i]) != len || strncmp(sp->sp_path[i], local, len) != 0 ||
+		(ns != NULL && strcmp(ns, sp->sp_namespace) != 0)){
+		match = 0;
+		goto skip;
+	    }
+	}
+	i++;
+	s += strspn(s, " \t\n");
+	while (*s == '['){
+	    s = statedata_xpath_skip(s);
+	    s += strspn(s, " \t\n");
+	}
+    }
+ skip: /* to next location path, match is result of this one */
+    while (*s && *s != '|'){
+	if (strchr("[(\"'", *s))
+	    s = statedata_xpath_skip(s);
+	else
+	    s++;
+    }
+    *xp = s;
+    return match;
+}
+
+/*! Check if the subtree of a provider may intersect the nodes selected by an xpath
+ * @param[in]  sp     Provider
+ * @param[in]  nsc    Namespace context of xpath
+ * @param[in]  xpath  XPath of request, or NULL for all
+ * @retval     1      May intersect, call the provider
+ * @retval     0      Does not intersect
+ */
+static int
+statedata_provider_match(statedata_provider *sp,
+			 cvec               *nsc,
+			 char               *xpath)
+{
+    char *s = xpath;
+
+    if (xpath == NULL)
+	return 1;
+    while (1){
+	if (statedata_xpath_step_match(sp, nsc, &s))
+	    return 1;
+	if (*s == '\0')
+	    break;
+	s++; /* Skip '|' */
+    }
+    return 0;
+}
+
+/*! Iterator over state data providers whose subtree intersects an xpath
+ * @param[in]  h      Clicon handle
+ * @param[in]  sp     Previous provider, or NULL to start
+ * @param[in]  nsc    Namespace context of xpath
+ * @param[in]  xpath  XPath of request, or NULL for all providers
+ * @retval     sp     Next provider
+ * @retval     NULL   No more providers
+ * @code
+ *   statedata_provider *sp = NULL;
+ *   while ((sp = clixon_statedata_provider_each(h, sp, nsc, xpath)) != NULL)
+ *     ...
+ * @endcode
+ */
+statedata_provider *
+clixon_statedata_provider_each(clicon_handle       h,
+			       statedata_provider *sp,
+			       cvec               *nsc,
+			       char               *xpath)
+{
+    statedata_provider *splist;
+
+    if ((splist = statedata_provider_list(h)) == NULL)
+	return NULL;
+    do {
+	if (sp == NULL)
+	    sp = splist;
+	else if ((sp = NEXTQ(statedata_provider *, sp)) == splist)
+	    return NULL;
+    } while (!statedata_provider_match(sp, nsc, xpath));
+    return sp;
+}
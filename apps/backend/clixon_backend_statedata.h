@@ -0,0 +1,101 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2020 Olof Hagsand and Rubicon Communications, LLC(Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2,
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ * State data cache and providers
+ * Cache is enabled with option CLICON_BACKEND_STATE_CACHE_TTL
+ *
+ * Part of the external API to plugins. Applications should not include
+ * this file directly (only via clicon_backend.h).
+ * Internal code should include this
+ */
+
+#ifndef _CLIXON_BACKEND_STATEDATA_H_
+#define _CLIXON_BACKEND_STATEDATA_H_
+
+/*
+ * Types
+ */
+
+/*! State data provider callback function
+ * Same as a ca_statedata plugin callback, but only called if the subtree given at
+ * registration intersects xpath.
+ * @param[in]  h       Clicon handle
+ * @param[in]  nsc     Namespace context of xpath
+ * @param[in]  xpath   XPath of request, or NULL for all
+ * @param[in]  xstate  Top-level <config> element, add state data of subtree here
+ * @param[in]  arg     User argument given at clixon_statedata_register()
+ * @retval     0       OK
+ * @retval    -1       Error, make a clicon_err call
+ */
+typedef int (*clixon_statedata_cb)(
+    clicon_handle h,
+    cvec         *nsc,
+    char         *xpath,
+    cxobj        *xstate,
+    void         *arg
+);
+
+/* State data provider of a subtree, registered with clixon_statedata_register() */
+struct statedata_provider{
+    qelem_t             sp_qelem;     /* List header */
+    clixon_statedata_cb sp_callback;  /* State data callback */
+    const char         *sp_fnstr;     /* Stringified fn name, cache key and debug */
+    void               *sp_arg;       /* Application specific argument to cb */
+    char               *sp_namespace; /* Namespace of subtree */
+    char              **sp_path;      /* Node names of subtree path from top */
+    int                 sp_len;       /* Length of sp_path */
+    uint32_t            sp_flags;     /* CLIXON_PLUGIN_WORKER, _NOCACHE, _PARALLEL */
+};
+typedef struct statedata_provider statedata_provider;
+
+/* Register a state data provider for a subtree, eg in plugin init */
+#define clixon_statedata_register(h, cb, arg, ns, path, flags) clixon_statedata_reg_fn((h), (cb), #cb, (arg), (ns), (path), (flags))
+
+/*
+ * Prototypes
+ */
+/* Plugin API */
+int clixon_statedata_cache_ttl(clicon_handle h, uint32_t ttl);
+int clixon_statedata_cache_invalidate(clicon_handle h, const char *plugin, const char *xpath);
+int clixon_statedata_reg_fn(clicon_handle h, clixon_statedata_cb cb, const char *fnstr, void *arg, const char *ns, const char *path, uint32_t flags);
+
+/* Backend internal */
+int clixon_statedata_cache_get(clicon_handle h, const char *name, cvec *nsc, char *xpath, cxobj **xp);
+int clixon_statedata_cache_put(clicon_handle h, const char *name, cvec *nsc, char *xpath, cxobj *x);
+int64_t clixon_statedata_cache_ttl_pop(clicon_handle h);
+int clixon_statedata_cache_stats(clicon_handle h, cbuf *cb);
+int clixon_statedata_cache_free(clicon_handle h);
+statedata_provider *clixon_statedata_provider_each(clicon_handle h, statedata_provider *sp, cvec *nsc, char *xpath);
+int clixon_statedata_provider_delete_all(clicon_handle h);
+
+#endif /* _CLIXON_BACKEND_STATEDATA_H_ */
@@ -410,6 +410,45 @@ show_yang(clicon_handle h,
     return 0;
 }
 
+/*! Get list pagination parameters from command-line variables
+ *
+ * @param[in]  cvv   Vector of variables from CLIgen command-line
+ * @param[out] pg    Pagination parameters, strings point into cvv
+ * @retval     1     At least one pagination variable is set
+ * @retval     0     No pagination
+ * @note  Hardcoded variable names: limit, offset, direction, where and cursor (kludge)
+ */
+static int
+cli_page_get(cvec        *cvv,
+	     clixon_page *pg)
+{
+    int     paged = 0;
+    cg_var *cv;
+    
+    memset(pg, 0, sizeof(*pg));
+    if ((cv = cvec_find(cvv, "limit")) != NULL){
+	pg->pg_limit = cv_uint32_get(cv);
+	paged++;
+    }
+    if ((cv = cvec_find(cvv, "offset")) != NULL){
+	pg->pg_offset = cv_uint32_get(cv);
+	paged++;
+    }
+    if ((cv = cvec_find(cvv, "direction")) != NULL){
+	pg->pg_backwards = strcmp(cv_string_get(cv), "backwards") == 0;
+	paged++;
+    }
+    if ((cv = cvec_find(cvv, "where")) != NULL){
+	pg->pg_where = cv_string_get(cv);
+	paged++;
+    }
+    if ((cv = cvec_find(cvv, "cursor")) != NULL){
+	pg->pg_cursor = cv_string_get(cv);
+	paged++;
+    }
+    return paged?1:0;
+}
+
 /*! Show configuration and state internal function
  *
  * @param[in]  h     CLICON handle
@@ -425,6 +464,9 @@ show_yang(clicon_handle h,
  * @code
  *   show config id <n:string>, cli_show_config("running","xml","iface[name='foo']","urn:example:example");
  * @endcode
+ * If cvv has limit, offset, direction, where or cursor variables, only a page of
+ * the list entries selected by xpath is shown, followed by the cursor of the next
+ * page if any.
  * @note if state parameter is set, then db must be running
  * @see cli_show_auto1
  */
@@ -449,6 +491,9 @@ cli_show_config1(clicon_handle h,
     char            *namespace = NULL;
     cvec            *nsc = NULL;
     char            *prefix = NULL;
+    clixon_page      pg;
+    int              paged;
+    char            *next = NULL;
     
     if (cvec_len(argv) < 3 || cvec_len(argv) > 5){
 	clicon_err(OE_PLUGIN, EINVAL, "Got %d arguments. Expected: <dbname>,<format>,<xpath>[,<namespace>, [<prefix>]]", cvec_len(argv));
@@ -485,8 +530,13 @@ cli_show_config1(clicon_handle h,
     if (cvec_len(argv) > 4){
 	prefix = cv_string_get(cvec_i(argv, 4));
     }
+    paged = cli_page_get(cvv, &pg);
     if (state == 0){     /* Get configuration-only from database */
-	if (clicon_rpc_get_config(h, NULL, db, cbuf_get(cbxpath), nsc, &xt) < 0)
+	if (paged){
+	    if (clicon_rpc_get_page(h, db, cbuf_get(cbxpath), nsc, -1, &pg, &xt, &next) < 0)
+		goto done;
+	}
+	else if (clicon_rpc_get_config(h, NULL, db, cbuf_get(cbxpath), nsc, &xt) < 0)
 	    goto done;
     }
     else {               /* Get configuration and state from database */
@@ -494,7 +544,11 @@ cli_show_config1(clicon_handle h,
 	    clicon_err(OE_FATAL, 0, "Show state only for running database, not %s", db);
 	    goto done;
 	}
-	if (clicon_rpc_get(h, cbuf_get(cbxpath), nsc, CONTENT_ALL, -1, &xt) < 0)
+	if (paged){
+	    if (clicon_rpc_get_page(h, NULL, cbuf_get(cbxpath), nsc, CONTENT_ALL, &pg, &xt, &next) < 0)
+		goto done;
+	}
+	else if (clicon_rpc_get(h, cbuf_get(cbxpath), nsc, CONTENT_ALL, -1, &xt) < 0)
 	    goto done;
     }
     if ((xerr = xpath_first(xt, NULL, "/rpc-error")) != NULL){
@@ -533,8 +587,12 @@ cli_show_config1(clicon_handle h,
 	cligen_output(stdout, "</config></edit-config></rpc>]]>]]>\n");
 	break;
     }
+    if (next && (format == FORMAT_TEXT || format == FORMAT_CLI))
+	cligen_output(stdout, "Next cursor: %s\n", next);
     retval = 0;
 done:
+    if (next)
+	free(next);
     if (nsc)
 	xml_nsctx_free(nsc);
     if (xt)
@@ -599,6 +657,8 @@ cli_show_config_state(clicon_handle h,
  * @param[in]  cvv   Vector of variables from CLIgen command-line must contain xpath and ns variables
  * @param[in]  argv  A string: <dbname>
  * @note  Hardcoded that variable xpath and ns cvv must exist. (kludge)
+ * @note  Optional limit, offset, direction, where and cursor cvv select a page
+ *        of list entries, see cli_page_get
  */
 int
 show_conf_xpath(clicon_handle h, 
@@ -616,6 +676,8 @@ show_conf_xpath(clicon_handle h,
     int              i;
     char            *namespace = NULL;
     cvec            *nsc = NULL;
+    clixon_page      pg;
+    char            *next = NULL;
 
     if (cvec_len(argv) != 1){
 	clicon_err(OE_PLUGIN, EINVAL, "Requires one element to be <dbname>");
@@ -642,7 +704,11 @@ show_conf_xpath(clicon_handle h,
     if (clicon_rpc_get(h, xpath, nsc, CONTENT_ALL, -1, &xt) < 0)
     	goto done;
 #else
-    if (clicon_rpc_get_config(h, NULL, str, xpath, nsc, &xt) < 0)
+    if (cli_page_get(cvv, &pg)){
+	if (clicon_rpc_get_page(h, str, xpath, nsc, -1, &pg, &xt, &next) < 0)
+	    goto done;
+    }
+    else if (clicon_rpc_get_config(h, NULL, str, xpath, nsc, &xt) < 0)
     	goto done;
 #endif
     if ((xerr = xpath_first(xt, NULL, "/rpc-error")) != NULL){
@@ -654,9 +720,12 @@ show_conf_xpath(clicon_handle h,
 	goto done;
     for (i=0; i<xlen; i++)
 	xml_print(stdout, xv[i]);
-
+    if (next)
+	fprintf(stdout, "Next cursor: %s\n", next);
     retval = 0;
 done:
+    if (next)
+	free(next);
     if (nsc)
 	xml_nsctx_free(nsc);
     if (xv)
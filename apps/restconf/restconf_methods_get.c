@@ -63,6 +63,80 @@
 #include "restconf_err.h"
 #include "restconf_methods_get.h"
 
+/*! Parse list pagination query parameters
+ * Clixon extension: limit, offset, direction (forwards|backwards), where and cursor
+ * @param[in]  qvec   Vector of query string (QUERY_STRING)
+ * @param[out] pg     Pagination parameters, strings point into qvec
+ * @param[out] paged  Set if any pagination parameter is given
+ * @param[out] xerr   Error tree if bad parameter. Free with xml_free
+ * @retval     1      OK
+ * @retval     0      Bad parameter, error in xerr
+ * @retval    -1      Error
+ */
+static int
+api_data_page_parse(cvec        *qvec,
+		    clixon_page *pg,
+		    int         *paged,
+		    cxobj      **xerr)
+{
+    int   retval = -1;
+    char *attr;
+    char *reason = NULL;
+    int   ret;
+
+    memset(pg, 0, sizeof(*pg));
+    *paged = 0;
+    if ((attr = cvec_find_str(qvec, "limit")) != NULL){
+	if ((ret = parse_uint32(attr, &pg->pg_limit, &reason)) < 0){
+	    clicon_err(OE_XML, errno, "parse_uint32");
+	    goto done;
+	}
+	if (ret == 0){
+	    if (netconf_bad_attribute_xml(xerr, "application",
+					  "limit", "Unrecognized value of limit attribute") < 0)
+		goto done;
+	    goto fail;
+	}
+	*paged = 1;
+    }
+    if ((attr = cvec_find_str(qvec, "offset")) != NULL){
+	if ((ret = parse_uint32(attr, &pg->pg_offset, &reason)) < 0){
+	    clicon_err(OE_XML, errno, "parse_uint32");
+	    goto done;
+	}
+	if (ret == 0){
+	    if (netconf_bad_attribute_xml(xerr, "application",
+					  "offset", "Unrecognized value of offset attribute") < 0)
+		goto done;
+	    goto fail;
+	}
+	*paged = 1;
+    }
+    if ((attr = cvec_find_str(qvec, "direction")) != NULL){
+	if (strcmp(attr, "backwards") == 0)
+	    pg->pg_backwards = 1;
+	else if (strcmp(attr, "forwards") != 0){
+	    if (netconf_bad_attribute_xml(xerr, "application",
+					  "direction", "Unrecognized value of direction attribute") < 0)
+		goto done;
+	    goto fail;
+	}
+	*paged = 1;
+    }
+    if ((pg->pg_where = cvec_find_str(qvec, "where")) != NULL)
+	*paged = 1;
+    if ((pg->pg_cursor = cvec_find_str(qvec, "cursor")) != NULL)
+	*paged = 1;
+    retval = 1;
+ done:
+    if (reason)
+	free(reason);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
 /*! Generic GET (both HEAD and GET)
  * According to restconf 
  * @param[in]  h        Clixon handle
@@ -90,6 +164,8 @@
  * encoding is used in the response, then an error response containing a
  * "400 Bad Request" status-line MUST be returned by the server.
  * Netconf: <get-config>, <get>                        
+ * Clixon extension: list pagination with query parameters limit, offset,
+ * direction, where and cursor. Cursor of next page in Next-Cursor header.
  */
 static int
 api_data_get2(clicon_handle  h,
@@ -122,6 +198,10 @@ api_data_get2(clicon_handle  h,
     cxobj     *xtop = NULL;
     cxobj     *xbot = NULL;
     yang_stmt *y = NULL;
+    clixon_page pg;
+    int        paged = 0;
+    char      *next = NULL;
+    int        json = 0;
     
     clicon_debug(1, "%s", __FUNCTION__);
     if ((yspec = clicon_dbspec_yang(h)) == NULL){
@@ -194,12 +274,34 @@ api_data_get2(clicon_handle  h,
 	}
     }
 
+    /* Check for list pagination attributes */
+    if ((ret = api_data_page_parse(qvec, &pg, &paged, &xerr)) < 0)
+	goto done;
+    if (ret == 0){
+	if ((xe = xpath_first(xerr, NULL, "rpc-error")) == NULL){
+	    clicon_err(OE_XML, EINVAL, "rpc-error not found (internal error)");
+	    goto done;
+	}
+	if (api_return_err(h, req, xe, pretty, media_out, 0) < 0)
+	    goto done;
+	goto ok;
+    }
     clicon_debug(1, "%s path:%s", __FUNCTION__, xpath);
+    /* Let the backend encode the reply as JSON */
+    json = media_out == YANG_DATA_JSON && !head && !paged && depth == -1 &&
+	clicon_option_bool(h, "CLICON_RESTCONF_BACKEND_JSON");
+    if ((cbx = cbuf_new()) == NULL)
+	goto done;
     switch (content){
     case CONTENT_CONFIG:
     case CONTENT_NONCONFIG:
     case CONTENT_ALL:
-	ret = clicon_rpc_get(h, xpath, nsc, content, depth, &xret);
+	if (paged)
+	    ret = clicon_rpc_get_page(h, NULL, xpath, nsc, content, &pg, &xret, &next);
+	else if (json)
+	    ret = clicon_rpc_get_json(h, xpath, nsc, content, pretty, cbx, &xret);
+	else
+	    ret = clicon_rpc_get(h, xpath, nsc, content, depth, &xret);
 	break;
     default:
 	clicon_err(OE_XML, EINVAL, "Invalid content attribute %d", content);
@@ -225,25 +327,36 @@ api_data_get2(clicon_handle  h,
 	clicon_log_xml(LOG_DEBUG, xret, "%s xret:", __FUNCTION__);
 #endif
     /* Check if error return  */
-    if ((xe = xpath_first(xret, NULL, "//rpc-error")) != NULL){
+    if (xret && (xe = xpath_first(xret, NULL, "//rpc-error")) != NULL){
 	if (api_return_err(h, req, xe, pretty, media_out, 0) < 0)
 	    goto done;
 	goto ok;
     }
     /* Normal return, no error */
-    if ((cbx = cbuf_new()) == NULL)
-	goto done;
     if (head){
 	/* Same headers as the GET, but no body */
 	if (restconf_reply_header(req, "Cache-Control", "no-cache") < 0)
 	    goto done;
 	if (restconf_reply_header(req, "Content-Type", "%s", restconf_media_int2str(media_out)) < 0)
 	    goto done;
+	if (next && restconf_reply_header(req, "Next-Cursor", "%s", next) < 0)
+	    goto done;
 	if (restconf_reply_send(req, 200, NULL) < 0)
 	    goto done;
 	goto ok;
     }
-    if (xpath==NULL || strcmp(xpath,"/")==0){ /* Special case: data root */
+    if (json){ /* Encoded by backend, empty if not exists */
+	if (cbuf_len(cbx) == 0){
+	    if (netconf_invalid_value_xml(&xerr, "application", "Instance does not exist") < 0)
+		goto done;
+	    if ((xe = xpath_first(xerr, NULL, "rpc-error")) != NULL){
+		if (api_return_err(h, req, xe, pretty, media_out, 404) < 0)
+		    goto done;
+	    }
+	    goto ok;
+	}
+    }
+    else if (xpath==NULL || strcmp(xpath,"/")==0){ /* Special case: data root */
 	switch (media_out){
 	case YANG_DATA_XML:
 	    if (clicon_xml2cbuf(cbx, xret, 0, pretty, -1) < 0) /* Dont print top object?  */
@@ -317,12 +430,16 @@ api_data_get2(clicon_handle  h,
 	goto done;
     if (restconf_reply_header(req, "Cache-Control", "no-cache") < 0)
 	goto done;
+    if (next && restconf_reply_header(req, "Next-Cursor", "%s", next) < 0)
+	goto done;
     if (restconf_reply_send(req, 200, cbx) < 0)
 	goto done;
  ok:
     retval = 0;
  done:
     clicon_debug(1, "%s retval:%d", __FUNCTION__, retval);
+    if (next)
+	free(next);
     if (xpath)
 	free(xpath);
     if (nsc)
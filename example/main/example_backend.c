@@ -66,7 +66,7 @@
 #include <clixon/clixon_backend.h> 
 
 /* Command line options to be passed to getopt(3) */
-#define BACKEND_EXAMPLE_OPTS "rsS:iuUt:v:"
+#define BACKEND_EXAMPLE_OPTS "rsS:ipd:uUt:v:"
 
 /*! Variable to control if reset code is run.
  * The reset code inserts "extra XML" which assumes ietf-interfaces is
@@ -94,6 +94,19 @@ static char *_state_file = NULL;
 static int _state_file_init = 0;
 static cxobj *_state_xstate = NULL;
 
+/*! Register a state data provider for the /state subtree 
+ * The provider returns the number of times it has been called
+ * Start backend with -- -p
+ */
+static int _state_provider = 0;
+static int _state_provider_count = 0;
+
+/*! Delay in ms of state callbacks, to simulate slow hardware
+ * Callbacks are then declared CLIXON_PLUGIN_PARALLEL 
+ * Start backend with -- -d <ms>
+ */
+static int _state_delay = 0;
+
 /*! Variable to control module-specific upgrade callbacks.
  * If set, call test-case for upgrading ietf-interfaces, otherwise call 
  * auto-upgrade
@@ -374,6 +387,8 @@ example_statedata(clicon_handle h,
 
     if (!_state)
 	goto ok;
+    if (_state_delay)
+	usleep(_state_delay*1000);
     yspec = clicon_dbspec_yang(h);
     
     /* If -S is set, then read state data from file, otherwise construct it programmatically */
@@ -491,6 +506,36 @@ example_statedata(clicon_handle h,
     return retval;
 }
 
+/*! State data provider of /state subtree, registered with clixon_statedata_register
+ * Only called if the xpath of a get intersects /state. 
+ * Returns the number of times it has been called, for testing. (Not if it runs
+ * in parallel with -d, since it is then called in a forked process)
+ * @param[in]    h       Clicon handle
+ * @param[in]    nsc     External XML namespace context, or NULL
+ * @param[in]    xpath   String with XPATH syntax. or NULL for all
+ * @param[in]    xstate  XML tree, <config/> on entry. 
+ * @param[in]    arg     Pointer to call counter
+ * @retval       0       OK
+ * @retval      -1       Error
+ */
+static int 
+example_state_provider(clicon_handle h, 
+		       cvec         *nsc,
+		       char         *xpath,
+		       cxobj        *xstate,
+		       void         *arg)
+{
+    int  *count = (int*)arg;
+    char  str[64];
+
+    if (_state_delay)
+	usleep(_state_delay*1000);
+    snprintf(str, sizeof(str), "<state xmlns=\"urn:example:clixon\"><op>%d</op></state>", ++*count);
+    if (clixon_xml_parse_string(str, YB_NONE, NULL, &xstate, NULL) < 0)
+	return -1;
+    return 0;
+}
+
 /*! Callback for yang extensions example:e4
  * 
  * @param[in] h    Clixon handle
@@ -1022,6 +1067,7 @@ static clixon_plugin_api api = {
     .ca_trans_end=main_end,                 /* trans end */
     .ca_trans_abort=main_abort,             /* trans abort */
     .ca_datastore_upgrade=example_upgrade,  /* general-purpose upgrade. */
+    .ca_flags=CLIXON_PLUGIN_WORKER,         /* statedata and validate may run in worker */
 };
 
 /*! Backend plugin initialization
@@ -1060,6 +1106,12 @@ clixon_plugin_init(clicon_handle h)
 	case 'i': /* read state file on init not by request (requires -sS <file> */
 	    _state_file_init = 1;
 	    break;
+	case 'p': /* state data provider of /state */
+	    _state_provider = 1;
+	    break;
+	case 'd': /* state callback delay */
+	    _state_delay = atoi(optarg);
+	    break;
        case 'u': /* module-specific upgrade */
            _module_upgrade = 1;
            break;
@@ -1074,6 +1126,9 @@ clixon_plugin_init(clicon_handle h)
 	    break;
 	}
 
+    /* Slow state callbacks may run in parallel */
+    if (_state_delay)
+	api.ca_flags |= CLIXON_PLUGIN_PARALLEL;
     /* Example stream initialization:
      * 1) Register EXAMPLE stream 
      * 2) setup timer for notifications, so something happens on stream
@@ -1122,6 +1177,18 @@ clixon_plugin_init(clicon_handle h)
 			      "copy-config"
 			      ) < 0)
 	goto done;
+    /* State data provider of a subtree: only called if the xpath of a get
+     * intersects /state. Not cached since it returns a call counter.
+     */
+    if (_state_provider){
+	if (clixon_statedata_register(h, example_state_provider,
+				      &_state_provider_count,
+				      "urn:example:clixon",
+				      "/state",
+				      CLIXON_PLUGIN_NOCACHE |
+				      (_state_delay?CLIXON_PLUGIN_PARALLEL:0)) < 0)
+	    goto done;
+    }
     /* Upgrade callback: if you start the backend with -- -u you will get the
      * test interface example. Otherwise the auto-upgrade feature is enabled.
      */
@@ -56,6 +56,9 @@ typedef struct {
     cxobj    *de_xml;      /* cache */
     int       de_modified; /* Dirty since loaded/copied/committed/etc XXX:nocache? */
     int       de_empty;    /* Empty on read from file, xmldb_readfile and xmldb_put sets it */
+    uint64_t  de_gen;      /* Generation, incremented on every write (put/copy/delete/create) */
+    int       de_dirtyok;  /* XML_FLAG_DIRTY marks in de_xml are relative to running */
+    uint64_t  de_dirtygen; /* Running generation when dirty marks were cleared */
 } db_elmnt;
 
 /*
@@ -106,6 +109,14 @@ int clicon_startup_status_set(clicon_handle h, enum startup_status status);
 int clicon_socket_get(clicon_handle h);
 int clicon_socket_set(clicon_handle h, int s);
 
+/* Set and get persistent client socket to backend */
+int clicon_client_socket_get(clicon_handle h);
+int clicon_client_socket_set(clicon_handle h, int s);
+
+/* Set and get if backend replies may be binary encoded */
+int clicon_client_binary_get(clicon_handle h);
+int clicon_client_binary_set(clicon_handle h, int val);
+
 /*! Set and get module state full and brief cached tree */
 cxobj *clicon_modst_cache_get(clicon_handle h, int brief);
 int clicon_modst_cache_set(clicon_handle h, int brief, cxobj *xms);
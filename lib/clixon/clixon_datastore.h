@@ -38,12 +38,15 @@
 #ifndef _CLIXON_DATASTORE_H
 #define _CLIXON_DATASTORE_H
 
+struct clixon_page; /* see clixon_xml_page.h */
+
 /*
  * Prototypes
  * API
  */
 /* Internal functions */
 int xmldb_db2file(clicon_handle h, const char *db, char **filename);
+int xmldb_gen_inc(clicon_handle h, const char *db);
 
 /* API */
 int xmldb_validate_db(const char *db);
@@ -54,6 +57,8 @@ int xmldb_get(clicon_handle h, const char *db, cvec *nsc, char *xpath, cxobj **x
 int xmldb_get0(clicon_handle h, const char *db, yang_bind yb,
 	       cvec *nsc, const char *xpath,
 	       int copy, cxobj **xtop, modstate_diff_t *msd); 
+int xmldb_get_page(clicon_handle h, const char *db, cvec *nsc, const char *xpath,
+		   struct clixon_page *pg, char *username, cxobj **xret, char **next);
 int xmldb_get0_clear(clicon_handle h, cxobj *x);
 int xmldb_get0_free(clicon_handle h, cxobj **xp);
 int xmldb_put(clicon_handle h, const char *db, enum operation_type op, cxobj *xt, char *username, cbuf *cbret); /* in clixon_datastore_write.[ch] */
@@ -74,6 +79,8 @@ cxobj *xmldb_cache_get(clicon_handle h, const char *db);
 int xmldb_modified_get(clicon_handle h, const char *db);
 int xmldb_modified_set(clicon_handle h, const char *db, int value);
 int xmldb_empty_get(clicon_handle h, const char *db);
+uint64_t xmldb_gen_get(clicon_handle h, const char *db);
+int xmldb_dirty_get(clicon_handle h, const char *db);
 int xmldb_dump(clicon_handle h, FILE *f, cxobj *xt);
 
 #endif /* _CLIXON_DATASTORE_H */
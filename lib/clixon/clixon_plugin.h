@@ -233,6 +233,7 @@ struct clixon_plugin_api{
 	    trans_cb_t       *cb_trans_end;	 /* Transaction completed  */
     	    trans_cb_t       *cb_trans_abort;	 /* Transaction aborted */
 	    datastore_upgrade_t *cb_datastore_upgrade; /* General-purpose datastore upgrade */
+	    uint32_t          cb_flags;          /* Plugin capabilities, see CLIXON_PLUGIN_WORKER */
 	} cau_backend;
     } u;
 };
@@ -254,6 +255,16 @@ struct clixon_plugin_api{
 #define ca_trans_end      u.cau_backend.cb_trans_end
 #define ca_trans_abort    u.cau_backend.cb_trans_abort
 #define ca_datastore_upgrade  u.cau_backend.cb_datastore_upgrade
+#define ca_flags          u.cau_backend.cb_flags
+
+/* Backend plugin capability flags (ca_flags) */
+#define CLIXON_PLUGIN_WORKER 0x01 /* Statedata and validate callbacks may run in a
+				     * backend worker process, see CLICON_BACKEND_WORKERS */
+#define CLIXON_PLUGIN_NOCACHE 0x02 /* State data is not cached, see 
+				     * CLICON_BACKEND_STATE_CACHE_TTL */
+#define CLIXON_PLUGIN_PARALLEL 0x04 /* Statedata callback may run in a forked process
+				     * concurrently with other plugins, see
+				     * CLICON_BACKEND_STATE_TIMEOUT */
 
 /*
  * Macros
@@ -51,6 +51,31 @@ enum format_enum{
     FORMAT_NETCONF
 };
 
+/* Flag in op_len of a message header: the message continues in next frame.
+ * A large message may be sent as a sequence of frames, each with a header
+ * with the length of the frame. The message body is the concatenation of the 
+ * frame bodies. All frames but the last have this flag set.
+ */
+#define CLICON_MSG_MORE 0x80000000
+
+/* Flag in op_len of a request header: the client accepts a binary encoded reply.
+ * Only set if the backend has announced CLIXON_BINARY_CAPABILITY in its hello.
+ * @see clixon_xml2bin
+ */
+#define CLICON_MSG_BINARY 0x40000000
+
+/* Flag in op_len of a request header: the client accepts a reply in shared memory.
+ * Only set on unix sockets.
+ * @see struct clicon_msg_shm
+ */
+#define CLICON_MSG_SHM    0x20000000
+
+/* All flags in op_len, the rest is the length */
+#define CLICON_MSG_FLAGS (CLICON_MSG_MORE|CLICON_MSG_BINARY|CLICON_MSG_SHM)
+
+/* Capability in internal hello of backends supporting binary encoded replies */
+#define CLIXON_BINARY_CAPABILITY "http://clicon.org/capability/binary"
+
 /* Protocol message header */
 struct clicon_msg {
     uint32_t    op_len;     /* length of message. network byte order. */
@@ -58,6 +83,23 @@ struct clicon_msg {
     char        op_body[0]; /* rest of message, actual data */
 };
 
+/* Body of a reply with the data in shared memory. 
+ * The memory file descriptor is passed with the message (SCM_RIGHTS), and holds
+ * the reply body as it would otherwise have been sent.
+ */
+#define CLICON_MSG_SHM_MAGIC "\002CXS"
+struct clicon_msg_shm {
+    char        ms_magic[4]; /* CLICON_MSG_SHM_MAGIC */
+    uint32_t    ms_len;      /* length of data in shared memory. network byte order. */
+};
+
+/* Body of a reply with RFC 7951 JSON text instead of XML, to a get or get-config with
+ * the encoding="json" attribute. The magic is followed by the null-terminated JSON 
+ * text, which is empty if there is no data.
+ * @see clicon_rpc_get_json
+ */
+#define CLICON_MSG_JSON_MAGIC "\003CXJ"
+
 /*
  * Prototypes
  */ 
@@ -73,6 +115,8 @@ int clicon_msg_decode(struct clicon_msg *msg, yang_stmt *yspec, uint32_t *id, cx
 
 int clicon_connect_unix(clicon_handle h, char *sockpath);
 
+int clicon_connect_inet(clicon_handle h, char *dst, uint16_t port);
+
 
 int clicon_rpc_connect_unix(clicon_handle         h,
 			    struct clicon_msg    *msg, 
@@ -89,6 +133,10 @@ int clicon_rpc_connect_inet(clicon_handle         h,
 
 int clicon_rpc(int s, struct clicon_msg *msg, char **xret);
 
+int clicon_rpc_shm(int s, struct clicon_msg *msg, char **xret, size_t *maplen);
+
+int clicon_rpc_sent(int s, struct clicon_msg *msg, int shm, char **xret, size_t *maplen, size_t *sent);
+
 int clicon_msg_send(int s, struct clicon_msg *msg);
 
 int clicon_msg_rcv(int s, struct clicon_msg **msg, int *eof);
@@ -42,10 +42,34 @@
 #ifndef _CLIXON_PROTO_CLIENT_H_
 #define _CLIXON_PROTO_CLIENT_H_
 
+/*
+ * Types
+ */
+/*! Asynchronous rpc reply callback
+ * @param[in]  h      CLICON handle
+ * @param[in]  reqid  Request id as given by clicon_rpc_async
+ * @param[in]  xret   Reply XML tree, or NULL if connection closed before reply. Freed by caller
+ * @param[in]  arg    Argument given to clicon_rpc_async
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+typedef int (clicon_rpc_async_cb)(clicon_handle h, uint32_t reqid, cxobj *xret, void *arg);
+
+/*
+ * Prototypes
+ */
+int clicon_rpc_close(clicon_handle h);
 int clicon_rpc_msg(clicon_handle h, struct clicon_msg *msg, cxobj **xret0,
 		   int *sock0);
 int clicon_rpc_netconf(clicon_handle h, char *xmlst, cxobj **xret, int *sp);
 int clicon_rpc_netconf_xml(clicon_handle h, cxobj *xml, cxobj **xret, int *sp);
+int clicon_rpc_async(clicon_handle h, struct clicon_msg *msg, clicon_rpc_async_cb *fn,
+		     void *arg, uint32_t *reqid);
+int clicon_rpc_netconf_async(clicon_handle h, char *xmlstr, clicon_rpc_async_cb *fn,
+			     void *arg, uint32_t *reqid);
+int clicon_rpc_async_wait(clicon_handle h, uint32_t reqid);
+int clicon_rpc_async_pending(clicon_handle h);
+int clicon_rpc_async_close(clicon_handle h);
 int clicon_rpc_get_config(clicon_handle h, char *username, char *db, char *xpath, cvec *nsc, cxobj **xret);
 int clicon_rpc_edit_config(clicon_handle h, char *db, enum operation_type op, 
 			   char *xml);
@@ -54,6 +78,9 @@ int clicon_rpc_delete_config(clicon_handle h, char *db);
 int clicon_rpc_lock(clicon_handle h, char *db);
 int clicon_rpc_unlock(clicon_handle h, char *db);
 int clicon_rpc_get(clicon_handle h, char *xpath, cvec *nsc, netconf_content content, int32_t depth, cxobj **xret);
+int clicon_rpc_get_json(clicon_handle h, char *xpath, cvec *nsc, netconf_content content, int pretty, cbuf *cb, cxobj **xerr);
+int clicon_rpc_get_page(clicon_handle h, char *db, char *xpath, cvec *nsc, netconf_content content,
+			clixon_page *pg, cxobj **xret, char **next);
 int clicon_rpc_close_session(clicon_handle h);
 int clicon_rpc_kill_session(clicon_handle h, uint32_t session_id);
 int clicon_rpc_validate(clicon_handle h, char *db);
@@ -76,6 +76,9 @@ struct stream_subscription{
     struct timeval              ss_stoptime; /* Replay stoptime */
     stream_fn_t                 ss_fn;     /* Callback when event occurs */
     void                       *ss_arg;    /* Callback argument */
+    struct event_stream        *ss_es;     /* Stream of subscription */
+    struct stream_subscription *ss_onext;  /* Next subscription of same owner */
+    struct stream_subscription **ss_oprev; /* Pointer to this in owner list, or NULL */
 };
 
 /* Replay time-series */
@@ -116,6 +119,8 @@ struct stream_subscription *stream_ss_find(event_stream_t *es,
 					   stream_fn_t fn, void *arg);
 int stream_ss_delete_all(clicon_handle h, stream_fn_t fn, void *arg);
 int stream_ss_delete(clicon_handle h, char *name, stream_fn_t fn, void *arg);
+int stream_ss_owner(struct stream_subscription *ss, struct stream_subscription **owner);
+int stream_ss_delete_owner(clicon_handle h, struct stream_subscription **owner);
 
 int stream_notify_xml(clicon_handle h, char *stream, cxobj *xml);
 #if defined(__GNUC__) && __GNUC__ >= 3
@@ -98,6 +98,10 @@ int xml_chardata_encode(char **escp, const char *fmt, ... ) __attribute__ ((form
 int uri_percent_encode(char **encp, const char *str, ...);
 int xml_chardata_encode(char **escp, const char *fmt, ...);
 #endif
+size_t xml_chardata_span(const char *str);
+int xml_chardata_simd_set(char *name);
+char *xml_chardata_simd_get(void);
+size_t xml_chardata_cdata(const char *str);
 int xml_chardata_cbuf_append(cbuf *cb, char *str);
 int uri_percent_decode(char *enc, char **str);
 const char *clicon_int2str(const map_str2int *mstab, int i);
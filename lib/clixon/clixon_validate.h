@@ -41,10 +41,16 @@
 /*
  * Prototypes
  */
+int xml_leafref_cache_begin(void);
+int xml_leafref_cache_end(void);
+int xml_leafref_target(cxobj *xt, yang_stmt *ys, yang_stmt *ytype, cxobj **xtarget);
 int xml_yang_validate_rpc(clicon_handle h, cxobj *xrpc, cxobj **xret);
 int xml_yang_validate_add(clicon_handle h, cxobj *xt, cxobj **xret);
 int xml_yang_validate_list_key_only(cxobj *xt, cxobj **xret);
 int xml_yang_validate_all(clicon_handle h, cxobj *xt, cxobj **xret);
 int xml_yang_validate_all_top(clicon_handle h, cxobj *xt, cxobj **xret);
+int xml_yang_validate_changes(clicon_handle h, cxobj *xt, cxobj **dvec, int dlen,
+			      cxobj **avec, int alen, cxobj **cvec, int clen, cxobj **xret);
+int xml_yang_validate_deps_free(clicon_handle h);
 
 #endif  /* _CLIXON_VALIDATE_H_ */
@@ -147,6 +147,8 @@ typedef struct clixon_xml_vec clixon_xvec; /* struct defined in clicon_xml_vec.c
 #define XML_FLAG_CHANGE  0x08  /* Node is changed (commits) or child changed rec */
 #define XML_FLAG_NONE    0x10  /* Node is added as NONE */
 #define XML_FLAG_DEFAULT 0x20  /* Added when a value is set as default @see xml_default */
+#define XML_FLAG_DIRTY   0x40  /* Node or descendant modified by edit @see xml_dirty_mark */
+#define XML_FLAG_NEW     0x80  /* Node created by edit @see xml_dirty_mark */
 
 /*
  * Prototypes
@@ -204,6 +206,9 @@ int       xml_purge(cxobj *xc);
 int       xml_child_rm(cxobj *xp, int i);
 int       xml_rm(cxobj *xc);
 int       xml_rm_children(cxobj *x, enum cxobj_type type);
+int       xml_dirty_mark(cxobj *x, int new);
+int       xml_dirty_get(cxobj *x, cxobj ***vec, int *len, cxobj ***rmvec, int *rmlen);
+int       xml_flag_reset_dirty(cxobj *x, uint16_t flags);
 int       xml_rootchild(cxobj  *xp, int i, cxobj **xcp);
 int       xml_rootchild_node(cxobj  *xp, cxobj *xc);
 int       xml_enumerate_children(cxobj *xp);
@@ -40,13 +40,32 @@
 #ifndef _CLIXON_XML_IO_H_
 #define _CLIXON_XML_IO_H_
 
+/*
+ * Types
+ */
+typedef struct xml_stream xml_stream_t; /* XML tree printed in chunks */
+
+/*! Write callback of clicon_xml2write_cb, called with output in chunks
+ * @param[in]  arg  Argument given to clicon_xml2write_cb
+ * @param[in]  buf  Output, not NULL-terminated
+ * @param[in]  len  Number of bytes in buf
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+typedef int (clicon_write_cb)(void *arg, const char *buf, size_t len);
+
 /*
  * Prototypes
  */
 int clicon_xml2file_cb(FILE *f, cxobj *x, int level, int prettyprint, clicon_output_cb *fn);
 int clicon_xml2file(FILE *f, cxobj *x, int level, int prettyprint);
+int clicon_xml2fd(int fd, cxobj *x, int level, int prettyprint);
+int clicon_xml2write_cb(cxobj *x, int level, int prettyprint, int32_t depth, clicon_write_cb *fn, void *arg);
 int xml_print(FILE *f, cxobj *xn);
 int clicon_xml2cbuf(cbuf *cb, cxobj *x, int level, int prettyprint, int32_t depth);
+xml_stream_t *xml_stream_new(cxobj *x, int32_t depth);
+int xml_stream_cbuf(xml_stream_t *xs, cbuf *cb, size_t len);
+int xml_stream_free(xml_stream_t *xs);
 char *clicon_xml2str(cxobj *x);
 int xmltree2cbuf(cbuf *cb, cxobj *x, int level);
 
@@ -0,0 +1,69 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2020 Olof Hagsand and Rubicon Communications, LLC(Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2,
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ * List pagination
+ * Select a page of the list or leaf-list entries selected by an xpath, given
+ * offset, limit, direction, a where filter and/or a cursor.
+ */
+#ifndef _CLIXON_XML_PAGE_H
+#define _CLIXON_XML_PAGE_H
+
+/*
+ * Types
+ */
+/* Filter of page entries, eg read access control, applied before offset and limit
+ * @retval  1  Keep entry x
+ * @retval  0  Skip entry x
+ * @retval -1  Error
+ */
+typedef int (clixon_page_filter_t)(cxobj *x, void *arg);
+
+/* List pagination parameters of a get or get-config request */
+struct clixon_page{
+    uint32_t  pg_offset;    /* Nr of entries to skip (after cursor) */
+    uint32_t  pg_limit;     /* Max nr of entries in page, 0 means no limit */
+    int       pg_backwards; /* Entries in reverse order */
+    char     *pg_where;     /* XPath relative to entry: select entries where true */
+    char     *pg_cursor;    /* Start after entry of this cursor, or NULL */
+    clixon_page_filter_t *pg_filter; /* Skip entries filtered out, or NULL */
+    void     *pg_filterarg; /* Argument of pg_filter */
+};
+typedef struct clixon_page clixon_page;
+
+/*
+ * Prototypes
+ */
+int clixon_page_select(cxobj *xt, cvec *nsc, char *xpath, clixon_page *pg,
+		       cxobj ***vec, size_t *veclen, char **next);
+
+#endif /* _CLIXON_XML_PAGE_H */
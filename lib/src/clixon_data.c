@@ -553,6 +553,72 @@ clicon_socket_set(clicon_handle h,
     return clicon_hash_add(cdat, "socket", &s, sizeof(int))==NULL?-1:0;
 }
 
+/*! Get persistent client socket to backend
+ * @param[in]  h   Clicon handle
+ * @retval    -1   No open socket
+ * @retval     s   Socket
+ * @see clicon_rpc_msg  where the socket is opened and used if CLICON_CLIENT_PERSISTENT
+ */
+int
+clicon_client_socket_get(clicon_handle h)
+{
+    clicon_hash_t *cdat = clicon_data(h);
+    void           *p;
+
+    if ((p = clicon_hash_value(cdat, "client-socket", NULL)) == NULL)
+	return -1;
+    return *(int*)p;
+}
+
+/*! Set persistent client socket to backend
+ * @param[in]  h   Clicon handle
+ * @param[in]  s   Open socket (or -1 to close)
+ * @retval    0       OK
+ * @retval   -1       Error
+ */
+int
+clicon_client_socket_set(clicon_handle h, 
+			 int           s)
+{
+    clicon_hash_t  *cdat = clicon_data(h);
+
+    if (s == -1)
+	return clicon_hash_del(cdat, "client-socket");
+    return clicon_hash_add(cdat, "client-socket", &s, sizeof(int))==NULL?-1:0;
+}
+
+/*! Get if client asks backend for binary encoded replies
+ * @param[in]  h   Clicon handle
+ * @retval     1   Yes, backend has announced support in hello and CLICON_CLIENT_BINARY is set
+ * @retval     0   No, replies are XML text
+ * @see clicon_hello_req
+ */
+int
+clicon_client_binary_get(clicon_handle h)
+{
+    clicon_hash_t *cdat = clicon_data(h);
+    void           *p;
+
+    if ((p = clicon_hash_value(cdat, "client-binary", NULL)) == NULL)
+	return 0;
+    return *(int*)p;
+}
+
+/*! Set if client asks backend for binary encoded replies
+ * @param[in]  h   Clicon handle
+ * @param[in]  val 1 if binary encoded replies, 0 if XML text
+ * @retval     0   OK
+ * @retval    -1   Error
+ */
+int
+clicon_client_binary_set(clicon_handle h, 
+			 int           val)
+{
+    clicon_hash_t  *cdat = clicon_data(h);
+
+    return clicon_hash_add(cdat, "client-binary", &val, sizeof(int))==NULL?-1:0;
+}
+
 /*! Get module state cache
  * @param[in]  h     Clicon handle
  * @param[in]  brief 0: Full module state tree, 1: Brief tree (datastore)
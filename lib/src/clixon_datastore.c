@@ -118,6 +118,28 @@ xmldb_db2file(clicon_handle  h,
     return retval;
 }
 
+/*! Increment generation of a datastore, ie mark that its content has been written
+ * @param[in]   h   Clicon handle
+ * @param[in]   db  Symbolic database name, eg "candidate", "running"
+ * @retval      0   OK
+ * @retval     -1   Error
+ * @see xmldb_gen_get
+ */
+int
+xmldb_gen_inc(clicon_handle h,
+	      const char   *db)
+{
+    db_elmnt  *de;
+    db_elmnt   de0 = {0,};
+
+    if ((de = clicon_db_elmnt_get(h, db)) != NULL){
+	de->de_gen++;
+	return 0;
+    }
+    de0.de_gen = 1;
+    return clicon_db_elmnt_set(h, db, &de0);
+}
+
 /*! Ensure database name is correct
  * @param[in]   db    Name of database 
  * @retval  0   OK
@@ -231,6 +253,8 @@ xmldb_copy(clicon_handle h,
 	if (de2)
 	    de0 = *de2;
 	de0.de_xml = x2; /* The new tree */
+	de0.de_dirtyok = (x2 != NULL && strcmp(from, "running") == 0);
+	de0.de_dirtygen = xmldb_gen_get(h, "running");
 	clicon_db_elmnt_set(h, to, &de0);
     }
     /* Copy the files themselves (above only in-memory cache) */
@@ -240,6 +264,15 @@ xmldb_copy(clicon_handle h,
 	goto done;
     if (clicon_file_copy(fromfile, tofile) < 0)
 	goto done;
+    if (xmldb_gen_inc(h, to) < 0)
+	goto done;
+    /* Copied to running (eg commit): source is now identical to running */
+    if (x1 && strcmp(to, "running") == 0 &&
+	(de1 = clicon_db_elmnt_get(h, from)) != NULL){
+	xml_flag_reset_dirty(x1, XML_FLAG_DIRTY|XML_FLAG_NEW);
+	de1->de_dirtyok = 1;
+	de1->de_dirtygen = xmldb_gen_get(h, "running");
+    }
     retval = 0;
  done:
     if (fromfile)
@@ -388,6 +421,7 @@ xmldb_clear(clicon_handle h,
 		xml_free(xt);
 		de->de_xml = NULL;
 	    }
+	    de->de_dirtyok = 0;
 	}
     }
     return 0;
@@ -416,6 +450,8 @@ xmldb_delete(clicon_handle h,
 	    clicon_err(OE_DB, errno, "truncate %s", filename);
 	    goto done;
 	}
+    if (xmldb_gen_inc(h, db) < 0)
+	goto done;
     retval = 0;
  done:
     if (filename)
@@ -445,6 +481,7 @@ xmldb_create(clicon_handle h,
 		xml_free(xt);
 		de->de_xml = NULL;
 	    }
+	    de->de_dirtyok = 0;
 	}
     }
     if (xmldb_db2file(h, db, &filename) < 0)
@@ -453,6 +490,8 @@ xmldb_create(clicon_handle h,
 	clicon_err(OE_UNIX, errno, "open(%s)", filename);
 	goto done;
     }
+    if (xmldb_gen_inc(h, db) < 0)
+	goto done;
    retval = 0;
  done:
     if (filename)
@@ -538,6 +577,51 @@ xmldb_empty_get(clicon_handle h,
     return de->de_empty;
 }
 
+/*! Get generation of datastore
+ * The generation is incremented each time the datastore is written, and can be used
+ * to detect if a datastore has changed since a previous access.
+ * @param[in]  h     Clicon handle
+ * @param[in]  db    Database name
+ * @retval     gen   Generation, 0 if the datastore has not been written since start
+ * @see xmldb_gen_inc
+ */
+uint64_t
+xmldb_gen_get(clicon_handle h,
+	      const char   *db)
+{
+    db_elmnt *de;
+    
+    if ((de = clicon_db_elmnt_get(h, db)) == NULL)
+	return 0;
+    return de->de_gen;
+}
+
+/*! Check if the cached tree of a datastore has valid dirty marks
+ *
+ * Dirty marks (XML_FLAG_DIRTY) are set by xmldb_put on every node that is modified,
+ * and on its ancestors, and recorded in their parents, see xml_dirty_mark. They
+ * are valid if the datastore was copied from (or to) running, and running has not
+ * changed since. Then only dirty subtrees can differ from running.
+ * @param[in]  h     Clicon handle
+ * @param[in]  db    Database name
+ * @retval     1     Dirty marks are valid, the tree can be diffed with xml_diff_dirty
+ * @retval     0     Dirty marks are not valid, a full xml_diff is necessary
+ * @see xml_diff_dirty
+ */
+int
+xmldb_dirty_get(clicon_handle h,
+		const char   *db)
+{
+    db_elmnt *de;
+    
+    if (clicon_datastore_cache(h) == DATASTORE_NOCACHE)
+	return 0;
+    if ((de = clicon_db_elmnt_get(h, db)) == NULL ||
+	de->de_xml == NULL)
+	return 0;
+    return de->de_dirtyok && de->de_dirtygen == xmldb_gen_get(h, "running");
+}
+
 /*! Get modified flag from datastore
  * @param[in]  h     Clicon handle
  * @param[in]  db    Database name
@@ -66,6 +66,7 @@
 #include "clixon_yang.h"
 #include "clixon_xml.h"
 #include "clixon_xml_sort.h"
+#include "clixon_xml_page.h"
 #include "clixon_options.h"
 #include "clixon_data.h"
 #include "clixon_xpath_ctx.h"
@@ -952,6 +953,182 @@ xmldb_get0(clicon_handle    h,
     return retval;
 }
 
+/* Argument of xmldb_page_nacm */
+struct page_nacm{
+    clicon_handle pn_h;
+    cxobj        *pn_xt;       /* Top of datastore tree */
+    char         *pn_username;
+    cxobj        *pn_xnacm;    /* NACM XML tree */
+};
+
+/*! Page filter: keep list entry if user has read access to it
+ *
+ * The entry and its ancestors (with keys) are copied and the copy is filtered by
+ * NACM read access, the datastore tree is not modified.
+ * @param[in]  x    List or leaf-list entry in datastore tree
+ * @param[in]  arg  struct page_nacm
+ * @retval     1    Entry is readable
+ * @retval     0    Entry is denied
+ * @retval    -1    Error
+ * @see nacm_datanode_read
+ */
+static int
+xmldb_page_nacm(cxobj *x,
+		void  *arg)
+{
+    int               retval = -1;
+    struct page_nacm *pn = (struct page_nacm *)arg;
+    cxobj            *x1t = NULL;
+    cxobj            *x1;
+    cxobj            *xa;
+    cxobj           **avec = NULL;
+    int               alen = 0;
+    int               i;
+
+    for (xa = x; xa != pn->pn_xt && xa != NULL; xa = xml_parent(xa))
+	alen++;
+    if ((avec = calloc(alen, sizeof(cxobj *))) == NULL){
+	clicon_err(OE_UNIX, errno, "calloc");
+	goto done;
+    }
+    i = alen;
+    for (xa = x; xa != pn->pn_xt && xa != NULL; xa = xml_parent(xa))
+	avec[--i] = xa;
+    if ((x1t = xml_new(xml_name(pn->pn_xt), NULL, CX_ELMNT)) == NULL)
+	goto done;
+    xml_spec_set(x1t, xml_spec(pn->pn_xt));
+    if (xml_copy_from_bottom(pn->pn_xt, x, x1t) < 0)
+	goto done;
+    /* Find copy of entry: one child of each ancestor is copied, besides keys */
+    x1 = x1t;
+    for (i=0; i<alen && x1; i++)
+	x1 = xml_find_type(x1, NULL, xml_name(avec[i]), CX_ELMNT);
+    if (x1 == NULL){
+	clicon_err(OE_XML, 0, "Copy of %s not found", xml_name(x));
+	goto done;
+    }
+    if (nacm_datanode_read(pn->pn_h, x1t, &x1, 1, pn->pn_username, pn->pn_xnacm) < 0)
+	goto done;
+    /* Entry is kept if not purged */
+    x1 = x1t;
+    for (i=0; i<alen && x1; i++)
+	x1 = xml_find_type(x1, NULL, xml_name(avec[i]), CX_ELMNT);
+    retval = x1 != NULL;
+ done:
+    if (avec)
+	free(avec);
+    if (x1t)
+	xml_free(x1t);
+    return retval;
+}
+
+/*! Get a page of list entries of a datastore, return a copy of the XML tree
+ *
+ * As xmldb_get0 with copy but only the list or leaf-list entries of a page are
+ * selected, instead of all matches of xpath.
+ * If NACM is enabled, entries that the user may not read are skipped before
+ * offset and limit are applied, so that a page is not short and denied entries
+ * do not leak in a cursor. The caller still filters the reply by NACM.
+ * @param[in]  h      Clicon handle
+ * @param[in]  db     Name of datastore, eg "running"
+ * @param[in]  nsc    External XML namespace context, or NULL
+ * @param[in]  xpath  String with XPATH syntax selecting list entries
+ * @param[in]  pg     Pagination parameters
+ * @param[in]  username User name for NACM read access, or NULL
+ * @param[out] xret   Single return XML tree. Free with xml_free()
+ * @param[out] next   Cursor of next page, or NULL if last page. Free after use
+ * @retval     -1     General error, check specific clicon_errno, clicon_suberrno
+ * @retval     0      Invalid cursor
+ * @retval     1      OK
+ * @see clixon_page_select
+ */
+int
+xmldb_get_page(clicon_handle    h,
+	       const char      *db,
+	       cvec            *nsc,
+	       const char      *xpath,
+	       clixon_page     *pg,
+	       char            *username,
+	       cxobj          **xret,
+	       char           **next)
+{
+    int        retval = -1;
+    yang_stmt *yspec;
+    struct page_nacm pn = {0,};
+    clixon_page pg0;
+    cxobj     *x0t = NULL; /* (cached) top of tree */
+    cxobj     *xfile = NULL; /* Read from file, not cached */
+    cxobj     *x1t = NULL;
+    cxobj    **xvec = NULL;
+    size_t     xlen;
+    int        i;
+    db_elmnt  *de = NULL;
+    db_elmnt   de0 = {0,};
+    int        ret;
+
+    if ((yspec = clicon_dbspec_yang(h)) == NULL){
+	clicon_err(OE_YANG, ENOENT, "No yang spec");
+	goto done;
+    }
+    de = clicon_db_elmnt_get(h, db);
+    if (clicon_datastore_cache(h) == DATASTORE_NOCACHE ||
+	de == NULL || de->de_xml == NULL){ 
+	if ((ret = xmldb_readfile(h, db, YB_MODULE, yspec, &x0t, &de0, NULL)) < 0)
+	    goto done;
+	if (ret == 0){
+	    clicon_err(OE_DB, 0, "%s: failed to bind yang", db);
+	    goto done;
+	}
+	if (clicon_datastore_cache(h) == DATASTORE_NOCACHE)
+	    xfile = x0t;
+	else
+	    de0.de_xml = x0t;
+	clicon_db_elmnt_set(h, db, &de0); /* Content is copied */
+    }
+    else
+	x0t = de->de_xml;
+    pg0 = *pg;
+    if ((pn.pn_xnacm = clicon_nacm_cache(h)) != NULL && pg0.pg_filter == NULL){
+	pn.pn_h = h;
+	pn.pn_xt = x0t;
+	pn.pn_username = username;
+	pg0.pg_filter = xmldb_page_nacm;
+	pg0.pg_filterarg = &pn;
+    }
+    if ((ret = clixon_page_select(x0t, nsc, (char*)xpath, &pg0, &xvec, &xlen, next)) < 0)
+	goto done;
+    if (ret == 0)
+	goto fail;
+    if ((x1t = xml_new(xml_name(x0t), NULL, CX_ELMNT)) == NULL)
+	goto done;
+    xml_spec_set(x1t, xml_spec(x0t));
+    /* Entries are copied in page order, ie reversed if backwards */
+    for (i=0; i<xlen; i++)
+	if (xml_copy_from_bottom(x0t, xvec[i], x1t) < 0)
+	    goto done;
+    if (xml_global_defaults(h, x1t, nsc, xpath, yspec, 0) < 0)
+	goto done;
+    if (xml_default_recurse(x1t, 0) < 0)
+	goto done;
+    if (clicon_debug_get()>1)
+    	clicon_xml2file(stderr, x1t, 0, 1);
+    *xret = x1t;
+    x1t = NULL;
+    retval = 1;
+ done:
+    clicon_debug(2, "%s retval:%d", __FUNCTION__, retval);
+    if (x1t)
+	xml_free(x1t);
+    if (xfile)
+	xml_free(xfile);
+    if (xvec)
+	free(xvec);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
 /*! Clear cached xml tree obtained with xmldb_get0, if zerocopy
  *
  * @param[in]  h    Clicon handle
@@ -976,9 +1153,9 @@ xmldb_get0_clear(clicon_handle    h,
     if (xml_tree_prune_flagged(x, XML_FLAG_DEFAULT, 1) < 0)
 	goto done;
 
-    /* clear mark and change */
+    /* clear mark and change, but keep dirty marks of cached tree */
     xml_apply0(x, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset,
-	       (void*)(0xffff));
+	       (void*)(0xffff & ~(XML_FLAG_DIRTY|XML_FLAG_NEW)));
  ok:
     retval = 0;
  done:
@@ -203,6 +203,20 @@ check_body_namespace(cxobj     *x0,
     return retval;
 }
 
+/*! Remove a node from the base tree and record it as removed in its parent
+ * @param[in]  x   XML node in base tree
+ * @retval     0   OK
+ * @retval    -1   Error
+ * @see xml_dirty_mark  the parent keeps a copy of the keys of x, see xml_diff_dirty
+ */
+static int
+xml_purge_dirty(cxobj *x)
+{
+    if (xml_dirty_mark(x, 0) < 0)
+	return -1;
+    return xml_purge(x);
+}
+
 /*! Modify a base tree x0 with x1 with yang spec y according to operation op
  * @param[in]  h        Clicon handle
  * @param[in]  x0       Base xml tree (can be NULL in add scenarios)
@@ -357,7 +371,8 @@ text_modify(clicon_handle       h,
 		 * original object is not reverted.
 		 */
 		if (x0){
-		    xml_purge(x0);
+		    if (xml_purge_dirty(x0) < 0)
+			goto done;
 		    x0 = NULL;
 		}
 	    } /* OP_MERGE & insert */
@@ -440,6 +455,8 @@ text_modify(clicon_handle       h,
 			}
 			if (xml_value_set(x0b, x1bstr) < 0)
 			    goto done;
+			if (xml_dirty_mark(x0, 0) < 0)
+			    goto done;
 			/* If a default value ies replaced, then reset default flag */
 			if (xml_flag(x0, XML_FLAG_DEFAULT))
 			    xml_flag_reset(x0, XML_FLAG_DEFAULT);
@@ -449,6 +466,8 @@ text_modify(clicon_handle       h,
 	    if (changed){ 
 		if (xml_insert(x0p, x0, insert, valstr, NULL) < 0) 
 		    goto done;
+		if (xml_dirty_mark(x0, 1) < 0)
+		    goto done;
 	    }
 	    break;
 	case OP_DELETE:
@@ -465,7 +484,7 @@ text_modify(clicon_handle       h,
 		    if (ret == 0)
 			goto fail;
 		}
-		if (xml_purge(x0) < 0)
+		if (xml_purge_dirty(x0) < 0)
 		    goto done;
 	    }
 	    break;
@@ -534,7 +553,8 @@ text_modify(clicon_handle       h,
 		 * original object is not reverted.
 		 */
 		if (x0){
-		    xml_purge(x0);
+		    if (xml_purge_dirty(x0) < 0)
+			goto done;
 		    x0 = NULL;
 		}
 	    } /* OP_MERGE & insert */
@@ -556,13 +576,14 @@ text_modify(clicon_handle       h,
 			goto fail;
 		    permit = 1;
 		}
-		if (x0){
-		    xml_purge(x0);
-		}
+		if (x0 && xml_purge_dirty(x0) < 0)
+		    goto done;
 		if ((x0 = xml_new(x1name, x0p, CX_ELMNT)) == NULL)
 		    goto done;
 		if (xml_copy(x1, x0) < 0)
 		    goto done;
+		if (xml_dirty_mark(x0, 1) < 0)
+		    goto done;
 		break;
 	    } /* anyxml, anydata */
 	    if (x0==NULL){
@@ -635,7 +656,7 @@ text_modify(clicon_handle       h,
 		    goto done;
 		if (x0c && (yc != xml_spec(x0c))){
 		    /* There is a match but is should be replaced (choice)*/
-		    if (xml_purge(x0c) < 0)
+		    if (xml_purge_dirty(x0c) < 0)
 			goto done;
 		    x0c = NULL;
 		}
@@ -662,6 +683,8 @@ text_modify(clicon_handle       h,
 	    if (changed){
 		if (xml_insert(x0p, x0, insert, keystr, nscx1) < 0)
 		    goto done;
+		if (xml_dirty_mark(x0, 1) < 0)
+		    goto done;
 	    }
 	    break;
 	case OP_DELETE:
@@ -678,7 +701,7 @@ text_modify(clicon_handle       h,
 		    if (ret == 0)
 			goto fail;
 		}
-		if (xml_purge(x0) < 0)
+		if (xml_purge_dirty(x0) < 0)
 		    goto done;
 	    }
 	    break;
@@ -770,7 +793,7 @@ text_modify_top(clicon_handle       h,
 		    permit = 1;
 		}
 		while ((x0c = xml_child_i(x0, 0)) != 0)
-		    if (xml_purge(x0c) < 0)
+		    if (xml_purge_dirty(x0c) < 0)
 			goto done;
 		break;
 	    default:
@@ -810,7 +833,7 @@ text_modify_top(clicon_handle       h,
 	    permit = 1;
 	}
 	while ((x0c = xml_child_i(x0, 0)) != 0)
-	    if (xml_purge(x0c) < 0)
+	    if (xml_purge_dirty(x0c) < 0)
 		goto done;
     }
     /* Loop through children of the modification tree */
@@ -845,7 +868,7 @@ text_modify_top(clicon_handle       h,
 	    goto done;
 	if (x0c && (yc != xml_spec(x0c))){
 	    /* There is a match but is should be replaced (choice)*/
-	    if (xml_purge(x0c) < 0)
+	    if (xml_purge_dirty(x0c) < 0)
 		goto done;
 	    x0c = NULL;
 	}
@@ -985,6 +1008,9 @@ xmldb_put(clicon_handle       h,
     /* Clear XML tree of defaults */
     if (xml_tree_prune_flagged(x0, XML_FLAG_DEFAULT, 1) < 0)
 	goto done;
+    /* Only keep records of modified nodes if they can be used, eg not in running */
+    if (!xmldb_dirty_get(h, db))
+	xml_flag_reset_dirty(x0, XML_FLAG_DIRTY|XML_FLAG_NEW);
 #if 0 /* debug */
     if (xml_apply0(x0, -1, xml_sort_verify, NULL) < 0)
 	clicon_log(LOG_NOTICE, "%s: verify failed #3", __FUNCTION__);
@@ -995,8 +1021,10 @@ xmldb_put(clicon_handle       h,
 	db_elmnt de0 = {0,};
 	if (de != NULL)
 	    de0 = *de;
-	if (de0.de_xml == NULL)
+	if (de0.de_xml == NULL){
 	    de0.de_xml = x0;
+	    de0.de_dirtyok = 0; /* Read from file, no dirty marks */
+	}
 	de0.de_empty = (xml_child_nr(de0.de_xml) == 0);
 	clicon_db_elmnt_set(h, db, &de0);
     }
@@ -1028,12 +1056,14 @@ xmldb_put(clicon_handle       h,
 	if (xml2json(f, x0, pretty) < 0)
 	    goto done;
     }
-    else if (clicon_xml2file(f, x0, 0, pretty) < 0)
+    else if (clicon_xml2fd(fileno(f), x0, 0, pretty) < 0) /* Nothing buffered in f */
 	goto done;
     /* Remove modules state after writing to file
      */
     if (xmodst && xml_purge(xmodst) < 0)
 	goto done;
+    if (xmldb_gen_inc(h, db) < 0)
+	goto done;
     retval = 1;
  done:
     if (f != NULL)
@@ -48,9 +48,14 @@
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
+#include <limits.h>
 #include <syslog.h>
+#include <poll.h>
 #include <sys/types.h>
 #include <sys/time.h>
+#ifdef HAVE_SYS_EPOLL_H
+#include <sys/epoll.h>
+#endif
 
 #include "clixon_queue.h"
 #include "clixon_log.h"
@@ -61,16 +66,19 @@
  * Constants
  */
 #define EVENT_STRLEN 32
+#define EVENT_MAXEVENTS 64 /* Max number of fd events returned by one epoll_wait */
 
 /*
  * Types
  */
 struct event_data{
     struct event_data *e_next;     /* next in list */
+    struct event_data *e_fdnext;   /* next event of same fd and direction (epoll) */
     int (*e_fn)(int, void*);            /* function */
-    enum {EVENT_FD, EVENT_TIME} e_type;        /* type of event */
+    enum {EVENT_FD, EVENT_FD_WRITE, EVENT_TIME} e_type; /* type of event */
     int e_fd;                      /* File descriptor */
     struct timeval e_time;         /* Timeout */
+    unsigned long e_seq;           /* Timer registration order, for equal timeouts */
     void *e_arg;                   /* function argument */
     char e_string[EVENT_STRLEN];             /* string for debugging */
 };
@@ -79,8 +87,32 @@ struct event_data{
  * Internal variables
  * XXX consider use handle variables instead of global
  */
+/* File descriptor events */
 static struct event_data *ee = NULL;
-static struct event_data *ee_timers = NULL;
+
+/* Timer events as a binary min-heap ordered by timeout */
+static struct event_data **ee_timers = NULL;
+static int                 ee_timers_len = 0; /* Number of timers */
+static int                 ee_timers_max = 0; /* Allocated size of ee_timers */
+static unsigned long       ee_timers_seq = 0; /* Registration counter */
+
+#ifdef HAVE_SYS_EPOLL_H
+/* Input and output events of a file descriptor, the epoll set is indexed by fd */
+struct event_fd{
+    struct event_data *ef_in;      /* Input (read) events, linked by e_fdnext */
+    struct event_data *ef_out;     /* Output (write) events, linked by e_fdnext */
+    int                ef_always;  /* Not in epoll set (eg regular file), always ready */
+};
+static int                ee_epfd = -1;  /* epoll file descriptor */
+static pid_t              ee_eppid = 0;  /* Process that created ee_epfd */
+static struct epoll_event ee_events[EVENT_MAXEVENTS]; /* Result of last wait */
+static struct event_fd   *ee_fds = NULL; /* Events indexed by file descriptor */
+static int                ee_fds_max = 0; /* Allocated size of ee_fds */
+static int                ee_always = 0; /* Number of always ready fds, see ef_always */
+#else
+static fd_set             ee_fdset;      /* Read result of last select */
+static fd_set             ee_wfdset;     /* Write result of last select */
+#endif
 
 /* Set if element in ee is deleted (clixon_event_unreg_fd). Check in ee loops */
 static int _ee_unreg = 0;
@@ -116,26 +148,185 @@ clicon_exit_get(void)
     return _clicon_exit;
 }
 
-/*! Register a callback function to be called on input on a file descriptor.
- *
+#ifdef HAVE_SYS_EPOLL_H
+/*! Get epoll event mask of registered events of a file descriptor
+ */
+static uint32_t
+event_epoll_mask(int fd)
+{
+    uint32_t mask = 0;
+
+    if (fd < ee_fds_max){
+	if (ee_fds[fd].ef_in)
+	    mask |= EPOLLIN;
+	if (ee_fds[fd].ef_out)
+	    mask |= EPOLLOUT;
+    }
+    return mask;
+}
+
+/*! Update the epoll set (level-triggered) after a file descriptor event has changed
+ * epoll rejects file descriptors that cannot be polled, eg regular files such as
+ * stdin redirected from a file. As with select and poll, they are always ready and
+ * are kept outside the epoll set, see event_fds_dispatch.
+ * @param[in]  epfd   epoll file descriptor
+ * @param[in]  fd     File descriptor
+ * @param[in]  mask0  Event mask of fd before the change
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+event_epoll_ctl(int      epfd,
+		int      fd,
+		uint32_t mask0)
+{
+    struct epoll_event ev = {0,};
+    int                op;
+
+    ev.events = event_epoll_mask(fd);
+    ev.data.fd = fd;
+    if (ev.events == mask0)
+	return 0;
+    if (fd < ee_fds_max && ee_fds[fd].ef_always){
+	if (ev.events == 0){
+	    ee_fds[fd].ef_always = 0;
+	    ee_always--;
+	}
+	return 0;
+    }
+    if (mask0 == 0)
+	op = EPOLL_CTL_ADD;
+    else if (ev.events == 0)
+	op = EPOLL_CTL_DEL;
+    else
+	op = EPOLL_CTL_MOD;
+    if (epoll_ctl(epfd, op, fd, &ev) < 0){
+	if (op == EPOLL_CTL_ADD && errno == EPERM){ /* Not pollable: always ready */
+	    ee_fds[fd].ef_always = 1;
+	    ee_always++;
+	    return 0;
+	}
+	/* May fail if fd already closed, it is then already removed */
+	if (op != EPOLL_CTL_ADD && (errno == EBADF || errno == ENOENT))
+	    return 0;
+	clicon_err(OE_EVENTS, errno, "epoll_ctl fd:%d", fd);
+	return -1;
+    }
+    return 0;
+}
+
+/*! Get epoll file descriptor, create it if not done or if inherited by fork
+ * An epoll set is shared by parent and child after fork, therefore a process that
+ * did not create it makes its own set of the registered file descriptors.
+ * @retval  epfd  epoll file descriptor
+ * @retval  -1    Error
+ */
+static int
+event_epoll_fd(void)
+{
+    int fd;
+
+    if (ee_epfd != -1 && ee_eppid == getpid())
+	return ee_epfd;
+    if (ee_epfd != -1)
+	close(ee_epfd);
+    if ((ee_epfd = epoll_create1(EPOLL_CLOEXEC)) < 0){
+	clicon_err(OE_EVENTS, errno, "epoll_create1");
+	return -1;
+    }
+    ee_eppid = getpid();
+    for (fd=0; fd<ee_fds_max; fd++)
+	if (event_epoll_ctl(ee_epfd, fd, 0) < 0)
+	    return -1;
+    return ee_epfd;
+}
+
+/*! Add or remove an event of a file descriptor in the epoll set
+ * Several events may be registered for the same file descriptor and direction,
+ * as with select. The file descriptor is in the epoll set as long as it has any.
  * @param[in]  fd  File descriptor
- * @param[in]  fn  Function to call when input available on fd
- * @param[in]  arg Argument to function fn
- * @param[in]  str Describing string for logging
- * @code
- * int fn(int fd, void *arg){
- * }
- * clixon_event_reg_fd(fd, fn, (void*)42, "call fn on input on fd");
- * @endcode 
+ * @param[in]  e   Event data
+ * @param[in]  out If set, output event, otherwise input event
+ * @param[in]  add If set add e, otherwise remove it
+ * @retval     0   OK
+ * @retval    -1   Error
  */
-int
-clixon_event_reg_fd(int   fd, 
-		    int (*fn)(int, void*), 
-		    void *arg, 
-		    char *str)
+static int
+event_epoll_set(int                fd,
+		struct event_data *e,
+		int                out,
+		int                add)
+{
+    struct event_fd   *vec;
+    struct event_data **ep;
+    uint32_t           mask0;
+    int                max;
+    int                epfd;
+
+    if ((epfd = event_epoll_fd()) < 0)
+	return -1;
+    if (fd >= ee_fds_max){
+	if (!add)
+	    return 0;
+	max = ee_fds_max ? 2*ee_fds_max : 64;
+	while (max <= fd)
+	    max *= 2;
+	if ((vec = realloc(ee_fds, max*sizeof(struct event_fd))) == NULL){
+	    clicon_err(OE_EVENTS, errno, "realloc");
+	    return -1;
+	}
+	memset(&vec[ee_fds_max], 0, (max-ee_fds_max)*sizeof(struct event_fd));
+	ee_fds = vec;
+	ee_fds_max = max;
+    }
+    ep = out ? &ee_fds[fd].ef_out : &ee_fds[fd].ef_in;
+    mask0 = event_epoll_mask(fd);
+    if (add){
+	e->e_fdnext = *ep;
+	*ep = e;
+    }
+    else {
+	while (*ep && *ep != e)
+	    ep = &(*ep)->e_fdnext;
+	if (*ep == NULL)
+	    return 0;
+	*ep = e->e_fdnext;
+	e->e_fdnext = NULL;
+    }
+    if (event_epoll_ctl(epfd, fd, mask0) < 0){
+	if (add){
+	    ep = out ? &ee_fds[fd].ef_out : &ee_fds[fd].ef_in;
+	    *ep = e->e_fdnext;
+	}
+	return -1;
+    }
+    return 0;
+}
+#endif /* HAVE_SYS_EPOLL_H */
+
+/*! Register a callback function for a file descriptor event
+ * @param[in]  fd   File descriptor
+ * @param[in]  fn   Function to call when fd is ready
+ * @param[in]  arg  Argument to function fn
+ * @param[in]  str  Describing string for logging
+ * @param[in]  type EVENT_FD or EVENT_FD_WRITE
+ * @see clixon_event_reg_fd, clixon_event_reg_fd_write
+ */
+static int
+event_reg_fd(int   fd, 
+	     int (*fn)(int, void*), 
+	     void *arg, 
+	     char *str,
+	     int   type)
 {
     struct event_data *e;
 
+#ifndef HAVE_SYS_EPOLL_H
+    if (fd >= FD_SETSIZE){
+	clicon_err(OE_EVENTS, EINVAL, "fd %d larger than FD_SETSIZE", fd);
+	return -1;
+    }
+#endif
     if ((e = (struct event_data *)malloc(sizeof(struct event_data))) == NULL){
 	clicon_err(OE_EVENTS, errno, "malloc");
 	return -1;
@@ -145,7 +336,13 @@ clixon_event_reg_fd(int   fd,
     e->e_fd = fd;
     e->e_fn = fn;
     e->e_arg = arg;
-    e->e_type = EVENT_FD;
+    e->e_type = type;
+#ifdef HAVE_SYS_EPOLL_H
+    if (event_epoll_set(fd, e, type == EVENT_FD_WRITE, 1) < 0){
+	free(e);
+	return -1;
+    }
+#endif
     e->e_next = ee;
     ee = e;
     clicon_debug(2, "%s, registering %s", __FUNCTION__, e->e_string);
@@ -153,25 +350,27 @@ clixon_event_reg_fd(int   fd,
 }
 
 /*! Deregister a file descriptor callback
- * @param[in]  s   File descriptor
- * @param[in]  fn  Function to call when input available on fd
- * Note: deregister when exactly function and socket match, not argument
- * @see clixon_event_reg_fd
- * @see clixon_event_unreg_timeout
+ * @param[in]  s    File descriptor
+ * @param[in]  fn   Function to call when fd is ready
+ * @param[in]  type EVENT_FD or EVENT_FD_WRITE
  */
-int
-clixon_event_unreg_fd(int   s, 
-		      int (*fn)(int, void*))
+static int
+event_unreg_fd(int   s, 
+	       int (*fn)(int, void*),
+	       int   type)
 {
     struct event_data *e, **e_prev;
     int found = 0;
 
     e_prev = &ee;
     for (e = ee; e; e = e->e_next){
-	if (fn == e->e_fn && s == e->e_fd) {
+	if (fn == e->e_fn && s == e->e_fd && type == e->e_type) {
 	    found++;
 	    *e_prev = e->e_next;
 	    _ee_unreg++;
+#ifdef HAVE_SYS_EPOLL_H
+	    event_epoll_set(s, e, type == EVENT_FD_WRITE, 0);
+#endif
 	    free(e);
 	    break;
 	}
@@ -180,6 +379,139 @@ clixon_event_unreg_fd(int   s,
     return found?0:-1;
 }
 
+/*! Register a callback function to be called on input on a file descriptor.
+ *
+ * @param[in]  fd  File descriptor
+ * @param[in]  fn  Function to call when input available on fd
+ * @param[in]  arg Argument to function fn
+ * @param[in]  str Describing string for logging
+ * @code
+ * int fn(int fd, void *arg){
+ * }
+ * clixon_event_reg_fd(fd, fn, (void*)42, "call fn on input on fd");
+ * @endcode 
+ * @see clixon_event_reg_fd_write
+ */
+int
+clixon_event_reg_fd(int   fd, 
+		    int (*fn)(int, void*), 
+		    void *arg, 
+		    char *str)
+{
+    return event_reg_fd(fd, fn, arg, str, EVENT_FD);
+}
+
+/*! Deregister a file descriptor callback
+ * @param[in]  s   File descriptor
+ * @param[in]  fn  Function to call when input available on fd
+ * Note: deregister when exactly function and socket match, not argument
+ * @see clixon_event_reg_fd
+ * @see clixon_event_unreg_timeout
+ */
+int
+clixon_event_unreg_fd(int   s, 
+		      int (*fn)(int, void*))
+{
+    return event_unreg_fd(s, fn, EVENT_FD);
+}
+
+/*! Register a callback function to be called when a file descriptor is writable.
+ *
+ * Typically registered when output on a non-blocking socket is pending and 
+ * deregistered when all is written. The callback is level-triggered, ie it is
+ * called in every loop iteration as long as fd is writable.
+ * @param[in]  fd  File descriptor
+ * @param[in]  fn  Function to call when fd is writable
+ * @param[in]  arg Argument to function fn
+ * @param[in]  str Describing string for logging
+ * @see clixon_event_unreg_fd_write
+ */
+int
+clixon_event_reg_fd_write(int   fd, 
+			  int (*fn)(int, void*), 
+			  void *arg, 
+			  char *str)
+{
+    return event_reg_fd(fd, fn, arg, str, EVENT_FD_WRITE);
+}
+
+/*! Deregister a file descriptor output callback
+ * @param[in]  s   File descriptor
+ * @param[in]  fn  Function to call when fd is writable
+ * @see clixon_event_reg_fd_write
+ */
+int
+clixon_event_unreg_fd_write(int   s, 
+			    int (*fn)(int, void*))
+{
+    return event_unreg_fd(s, fn, EVENT_FD_WRITE);
+}
+
+/*! Compare two timers in heap, order by timeout, then by registration
+ * @retval  1  ea expires before eb
+ * @retval  0  ea expires after eb
+ */
+static int
+event_timer_before(struct event_data *ea,
+		   struct event_data *eb)
+{
+    if (timercmp(&ea->e_time, &eb->e_time, ==))
+	return ea->e_seq < eb->e_seq;
+    return timercmp(&ea->e_time, &eb->e_time, <);
+}
+
+/*! Move timer at heap position i up until heap property holds
+ */
+static void
+event_timer_up(int i)
+{
+    struct event_data *e = ee_timers[i];
+    int                p;
+
+    while (i > 0){
+	p = (i-1)/2;
+	if (!event_timer_before(e, ee_timers[p]))
+	    break;
+	ee_timers[i] = ee_timers[p];
+	i = p;
+    }
+    ee_timers[i] = e;
+}
+
+/*! Move timer at heap position i down until heap property holds
+ */
+static void
+event_timer_down(int i)
+{
+    struct event_data *e = ee_timers[i];
+    int                c;
+
+    while ((c = 2*i+1) < ee_timers_len){
+	if (c+1 < ee_timers_len && event_timer_before(ee_timers[c+1], ee_timers[c]))
+	    c++;
+	if (!event_timer_before(ee_timers[c], e))
+	    break;
+	ee_timers[i] = ee_timers[c];
+	i = c;
+    }
+    ee_timers[i] = e;
+}
+
+/*! Remove timer at heap position i and return it
+ */
+static struct event_data *
+event_timer_remove(int i)
+{
+    struct event_data *e = ee_timers[i];
+
+    if (--ee_timers_len > i){
+	ee_timers[i] = ee_timers[ee_timers_len];
+	event_timer_up(i);
+	event_timer_down(i);
+    }
+    return e;
+}
+
 /*! Call a callback function at an absolute time
  * @param[in]  t   Absolute (not relative!) timestamp when callback is called
  * @param[in]  fn  Function to call at time t
@@ -209,8 +541,19 @@ clixon_event_reg_timeout(struct timeval t,
 			 void          *arg, 
 			 char          *str)
 {
-    struct event_data *e, *e1, **e_prev;
-
+    struct event_data  *e;
+    struct event_data **vec;
+    int                 max;
+
+    if (ee_timers_len == ee_timers_max){
+	max = ee_timers_max ? 2*ee_timers_max : 16;
+	if ((vec = realloc(ee_timers, max*sizeof(struct event_data *))) == NULL){
+	    clicon_err(OE_EVENTS, errno, "realloc");
+	    return -1;
+	}
+	ee_timers = vec;
+	ee_timers_max = max;
+    }
     if ((e = (struct event_data *)malloc(sizeof(struct event_data))) == NULL){
 	clicon_err(OE_EVENTS, errno, "malloc");
 	return -1;
@@ -221,15 +564,10 @@ clixon_event_reg_timeout(struct timeval t,
     e->e_arg = arg;
     e->e_type = EVENT_TIME;
     e->e_time = t;
-    /* Sort into right place */
-    e_prev = &ee_timers;
-    for (e1=ee_timers; e1; e1=e1->e_next){
-	if (timercmp(&e->e_time, &e1->e_time, <))
-	    break;
-	e_prev = &e1->e_next;
-    }
-    e->e_next = e1;
-    *e_prev = e;
+    e->e_seq = ee_timers_seq++;
+    /* Insert last in heap and move up into right place */
+    ee_timers[ee_timers_len++] = e;
+    event_timer_up(ee_timers_len-1);
     clicon_debug(2, "%s: %s", __FUNCTION__, str); 
     return 0;
 }
@@ -247,20 +585,15 @@ int
 clixon_event_unreg_timeout(int (*fn)(int, void*), 
 			   void *arg)
 {
-    struct event_data *e, **e_prev;
-    int found = 0;
+    int i;
 
-    e_prev = &ee_timers;
-    for (e = ee_timers; e; e = e->e_next){
-	if (fn == e->e_fn && arg == e->e_arg) {
-	    found++;
-	    *e_prev = e->e_next;
-	    free(e);
-	    break;
+    for (i=0; i<ee_timers_len; i++){
+	if (fn == ee_timers[i]->e_fn && arg == ee_timers[i]->e_arg) {
+	    free(event_timer_remove(i));
+	    return 0;
 	}
-	e_prev = &e->e_next;
     }
-    return found?0:-1;
+    return -1;
 }
 
 /*! Poll to see if there is any data available on this file descriptor.
@@ -273,49 +606,218 @@ int
 clixon_event_poll(int fd)
 {
     int            retval = -1;
-    fd_set         fdset;
-    struct timeval tnull = {0,};
+    struct pollfd  pfd = {0,};
 
-    FD_ZERO(&fdset);
-    FD_SET(fd, &fdset);
-    if ((retval = select(FD_SETSIZE, &fdset, NULL, NULL, &tnull)) < 0)
-	clicon_err(OE_EVENTS, errno, "select");
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    if ((retval = poll(&pfd, 1, 0)) < 0)
+	clicon_err(OE_EVENTS, errno, "poll");
     return retval;
 }
 
-/*! Dispatch file descriptor events (and timeouts) by invoking callbacks.
- * There is an issue with fairness that timeouts may take over all events
- * One could try to poll the file descriptors after a timeout?
+/*! Wait for file descriptor events at most a time
+ * @param[in]  tp   Max time to wait, or NULL for no timeout
+ * @retval     n    Number of file descriptors with events
+ * @retval    -1    Error, errno set. Also if the epoll set could not be created
+ */
+static int
+event_fds_wait(struct timeval *tp)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    int                epfd;
+    int                ms = -1;
+
+    if ((epfd = event_epoll_fd()) < 0)
+	return -1;
+    if (tp){ /* Round up to ms, to not wake up just before timeout */
+	if (tp->tv_sec >= INT_MAX/1000 - 1) /* Longer than ~24 days: do not overflow */
+	    ms = INT_MAX;
+	else
+	    ms = tp->tv_sec*1000 + (tp->tv_usec+999)/1000;
+    }
+    if (ee_always) /* Do not wait if there are always ready fds */
+	ms = 0;
+    return epoll_wait(epfd, ee_events, EVENT_MAXEVENTS, ms);
+#else
+    struct event_data *e;
+
+    FD_ZERO(&ee_fdset);
+    FD_ZERO(&ee_wfdset);
+    for (e=ee; e; e=e->e_next)
+	if (e->e_type == EVENT_FD)
+	    FD_SET(e->e_fd, &ee_fdset);
+	else if (e->e_type == EVENT_FD_WRITE)
+	    FD_SET(e->e_fd, &ee_wfdset);
+    return select(FD_SETSIZE, &ee_fdset, &ee_wfdset, NULL, tp); 
+#endif
+}
+
+/*! Invoke the callback of a file descriptor event
+ * @retval  0  OK
+ * @retval -1  Error in callback
+ */
+static int
+event_fd_call(struct event_data *e)
+{
+    clicon_debug(2, "%s: %s", __FUNCTION__, e->e_string);
+    if ((*e->e_fn)(e->e_fd, e->e_arg) < 0){
+	clicon_debug(1, "%s Error in: %s", __FUNCTION__, e->e_string);
+	return -1;
+    }
+    return 0;
+}
+
+#ifdef HAVE_SYS_EPOLL_H
+/*! Invoke the callbacks of the events of a file descriptor and direction
+ * @param[in]  e    First event, linked by e_fdnext
+ * @retval     1    A callback deregistered a file descriptor, stop dispatch
+ * @retval     0    OK
+ * @retval    -1    Error in callback
+ */
+static int
+event_fd_call_all(struct event_data *e)
+{
+    for (; e; e = e->e_fdnext){
+	if (event_fd_call(e) < 0)
+	    return -1;
+	if (_ee_unreg) /* e may be freed */
+	    return 1;
+    }
+    return 0;
+}
+#endif /* HAVE_SYS_EPOLL_H */
+
+/*! Dispatch file descriptor events of last wait by invoking callbacks.
+ * Input callbacks are invoked before output callbacks of the same fd. Hangup and 
+ * error conditions are reported to both.
+ * If a callback deregisters a file descriptor, dispatch stops since the
+ * remaining events may refer to it. Pending events are then reported again
+ * by next wait.
+ * File descriptors that are not in the epoll set are always ready, and their
+ * callbacks are invoked after the epoll events.
+ * @param[in]  n    Number of file descriptors with events
+ * @retval     0    OK
+ * @retval    -1    Error in callback
+ */
+static int
+event_fds_dispatch(int n)
+{
+#ifdef HAVE_SYS_EPOLL_H
+    int                i;
+    int                fd;
+    uint32_t           events;
+    int                ret;
+
+    _ee_unreg = 0;
+    for (i=0; i<n; i++){
+	if (clicon_exit_get())
+	    break;
+	fd = ee_events[i].data.fd;
+	events = ee_events[i].events;
+	if (events & (EPOLLIN|EPOLLHUP|EPOLLERR)){
+	    if ((ret = event_fd_call_all(ee_fds[fd].ef_in)) < 0)
+		return -1;
+	    if (ret == 1)
+		break;
+	}
+	if (events & (EPOLLOUT|EPOLLHUP|EPOLLERR)){
+	    if ((ret = event_fd_call_all(ee_fds[fd].ef_out)) < 0)
+		return -1;
+	    if (ret == 1)
+		break;
+	}
+    }
+    for (fd=0; ee_always && !_ee_unreg && fd<ee_fds_max; fd++){
+	if (clicon_exit_get() || !ee_fds[fd].ef_always)
+	    continue;
+	if ((ret = event_fd_call_all(ee_fds[fd].ef_in)) < 0)
+	    return -1;
+	if (ret == 1)
+	    break;
+	if (event_fd_call_all(ee_fds[fd].ef_out) < 0)
+	    return -1;
+    }
+    _ee_unreg = 0;
+#else
+    struct event_data *e;
+    struct event_data *e_next;
+
+    _ee_unreg = 0;
+    for (e=ee; e && n > 0; e=e_next){
+	if (clicon_exit_get())
+	    break;
+	e_next = e->e_next;
+	if ((e->e_type == EVENT_FD && FD_ISSET(e->e_fd, &ee_fdset)) ||
+	    (e->e_type == EVENT_FD_WRITE && FD_ISSET(e->e_fd, &ee_wfdset))){
+	    if (event_fd_call(e) < 0)
+		return -1;
+	    if (_ee_unreg){
+		_ee_unreg = 0;
+		break;
+	    }
+	}
+    }
+#endif
+    return 0;
+}
+
+/*! Invoke callbacks of all timers that have expired
+ * Timers registered by the callbacks are not run until next iteration, so that
+ * timers with an expired timeout cannot starve file descriptor events.
+ * @retval  0  OK
+ * @retval -1  Error in callback
+ */
+static int
+event_timers_run(void)
+{
+    struct event_data *e;
+    struct timeval     t0;
+    unsigned long      seq;
+
+    gettimeofday(&t0, NULL);
+    seq = ee_timers_seq;
+    while (ee_timers_len > 0 && !clicon_exit_get()){
+	e = ee_timers[0];
+	if (timercmp(&e->e_time, &t0, >) || e->e_seq >= seq)
+	    break;
+	event_timer_remove(0);
+	clicon_debug(2, "%s timeout: %s", __FUNCTION__, e->e_string);
+	if ((*e->e_fn)(0, e->e_arg) < 0){
+	    free(e);
+	    return -1;
+	}
+	free(e);
+    }
+    return 0;
+}
+
+/*! Dispatch file descriptor events and timeouts by invoking callbacks.
+ * Uses epoll if available, otherwise select.
+ * Each iteration first dispatches file descriptor events and then all expired
+ * timeouts, so that neither can starve the other.
  * @retval  0  OK
  * @retval -1  Error: eg select, callback, timer, 
  */
 int
 clixon_event_loop(void)
 {
-    struct event_data *e;
-    struct event_data *e_next;
     int                n;
     struct timeval     t;
     struct timeval     t0;
     struct timeval     tnull = {0,};
-    fd_set             fdset;
     int                retval = -1;
 
     while (!clicon_exit_get()){
-	FD_ZERO(&fdset);
-	for (e=ee; e; e=e->e_next)
-	    if (e->e_type == EVENT_FD)
-		FD_SET(e->e_fd, &fdset);
-	if (ee_timers != NULL){
+	if (ee_timers_len > 0){
 	    gettimeofday(&t0, NULL);
-	    timersub(&ee_timers->e_time, &t0, &t); 
+	    timersub(&ee_timers[0]->e_time, &t0, &t); 
 	    if (t.tv_sec < 0)
-		n = select(FD_SETSIZE, &fdset, NULL, NULL, &tnull); 
+		n = event_fds_wait(&tnull);
 	    else
-		n = select(FD_SETSIZE, &fdset, NULL, NULL, &t); 
+		n = event_fds_wait(&t);
 	}
 	else
-	    n = select(FD_SETSIZE, &fdset, NULL, NULL, NULL); 
+	    n = event_fds_wait(NULL);
 	if (clicon_exit_get())
 	    break;
 	if (n == -1) {
@@ -328,34 +830,10 @@ clixon_event_loop(void)
 		clicon_err(OE_EVENTS, errno, "select");
 	    goto err;
 	}
-	if (n==0){ /* Timeout */
-	    e = ee_timers;
-	    ee_timers = ee_timers->e_next;
-	    clicon_debug(2, "%s timeout: %s", __FUNCTION__, e->e_string);
-	    if ((*e->e_fn)(0, e->e_arg) < 0){
-		free(e);
-		goto err;
-	    }
-	    free(e);
-	}
-	_ee_unreg = 0;
-	for (e=ee; e; e=e_next){
-	    if (clicon_exit_get())
-		break;
-	    e_next = e->e_next;
-	    if(e->e_type == EVENT_FD && FD_ISSET(e->e_fd, &fdset)){
-		clicon_debug(2, "%s: FD_ISSET: %s", __FUNCTION__, e->e_string);
-		if ((*e->e_fn)(e->e_fd, e->e_arg) < 0){
-		    clicon_debug(1, "%s Error in: %s", __FUNCTION__, e->e_string);
-		    goto err;
-
-		}
-		if (_ee_unreg){
-		    _ee_unreg = 0;
-		    break;
-		}
-	    }
-	}
+	if (event_fds_dispatch(n) < 0)
+	    goto err;
+	if (event_timers_run() < 0)
+	    goto err;
 	continue;
       err:
 	break;
@@ -368,6 +846,7 @@ int
 clixon_event_exit(void)
 {
     struct event_data *e, *e_next;
+    int                i;
     
     e_next = ee;
     while ((e = e_next) != NULL){
@@ -375,11 +854,22 @@ clixon_event_exit(void)
 	free(e);
     }
     ee = NULL;
-    e_next = ee_timers;
-    while ((e = e_next) != NULL){
-	e_next = e->e_next;
-	free(e);
-    }
+    for (i=0; i<ee_timers_len; i++)
+	free(ee_timers[i]);
+    if (ee_timers)
+	free(ee_timers);
     ee_timers = NULL;
+    ee_timers_len = 0;
+    ee_timers_max = 0;
+#ifdef HAVE_SYS_EPOLL_H
+    if (ee_epfd != -1 && ee_eppid == getpid())
+	close(ee_epfd);
+    ee_epfd = -1;
+    if (ee_fds)
+	free(ee_fds);
+    ee_fds = NULL;
+    ee_fds_max = 0;
+    ee_always = 0;
+#endif
     return 0;
 }
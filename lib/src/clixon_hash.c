@@ -96,15 +96,17 @@
 #define HASH_SIZE	1031	/* Number of hash buckets. Should be a prime */ 
 #define align4(s) (((s)/4)*4 + 4)
 
-/*! A very simplistic algorithm to calculate a hash bucket index
+/*! Calculate a hash bucket index (djb2)
+ * Keys that differ only in order or in a numeric suffix, such as list keys,
+ * should be spread over different buckets.
  */
 static uint32_t
 hash_bucket(const char *str)
 {
-    uint32_t n = 0;
+    uint32_t n = 5381;
 
     while(*str)
-	n += (uint32_t)*str++;
+	n = (n << 5) + n + (uint8_t)*str++;
     return n % HASH_SIZE;
 }
 
@@ -71,6 +71,8 @@
 #include "clixon_xml_bind.h"
 #include "clixon_xml_map.h"
 #include "clixon_xml_nsctx.h" /* namespace context */
+#include "clixon_xpath_ctx.h"
+#include "clixon_xpath.h"
 #include "clixon_netconf_lib.h"
 #include "clixon_json.h"
 #include "clixon_json_parse.h"
@@ -88,6 +90,18 @@
 /* Name of xml top object created by xml parse functions */
 #define JSON_TOP_SYMBOL "top"
 
+/* Characters that stop the span scan in json_str_escape_cdata(): the ones with 
+ * an entry in json_escape_tab and the first characters of the CDATA delimiters
+ */
+#define JSON_ESCAPE_STOP "\n\"\\<]"
+
+/* Escape sequences of characters in JSON strings, NULL if not escaped */
+static const char *json_escape_tab[256] = {
+    ['\n']  = "\\n",
+    ['"']   = "\\\"",
+    ['\\']  = "\\\\",
+};
+
 enum array_element_type{
     NO_ARRAY=0,
     FIRST_ARRAY,  /* [a, */
@@ -180,7 +194,10 @@ arraytype2str(enum array_element_type lt)
 }
 
 /*! Check typeof x in array
- * Some complexity when x is in different namespaces
+ * If x has a yang spec, the framing is given by its keyword: only list and leaf-list 
+ * entries form arrays, and neighbours belong to the same array if they have the
+ * same yang spec. Otherwise fall back to comparing names and namespaces of the 
+ * neighbours, with some complexity when x is in different namespaces
  */
 static enum array_element_type
 array_eval(cxobj *xprev, 
@@ -191,31 +208,42 @@ array_eval(cxobj *xprev,
     int                     eqprev=0;
     int                     eqnext=0;
     yang_stmt              *ys;
+    enum rfc_6020           keyword;
     char                   *nsx; /* namespace of x */
     char                   *ns2;
 
-    nsx = xml_find_type_value(x, NULL, "xmlns", CX_ATTR);
     if (xml_type(x) != CX_ELMNT){
 	array=BODY_ARRAY;
 	goto done;
     }
-    ys = xml_spec(x);
-    if (xnext && 
-	xml_type(xnext)==CX_ELMNT &&
-	strcmp(xml_name(x), xml_name(xnext))==0){
-        ns2 = xml_find_type_value(xnext, NULL, "xmlns", CX_ATTR);
-	if ((!nsx && !ns2)
-	    || (nsx && ns2 && strcmp(nsx,ns2)==0))
+    if ((ys = xml_spec(x)) != NULL){
+	keyword = yang_keyword_get(ys);
+	if (keyword != Y_LIST && keyword != Y_LEAF_LIST)
+	    goto done;
+	if (xnext && xml_spec(xnext) == ys)
 	    eqnext++;
-    }
-    if (xprev &&
-	xml_type(xprev)==CX_ELMNT &&
-	strcmp(xml_name(x),xml_name(xprev))==0){
-	ns2 = xml_find_type_value(xprev, NULL, "xmlns", CX_ATTR);
-	if ((!nsx && !ns2)
-	    || (nsx && ns2 && strcmp(nsx,ns2)==0))
+	if (xprev && xml_spec(xprev) == ys)
 	    eqprev++;
     }
+    else {
+	nsx = xml_find_type_value(x, NULL, "xmlns", CX_ATTR);
+	if (xnext && 
+	    xml_type(xnext)==CX_ELMNT &&
+	    strcmp(xml_name(x), xml_name(xnext))==0){
+	    ns2 = xml_find_type_value(xnext, NULL, "xmlns", CX_ATTR);
+	    if ((!nsx && !ns2)
+		|| (nsx && ns2 && strcmp(nsx,ns2)==0))
+		eqnext++;
+	}
+	if (xprev &&
+	    xml_type(xprev)==CX_ELMNT &&
+	    strcmp(xml_name(x),xml_name(xprev))==0){
+	    ns2 = xml_find_type_value(xprev, NULL, "xmlns", CX_ATTR);
+	    if ((!nsx && !ns2)
+		|| (nsx && ns2 && strcmp(nsx,ns2)==0))
+		eqprev++;
+	}
+    }
     if (eqprev && eqnext)
 	array = MIDDLE_ARRAY;
     else if (eqprev)
@@ -231,55 +259,101 @@ array_eval(cxobj *xprev,
 }
 
 /*! Escape a json string as well as decode xml cdata
+ * Runs of characters not needing escaping are found with strcspn(), which is 
+ * vectorized in most libc:s, and appended in bulk. Escape sequences are looked up
+ * in json_escape_tab.
  * @param[out] cb   cbuf   (encoded)
  * @param[in]  str  string (unencoded)
+ * @retval     0    OK
+ * @retval    -1    Error
  */
 static int
 json_str_escape_cdata(cbuf *cb,
 		      char *str)
 {
-    int   retval = -1;
-    int   i;
-    int   esc = 0; /* cdata escape */
-
-    for (i=0;i<strlen(str);i++)
-	switch (str[i]){
-	case '\n':
-	    cprintf(cb, "\\n");
-	    break;
-	case '\"':
-	    cprintf(cb, "\\\"");
-	    break;
-	case '\\':
-	    cprintf(cb, "\\\\");
-	    break;
-	case '<':
-	    if (!esc &&
-		strncmp(&str[i], "<![CDATA[", strlen("<![CDATA[")) == 0){
-		esc=1;
-		i += strlen("<![CDATA[")-1;
-	    }
-	    else
-		cprintf(cb, "%c", str[i]);
-	    break;
-	case ']':
-	    if (esc &&
-		strncmp(&str[i], "]]>", strlen("]]>")) == 0){
-		esc=0;
-		i += strlen("]]>")-1;
+    int         retval = -1;
+    char       *s = str;
+    size_t      len;
+    const char *esc;
+    int         cdata = 0; /* inside cdata section */
+
+    while (*s != '\0'){
+	if ((len = strcspn(s, JSON_ESCAPE_STOP)) > 0){
+	    if (cbuf_append_buf(cb, s, len) < 0){
+		clicon_err(OE_UNIX, errno, "cbuf_append_buf");
+		goto done;
 	    }
-	    else
-		cprintf(cb, "%c", str[i]);
-	    break;
-	default: /* fall thru */
-	    cprintf(cb, "%c", str[i]);
-	    break;
+	    s += len;
+	    if (*s == '\0')
+		break;
+	}
+	if ((esc = json_escape_tab[(unsigned char)*s]) != NULL){
+	    cbuf_append_str(cb, (char*)esc);
+	    s++;
+	}
+	else if (*s == '<' && !cdata &&
+		 strncmp(s, "<![CDATA[", strlen("<![CDATA[")) == 0){
+	    cdata = 1;
+	    s += strlen("<![CDATA[");
 	}
+	else if (*s == ']' && cdata &&
+		 strncmp(s, "]]>", strlen("]]>")) == 0){
+	    cdata = 0;
+	    s += strlen("]]>");
+	}
+	else
+	    cbuf_append(cb, *s++);
+    }
     retval = 0;
-    // done:
+ done:
     return retval;
 }
 
+/*! Append pretty-print indentation of a level to a JSON cbuf
+ * @param[out] cb     Cligen buffer to write to
+ * @param[in]  pretty No indentation unless set
+ * @param[in]  level  Indentation level
+ */
+static void
+json_indent(cbuf *cb,
+	    int   pretty,
+	    int   level)
+{
+    static char spaces[] = "                                ";
+    size_t      n;
+    size_t      len;
+
+    if (!pretty || level <= 0)
+	return;
+    n = level*JSON_INDENT;
+    while (n > 0){
+	len = n < sizeof(spaces)-1 ? n : sizeof(spaces)-1;
+	cbuf_append_buf(cb, spaces, len);
+	n -= len;
+    }
+}
+
+/*! Append a JSON member name: "modname:name":
+ * @param[out] cb      Cligen buffer to write to
+ * @param[in]  modname Module name qualifier, or NULL
+ * @param[in]  name    Member name
+ * @param[in]  pretty  Pretty-print output
+ */
+static void
+json_name(cbuf *cb,
+	  char *modname,
+	  char *name,
+	  int   pretty)
+{
+    cbuf_append(cb, '"');
+    if (modname){
+	cbuf_append_str(cb, modname);
+	cbuf_append(cb, ':');
+    }
+    cbuf_append_str(cb, name);
+    cbuf_append_str(cb, pretty?"\": ":"\":");
+}
+
 /*! Decode types from JSON to XML identityrefs
  * Assume an xml tree where prefix:name have been split into "module":"name"
  * In other words, from JSON RFC7951 to XML namespace trees
@@ -514,6 +588,8 @@ xml2json_encode_identityref(cxobj     *xb,
 }
 
 /*! Encode leaf/leaf_list types from XML to JSON
+ * The value is written directly to cb0, only encoded identityrefs use an 
+ * intermediate buffer.
  * @param[in]     x   XML body
  * @param[in]     ys  Yang spec of parent
  * @param[out]    cb0  Encoded string
@@ -532,15 +608,12 @@ xml2json_encode_leafs(cxobj     *xb,
     char         *body;
     enum cv_type  cvtype;
     int           quote = 1; /* Quote value w string: "val" */
-    cbuf         *cb = NULL; /* the variable itself */
+    char         *str = NULL; /* the variable itself */
+    cbuf         *cb = NULL; /* encoded identityref */
 
-    if ((cb = cbuf_new()) ==NULL){
-	clicon_err(OE_XML, errno, "cbuf_new");
-	goto done;
-    }
     body = xb?xml_value(xb):NULL;
     if (yp == NULL){
-	cprintf(cb, "%s", body?body:"null"); 
+	str = body?body:"null"; 
 	goto ok; /* unknown */
     }
     keyword = yang_keyword_get(yp);
@@ -556,16 +629,17 @@ xml2json_encode_leafs(cxobj     *xb,
 	case CGV_REST:
 	    if (body==NULL)
 		; /* empty: "" */
-	    else if (ytype){
-		if (strcmp(restype, "identityref")==0){
-		    if (xml2json_encode_identityref(xb, body, yp, cb) < 0)
-			goto done;
+	    else if (restype && strcmp(restype, "identityref")==0){
+		if ((cb = cbuf_new()) ==NULL){
+		    clicon_err(OE_XML, errno, "cbuf_new");
+		    goto done;
 		}
-		else
-		    cprintf(cb, "%s", body);
+		if (xml2json_encode_identityref(xb, body, yp, cb) < 0)
+		    goto done;
+		str = cbuf_get(cb);
 	    }
 	    else
-		cprintf(cb, "%s", body);
+		str = body;
 	    break;
 	case CGV_INT8:
 	case CGV_INT16:
@@ -577,25 +651,22 @@ xml2json_encode_leafs(cxobj     *xb,
 	case CGV_UINT64:
 	case CGV_DEC64:
 	case CGV_BOOL:
-	    cprintf(cb, "%s", body);
+	    str = body?body:"null";
 	    quote = 0;
 	    break;
 	case CGV_VOID:
 	    /* special case YANG empty type */
-	    if (body == NULL && strcmp(restype, "empty")==0){
+	    if (body == NULL && restype && strcmp(restype, "empty")==0){
 		quote = 0;
-		cprintf(cb, "[null]");
+		str = "[null]";
 	    }
 	    break;
 	default:
-	    if (body)
-		cprintf(cb, "%s", body);
-	    else
-		cprintf(cb, "{}"); /* dont know */
+	    str = body?body:"{}"; /* dont know */
 	}
 	break;
     default:
-	cprintf(cb, "%s", body);
+	str = body;
 	break;
     }
  ok:
@@ -603,13 +674,13 @@ xml2json_encode_leafs(cxobj     *xb,
      * includign quoting and encoding 
      */
     if (quote){
-	cprintf(cb0, "\"");
-	json_str_escape_cdata(cb0, cbuf_get(cb));
+	cbuf_append(cb0, '"');
+	if (str && json_str_escape_cdata(cb0, str) < 0)
+	    goto done;
+	cbuf_append(cb0, '"');
     }
     else
-	cprintf(cb0, "%s", cbuf_get(cb));
-    if (quote)
-	cprintf(cb0, "\"");
+	cbuf_append_str(cb0, str);
     retval = 0;
  done:
     if (cb)
@@ -635,14 +706,14 @@ nullchild(cbuf      *cb,
 	/* This is very problematic.
 	 * RFC 7951 explicitly forbids "null" to be used unless for empty types in [null]
 	 */
-	cprintf(cb, "{}");
+	cbuf_append_str(cb, "{}");
     }
     else{
 	switch (yang_keyword_get(y)){
 	case Y_ANYXML:
 	case Y_ANYDATA:
 	case Y_CONTAINER:
-	    cprintf(cb, "{}");
+	    cbuf_append_str(cb, "{}");
 	    break;
 	case Y_LEAF:
 	case Y_LEAF_LIST:
@@ -653,7 +724,7 @@ nullchild(cbuf      *cb,
 	    /* This is very problematic.
 	     * RFC 7951 explicitly forbids "null" to be used unless for empty types in [null]
 	     */
-	    cprintf(cb, "{}");
+	    cbuf_append_str(cb, "{}");
 	    break;
 	}
     }
@@ -711,6 +782,7 @@ xml2json1_cbuf(cbuf                   *cb,
 {
     int              retval = -1;
     int              i;
+    int              nr;
     cxobj           *xc;
     cxobj           *xp;
     enum childtype   childt;
@@ -742,10 +814,8 @@ xml2json1_cbuf(cbuf                   *cb,
 	break;
     case NO_ARRAY:
 	if (!flat){
-	    cprintf(cb, "%*s\"", pretty?(level*JSON_INDENT):0, "");
-	    if (modname) 
-		cprintf(cb, "%s:", modname);
-	    cprintf(cb, "%s\":%s", xml_name(x), pretty?" ":"");
+	    json_indent(cb, pretty, level);
+	    json_name(cb, modname, xml_name(x), pretty);
 	}
 	switch (childt){
 	case NULL_CHILD:
@@ -755,7 +825,7 @@ xml2json1_cbuf(cbuf                   *cb,
 	case BODY_CHILD:
 	    break;
 	case ANY_CHILD:
-	    cprintf(cb, "{%s", pretty?"\n":"");
+	    cbuf_append_str(cb, pretty?"{\n":"{");
 	    break;
 	default:
 	    break;
@@ -763,14 +833,11 @@ xml2json1_cbuf(cbuf                   *cb,
 	break;
     case FIRST_ARRAY:
     case SINGLE_ARRAY:
-	cprintf(cb, "%*s\"", pretty?(level*JSON_INDENT):0, "");
-	if (modname)
-	    cprintf(cb, "%s:", modname);
-	cprintf(cb, "%s\":%s", xml_name(x), pretty?" ":"");
+	json_indent(cb, pretty, level);
+	json_name(cb, modname, xml_name(x), pretty);
 	level++;
-	cprintf(cb, "[%s%*s", 
-		pretty?"\n":"",
-		pretty?(level*JSON_INDENT):0, "");
+	cbuf_append_str(cb, pretty?"[\n":"[");
+	json_indent(cb, pretty, level);
 	switch (childt){
 	case NULL_CHILD:
 	    if (nullchild(cb, x, ys) < 0)
@@ -779,7 +846,7 @@ xml2json1_cbuf(cbuf                   *cb,
 	case BODY_CHILD:
 	    break;
 	case ANY_CHILD:
-	    cprintf(cb, "{%s", pretty?"\n":"");
+	    cbuf_append_str(cb, pretty?"{\n":"{");
 	    break;
 	default:
 	    break;
@@ -788,8 +855,7 @@ xml2json1_cbuf(cbuf                   *cb,
     case MIDDLE_ARRAY:
     case LAST_ARRAY:
 	level++;
-	cprintf(cb, "%*s", 
-		pretty?(level*JSON_INDENT):0, "");
+	json_indent(cb, pretty, level);
 	switch (childt){
 	case NULL_CHILD:
 	    if (nullchild(cb, x, ys) < 0)
@@ -798,7 +864,7 @@ xml2json1_cbuf(cbuf                   *cb,
 	case BODY_CHILD:
 	    break;
 	case ANY_CHILD:
-	    cprintf(cb, "{%s", pretty?"\n":"");
+	    cbuf_append_str(cb, pretty?"{\n":"{");
 	    break;
 	default:
 	    break;
@@ -812,21 +878,22 @@ xml2json1_cbuf(cbuf                   *cb,
      * This is code for writing <a>42</a> as "a":42 and not "a":"42"
      */
     commas = xml_child_nr_notype(x, CX_ATTR) - 1;
-    for (i=0; i<xml_child_nr(x); i++){
+    nr = xml_child_nr(x);
+    for (i=0; i<nr; i++){
 	xc = xml_child_i(x, i);
 	if (xml_type(xc) == CX_ATTR)
 	    continue; /* XXX Only xmlns attributes mapped */
 
 	xc_arraytype = array_eval(i?xml_child_i(x,i-1):NULL, 
 				xc, 
-				xml_child_i(x, i+1));
+				i+1<nr?xml_child_i(x, i+1):NULL);
 	if (xml2json1_cbuf(cb, 
 			   xc, 
 			   xc_arraytype,
 			   level+1, pretty, 0, modname0) < 0)
 	    goto done;
 	if (commas > 0) {
-	    cprintf(cb, ",%s", pretty?"\n":"");
+	    cbuf_append_str(cb, pretty?",\n":",");
 	    --commas;
 	}
     }
@@ -839,9 +906,10 @@ xml2json1_cbuf(cbuf                   *cb,
 	case BODY_CHILD:
 	    break;
 	case ANY_CHILD:
-	    cprintf(cb, "%s%*s}", 
-		    pretty?"\n":"",
-		    pretty?(level*JSON_INDENT):0, "");
+	    if (pretty)
+		cbuf_append(cb, '\n');
+	    json_indent(cb, pretty, level);
+	    cbuf_append(cb, '}');
 	    break;
 	default:
 	    break;
@@ -855,9 +923,10 @@ xml2json1_cbuf(cbuf                   *cb,
 	case BODY_CHILD:
 	    break;
 	case ANY_CHILD:
-	    cprintf(cb, "%s%*s}", 
-		    pretty?"\n":"",
-		    pretty?(level*JSON_INDENT):0, "");
+	    if (pretty)
+		cbuf_append(cb, '\n');
+	    json_indent(cb, pretty, level);
+	    cbuf_append(cb, '}');
 	    level--;
 	    break;
 	default:
@@ -869,20 +938,23 @@ xml2json1_cbuf(cbuf                   *cb,
 	switch (childt){
 	case NULL_CHILD:
 	case BODY_CHILD:
-	    cprintf(cb, "%s",pretty?"\n":"");
+	    if (pretty)
+		cbuf_append(cb, '\n');
 	    break;
 	case ANY_CHILD:
-	    cprintf(cb, "%s%*s}", 
-		    pretty?"\n":"",
-		    pretty?(level*JSON_INDENT):0, "");
-	    cprintf(cb, "%s",pretty?"\n":"");
+	    if (pretty)
+		cbuf_append(cb, '\n');
+	    json_indent(cb, pretty, level);
+	    cbuf_append(cb, '}');
+	    if (pretty)
+		cbuf_append(cb, '\n');
 	    level--;
 	    break;
 	default:
 	    break;
 	}
-	cprintf(cb, "%*s]",
-		pretty?(level*JSON_INDENT):0,"");
+	json_indent(cb, pretty, level);
+	cbuf_append(cb, ']');
 	break;
     default:
 	break;
@@ -1008,6 +1080,52 @@ xml2json_cbuf_vec(cbuf      *cb,
     return retval;
 }
 
+/*! Translate the nodes of an XML tree selected by an XPath to JSON in a CLIgen buffer
+ *
+ * This is the RESTCONF data resource encoding: the whole tree if xpath is the root,
+ * otherwise the selected nodes, see xml2json_cbuf_vec.
+ * @param[in,out] cb     Cligen buffer to write to
+ * @param[in]     xt     XML tree, eg <data>, bound to YANG
+ * @param[in]     nsc    Namespace context of xpath
+ * @param[in]     xpath  XPath selecting nodes in xt, or NULL for root
+ * @param[in]     pretty Set if output is pretty-printed
+ * @retval        1      OK
+ * @retval        0      No node selected, nothing written
+ * @retval       -1      Error
+ */
+int 
+xml2json_cbuf_xpath(cbuf  *cb, 
+		    cxobj *xt, 
+		    cvec  *nsc,
+		    char  *xpath,
+		    int    pretty)
+{
+    int     retval = -1;
+    cxobj **xvec = NULL;
+    size_t  xlen;
+
+    if (xpath == NULL || strcmp(xpath, "/") == 0){
+	if (xml2json_cbuf(cb, xt, pretty) < 0)
+	    goto done;
+    }
+    else {
+	if (xpath_vec(xt, nsc, "%s", &xvec, &xlen, xpath) < 0)
+	    goto done;
+	if (xlen == 0)
+	    goto fail;
+	if (xml2json_cbuf_vec(cb, xvec, xlen, pretty) < 0)
+	    goto done;
+    }
+    retval = 1;
+ done:
+    if (xvec)
+	free(xvec);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
 /*! Translate from xml tree to JSON and print to file using a callback
  * @param[in]  f      File to print to
  * @param[in]  x      XML tree to translate from
@@ -46,6 +46,7 @@
 #include <string.h>
 #include <limits.h>
 #include <stdint.h>
+#include <inttypes.h>
 #include <assert.h>
 #include <syslog.h>
 
@@ -103,15 +104,546 @@ match_access(char *access_operations,
     return 0;
 }
 
+/*---------------------------------------------------------------
+ * Compiled NACM
+ * The NACM config tree is compiled into rules and per-user rule vectors, so
+ * that access checks do not interpret the XML tree on every request.
+ * The compiled structure is rebuilt when the NACM config changes, ie when the
+ * generation of running (internal mode) or the external NACM tree changes.
+ * It is replaced as a whole: a new structure is built before the old is freed.
+ */
+
+/* Access operation bits of a compiled rule, see access-operations in rfc8341 */
+#define NACM_BIT_CREATE 0x01
+#define NACM_BIT_READ   0x02
+#define NACM_BIT_UPDATE 0x04
+#define NACM_BIT_DELETE 0x08
+#define NACM_BIT_EXEC   0x10
+
+/* Action of a compiled rule */
+#define NACM_ACTION_NONE   0
+#define NACM_ACTION_PERMIT 1
+#define NACM_ACTION_DENY   2
+#define NACM_ACTION_BIT(a) (1<<(a))
+
+/* Default values in compiled NACM, -1 if not set */
+#define NACM_DEFAULT_DENY   0
+#define NACM_DEFAULT_PERMIT 1
+
+/* Cached rpc decisions of a user */
+#define NACM_RPC_PERMIT       1
+#define NACM_RPC_DENY         2 /* Denied by rule */
+#define NACM_RPC_DEFAULT_DENY 3 /* Denied by default */
+
+/* Compiled NACM rule */
+struct nacm_rule{
+    char     *nr_module;  /* module-name, "*" is all modules, NULL if not set */
+    char     *nr_rpc;     /* rpc-name, or NULL */
+    int       nr_notif;   /* notification-name is set */
+    char     *nr_path;    /* data-node path (trimmed), or NULL */
+    uint32_t  nr_access;  /* NACM_BIT_* */
+    int       nr_action;  /* NACM_ACTION_* */
+};
+typedef struct nacm_rule nacm_rule;
+
+/* Compiled rule-list */
+struct nacm_rulelist{
+    cvec       *nl_groups;  /* Names of groups of rule-list */
+    nacm_rule  *nl_rules;   /* Rules of rule-list, in order */
+    int         nl_len;
+};
+typedef struct nacm_rulelist nacm_rulelist;
+
+/* Trie of the paths of a user's read rules over YANG schema nodes.
+ * A trie node is a path step: a schema node and its instance predicates, if any.
+ * Rules whose path ends in a step are stored in that step.
+ * @see nacm_rtrie_build
+ */
+struct nacm_rtrie{
+    yang_stmt          *rt_yang;  /* Schema node of step, NULL in root */
+    cvec               *rt_cvk;   /* Instance predicates of step, or NULL */
+    int                *rt_rules; /* Rules ending here, index in nu_access[NACM_READ] */
+    int                 rt_rlen;
+    struct nacm_rtrie **rt_vec;   /* Child steps */
+    int                 rt_len;
+    int                 rt_below; /* Actions of rules ending below, NACM_ACTION_BIT() */
+};
+typedef struct nacm_rtrie nacm_rtrie;
+
+/* Rules that apply to a user: all rules of the rule-lists of the user's groups,
+ * in order. Created on first request of the user (the read trie on first read),
+ * freed with the compiled NACM */
+struct nacm_user{
+    int            nu_groups;   /* Nr of groups user is member of */
+    nacm_rule    **nu_rules;    /* Rules of user's rule-lists, in order */
+    int            nu_len;
+    nacm_rule    **nu_access[NACM_EXEC+1]; /* Data-node rules per access, in order */
+    int            nu_alen[NACM_EXEC+1];
+    clicon_hash_t *nu_rpc;      /* Rpc decision cache: "<module>:<rpc>" -> NACM_RPC_* */
+    nacm_rtrie    *nu_rtrie;    /* Read rule paths, or NULL if not built */
+    int            nu_rnopath;  /* Actions of read rules without path, NACM_ACTION_BIT() */
+};
+typedef struct nacm_user nacm_user;
+
+/* Compiled NACM config */
+struct nacm_compiled{
+    uint64_t       nc_gen;      /* Generation of running when compiled */
+    cxobj         *nc_ext;      /* External NACM tree when compiled */
+    int            nc_read_default;  /* NACM_DEFAULT_*, -1 if not set */
+    int            nc_write_default;
+    int            nc_exec_default;
+    cvec          *nc_groups;   /* group-name/user-name pairs */
+    nacm_rulelist *nc_rlists;   /* Rule-lists, in order */
+    int            nc_rlen;
+    clicon_hash_t *nc_users;    /* username -> nacm_user* */
+};
+typedef struct nacm_compiled nacm_compiled;
+
+/* User without groups, shared */
+static nacm_user _nacm_user_nogroup = {0,};
+
+/*! Parse access-operations bits
+ * @param[in] access_operations  Value of access-operations leaf
+ * @retval    bits               NACM_BIT_*
+ * @see match_access  Same matching rules
+ */
+static uint32_t
+nacm_access_bits(char *access_operations)
+{
+    uint32_t bits = 0;
+
+    if (match_access(access_operations, "create", "write"))
+	bits |= NACM_BIT_CREATE;
+    if (match_access(access_operations, "read", NULL))
+	bits |= NACM_BIT_READ;
+    if (match_access(access_operations, "update", "write"))
+	bits |= NACM_BIT_UPDATE;
+    if (match_access(access_operations, "delete", "write"))
+	bits |= NACM_BIT_DELETE;
+    if (match_access(access_operations, "exec", NULL))
+	bits |= NACM_BIT_EXEC;
+    return bits;
+}
+
+/*! Access bit of an access operation */
+static uint32_t
+nacm_access2bit(enum nacm_access access)
+{
+    switch (access){
+    case NACM_CREATE:
+	return NACM_BIT_CREATE;
+    case NACM_READ:
+	return NACM_BIT_READ;
+    case NACM_UPDATE:
+	return NACM_BIT_UPDATE;
+    case NACM_DELETE:
+	return NACM_BIT_DELETE;
+    case NACM_EXEC:
+	return NACM_BIT_EXEC;
+    }
+    return 0;
+}
+
+/*! Compiled default value of a leaf, eg read-default */
+static int
+nacm_default(cxobj *xnacm,
+	     char  *name)
+{
+    char *str;
+
+    if ((str = xml_find_body(xnacm, name)) == NULL)
+	return -1;
+    return strcmp(str, "deny") == 0 ? NACM_DEFAULT_DENY : NACM_DEFAULT_PERMIT;
+}
+
+/*! Strdup a body, or NULL */
+static int
+nacm_strdup(char  *str,
+	    char **strp)
+{
+    if (str == NULL){
+	*strp = NULL;
+	return 0;
+    }
+    if ((*strp = strdup(str)) == NULL){
+	clicon_err(OE_UNIX, errno, "strdup");
+	return -1;
+    }
+    return 0;
+}
+
+/*! Free a read rule trie */
+static void
+nacm_rtrie_free(nacm_rtrie *rt)
+{
+    int i;
+
+    for (i=0; i<rt->rt_len; i++)
+	nacm_rtrie_free(rt->rt_vec[i]);
+    if (rt->rt_vec)
+	free(rt->rt_vec);
+    if (rt->rt_rules)
+	free(rt->rt_rules);
+    if (rt->rt_cvk)
+	cvec_free(rt->rt_cvk);
+    free(rt);
+}
+
+/*! Free a compiled user */
+static void
+nacm_user_free(nacm_user *nu)
+{
+    int i;
+
+    if (nu == &_nacm_user_nogroup)
+	return;
+    if (nu->nu_rules)
+	free(nu->nu_rules);
+    for (i=0; i<=NACM_EXEC; i++)
+	if (nu->nu_access[i])
+	    free(nu->nu_access[i]);
+    if (nu->nu_rpc)
+	clicon_hash_free(nu->nu_rpc);
+    if (nu->nu_rtrie)
+	nacm_rtrie_free(nu->nu_rtrie);
+    free(nu);
+}
+
+/*! Free compiled NACM */
+static void
+nacm_compiled_free(nacm_compiled *nc)
+{
+    nacm_rulelist *nl;
+    nacm_rule     *nr;
+    char         **keys = NULL;
+    size_t         klen = 0;
+    void          *p;
+    int            i;
+    int            j;
+
+    if (nc->nc_users){
+	if (clicon_hash_keys(nc->nc_users, &keys, &klen) == 0)
+	    for (i=0; i<klen; i++)
+		if ((p = clicon_hash_value(nc->nc_users, keys[i], NULL)) != NULL)
+		    nacm_user_free(*(nacm_user **)p);
+	if (keys)
+	    free(keys);
+	clicon_hash_free(nc->nc_users);
+    }
+    for (i=0; i<nc->nc_rlen; i++){
+	nl = &nc->nc_rlists[i];
+	if (nl->nl_groups)
+	    cvec_free(nl->nl_groups);
+	for (j=0; j<nl->nl_len; j++){
+	    nr = &nl->nl_rules[j];
+	    if (nr->nr_module)
+		free(nr->nr_module);
+	    if (nr->nr_rpc)
+		free(nr->nr_rpc);
+	    if (nr->nr_path)
+		free(nr->nr_path);
+	}
+	if (nl->nl_rules)
+	    free(nl->nl_rules);
+    }
+    if (nc->nc_rlists)
+	free(nc->nc_rlists);
+    if (nc->nc_groups)
+	cvec_free(nc->nc_groups);
+    free(nc);
+}
+
+/*! Compile a NACM config tree
+ * @param[in]  xnacm  NACM XML tree, root is "nacm"
+ * @param[out] ncp    Compiled NACM. Free with nacm_compiled_free
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+nacm_compile(cxobj          *xnacm,
+	     nacm_compiled **ncp)
+{
+    int            retval = -1;
+    nacm_compiled *nc = NULL;
+    nacm_rulelist *nl;
+    nacm_rule     *nr;
+    cxobj         *xg;
+    cxobj         *xgs;
+    cxobj         *xl;
+    cxobj         *xr;
+    cxobj         *x;
+    char          *gname;
+    cxobj         *xpath;
+    int            n;
+
+    if ((nc = malloc(sizeof(*nc))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    memset(nc, 0, sizeof(*nc));
+    if ((nc->nc_users = clicon_hash_init()) == NULL)
+	goto done;
+    if ((nc->nc_groups = cvec_new(0)) == NULL){
+	clicon_err(OE_UNIX, errno, "cvec_new");
+	goto done;
+    }
+    nc->nc_read_default = nacm_default(xnacm, "read-default");
+    nc->nc_write_default = nacm_default(xnacm, "write-default");
+    nc->nc_exec_default = nacm_default(xnacm, "exec-default");
+    /* Groups: name/user-name pairs */
+    if ((xgs = xml_find_type(xnacm, NULL, "groups", CX_ELMNT)) != NULL){
+	xg = NULL;
+	while ((xg = xml_child_each(xgs, xg, CX_ELMNT)) != NULL){
+	    if (strcmp(xml_name(xg), "group") != 0 ||
+		(gname = xml_find_body(xg, "name")) == NULL)
+		continue;
+	    x = NULL;
+	    while ((x = xml_child_each(xg, x, CX_ELMNT)) != NULL)
+		if (strcmp(xml_name(x), "user-name") == 0 && xml_body(x))
+		    if (cvec_add_string(nc->nc_groups, gname, xml_body(x)) == NULL){
+			clicon_err(OE_UNIX, errno, "cvec_add_string");
+			goto done;
+		    }
+	}
+    }
+    /* Rule-lists */
+    n = 0;
+    xl = NULL;
+    while ((xl = xml_child_each(xnacm, xl, CX_ELMNT)) != NULL)
+	if (strcmp(xml_name(xl), "rule-list") == 0)
+	    n++;
+    if (n && (nc->nc_rlists = calloc(n, sizeof(nacm_rulelist))) == NULL){
+	clicon_err(OE_UNIX, errno, "calloc");
+	goto done;
+    }
+    xl = NULL;
+    while ((xl = xml_child_each(xnacm, xl, CX_ELMNT)) != NULL){
+	if (strcmp(xml_name(xl), "rule-list") != 0)
+	    continue;
+	nl = &nc->nc_rlists[nc->nc_rlen++];
+	if ((nl->nl_groups = cvec_new(0)) == NULL){
+	    clicon_err(OE_UNIX, errno, "cvec_new");
+	    goto done;
+	}
+	n = 0;
+	x = NULL;
+	while ((x = xml_child_each(xl, x, CX_ELMNT)) != NULL){
+	    if (strcmp(xml_name(x), "group") == 0 && xml_body(x)){
+		if (cvec_add_string(nl->nl_groups, xml_body(x), xml_body(x)) == NULL){
+		    clicon_err(OE_UNIX, errno, "cvec_add_string");
+		    goto done;
+		}
+	    }
+	    else if (strcmp(xml_name(x), "rule") == 0)
+		n++;
+	}
+	if (n && (nl->nl_rules = calloc(n, sizeof(nacm_rule))) == NULL){
+	    clicon_err(OE_UNIX, errno, "calloc");
+	    goto done;
+	}
+	xr = NULL;
+	while ((xr = xml_child_each(xl, xr, CX_ELMNT)) != NULL){
+	    if (strcmp(xml_name(xr), "rule") != 0)
+		continue;
+	    nr = &nl->nl_rules[nl->nl_len++];
+	    if (nacm_strdup(xml_find_body(xr, "module-name"), &nr->nr_module) < 0)
+		goto done;
+	    if (nacm_strdup(xml_find_body(xr, "rpc-name"), &nr->nr_rpc) < 0)
+		goto done;
+	    nr->nr_notif = xml_find_body(xr, "notification-name") != NULL;
+	    if ((xpath = xml_find_type(xr, NULL, "path", CX_ELMNT)) != NULL &&
+		nacm_strdup(clixon_trim2(xml_body(xpath), " \t\n"), &nr->nr_path) < 0)
+		goto done;
+	    nr->nr_access = nacm_access_bits(xml_find_body(xr, "access-operations"));
+	    if ((gname = xml_find_body(xr, "action")) != NULL){
+		if (strcmp(gname, "deny") == 0)
+		    nr->nr_action = NACM_ACTION_DENY;
+		else if (strcmp(gname, "permit") == 0)
+		    nr->nr_action = NACM_ACTION_PERMIT;
+	    }
+	}
+    }
+    *ncp = nc;
+    nc = NULL;
+    retval = 0;
+ done:
+    if (nc)
+	nacm_compiled_free(nc);
+    return retval;
+}
+
+/*! Get compiled NACM, compile if NACM config has changed
+ * @param[in]  h      Clicon handle
+ * @param[in]  xnacm  NACM XML tree of this request
+ * @param[out] ncp    Compiled NACM, valid until NACM config changes
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+nacm_compiled_get(clicon_handle   h,
+		  cxobj          *xnacm,
+		  nacm_compiled **ncp)
+{
+    int            retval = -1;
+    clicon_hash_t *cdat = clicon_data(h);
+    nacm_compiled *nc = NULL;
+    nacm_compiled *nc0 = NULL;
+    void          *p;
+    uint64_t       gen;
+    cxobj         *xext;
+
+    gen = xmldb_gen_get(h, "running");
+    xext = clicon_nacm_ext(h);
+    if ((p = clicon_hash_value(cdat, "nacm_compiled", NULL)) != NULL)
+	nc0 = *(nacm_compiled **)p;
+    if (nc0 && nc0->nc_gen == gen && nc0->nc_ext == xext){
+	*ncp = nc0;
+	goto ok;
+    }
+    clicon_debug(1, "%s compile NACM gen:%" PRIu64, __FUNCTION__, gen);
+    if (nacm_compile(xnacm, &nc) < 0)
+	goto done;
+    nc->nc_gen = gen;
+    nc->nc_ext = xext;
+    /* Replace the old compiled NACM */
+    if (clicon_hash_add(cdat, "nacm_compiled", &nc, sizeof(nc)) == NULL)
+	goto done;
+    if (nc0)
+	nacm_compiled_free(nc0);
+    *ncp = nc;
+    nc = NULL;
+ ok:
+    retval = 0;
+ done:
+    if (nc)
+	nacm_compiled_free(nc);
+    return retval;
+}
+
+/*! Get rules of a user, compile them if first request of user
+ * @param[in]  nc       Compiled NACM
+ * @param[in]  username User name
+ * @param[out] nup      Compiled user, immutable
+ * @retval     0        OK
+ * @retval    -1        Error
+ */
+static int
+nacm_user_get(nacm_compiled *nc,
+	      char          *username,
+	      nacm_user    **nup)
+{
+    int        retval = -1;
+    nacm_user *nu = NULL;
+    cvec      *groups = NULL;
+    cg_var    *cv = NULL;
+    cg_var    *cvg;
+    nacm_rulelist *nl;
+    nacm_rule *nr;
+    void      *p;
+    int        i;
+    int        j;
+    int        a;
+
+    if ((p = clicon_hash_value(nc->nc_users, username, NULL)) != NULL){
+	*nup = *(nacm_user **)p;
+	goto ok;
+    }
+    if ((groups = cvec_new(0)) == NULL){
+	clicon_err(OE_UNIX, errno, "cvec_new");
+	goto done;
+    }
+    while ((cv = cvec_each(nc->nc_groups, cv)) != NULL)
+	if (strcmp(cv_string_get(cv), username) == 0 &&
+	    cvec_find(groups, cv_name_get(cv)) == NULL)
+	    if (cvec_add_string(groups, cv_name_get(cv), cv_name_get(cv)) == NULL){
+		clicon_err(OE_UNIX, errno, "cvec_add_string");
+		goto done;
+	    }
+    /* Users without groups are not stored, all share the same empty rules */
+    if (cvec_len(groups) == 0){
+	*nup = &_nacm_user_nogroup;
+	goto ok;
+    }
+    if ((nu = malloc(sizeof(*nu))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    memset(nu, 0, sizeof(*nu));
+    nu->nu_groups = cvec_len(groups);
+    if ((nu->nu_rpc = clicon_hash_init()) == NULL)
+	goto done;
+    for (i=0; i<nc->nc_rlen; i++)
+	nu->nu_len += nc->nc_rlists[i].nl_len;
+    if (nu->nu_len && (nu->nu_rules = calloc(nu->nu_len, sizeof(nacm_rule*))) == NULL){
+	clicon_err(OE_UNIX, errno, "calloc");
+	goto done;
+    }
+    nu->nu_len = 0;
+    for (i=0; i<nc->nc_rlen; i++){
+	nl = &nc->nc_rlists[i];
+	/* Rule-list applies if one of its groups is a group of the user */
+	cvg = NULL;
+	while ((cvg = cvec_each(nl->nl_groups, cvg)) != NULL)
+	    if (cvec_find(groups, cv_string_get(cvg)) != NULL)
+		break;
+	if (cvg == NULL)
+	    continue;
+	for (j=0; j<nl->nl_len; j++)
+	    nu->nu_rules[nu->nu_len++] = &nl->nl_rules[j];
+    }
+    /* Data-node rules per access: not rpc or notification rules */
+    for (a=0; a<=NACM_EXEC; a++){
+	if (nu->nu_len &&
+	    (nu->nu_access[a] = calloc(nu->nu_len, sizeof(nacm_rule*))) == NULL){
+	    clicon_err(OE_UNIX, errno, "calloc");
+	    goto done;
+	}
+	for (j=0; j<nu->nu_len; j++){
+	    nr = nu->nu_rules[j];
+	    if ((nr->nr_access & nacm_access2bit(a)) == 0)
+		continue;
+	    if (nr->nr_path == NULL && (nr->nr_rpc || nr->nr_notif))
+		continue;
+	    nu->nu_access[a][nu->nu_alen[a]++] = nr;
+	}
+    }
+    if (clicon_hash_add(nc->nc_users, username, &nu, sizeof(nu)) == NULL)
+	goto done;
+    *nup = nu;
+    nu = NULL;
+ ok:
+    retval = 0;
+ done:
+    if (nu)
+	nacm_user_free(nu);
+    if (groups)
+	cvec_free(groups);
+    return retval;
+}
+
+/*! Free compiled NACM of a handle, eg on exit or when external NACM is reloaded
+ * @param[in]  h   Clicon handle
+ * @retval     0   OK
+ */
+int
+nacm_compiled_clear(clicon_handle h)
+{
+    clicon_hash_t *cdat = clicon_data(h);
+    void          *p;
+
+    if ((p = clicon_hash_value(cdat, "nacm_compiled", NULL)) != NULL){
+	nacm_compiled_free(*(nacm_compiled **)p);
+	clicon_hash_del(cdat, "nacm_compiled");
+    }
+    return 0;
+}
+
 /*! Match nacm single rule. Either match with access or deny. Or not match.
  * @param[in]  rpc    rpc name
  * @param[in]  module Yang module name
- * @param[in]  xrule  NACM rule XML tree
- * @param[out] cbret  Cligen buffer result. Set to an error msg if retval=0.
- * @retval -1  Error
- * @retval  0  Matching rule AND Not access and cbret set
- * @retval  1  Matching rule AND Access
- * @retval  2  No matching rule Goto step 10
+ * @param[in]  nr     Compiled NACM rule
+ * @retval  0  No matching rule
+ * @retval  1  Matching rule
  * @see RFC8341 3.4.4.  Incoming RPC Message Validation
  7.(cont) A rule matches if all of the following criteria are met: 
         *  The rule's "module-name" leaf is "*" or equals the name of
@@ -126,47 +658,102 @@ match_access(char *access_operations,
            has the special value "*".
  */
 static int
-nacm_rule_rpc(char         *rpc,
-	      char         *module,
-	      cxobj        *xrule)
+nacm_rule_rpc(char      *rpc,
+	      char      *module,
+	      nacm_rule *nr)
 {
-    int    retval = -1;
-    char  *module_rule; /* rule module name */
-    char  *rpc_rule;
-    char  *access_operations;
-    
     /*  7a) The rule's "module-name" leaf is "*" or equals the name of
 	the YANG module where the protocol operation is defined. */
-    if ((module_rule = xml_find_body(xrule, "module-name")) == NULL)
-	goto nomatch;
-    if (strcmp(module_rule,"*") && strcmp(module_rule,module))
-	goto nomatch;
+    if (nr->nr_module == NULL)
+	return 0;
+    if (strcmp(nr->nr_module, "*") && strcmp(nr->nr_module, module))
+	return 0;
     /*  7b) Either (1) the rule does not have a "rule-type" defined or
 	(2) the "rule-type" is "protocol-operation" and the
 	"rpc-name" is "*" or equals the name of the requested
 	protocol operation. */
-    if ((rpc_rule = xml_find_body(xrule, "rpc-name")) == NULL){
-	if (xml_find_body(xrule, "path") || xml_find_body(xrule, "notification-name"))
-	    goto nomatch;
+    if (nr->nr_rpc == NULL){
+	if (nr->nr_path || nr->nr_notif)
+	    return 0;
     }
-    if (rpc_rule && (strcmp(rpc_rule, "*") && strcmp(rpc_rule, rpc)))
-	goto nomatch;
+    else if (strcmp(nr->nr_rpc, "*") && strcmp(nr->nr_rpc, rpc))
+	return 0;
     /* 7c) The rule's "access-operations" leaf has the "exec" bit set or
 	has the special value "*". */
-    access_operations = xml_find_body(xrule, "access-operations");
-    if (!match_access(access_operations, "exec", NULL))
-	goto nomatch;
-    retval = 1;
- done:
-    return retval;
- nomatch:
-    retval = 0;
-    goto done;
+    if ((nr->nr_access & NACM_BIT_EXEC) == 0)
+	return 0;
+    return 1;
 }
 
-/*! Process nacm incoming RPC message validation steps
+/*! Compute NACM rpc decision of a user, steps 3-12 
+ * @param[in]  nc       Compiled NACM
+ * @param[in]  nu       Compiled user, or NULL if no user
+ * @param[in]  rpc      rpc name
  * @param[in]  module   Yang module name
+ * @retval     dec      NACM_RPC_PERMIT, NACM_RPC_DENY or NACM_RPC_DEFAULT_DENY
+ */
+static int
+nacm_rpc_decide(nacm_compiled *nc,
+		nacm_user     *nu,
+		char          *rpc,
+		char          *module)
+{
+    nacm_rule *nr;
+    int        i;
+
+    /* 3.   If the requested operation is the NETCONF <close-session>
+       protocol operation, then the protocol operation is permitted.
+    */
+    if (strcmp(rpc, "close-session") == 0)
+	return NACM_RPC_PERMIT;
+    /* 4.   Check all the "group" entries to see if any of them contain a
+       "user-name" entry that equals the username for the session
+       making the request.  (If the "enable-external-groups" leaf is
+       "true", add to these groups the set of groups provided by the
+       transport layer.)	       
+       5. If no groups are found, continue with step 10. 
+       6. Process all rule-list entries, in the order they appear in the
+        configuration.  If a rule-list's "group" leaf-list does not
+        match any of the user's groups, proceed to the next rule-list
+        entry. 
+       7. For each rule-list entry found, process all rules, in order,
+	   until a rule that matches the requested access operation is
+	   found. 
+       The user's rules are the rules of the rule-lists found, in order
+    */
+    if (nu != NULL)
+	for (i=0; i<nu->nu_len; i++){
+	    nr = nu->nu_rules[i];
+	    if (nacm_rule_rpc(rpc, module, nr) == 0)
+		continue;
+	    if (nr->nr_action == NACM_ACTION_DENY)
+		return NACM_RPC_DENY;
+	    if (nr->nr_action == NACM_ACTION_PERMIT)
+		return NACM_RPC_PERMIT;
+	    break;
+	}
+    /*   10.  If the requested protocol operation is defined in a YANG module
+        advertised in the server capabilities and the "rpc" statement
+        contains a "nacm:default-deny-all" statement, then the protocol
+        operation is denied. */
+    /* 11.  If the requested protocol operation is the NETCONF
+        <kill-session> or <delete-config>, then the protocol operation
+        is denied. */
+    if (strcmp(rpc, "kill-session")==0 || strcmp(rpc, "delete-config")==0)
+	return NACM_RPC_DEFAULT_DENY;
+    /*   12.  If the "exec-default" leaf is set to "permit", then permit the
+	 protocol operation; otherwise, deny the request. */
+    if (nc->nc_exec_default != NACM_DEFAULT_DENY)
+	return NACM_RPC_PERMIT;
+    return NACM_RPC_DEFAULT_DENY;
+}
+
+/*! Process nacm incoming RPC message validation steps
+ * The decision of a user is cached per module and rpc name until the NACM config
+ * changes.
+ * @param[in]  h        Clicon handle
  * @param[in]  rpc      rpc name
+ * @param[in]  module   Yang module name
  * @param[in]  username User name of requestor
  * @param[in]  xnacm    NACM xml tree
  * @param[out] cbret Cligen buffer result. Set to an error msg if retval=0.
@@ -178,131 +765,65 @@ nacm_rule_rpc(char         *rpc,
  * @see nacm_datanode_read
  */
 int
-nacm_rpc(char         *rpc,
+nacm_rpc(clicon_handle h,
+	 char         *rpc,
 	 char         *module,
 	 char         *username,
 	 cxobj        *xnacm,
 	 cbuf         *cbret)
 {
-    int     retval = -1;
-    cxobj  *xrule;
-    cxobj **gvec = NULL; /* groups */
-    size_t  glen;
-    cxobj  *rlist;
-    cxobj **rlistvec = NULL; /* rule-list */
-    size_t  rlistlen;
-    cxobj **rvec = NULL; /* rules */
-    size_t  rlen;
-    int     i, j;
-    char   *exec_default = NULL;
-    char   *gname;
-    char   *action;
-    int     match= 0;
-    cvec   *nsc = NULL;
+    int            retval = -1;
+    nacm_compiled *nc;
+    nacm_user     *nu = NULL;
+    cbuf          *cbkey = NULL;
+    void          *p;
+    int            dec;
     
-    /* Create namespace context for with nacm namespace as default */
-    if ((nsc = xml_nsctx_init(NULL, NACM_NS)) == NULL)
+    if (nacm_compiled_get(h, xnacm, &nc) < 0)
 	goto done;
-    /* 3.   If the requested operation is the NETCONF <close-session>
-       protocol operation, then the protocol operation is permitted.
-    */
-    if (strcmp(rpc, "close-session") == 0)
-	goto permit;
-    /* 4.   Check all the "group" entries to see if any of them contain a
-       "user-name" entry that equals the username for the session
-       making the request.  (If the "enable-external-groups" leaf is
-       "true", add to these groups the set of groups provided by the
-       transport layer.)	       */
     if (username == NULL)
-	goto step10;
-
-    /* User's group */
-    if (xpath_vec(xnacm, nsc, "groups/group[user-name='%s']", &gvec, &glen, username) < 0)
-	goto done;
-    /* 5. If no groups are found, continue with step 10. */
-    if (glen == 0)
-	goto step10;
-    /* 6. Process all rule-list entries, in the order they appear in the
-        configuration.  If a rule-list's "group" leaf-list does not
-        match any of the user's groups, proceed to the next rule-list
-        entry. */
-    if (xpath_vec(xnacm, nsc, "rule-list", &rlistvec, &rlistlen) < 0)
-	goto done;
-    for (i=0; i<rlistlen; i++){
-	rlist = rlistvec[i];
-	/* Loop through user's group to find match in this rule-list */
-	for (j=0; j<glen; j++){
-	    gname = xml_find_body(gvec[j], "name");
-	    if (xpath_first(rlist, nsc, ".[group='%s']", gname)!=NULL)
-		break; /* found */
-	}
-	if (j==glen) /* not found */
-	    continue;
-	/* 7. For each rule-list entry found, process all rules, in order,
-	   until a rule that matches the requested access operation is
-	   found. 
-	*/
-	if (xpath_vec(rlist, nsc, "rule", &rvec, &rlen) < 0)
+	dec = nacm_rpc_decide(nc, NULL, rpc, module);
+    else {
+	if (nacm_user_get(nc, username, &nu) < 0)
 	    goto done;
-	for (j=0; j<rlen; j++){
-	    xrule = rvec[j];
-	    if ((match = nacm_rule_rpc(rpc, module, xrule)) < 0)
-		goto done;
-	    if (match)
-		break;
-	}
-	if (match)
-	    break;
-	if (rvec){
-	    free(rvec);
-	    rvec=NULL;
-	}
-    }
-    if (match){
-	if ((action = xml_find_body(xrule, "action")) == NULL)
-	    goto step10;
-	if (strcmp(action, "deny")==0){
-	    if (netconf_access_denied(cbret, "application", "access denied") < 0)
+	if (nu->nu_rpc == NULL) /* No groups */
+	    dec = nacm_rpc_decide(nc, NULL, rpc, module);
+	else {
+	    if ((cbkey = cbuf_new()) == NULL){
+		clicon_err(OE_UNIX, errno, "cbuf_new");
 		goto done;
-	    goto deny;
+	    }
+	    cprintf(cbkey, "%s:%s", module, rpc);
+	    if ((p = clicon_hash_value(nu->nu_rpc, cbuf_get(cbkey), NULL)) != NULL)
+		dec = *(int*)p;
+	    else {
+		dec = nacm_rpc_decide(nc, nu, rpc, module);
+		if (clicon_hash_add(nu->nu_rpc, cbuf_get(cbkey), &dec, sizeof(dec)) == NULL)
+		    goto done;
+	    }
 	}
-	else if (strcmp(action, "permit")==0)
-	    goto permit;
-
     }
- step10:
-    /*   10.  If the requested protocol operation is defined in a YANG module
-        advertised in the server capabilities and the "rpc" statement
-        contains a "nacm:default-deny-all" statement, then the protocol
-        operation is denied. */
-    /* 11.  If the requested protocol operation is the NETCONF
-        <kill-session> or <delete-config>, then the protocol operation
-        is denied. */
-    if (strcmp(rpc, "kill-session")==0 || strcmp(rpc, "delete-config")==0){
+    switch (dec){
+    case NACM_RPC_PERMIT:
+	goto permit;
+	break;
+    case NACM_RPC_DENY:
+	if (netconf_access_denied(cbret, "application", "access denied") < 0)
+	    goto done;
+	goto deny;
+	break;
+    default:
 	if (netconf_access_denied(cbret, "application", "default deny") < 0)
 	    goto done;
 	goto deny;
+	break;
     }
-    /*   12.  If the "exec-default" leaf is set to "permit", then permit the
-	 protocol operation; otherwise, deny the request. */
-    exec_default = xml_find_body(xnacm, "exec-default");
-    if (exec_default ==NULL || strcmp(exec_default, "permit")==0)
-	goto permit;
-    if (netconf_access_denied(cbret, "application", "default deny") < 0)
-	goto done;
-    goto deny;
  permit:
     retval = 1;
  done:
     clicon_debug(1, "%s retval:%d (0:deny 1:permit)", __FUNCTION__, retval);
-    if (nsc)
-	xml_nsctx_free(nsc);
-    if (gvec)
-	free(gvec);
-    if (rlistvec)
-	free(rlistvec);
-    if (rvec)
-	free(rvec);
+    if (cbkey)
+	cbuf_free(cbkey);
     return retval;
  deny: /* Here, cbret must contain a netconf error msg */
     assert(cbuf_len(cbret));
@@ -313,7 +834,7 @@ nacm_rpc(char         *rpc,
 /* Local struct for keeping preparation/compiled data in NACM data path code */
 struct prepvec{
     qelem_t       pv_q;
-    cxobj        *pv_xrule;
+    nacm_rule    *pv_rule;
     clixon_xvec  *pv_xpathvec;
 };
 typedef struct prepvec prepvec;
@@ -336,7 +857,7 @@ prepvec_free(prepvec *pv_list)
 
 prepvec *
 prepvec_add(prepvec  **pv_listp,
-	    cxobj     *xrule)
+	    nacm_rule *nr)
 {
     prepvec *pv;
 
@@ -346,7 +867,7 @@ prepvec_add(prepvec  **pv_listp,
     }
     memset(pv, 0, sizeof(*pv));
     ADDQ(pv, *pv_listp);
-    pv->pv_xrule = xrule;
+    pv->pv_rule = nr;
     if ((pv->pv_xpathvec = clixon_xvec_new()) == NULL)
 	return NULL;
     return pv;
@@ -355,159 +876,68 @@ prepvec_add(prepvec  **pv_listp,
 /*! Prepare datastructures before running through XML tree
  * Save rules in a "cache"
  * These rules match:
- *  - user/group
- *  - have read access-op, etc
+ *  - user/group (the rules of the compiled user)
+ *  - have read access-op, etc (the rules of the compiled user for this access)
  * Also make instance-id lookups on top object for each rule. Assume at most one result
  */
 static int
 nacm_datanode_prepare(clicon_handle     h,
 		      cxobj            *xt,
 		      enum nacm_access  access,
-		      cxobj           **gvec,
-		      size_t            glen,
-		      cxobj           **rlistvec,
-		      size_t            rlistlen,
-		      cvec             *nsc,
+		      nacm_user        *nu,
 		      prepvec         **pv_listp)
 {
     int        retval = -1;
-    cxobj     *rlist;
-    int        i;
     int        j;
     int        k;
-    char      *gname;
-    cxobj    **rvec = NULL; /* rules */
-    size_t     rlen;	
-    cxobj     *xrule;
-    cxobj     *pathobj;
-    char      *access_operations;
-    char      *path0;         /* Non-canonical path */
-    char      *path=NULL;     /* Canonical path */
-    cvec      *nsc0 = NULL;   /* Non-canonical namespace context */
+    nacm_rule *nr;
     yang_stmt *yspec;
-    cxobj   **xvec = NULL;
-    int       xlen = 0;
-    int       ret;
-    prepvec *pv;
+    cxobj    **xvec = NULL;
+    int        xlen = 0;
+    int        ret;
+    prepvec   *pv;
 
     yspec = clicon_dbspec_yang(h);
-    for (i=0; i<rlistlen; i++){ 	/* Loop through rule list */
-	rlist = rlistvec[i];
-	/* Loop through user's group to find match in this rule-list */
-	for (j=0; j<glen; j++){
-	    gname = xml_find_body(gvec[j], "name");
-	    if (xpath_first(rlist, nsc, ".[group='%s']", gname)!=NULL)
-		break; /* found */
+    /* 6. For each rule-list entry found, process all rules, in order,
+       until a rule that matches the requested access operation is
+       found. (see 6 sub rules in nacm_rule_datanode)
+       6c-6f) The access-operations of the rule matches the access: 
+       the compiled user has rules indexed per access
+    */
+    for (j=0; j<nu->nu_alen[access]; j++){ /* Loop through rules */
+	nr = nu->nu_access[access][j];
+	/*  6b) Either (1) the rule does not have a "rule-type" defined or
+	    (2) the "rule-type" is "data-node" and the "path" matches the
+	    requested data node, action node, or notification node. */    
+	if (nr->nr_path == NULL){
+	    /* Here a new rule is found, add it */
+	    if (prepvec_add(pv_listp, nr) == NULL)
+		goto done;
+	    continue;
 	}
-	if (j==glen) /* not found */
+	/* See https://github.com/clicon/clixon/issues/129:
+	 * Paths are assumed canonical, they are not translated with xpath2canonical
+	 */
+	if ((ret = clixon_xml_find_instance_id(xt, yspec, &xvec, &xlen, "%s", nr->nr_path)) < 0)
+	    goto done;
+	if (ret == 0)
 	    continue;
-	/* 6. For each rule-list entry found, process all rules, in order,
-	   until a rule that matches the requested access operation is
-	   found. (see 6 sub rules in nacm_rule_datanode
-	*/
-	if (xpath_vec(rlist, nsc, "rule", &rvec, &rlen) < 0)
+	/* Here a new rule is found, add it */
+	if ((pv = prepvec_add(pv_listp, nr)) == NULL)
 	    goto done;
-	for (j=0; j<rlen; j++){ /* Loop through rules */
-	    xrule = rvec[j];
-	    /* 6c) For a "read" access operation, the rule's "access-operations"
-	       leaf has the "read" bit set or has the special value "*" */
-	    access_operations = xml_find_body(xrule, "access-operations");
-	    switch (access){
-	    case NACM_READ: 
-		/* 6c) For a "read" access operation, the rule's "access-operations"
-		   leaf has the "read" bit set or has the special value "*" */
-		if (!match_access(access_operations, "read", NULL))
-		    continue;
-		break;
-	    case NACM_CREATE:
-		/* 6d) For a "create" access operation, the rule's "access-operations" 
-		   leaf has the "create" bit set or has the special value "*". */
-		if (!match_access(access_operations, "create", "write"))
-		    continue;
-		break;
-	    case NACM_DELETE:
-		/* 6e) For a "delete" access operation, the rule's "access-operations" 
-		   leaf has the "delete" bit set or has the  special value "*". */
-		if (!match_access(access_operations, "delete", "write"))
-		    continue;
-		break;
-	    case NACM_UPDATE:
-		/* 6f) For an "update" access operation, the rule's "access-operations"
-		   leaf has the "update" bit set or has the special value "*". */ 
-		if (!match_access(access_operations, "update", "write"))
-		    continue;
-		break;
-	    default:
-		clicon_err(OE_XML, EINVAL, "Access %d unupported (shouldnt happen)", access);
+	for (k=0; k<xlen; k++){
+	    if (clixon_xvec_append(pv->pv_xpathvec, xvec[k]) < 0)
 		goto done;
-		break;
-	    }
-	    /*  6b) Either (1) the rule does not have a "rule-type" defined or
-		(2) the "rule-type" is "data-node" and the "path" matches the
-		requested data node, action node, or notification node. */    
-	    if ((pathobj = xml_find_type(xrule, NULL, "path", CX_ELMNT)) == NULL){
-		if (xml_find_body(xrule, "rpc-name") || xml_find_body(xrule, "notification-name"))
-		    continue;
-		/* Here a new xrule is found, add it */
-		if (prepvec_add(pv_listp, xrule) == NULL)
-		    goto done;
-	    }
-	    else{
-		path0 = clixon_trim2(xml_body(pathobj), " \t\n");
-		/* Get canonical namespace context for nacm paths */
-		if ((path = strdup(path0)) == NULL){
-		    clicon_err(OE_UNIX, errno, "strdup");
-		    goto done;
-		}
-#if 0
-		/* See https://github.com/clicon/clixon/issues/129:
-		 * If this is enabled, you are back to the problem of JSON encodings
-		 */
-		/* Create namespace context for with nacm namespace as default */
-		if (xml_nsctx_node(pathobj, &nsc0) < 0)
-		    goto done;
-		/* instance-id requires canonical paths */
-		if (xpath2canonical(path0, nsc0, yspec, &path, NULL) < 0)
-		    goto done;
-#endif
-		if ((ret = clixon_xml_find_instance_id(xt, yspec, &xvec, &xlen, "%s", path)) < 0)
-		    goto done;
-		if (ret == 0)
-		    continue;
-		/* Here a new xrule is found, add it */
-		if ((pv = prepvec_add(pv_listp, xrule)) == NULL)
-		    goto done;
-		for (k=0; k<xlen; k++){
-		    if (clixon_xvec_append(pv->pv_xpathvec, xvec[k]) < 0)
-			goto done;
-		}
-		if (xvec){
-		    free(xvec);
-		    xvec = NULL;
-		}
-		if (nsc0){
-		    cvec_free(nsc0);
-		    nsc0 = NULL;
-		}
-		if (path){
-		    free(path);
-		    path = NULL;
-		}
-	    }
 	}
-	if (rvec){
-	    free(rvec);
-	    rvec=NULL;
-	}	
+	if (xvec){
+	    free(xvec);
+	    xvec = NULL;
+	}
     }
     retval = 0;
  done:
     if (xvec)
 	free(xvec);
-    if (path)
-	free(path);
-    if (nsc0)
-	cvec_free(nsc0);
     return retval;
 }
 
@@ -517,7 +947,7 @@ nacm_datanode_prepare(clicon_handle     h,
 
 /*! Match specific rule to specific requested node
  * @param[in]  xn       XML node (requested node)
- * @param[in]  xrule    NACM rule
+ * @param[in]  nr       Compiled NACM rule
  * @param[in]  xp       Xpath match
  * @param[in]  yspec    YANG spec
  * @retval -1  Error
@@ -526,36 +956,33 @@ nacm_datanode_prepare(clicon_handle     h,
  * @retval  2  OK and rule matches permit
  */
 static int
-nacm_data_write_xrule_xml(cxobj       *xn,
-			  cxobj       *xrule,
-			  clixon_xvec *xpathvec,
-			  yang_stmt   *yspec)
+nacm_data_write_rule(cxobj       *xn,
+		     nacm_rule   *nr,
+		     clixon_xvec *xpathvec,
+		     yang_stmt   *yspec)
 {
     int        retval = -1;
     yang_stmt *ymod;
-    char      *module_pattern; /* rule module name */
-    char      *action;
     cxobj     *xp;
     int        i;
 
-    if ((module_pattern = xml_find_body(xrule, "module-name")) == NULL)
+    if (nr->nr_module == NULL)
 	goto nomatch;
     /* 6a) The rule's "module-name" leaf is "*" or equals the name of
      * the YANG module where the requested data node is defined. 
      */
-    if (strcmp(module_pattern, "*") != 0){
+    if (strcmp(nr->nr_module, "*") != 0){
 	if (ys_module_by_xml(yspec, xn, &ymod) < 0)
 	    goto done;
 	/* ymod is NULL (xn is "config") Can this breach the NACM rule? */
-	if (ymod && strcmp(yang_argument_get(ymod), module_pattern) != 0)
+	if (ymod && strcmp(yang_argument_get(ymod), nr->nr_module) != 0)
 	    goto nomatch;
     }
-    action = xml_find_body(xrule, "action"); /* mandatory */
     /*  6b) Either (1) the rule does not have a "rule-type" defined or
 	(2) the "rule-type" is "data-node" and the "path" matches the
 	Requested data node, action node, or notification node. */    
-    if (xml_find_type(xrule, NULL, "path", CX_ELMNT) == NULL){
-	if (strcmp(action, "deny")==0)
+    if (nr->nr_path == NULL){
+	if (nr->nr_action == NACM_ACTION_DENY)
 	    goto deny;
 	goto permit;
     }
@@ -563,7 +990,7 @@ nacm_data_write_xrule_xml(cxobj       *xn,
 	xp = clixon_xvec_i(xpathvec, i);
 	/* Check if ancestor is xp (for every xpathvec?) */
 	if (xn == xp || xml_isancestor(xn, xp)){
-	    if (strcmp(action, "deny")==0)
+	    if (nr->nr_action == NACM_ACTION_DENY)
 		goto deny;
 	    goto permit;
 	}
@@ -615,7 +1042,7 @@ nacm_datanode_write_recurse(clicon_handle h,
 	do {
 	    /* return values: -1:Error /0:no match /1: deny /2: permit
 	     */
-	    if ((ret = nacm_data_write_xrule_xml(xn, pv->pv_xrule, pv->pv_xpathvec, yspec)) < 0) 
+	    if ((ret = nacm_data_write_rule(xn, pv->pv_rule, pv->pv_xpathvec, yspec)) < 0) 
 		goto done;
 	    switch(ret){
 	    case 0: /* No match, continue with next rule */
@@ -683,23 +1110,17 @@ nacm_datanode_write(clicon_handle    h,
 		    cbuf            *cbret)
 {
     int             retval = -1;
-    cxobj         **gvec = NULL; /* groups */
-    size_t          glen;
-    cxobj         **rlistvec = NULL; /* rule-list */
-    size_t          rlistlen;
-    cxobj         **rvec = NULL; /* rules */
-    char           *write_default = NULL;
-    cvec           *nsc = NULL;
+    nacm_compiled  *nc;
+    nacm_user      *nu;
     int             ret;
     prepvec        *pv_list = NULL;
 
-    /* Create namespace context for with nacm namespace as default */
-    if ((nsc = xml_nsctx_init(NULL, NACM_NS)) == NULL)
-	goto done;
     if (xnacm == NULL)
 	goto permit;
+    if (nacm_compiled_get(h, xnacm, &nc) < 0)
+	goto done;
     /* write-default (create, update, or delete) has default deny so should never be NULL */
-    if ((write_default = xml_find_body(xnacm, "write-default")) == NULL){
+    if (nc->nc_write_default == -1){
 	clicon_err(OE_XML, EINVAL, "No nacm write-default rule");
 	goto done;
     }
@@ -711,24 +1132,22 @@ nacm_datanode_write(clicon_handle    h,
     if (username == NULL)
 	goto step9;
     /* User's group */
-    if (xpath_vec(xnacm, nsc, "groups/group[user-name='%s']", &gvec, &glen, username) < 0)
+    if (nacm_user_get(nc, username, &nu) < 0)
 	goto done;
     /* 4. If no groups are found, continue with step 9. */
-    if (glen == 0)
+    if (nu->nu_groups == 0)
 	goto step9;
     /* 5. Process all rule-list entries, in the order they appear in the
         configuration.  If a rule-list's "group" leaf-list does not
         match any of the user's groups, proceed to the next rule-list
-        entry. */
-    if (xpath_vec(xnacm, nsc, "rule-list", &rlistvec, &rlistlen) < 0)
-	goto done;
-    /* First run through rules and cache rules as well as lookup objects in xt. 
+        entry. (The compiled user has the rules of these rule-lists)
+       First run through rules and cache rules as well as lookup objects in xt. 
      */
-    if (nacm_datanode_prepare(h, xt, access, gvec, glen, rlistvec, rlistlen, nsc, &pv_list) < 0)
+    if (nacm_datanode_prepare(h, xt, access, nu, &pv_list) < 0)
 	goto done;
     /* Then recursivelyy traverse all requested nodes */
     if ((ret = nacm_datanode_write_recurse(h, xreq, pv_list,
-					   strcmp(write_default, "deny"),
+					   nc->nc_write_default != NACM_DEFAULT_DENY,
 					   clicon_dbspec_yang(h),
 					   cbret)) < 0)
 	goto done;
@@ -750,7 +1169,7 @@ nacm_datanode_write(clicon_handle    h,
         set to "permit", then permit the data node access request;
         otherwise, deny the request.*/
     /* write-default has default permit so should never be NULL */
-    if (strcmp(write_default, "deny") == 0){
+    if (nc->nc_write_default == NACM_DEFAULT_DENY){
 	if (netconf_access_denied(cbret, "application", "default deny") < 0)
 	    goto done;
 	goto deny;
@@ -761,14 +1180,6 @@ nacm_datanode_write(clicon_handle    h,
     clicon_debug(1, "%s retval:%d (0:deny 1:permit)", __FUNCTION__, retval);
     if (pv_list)
 	prepvec_free(pv_list);
-    if (nsc)
-	xml_nsctx_free(nsc);
-    if (gvec)
-	free(gvec);
-    if (rlistvec)
-	free(rlistvec);
-    if (rvec)
-	free(rvec);
     return retval;
  deny: /* Here, cbret must contain a netconf error msg */
     assert(cbuf_len(cbret));
@@ -781,152 +1192,411 @@ nacm_datanode_write(clicon_handle    h,
  */
 
 /*! Perform NACM action: mark if permit, del if deny
- * @param[in] xrule    NACM rule
+ * @param[in] nr       Compiled NACM rule
  * @param[in] xn       XML node (requested node)
  * @retval    -1       Error
  * @retval    0        OK
  */
 static int
-nacm_data_read_action(cxobj *xrule,
-		      cxobj *xn)
+nacm_data_read_action(nacm_rule *nr,
+		      cxobj     *xn)
 {
-    int   retval = -1;
-    char *action;
+    if (nr->nr_action == NACM_ACTION_DENY)
+	xml_flag_set(xn, XML_FLAG_DEL);
+    else if (nr->nr_action == NACM_ACTION_PERMIT)
+	xml_flag_set(xn, XML_FLAG_MARK);
+    return 0;
+}
+
+/*! Compare instance predicates of two path steps, NULL means no predicates
+ * @retval  1  Equal
+ * @retval  0  Not equal
+ */
+static int
+nacm_rtrie_cvk_eq(cvec *cvk0,
+		  cvec *cvk1)
+{
+    cg_var *cv0;
+    cg_var *cv1;
+    int     i;
+
+    if (cvk0 == NULL || cvk1 == NULL)
+	return cvk0 == cvk1;
+    if (cvec_len(cvk0) != cvec_len(cvk1))
+	return 0;
+    for (i=0; i<cvec_len(cvk0); i++){
+	cv0 = cvec_i(cvk0, i);
+	cv1 = cvec_i(cvk1, i);
+	if (cv_type_get(cv0) != cv_type_get(cv1))
+	    return 0;
+	if (cv_type_get(cv0) == CGV_UINT32){
+	    if (cv_uint32_get(cv0) != cv_uint32_get(cv1))
+		return 0;
+	}
+	else if (clicon_strcmp(cv_name_get(cv0), cv_name_get(cv1)) != 0 ||
+		 clicon_strcmp(cv_string_get(cv0), cv_string_get(cv1)) != 0)
+	    return 0;
+    }
+    return 1;
+}
+
+/*! Get child step of a trie node, create it if not found
+ * @param[in]  rt    Trie node
+ * @param[in]  cp    Path step, resolved to yang
+ * @param[out] rtcp  Child trie node
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+nacm_rtrie_step(nacm_rtrie  *rt,
+		clixon_path *cp,
+		nacm_rtrie **rtcp)
+{
+    int          retval = -1;
+    nacm_rtrie  *rtc = NULL;
+    nacm_rtrie **vec;
+    int          i;
 
-    if ((action = xml_find_body(xrule, "action")) != NULL){
-	if (strcmp(action, "deny")==0)
-	    xml_flag_set(xn, XML_FLAG_DEL);
-	else if (strcmp(action, "permit")==0)
-	    xml_flag_set(xn, XML_FLAG_MARK);
+    for (i=0; i<rt->rt_len; i++){
+	rtc = rt->rt_vec[i];
+	if (rtc->rt_yang == cp->cp_yang &&
+	    nacm_rtrie_cvk_eq(rtc->rt_cvk, cp->cp_cvk))
+	    goto ok;
+    }
+    if ((rtc = malloc(sizeof(*rtc))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    memset(rtc, 0, sizeof(*rtc));
+    rtc->rt_yang = cp->cp_yang;
+    if (cp->cp_cvk && (rtc->rt_cvk = cvec_dup(cp->cp_cvk)) == NULL){
+	clicon_err(OE_UNIX, errno, "cvec_dup");
+	goto done;
     }
+    if ((vec = realloc(rt->rt_vec, (rt->rt_len+1)*sizeof(nacm_rtrie*))) == NULL){
+	clicon_err(OE_UNIX, errno, "realloc");
+	goto done;
+    }
+    rt->rt_vec = vec;
+    rt->rt_vec[rt->rt_len++] = rtc;
+ ok:
+    *rtcp = rtc;
+    rtc = NULL;
     retval = 0;
-    //done:
+ done:
+    if (rtc)
+	nacm_rtrie_free(rtc);
     return retval;
 }
 
-/*! Match specific rule to specific requested node
- * @param[in]  xn       XML node (requested node)
- * @param[in]  xrule    NACM rule
- * @param[in]  yspec    YANG spec
- * @retval -1  Error
- * @retval  0  OK and rule does not match
- * @retval  1  OK and rule matches
- * Two distinct cases:
- * (1) read_default is permit
- *     mark all deny rules and remove them
- * (2) read_default is deny:
- *     mark all permit rules and ancestors, remove everything else
+/*! Build the read rule trie of a user
+ * Rule paths are instance-identifiers resolved to yang, where each step is a
+ * schema node with optional predicates (keys, leaf-list value or position).
+ * Rules whose path does not resolve never match and are left out.
+ * @param[in]  nu     Compiled user
+ * @param[in]  yspec  YANG spec
+ * @retval     0      OK
+ * @retval    -1      Error
  */
 static int
-nacm_data_read_xrule_xml(cxobj        *xn,
-			 cxobj        *xrule,
-			 clixon_xvec  *xpathvec,
-			 yang_stmt    *yspec)
+nacm_rtrie_build(nacm_user *nu,
+		 yang_stmt *yspec)
 {
-    int        retval = -1;
-    yang_stmt *ymod;
-    char      *module_pattern; /* rule module name */
-    cxobj     *xp;
-    int        i;
-    
-    if ((module_pattern = xml_find_body(xrule, "module-name")) == NULL)
-	goto nomatch;
-    /* 6a) The rule's "module-name" leaf is "*" or equals the name of
-     * the YANG module where the requested data node is defined. 
-     */
-    if (strcmp(module_pattern, "*") != 0){
-	if (ys_module_by_xml(yspec, xn, &ymod) < 0)
-	    goto done;
-	if (strcmp(yang_argument_get(ymod), module_pattern) != 0)
-	    goto nomatch;
+    int          retval = -1;
+    nacm_rtrie  *root = NULL;
+    nacm_rtrie  *rt;
+    nacm_rtrie  *rtc;
+    nacm_rule   *nr;
+    clixon_path *cplist = NULL;
+    clixon_path *cp;
+    int         *vec;
+    int          i;
+    int          ret;
+
+    if ((root = malloc(sizeof(*root))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
     }
-    /*  6b) Either (1) the rule does not have a "rule-type" defined or
-	(2) the "rule-type" is "data-node" and the "path" matches the
-	requested data node, action node, or notification node. */    
-    if (xml_find_type(xrule, NULL, "path", CX_ELMNT) == NULL){
-	if (nacm_data_read_action(xrule, xn) < 0)
+    memset(root, 0, sizeof(*root));
+    nu->nu_rnopath = 0;
+    for (i=0; i<nu->nu_alen[NACM_READ]; i++){
+	nr = nu->nu_access[NACM_READ][i];
+	if (nr->nr_module == NULL)
+	    continue;
+	if (nr->nr_path == NULL){
+	    nu->nu_rnopath |= NACM_ACTION_BIT(nr->nr_action);
+	    continue;
+	}
+	/* See https://github.com/clicon/clixon/issues/129:
+	 * Paths are assumed canonical, they are not translated with xpath2canonical
+	 */
+	if ((ret = clixon_instance_id_parse(yspec, nr->nr_path, &cplist)) < 0)
 	    goto done;
-	goto match;
-    }
-    for (i=0; i<clixon_xvec_len(xpathvec); i++){
-	xp = clixon_xvec_i(xpathvec, i);
-	/* Check if ancestor is xp (for every xpathvec?) */
-	if (xn == xp || xml_isancestor(xn, xp)){
-	    if (nacm_data_read_action(xrule, xn) < 0)
-		goto done;
-	    goto match;
+	if (ret == 0)
+	    continue;
+	rt = root;
+	if ((cp = cplist) != NULL){
+	    do {
+		rt->rt_below |= NACM_ACTION_BIT(nr->nr_action);
+		if (nacm_rtrie_step(rt, cp, &rtc) < 0)
+		    goto done;
+		rt = rtc;
+		cp = NEXTQ(clixon_path *, cp);
+	    } while (cp && cp != cplist);
 	}
+	if ((vec = realloc(rt->rt_rules, (rt->rt_rlen+1)*sizeof(int))) == NULL){
+	    clicon_err(OE_UNIX, errno, "realloc");
+	    goto done;
+	}
+	rt->rt_rules = vec;
+	rt->rt_rules[rt->rt_rlen++] = i;
+	clixon_path_free(cplist);
+	cplist = NULL;
     }
- nomatch:
+    nu->nu_rtrie = root;
+    root = NULL;
     retval = 0;
  done:
+    if (cplist)
+	clixon_path_free(cplist);
+    if (root)
+	nacm_rtrie_free(root);
     return retval;
- match:
-    retval = 1; /* match */
-    goto done;
 }
 
-/*! Recursive check for NACM read rules among all XML nodes
- * @param[in]  h        Clicon handle
+/*! Check if XML node matches the instance predicates of a path step
+ * @param[in]  x    XML node whose schema node is the one of the step
+ * @param[in]  cvk  Predicates: key values, leaf-list value or position
+ * @retval     1    Match
+ * @retval     0    No match
+ * @see clixon_path_search  Same matching on XML search
+ */
+static int
+nacm_rtrie_pred(cxobj *x,
+		cvec  *cvk)
+{
+    cg_var  *cv;
+    cxobj   *xs;
+    char    *name;
+    char    *body;
+    uint32_t u;
+
+    if (cvec_len(cvk) == 1 && (cv = cvec_i(cvk, 0)) != NULL &&
+	cv_type_get(cv) == CGV_UINT32){ /* Position, eg x/y[42] */
+	u = 0;
+	xs = NULL;
+	while ((xs = xml_child_each(xml_parent(x), xs, CX_ELMNT)) != NULL && xs != x)
+	    if (strcmp(xml_name(xs), xml_name(x)) == 0)
+		u++;
+	return cv_uint32_get(cv) == u;
+    }
+    cv = NULL;
+    while ((cv = cvec_each(cvk, cv)) != NULL){
+	name = cv_name_get(cv);
+	if (name == NULL || strcmp(name, ".") == 0)
+	    body = xml_body(x);
+	else
+	    body = xml_find_body(x, name);
+	if (body == NULL || strcmp(body, cv_string_get(cv)) != 0)
+	    return 0;
+    }
+    return 1;
+}
+
+/* Read walk state, same for all nodes */
+typedef struct {
+    nacm_rule **rw_rules;   /* Read rules of user, in order */
+    int         rw_len;
+    int         rw_nopath;  /* Actions of read rules without path */
+    int         rw_default; /* read-default, NACM_DEFAULT_* */
+    yang_stmt  *rw_yspec;
+    int         rw_marks;   /* Nr of permitted (marked) nodes */
+} nacm_rwalk;
+
+/*! Find the first read rule that matches a requested node
+ * @param[in]  rw       Read walk state
  * @param[in]  xn       XML node (requested node)
- * @param[in]  rulevec  Precomputed rules that apply to this user group
- * @param[in]  xpathvec Precomputed xpath results that apply to this XML tree
- * @param[in]  yspec    YANG spec
- * @retval  0  OK
- * @retval -1  Error
+ * @param[in]  matched  Rules whose path is xn or an ancestor, indexed as rw_rules, or NULL
+ * @param[out] nrp      First matching rule, or NULL
+ * @retval     0        OK
+ * @retval    -1        Error
  */
 static int
-nacm_datanode_read_recurse(clicon_handle h,
-			   cxobj        *xn,
-			   prepvec      *pv_list,
-			   yang_stmt    *yspec)
+nacm_rwalk_decide(nacm_rwalk *rw,
+		  cxobj      *xn,
+		  char       *matched,
+		  nacm_rule **nrp)
 {
-    int      retval = -1;
-    cxobj   *x;
-    cxobj   *xprev;
-    int      ret;
-    prepvec *pv;
-    
-    if (xml_spec(xn)){ /* Check this node */
-	pv = pv_list;
-	if (pv){
-	    do {
-		if ((ret = nacm_data_read_xrule_xml(xn,
-						    pv->pv_xrule,
-						    pv->pv_xpathvec,
-						    yspec)) < 0) 
-		    goto done;	    
-		if (ret == 1)
-		    break; /* stop at first match */		    
-		pv = NEXTQ(prepvec *, pv);
-	    } while (pv && pv != pv_list);
-	}
+    int        retval = -1;
+    nacm_rule *nr;
+    yang_stmt *ymod = NULL;
+    int        ymodok = 0;
+    int        i;
 
-#if 0 /* 6(A) in algorithm 
-       * If N did not match any rule R, and default rule is deny, remove that subtree */
-	if (strcmp(read_default, "deny") == 0)
-	    if (xml_tree_prune_flagged_sub(xt, XML_FLAG_MARK, 1, NULL) < 0)
-		goto done;
-#endif
+    *nrp = NULL;
+    for (i=0; i<rw->rw_len; i++){
+	nr = rw->rw_rules[i];
+	if (nr->nr_module == NULL)
+	    continue;
+	/*  6b) Either (1) the rule does not have a "rule-type" defined or
+	    (2) the "rule-type" is "data-node" and the "path" matches the
+	    requested data node, action node, or notification node. */    
+	if (nr->nr_path && (matched == NULL || matched[i] == 0))
+	    continue;
+	/* 6a) The rule's "module-name" leaf is "*" or equals the name of
+	 * the YANG module where the requested data node is defined. 
+	 */
+	if (strcmp(nr->nr_module, "*") != 0){
+	    if (!ymodok){
+		if (ys_module_by_xml(rw->rw_yspec, xn, &ymod) < 0)
+		    goto done;
+		ymodok++;
+	    }
+	    if (ymod == NULL || strcmp(yang_argument_get(ymod), nr->nr_module) != 0)
+		continue;
+	}
+	*nrp = nr;
+	break;
     }
+    retval = 0;
+ done:
+    return retval;
+}
 
-    /* If node should be purged, dont recurse and defer removal to caller */
-    if (xml_flag(xn, XML_FLAG_DEL) == 0){
-	x = NULL; 	/* Recursively check XML */
-	xprev = NULL;
-	while ((x = xml_child_each(xn, x, CX_ELMNT)) != NULL) {
-	    if (nacm_datanode_read_recurse(h, x, pv_list, yspec) < 0)
+/*! Top-down walk of NACM read rules among all XML nodes
+ *
+ * The trie steps matching the ancestors of the children of xp are given in
+ * active. A rule matches a node if its path matches the node or an ancestor,
+ * which is inherited in matched.
+ * A subtree is not walked further if it is decided: if no rule that could match
+ * below can change whether it is returned. A denied node is purged at once.
+ * @param[in]  rw       Read walk state
+ * @param[in]  xp       XML parent node, its children are requested nodes
+ * @param[in]  active   Trie steps whose child steps may match children of xp
+ * @param[in]  alen     Length of active
+ * @param[in]  matched  Rules matching xp (or ancestor) on path, or NULL
+ * @param[in]  mbits    Actions of rules in matched, NACM_ACTION_BIT()
+ * @param[in]  marked   xp or an ancestor is permitted
+ * @retval     0        OK
+ * @retval    -1        Error
+ */
+static int
+nacm_datanode_read_walk(nacm_rwalk  *rw,
+			cxobj       *xp,
+			nacm_rtrie **active,
+			int          alen,
+			char        *matched,
+			int          mbits,
+			int          marked)
+{
+    int          retval = -1;
+    cxobj       *x;
+    cxobj       *xprev;
+    yang_stmt   *ys;
+    nacm_rtrie  *rt;
+    nacm_rtrie  *rtc;
+    nacm_rtrie **xactive = NULL;
+    int          xalen;
+    char        *xmatched = NULL;
+    int          xmbits;
+    int          xmarked;
+    int          below;
+    int          possible;
+    nacm_rule   *nr;
+    int          i;
+    int          j;
+    int          k;
+    int          n;
+
+    /* Max nr of child steps */
+    n = 0;
+    for (i=0; i<alen; i++)
+	n += active[i]->rt_len;
+    if (n && (xactive = malloc(n*sizeof(nacm_rtrie*))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    x = NULL;
+    xprev = NULL;
+    while ((x = xml_child_each(xp, x, CX_ELMNT)) != NULL) {
+	if ((ys = xml_spec(x)) == NULL){
+	    if (nacm_datanode_read_walk(rw, x, NULL, 0, matched, mbits, marked) < 0)
 		goto done;
-	    /* check for delayed remove */
-	    if (xml_flag(x, XML_FLAG_DEL)){
-		if (xml_purge(x) < 0)
-		    goto done;
-	    x = xprev;
+	    xprev = x;
+	    continue;
+	}
+	/* Steps matching x, and rules whose path ends in x */
+	xalen = 0;
+	xmbits = mbits;
+	below = 0;
+	for (i=0; i<alen; i++){
+	    rt = active[i];
+	    for (j=0; j<rt->rt_len; j++){
+		rtc = rt->rt_vec[j];
+		if (rtc->rt_yang != ys)
+		    continue;
+		if (rtc->rt_cvk && !nacm_rtrie_pred(x, rtc->rt_cvk))
+		    continue;
+		if (rtc->rt_len)
+		    xactive[xalen++] = rtc;
+		below |= rtc->rt_below;
+		for (k=0; k<rtc->rt_rlen; k++){
+		    if (xmatched == NULL){
+			if ((xmatched = malloc(rw->rw_len)) == NULL){
+			    clicon_err(OE_UNIX, errno, "malloc");
+			    goto done;
+			}
+			if (matched)
+			    memcpy(xmatched, matched, rw->rw_len);
+			else
+			    memset(xmatched, 0, rw->rw_len);
+		    }
+		    xmatched[rtc->rt_rules[k]] = 1;
+		    xmbits |= NACM_ACTION_BIT(rw->rw_rules[rtc->rt_rules[k]]->nr_action);
+		}
 	    }
 	}
+	if (nacm_rwalk_decide(rw, x, xmatched?xmatched:matched, &nr) < 0)
+	    goto done;
+	if (nr){
+	    if (nacm_data_read_action(nr, x) < 0)
+		goto done;
+	    if (nr->nr_action == NACM_ACTION_PERMIT)
+		rw->rw_marks++;
+	}
+	if (xml_flag(x, XML_FLAG_DEL)){
+	    if (xml_purge(x) < 0)
+		goto done;
+	    x = xprev;
+	}
+	else {
+	    /* Walk subtree only if a rule below can change the result:
+	     * a permitted subtree (or default permit) can only shrink by deny rules,
+	     * a non-permitted subtree (default deny) only be kept by permit rules.
+	     */
+	    xmarked = marked || xml_flag(x, XML_FLAG_MARK);
+	    possible = rw->rw_nopath | xmbits | below;
+	    if (xmarked || rw->rw_default == NACM_DEFAULT_PERMIT)
+		possible &= NACM_ACTION_BIT(NACM_ACTION_DENY);
+	    else
+		possible &= NACM_ACTION_BIT(NACM_ACTION_PERMIT);
+	    if (possible &&
+		nacm_datanode_read_walk(rw, x, xactive, xalen,
+					xmatched?xmatched:matched, xmbits, xmarked) < 0)
+		goto done;
+	    xprev = x;
+	}
+	if (xmatched){
+	    free(xmatched);
+	    xmatched = NULL;
+	}
     }
     retval = 0;
  done:
+    if (xmatched)
+	free(xmatched);
+    if (xactive)
+	free(xactive);
     return retval;
 }
 
@@ -974,6 +1644,10 @@ nacm_datanode_read_recurse(clicon_handle h,
  * 7. If remaining nodes, goto 1
  * 8(B) If default rule is deny, recursively remove all subtrees that are not marked
  *
+ * Rule paths are compiled into a trie over schema nodes that is matched while the
+ * tree is walked top-down, and a subtree is skipped in step 1 once no rule can 
+ * change its result, see nacm_datanode_read_walk.
+ *
  * @see RFC8341 3.4.5.  Data Node Access Validation
  * @see nacm_datanode_write
  * @see nacm_rpc
@@ -987,17 +1661,12 @@ nacm_datanode_read(clicon_handle h,
 		   cxobj        *xnacm)
 {
     int             retval = -1;
-    cxobj         **gvec = NULL; /* groups */
-    size_t          glen;
-    cxobj         **rlistvec = NULL; /* rule-list */
-    size_t          rlistlen;
     int             i;
-    char           *read_default = NULL;
-    cvec           *nsc = NULL;
-    prepvec        *pv_list = NULL;
+    nacm_compiled  *nc;
+    nacm_user      *nu;
+    nacm_rwalk      rw = {0,};
     
-    /* Create namespace context for with nacm namespace as default */
-    if ((nsc = xml_nsctx_init(NULL, NACM_NS)) == NULL)
+    if (nacm_compiled_get(h, xnacm, &nc) < 0)
 	goto done;
     /* 3.   Check all the "group" entries to see if any of them contain a
        "user-name" entry that equals the username for the session
@@ -1007,39 +1676,44 @@ nacm_datanode_read(clicon_handle h,
     if (username == NULL)
 	goto step9;
     /* User's group */
-    if (xpath_vec(xnacm, nsc, "groups/group[user-name='%s']", &gvec, &glen, username) < 0)
+    if (nacm_user_get(nc, username, &nu) < 0)
 	goto done;
-    /* 4. If no groups are found (glen=0), continue and check read-default 
+    /* 4. If no groups are found, continue and check read-default 
           in step 11. */
     /* 5. Process all rule-list entries, in the order they appear in the
         configuration.  If a rule-list's "group" leaf-list does not
         match any of the user's groups, proceed to the next rule-list
-        entry. */
-    if (xpath_vec(xnacm, nsc, "rule-list", &rlistvec, &rlistlen) < 0)
-	goto done;
+        entry. (The compiled user has the rules of these rule-lists) */
     /* read-default has default permit so should never be NULL */
-    if ((read_default = xml_find_body(xnacm, "read-default")) == NULL){
+    if (nc->nc_read_default == -1){
 	clicon_err(OE_XML, EINVAL, "No nacm read-default rule");
 	goto done;
     }
-    /* First run through rules and cache rules as well as lookup objects in xt. 
-     * DANGER: objects could be stale if they are removed?
-     */
-    if (nacm_datanode_prepare(h, xt, NACM_READ, gvec, glen, rlistvec, rlistlen, nsc, &pv_list) < 0)
-	goto done;
-    /* Then recursivelyy traverse all nodes */
-    if (nacm_datanode_read_recurse(h, xt, pv_list, clicon_dbspec_yang(h)) < 0)
+    /* Rule paths are compiled on first read of user */
+    if (nu->nu_alen[NACM_READ] && nu->nu_rtrie == NULL &&
+	nacm_rtrie_build(nu, clicon_dbspec_yang(h)) < 0)
 	goto done;
+    /* Then traverse nodes top-down */
+    if (nu->nu_rtrie){
+	rw.rw_rules = nu->nu_access[NACM_READ];
+	rw.rw_len = nu->nu_alen[NACM_READ];
+	rw.rw_nopath = nu->nu_rnopath;
+	rw.rw_default = nc->nc_read_default;
+	rw.rw_yspec = clicon_dbspec_yang(h);
+	if (nacm_datanode_read_walk(&rw, xt, &nu->nu_rtrie, 1, NULL, 0, 0) < 0)
+	    goto done;
+    }
 #if 1
     /* Step 8(B) above:
      * If default rule is deny, recursively remove all subtrees that are not marked
      */
-    if (strcmp(read_default, "deny") == 0)
+    if (nc->nc_read_default == NACM_DEFAULT_DENY)
 	if (xml_tree_prune_flagged_sub(xt, XML_FLAG_MARK, 1, NULL) < 0)
 	    goto done;
 #endif
     /* reset flag */
-    if (xml_apply(xt, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset, (void*)XML_FLAG_MARK) < 0)
+    if (rw.rw_marks &&
+	xml_apply(xt, CX_ELMNT, (xml_applyfn_t*)xml_flag_reset, (void*)XML_FLAG_MARK) < 0)
 	goto done;
 
     goto ok;
@@ -1059,14 +1733,6 @@ nacm_datanode_read(clicon_handle h,
     retval = 0;
  done:
     clicon_debug(1, "%s retval:%d", __FUNCTION__, retval);
-    if (pv_list)
-	prepvec_free(pv_list);
-    if (nsc)
-	xml_nsctx_free(nsc);
-    if (gvec)
-	free(gvec);
-    if (rlistvec)
-	free(rlistvec);
     return retval;
 }
 
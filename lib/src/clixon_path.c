@@ -196,7 +196,10 @@ instance_id_parse(char         *path,
     return retval;
 }
 
-static int
+/*! Free clixon-path list
+ * @param[in]  cplist    Structured internal clixon-path
+ */
+int
 clixon_path_free(clixon_path *cplist)
 {
     clixon_path *cp;
@@ -1796,3 +1799,45 @@ clixon_instance_id_bind(yang_stmt  *yt,
     retval = 0;
     goto done;
 }
+
+/*! Given (instance-id) path and YANG, parse path and resolve it to YANG statements
+ *
+ * Same as clixon_xml_find_instance_id but without XML search, for callers that
+ * match the path themselves, eg NACM rule paths.
+ * @param[in]  yt       Yang statement of top symbol (can be yang-spec if top-level)
+ * @param[in]  path     Instance-id path
+ * @param[out] cplistp  Structured clixon-path with cp_yang set. Free with clixon_path_free
+ * @retval    -1        Error
+ * @retval     0        Non-fatal failure, eg path does not match yang, cplistp is NULL
+ * @retval     1        OK
+ * @see clixon_xml_find_instance_id
+ */
+int
+clixon_instance_id_parse(yang_stmt    *yt,
+			 char         *path,
+			 clixon_path **cplistp)
+{
+    int          retval = -1;
+    clixon_path *cplist = NULL;
+    int          ret;
+
+    if (instance_id_parse(path, &cplist) < 0)
+	goto done;
+    if (clicon_debug_get())
+	clixon_path_print(stderr, cplist);
+    if ((ret = instance_id_resolve(cplist, yt)) < 0)
+	goto done;
+    if (ret == 0)
+	goto fail;
+    *cplistp = cplist;
+    cplist = NULL;
+    retval = 1;
+ done:
+    if (cplist)
+	clixon_path_free(cplist);
+    return retval;
+ fail:
+    *cplistp = NULL;
+    retval = 0;
+    goto done;
+}
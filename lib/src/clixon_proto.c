@@ -56,6 +56,7 @@
 #include <sys/time.h>
 #include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <netinet/in.h>
 #include <sys/un.h>
 #include <arpa/inet.h>
@@ -74,6 +75,7 @@
 #include "clixon_sig.h"
 #include "clixon_xml.h"
 #include "clixon_xml_io.h"
+#include "clixon_xml_bin.h"
 #include "clixon_options.h"
 #include "clixon_proto.h"
 
@@ -243,6 +245,41 @@ clicon_connect_unix(clicon_handle h,
     return retval;
 }
 
+/*! Open connection to server using an inet socket
+ * @param[in]  h        Clicon handle
+ * @param[in]  dst      IPv4 address
+ * @param[in]  port     TCP port
+ * @retval     s        socket
+ * @retval     -1       error
+ */
+int
+clicon_connect_inet(clicon_handle h,
+		    char         *dst,
+		    uint16_t      port)
+{
+    struct sockaddr_in addr;
+    int                s;
+
+    clicon_debug(2, "%s: connecting to %s:%hu", __FUNCTION__, dst, port);
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    if (inet_pton(addr.sin_family, dst, &addr.sin_addr) != 1){
+	clicon_err(OE_CFG, EINVAL, "Invalid IPv4 address: %s", dst);
+	return -1; /* Could check getaddrinfo */
+    }
+    if ((s = socket(addr.sin_family, SOCK_STREAM, 0)) < 0) {
+	clicon_err(OE_CFG, errno, "socket");
+	return -1;
+    }
+    if (connect(s, (struct sockaddr*)&addr, sizeof(addr)) < 0){
+	clicon_err(OE_CFG, errno, "connecting socket inet4");
+	close(s);
+	return -1;
+    }
+    return s;
+}
+
 static void
 atomicio_sig_handler(int arg)
 {
@@ -254,16 +291,20 @@ atomicio_sig_handler(int arg)
  * @param[in]  fd  File descriptor, eg socket
  * @param[in]  s0  Buffer to read to or write from
  * @param[in]  n   Number of bytes to read/write, loop until done
+ * @param[out] npos Number of bytes read/written, also on error (if not NULL)
  */
 static ssize_t
 atomicio(ssize_t (*fn) (int, void *, size_t), 
 	 int       fd, 
 	 void     *s0, 
-	 size_t    n)
+	 size_t    n,
+	 size_t   *npos)
 {
     char *s = s0;
     ssize_t res, pos = 0;
 
+    if (npos)
+	*npos = 0;
     while (n > pos) {
 	_atomicio_sig = 0;
 	res = (fn)(fd, s + pos, n - pos);
@@ -281,6 +322,8 @@ atomicio(ssize_t (*fn) (int, void *, size_t),
 	    return (res);
 	default:
 	    pos += res;
+	    if (npos)
+		*npos = pos;
 	}
     }
     return (pos);
@@ -301,7 +344,7 @@ msg_dump(struct clicon_msg *msg)
 	goto done;
     }
     cprintf(cb, "%s:", __FUNCTION__);
-    for (i=0; i<ntohl(msg->op_len); i++){
+    for (i=0; i<(ntohl(msg->op_len) & ~CLICON_MSG_FLAGS); i++){
 	cprintf(cb, "%02x", ((char*)msg)[i]&0xff);
 	if ((i+1)%32==0){
 	    clicon_debug(2, "%s", cbuf_get(cb));
@@ -320,22 +363,28 @@ msg_dump(struct clicon_msg *msg)
     return retval;
 }
 
-/*! Send a CLICON netconf message
+/*! Send a CLICON netconf message and report how much of it was written
  * @param[in]   s      socket (unix or inet) to communicate with backend
- * @param[out]  msg    CLICON msg data reply structure. Free with free()
+ * @param[in]   msg    CLICON msg data structure
+ * @param[out]  sent   Number of bytes of msg written, also on error (if not NULL)
+ * @retval      0      OK
+ * @retval     -1      Error
  */
-int
-clicon_msg_send(int                s, 
-		struct clicon_msg *msg)
+static int
+msg_send(int                s, 
+	 struct clicon_msg *msg,
+	 size_t            *sent)
 { 
-    int retval = -1;
+    int      retval = -1;
+    uint32_t len;
 
+    len = ntohl(msg->op_len) & ~CLICON_MSG_FLAGS;
     clicon_debug(2, "%s: send msg len=%d", 
-		 __FUNCTION__, ntohl(msg->op_len));
+		 __FUNCTION__, len);
     if (clicon_debug_get() > 2)
 	msg_dump(msg);
     if (atomicio((ssize_t (*)(int, void *, size_t))write, 
-		 s, msg, ntohl(msg->op_len)) < 0){
+		 s, msg, len, sent) < 0){
 	clicon_err(OE_CFG, errno, "atomicio");
 	clicon_log(LOG_WARNING, "%s: write: %s len:%u msg:%s", __FUNCTION__,
 		   strerror(errno), ntohs(msg->op_len), msg->op_body);
@@ -346,6 +395,150 @@ clicon_msg_send(int                s,
     return retval;
 }
 
+/*! Send a CLICON netconf message
+ * @param[in]   s      socket (unix or inet) to communicate with backend
+ * @param[out]  msg    CLICON msg data reply structure. Free with free()
+ */
+int
+clicon_msg_send(int                s, 
+		struct clicon_msg *msg)
+{ 
+    return msg_send(s, msg, NULL);
+}
+
+/*! Read a message header and a file descriptor passed with it, if any
+ * The descriptor is passed with the first byte of the header, see SCM_RIGHTS
+ * @param[in]   s    Unix socket
+ * @param[out]  hdr  Message header
+ * @param[out]  fd   Passed file descriptor, or -1
+ * @retval      n    Bytes read, 0 on eof
+ * @retval     -1    Error
+ */
+static ssize_t
+msg_rcv_hdr_fd(int                s,
+	       struct clicon_msg *hdr,
+	       int               *fd)
+{
+    struct msghdr   mh = {0,};
+    struct iovec    iov;
+    struct cmsghdr *cmsg;
+    char            ctrl[CMSG_SPACE(sizeof(int))];
+    ssize_t         n;
+    ssize_t         n2;
+    int             flags = 0;
+
+    *fd = -1;
+    iov.iov_base = hdr;
+    iov.iov_len = sizeof(*hdr);
+    mh.msg_iov = &iov;
+    mh.msg_iovlen = 1;
+    mh.msg_control = ctrl;
+    mh.msg_controllen = sizeof(ctrl);
+#ifdef MSG_CMSG_CLOEXEC
+    flags |= MSG_CMSG_CLOEXEC;
+#endif
+    while ((n = recvmsg(s, &mh, flags)) < 0 && errno == EINTR)
+	;
+    if (n < 0)
+	return errno == ECONNRESET ? 0 : -1;
+    if ((cmsg = CMSG_FIRSTHDR(&mh)) != NULL &&
+	cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_RIGHTS)
+	memcpy(fd, CMSG_DATA(cmsg), sizeof(int));
+    if (n > 0 && n < sizeof(*hdr)){
+	if ((n2 = atomicio(read, s, (char*)hdr + n, sizeof(*hdr) - n, NULL)) <= 0)
+	    return n2;
+	n += n2;
+    }
+    return n;
+}
+
+/*! Receive a CLICON message, and a file descriptor passed with it
+ * @param[in]   s      socket (unix or inet) to communicate with backend
+ * @param[out]  msg    CLICON msg data reply structure. Free with free()
+ * @param[out]  eof    Set if eof encountered
+ * @param[out]  fd     If not NULL, file descriptor passed with message, or -1
+ * @see clicon_msg_rcv
+ */
+static int
+msg_rcv(int                s,
+	struct clicon_msg **msg,
+	int                *eof,
+	int                *fd)
+{ 
+    int       retval = -1;
+    struct clicon_msg hdr;
+    struct clicon_msg *m;
+    int       hlen;
+    uint32_t  len2;
+    uint32_t  flen;
+    uint32_t  mlen = sizeof(hdr); /* Length of message received so far */
+    int       more = 1;
+
+    *eof = 0;
+    *msg = NULL;
+    while (more){
+	if (fd && *msg == NULL)
+	    hlen = msg_rcv_hdr_fd(s, &hdr, fd);
+	else
+	    hlen = atomicio(read, s, &hdr, sizeof(hdr), NULL);
+	if (hlen < 0){ 
+	    clicon_err(OE_CFG, errno, "atomicio");
+	    goto done;
+	}
+	if (hlen == 0){
+	    retval = 0;
+	    *eof = 1;
+	    goto done;
+	}
+	if (hlen != sizeof(hdr)){
+	    clicon_err(OE_CFG, errno, "header too short (%d)", hlen);
+	    goto done;
+	}
+	flen = ntohl(hdr.op_len);
+	more = (flen & CLICON_MSG_MORE) != 0;
+	flen &= ~CLICON_MSG_MORE;
+	clicon_debug(2, "%s: rcv msg len=%d%s",  
+		     __FUNCTION__, flen, more?" (more)":"");
+	if (flen < sizeof(hdr)){
+	    clicon_err(OE_CFG, EINVAL, "frame length too short (%u)", flen);
+	    goto done;
+	}
+	if ((m = (struct clicon_msg *)realloc(*msg, mlen + flen - sizeof(hdr))) == NULL){
+	    clicon_err(OE_CFG, errno, "realloc");
+	    goto done;
+	}
+	if (*msg == NULL)
+	    memcpy(m, &hdr, hlen);
+	*msg = m;
+	if (flen > sizeof(hdr)){
+	    if ((len2 = atomicio(read, s, (char*)m + mlen, flen - sizeof(hdr), NULL)) == 0){ 
+		clicon_err(OE_CFG, errno, "read");
+		goto done;
+	    }
+	    if (len2 != flen - sizeof(hdr)){
+		clicon_err(OE_CFG, errno, "body too short");
+		goto done;
+	    }
+	}
+	mlen += flen - sizeof(hdr);
+    }
+    (*msg)->op_len = htonl(mlen);
+    if (clicon_debug_get() > 1)
+	msg_dump(*msg);
+    retval = 0;
+  done:
+    if (retval < 0 || *eof){
+	if (*msg)
+	    free(*msg);
+	*msg = NULL;
+	if (fd && *fd != -1){
+	    close(*fd);
+	    *fd = -1;
+	}
+    }
+    return retval;
+}
+
 /*! Receive a CLICON message
  *
  * XXX: timeout? and signals?
@@ -356,6 +549,7 @@ clicon_msg_send(int                s,
  * behaviour.
  * Now, ^C will interrupt the whole process, and this may not be what you want.
  *
+ * A message sent in several frames (see CLICON_MSG_MORE) is received as one.
  * @param[in]   s      socket (unix or inet) to communicate with backend
  * @param[out]  msg    CLICON msg data reply structure. Free with free()
  * @param[out]  eof    Set if eof encountered
@@ -366,50 +560,12 @@ clicon_msg_rcv(int                s,
 	       struct clicon_msg **msg,
 	       int                *eof)
 { 
-    int       retval = -1;
-    struct clicon_msg hdr;
-    int       hlen;
-    uint32_t  len2;
-    sigfn_t   oldhandler;
-    uint32_t  mlen;
+    int     retval;
+    sigfn_t oldhandler;
 
-    *eof = 0;
     if (0)
 	set_signal(SIGINT, atomicio_sig_handler, &oldhandler);
-
-    if ((hlen = atomicio(read, s, &hdr, sizeof(hdr))) < 0){ 
-	clicon_err(OE_CFG, errno, "atomicio");
-	goto done;
-    }
-    if (hlen == 0){
-	retval = 0;
-	*eof = 1;
-	goto done;
-    }
-    if (hlen != sizeof(hdr)){
-	clicon_err(OE_CFG, errno, "header too short (%d)", hlen);
-	goto done;
-    }
-    mlen = ntohl(hdr.op_len);
-    clicon_debug(2, "%s: rcv msg len=%d",  
-		 __FUNCTION__, mlen);
-    if ((*msg = (struct clicon_msg *)malloc(mlen)) == NULL){
-	clicon_err(OE_CFG, errno, "malloc");
-	goto done;
-    }
-    memcpy(*msg, &hdr, hlen);
-    if ((len2 = atomicio(read, s, (*msg)->op_body, mlen - sizeof(hdr))) == 0){ 
- 	clicon_err(OE_CFG, errno, "read");
-	goto done;
-    }
-    if (len2 != mlen - sizeof(hdr)){
-	clicon_err(OE_CFG, errno, "body too short");
-	goto done;
-    }
-    if (clicon_debug_get() > 1)
-	msg_dump(*msg);
-    retval = 0;
-  done:
+    retval = msg_rcv(s, msg, eof, NULL);
     if (0)
 	set_signal(SIGINT, oldhandler, NULL);
     return retval;
@@ -455,7 +611,7 @@ clicon_rpc_connect_unix(clicon_handle      h,
 	*sock0 = s;
     retval = 0;
   done:
-    if (sock0 == NULL && s >= 0)
+    if ((sock0 == NULL || retval < 0) && s >= 0)
 	close(s);
     return retval;
 }
@@ -482,47 +638,66 @@ clicon_rpc_connect_inet(clicon_handle      h,
 {
     int                retval = -1;
     int                s = -1;
-    struct sockaddr_in addr;
 
     clicon_debug(1, "Send msg to %s:%hu", dst, port);
-
-    memset(&addr, 0, sizeof(addr));
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons(port);
-    if (inet_pton(addr.sin_family, dst, &addr.sin_addr) != 1)
-	goto done; /* Could check getaddrinfo */
-    
-    /* special error handling to get understandable messages (otherwise ENOENT) */
-    if ((s = socket(addr.sin_family, SOCK_STREAM, 0)) < 0) {
-	clicon_err(OE_CFG, errno, "socket");
-	return -1;
-    }
-    if (connect(s, (struct sockaddr*)&addr, sizeof(addr)) < 0){
-	clicon_err(OE_CFG, errno, "connecting socket inet4");
-	close(s);
+    if ((s = clicon_connect_inet(h, dst, port)) < 0)
 	goto done;
-    }
     if (clicon_rpc(s, msg, retdata) < 0)
 	goto done;
     if (sock0 != NULL)
 	*sock0 = s;
     retval = 0;
   done:
-    if (sock0 == NULL && s >= 0)
+    if ((sock0 == NULL || retval < 0) && s >= 0)
 	close(s);
     return retval;
 }
 
+/*! Copy data of a reply message
+ * @param[in]  reply   Reply message
+ * @param[out] ret     Null-terminated string or binary encoding. Free with free
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+static int
+rpc_reply_copy(struct clicon_msg *reply,
+	       char             **ret)
+{
+    char  *data;
+    size_t len;
+    size_t blen;
+
+    data = reply->op_body; /* assume string */
+    len = ntohl(reply->op_len) - sizeof(*reply);
+    if ((blen = clixon_xml_bin_len(data)) > 0){ /* binary encoding */
+	if (blen > len){
+	    clicon_err(OE_PROTO, EINVAL, "binary reply longer than message");
+	    return -1;
+	}
+	if ((*ret = malloc(blen)) == NULL){
+	    clicon_err(OE_UNIX, errno, "malloc");
+	    return -1;
+	}
+	memcpy(*ret, data, blen);
+    }
+    else if ((*ret = strdup(data)) == NULL){
+	clicon_err(OE_UNIX, errno, "strdup");
+	return -1;
+    }
+    return 0;
+}
+
 /*! Send a clicon_msg message and wait for result.
  *
  * TBD: timeout, interrupt?
  * retval may be -1 and
- * errno set to ENOTCONN which means that socket is now closed probably
- * due to remote peer disconnecting. The caller may have to do something,...
+ * errno set to ESHUTDOWN which means that the remote peer closed the socket
+ * The socket is not closed, the caller should close it.
  *
  * @param[in]  s       Socket to communicate with backend
  * @param[in]  msg     CLICON msg data structure. It has fixed header and variable body.
- * @param[out] xret    Returned data as netconf xml tree.
+ * @param[out] xret    Returned data as netconf xml string, or binary encoding if
+ *                     requested with CLICON_MSG_BINARY, see clixon_xml_bin_len
  * @retval     0       OK
  * @retval     -1      Error
  */
@@ -530,38 +705,183 @@ int
 clicon_rpc(int                   s, 
 	   struct clicon_msg    *msg, 
 	   char                **ret)
+{
+    return clicon_rpc_sent(s, msg, 0, ret, NULL, NULL);
+}
+
+/*! Send a clicon_msg message and wait for result, not in shared memory
+ * @see clicon_rpc
+ */
+static int
+rpc_plain(int                   s, 
+	  struct clicon_msg    *msg, 
+	  char                **ret,
+	  size_t               *sent)
 {
     int                retval = -1;
     struct clicon_msg *reply = NULL;
     int                eof;
-    char              *data = NULL;
-    cxobj             *cx = NULL;
 
-    if (clicon_msg_send(s, msg) < 0)
+    if (msg_send(s, msg, sent) < 0)
 	goto done;
     if (clicon_msg_rcv(s, &reply, &eof) < 0)
 	goto done;
     if (eof){
 	clicon_err(OE_PROTO, ESHUTDOWN, "Unexpected close of CLICON_SOCK. Clixon backend daemon may have crashed.");
-	close(s);
 	errno = ESHUTDOWN;
 	goto done;
     }
-    data = reply->op_body; /* assume string */
-    if (ret && data)
-	if ((*ret = strdup(data)) == NULL){
-	    clicon_err(OE_UNIX, errno, "strdup");
-	    goto done;
-	}
+    if (ret && rpc_reply_copy(reply, ret) < 0)
+	goto done;
+    retval = 0;
+  done:
+    if (reply)
+	free(reply);
+    return retval;
+}
+
+/*! Map reply data passed in shared memory
+ * @param[in]  reply   Reply message with struct clicon_msg_shm body
+ * @param[in]  fd      Shared memory file descriptor passed with reply
+ * @param[out] ret     Reply data, mapped read-only
+ * @param[out] maplen  Length of mapping
+ * @retval     1       OK, ret and maplen set
+ * @retval     0       Reply is not in shared memory
+ * @retval    -1       Error
+ */
+static int
+rpc_reply_map(struct clicon_msg *reply,
+	      int                fd,
+	      char             **ret,
+	      size_t            *maplen)
+{
+    struct clicon_msg_shm *ms;
+    struct stat            st;
+    size_t                 len;
+    size_t                 blen;
+    char                  *p;
+
+    if (ntohl(reply->op_len) < sizeof(*reply) + sizeof(*ms))
+	return 0;
+    ms = (struct clicon_msg_shm *)reply->op_body;
+    if (memcmp(ms->ms_magic, CLICON_MSG_SHM_MAGIC, sizeof(ms->ms_magic)) != 0)
+	return 0;
+    len = ntohl(ms->ms_len);
+    if (fstat(fd, &st) < 0){
+	clicon_err(OE_UNIX, errno, "fstat");
+	return -1;
+    }
+    if (len == 0 || st.st_size < len){
+	clicon_err(OE_PROTO, EINVAL, "shared memory reply length %zu", len);
+	return -1;
+    }
+    if ((p = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0)) == MAP_FAILED){
+	clicon_err(OE_UNIX, errno, "mmap");
+	return -1;
+    }
+    /* The data is a binary encoding or a null-terminated string */
+    blen = clixon_xml_bin_len(p);
+    if (blen ? blen > len : p[len-1] != '\0'){
+	munmap(p, len);
+	clicon_err(OE_PROTO, EINVAL, "shared memory reply truncated");
+	return -1;
+    }
+    *ret = p;
+    *maplen = len;
+    return 1;
+}
+
+/*! Send a clicon_msg message and wait for result, which may be in shared memory
+ *
+ * As clicon_rpc, but the backend may pass a large reply in shared memory instead
+ * of over the socket, see CLICON_MSG_SHM. The shared memory is mapped read-only
+ * so that the reply data is not copied. Only for unix sockets.
+ * @param[in]  s       Unix socket to communicate with backend
+ * @param[in]  msg     CLICON msg data structure. It has fixed header and variable body.
+ * @param[out] ret     Returned data as in clicon_rpc
+ * @param[out] maplen  If >0 ret is mapped shared memory of this length: release with
+ *                     munmap. If 0, free ret with free
+ * @retval     0       OK
+ * @retval     -1      Error
+ * @see clicon_rpc
+ */
+int
+clicon_rpc_shm(int                   s, 
+	       struct clicon_msg    *msg, 
+	       char                **ret,
+	       size_t               *maplen)
+{
+    return clicon_rpc_sent(s, msg, 1, ret, maplen, NULL);
+}
+
+/*! Send a clicon_msg message and wait for result, which may be in shared memory
+ * @see clicon_rpc_shm
+ */
+static int
+rpc_shm(int                   s, 
+	struct clicon_msg    *msg, 
+	char                **ret,
+	size_t               *maplen,
+	size_t               *sent)
+{
+    int                retval = -1;
+    struct clicon_msg *reply = NULL;
+    int                eof;
+    int                fd = -1;
+    int                ret1 = 0;
+
+    *maplen = 0;
+    msg->op_len = htonl(ntohl(msg->op_len) | CLICON_MSG_SHM);
+    if (msg_send(s, msg, sent) < 0)
+	goto done;
+    if (msg_rcv(s, &reply, &eof, &fd) < 0)
+	goto done;
+    if (eof){
+	clicon_err(OE_PROTO, ESHUTDOWN, "Unexpected close of CLICON_SOCK. Clixon backend daemon may have crashed.");
+	errno = ESHUTDOWN;
+	goto done;
+    }
+    if (fd != -1 && (ret1 = rpc_reply_map(reply, fd, ret, maplen)) < 0)
+	goto done;
+    if (ret1 == 0 && ret && rpc_reply_copy(reply, ret) < 0)
+	goto done;
     retval = 0;
   done:
-    if (cx)
-	xml_free(cx);
+    msg->op_len = htonl(ntohl(msg->op_len) & ~CLICON_MSG_SHM);
+    if (fd != -1)
+	close(fd);
     if (reply)
 	free(reply);
     return retval;
 }
 
+/*! Send a clicon_msg message and wait for result, report how much of it was sent
+ *
+ * As clicon_rpc, or clicon_rpc_shm if shm is set. For callers that may send the
+ * message again on another connection after an error: that is only safe if none
+ * of it was written, otherwise the backend may have received and executed it.
+ * @param[in]  s       Socket to communicate with backend
+ * @param[in]  msg     CLICON msg data structure. It has fixed header and variable body.
+ * @param[in]  shm     Accept reply in shared memory, see clicon_rpc_shm
+ * @param[out] ret     Returned data as in clicon_rpc
+ * @param[out] maplen  As in clicon_rpc_shm, may be NULL if shm is not set
+ * @param[out] sent    Number of bytes of msg written, also on error (if not NULL)
+ * @retval     0       OK
+ * @retval     -1      Error
+ */
+int
+clicon_rpc_sent(int                   s, 
+		struct clicon_msg    *msg, 
+		int                   shm,
+		char                **ret,
+		size_t               *maplen,
+		size_t               *sent)
+{
+    if (shm)
+	return rpc_shm(s, msg, ret, maplen, sent);
+    return rpc_plain(s, msg, ret, sent);
+}
+
 /*! Send a clicon_msg message as reply to a clicon rpc request
  *
  * @param[in]  s       Socket to communicate with client
@@ -48,10 +48,13 @@
 #include <string.h>
 #include <errno.h>
 #include <assert.h>
+#include <signal.h>
+#include <poll.h>
 #include <unistd.h>
 #include <sys/param.h>
 #include <sys/stat.h>
 #include <sys/socket.h>
+#include <sys/mman.h>
 #include <sys/syslog.h>
 
 /* cligen */
@@ -73,40 +76,202 @@
 #include "clixon_xpath.h"
 #include "clixon_proto.h"
 #include "clixon_err.h"
+#include "clixon_sig.h"
+#include "clixon_event.h"
 #include "clixon_stream.h"
 #include "clixon_err_string.h"
 #include "clixon_xml_nsctx.h"
 #include "clixon_xml_bind.h"
 #include "clixon_xml_sort.h"
 #include "clixon_xml_io.h"
+#include "clixon_xml_bin.h"
+#include "clixon_xml_page.h"
 #include "clixon_netconf_lib.h"
+#include "clixon_json.h"
 #include "clixon_proto_client.h"
 
-/*! Send internal netconf rpc from client to backend
- * @param[in]    h      CLICON handle
- * @param[in]    msg    Encoded message. Deallocate with free
- * @param[out]   xret0  Return value from backend as xml tree. Free w xml_free
- * @param[inout] sock0  If pointer exists, do not close socket to backend on success 
- *                      and return it here. For keeping a notify socket open
- * @note sock0 is if connection should be persistent, like a notification/subscribe api
- * @note xret is populated with yangspec according to standard handle yangspec
+/*! Open a connection to the backend according to CLICON_SOCK and CLICON_SOCK_FAMILY
+ * @param[in]  h   CLICON handle
+ * @retval     s   Socket
+ * @retval    -1   Error
+ */
+static int
+clicon_rpc_connect(clicon_handle h)
+{
+    char       *sock;
+    int         port;
+    struct stat sb;
+
+    if ((sock = clicon_sock(h)) == NULL){
+	clicon_err(OE_FATAL, 0, "CLICON_SOCK option not set");
+	return -1;
+    }
+    switch (clicon_sock_family(h)){
+    case AF_UNIX:
+	/* special error handling to get understandable messages (otherwise ENOENT) */
+	if (stat(sock, &sb) < 0){
+	    clicon_err(OE_PROTO, errno, "%s: config daemon not running?", sock);
+	    return -1;
+	}
+	if (!S_ISSOCK(sb.st_mode)){
+	    clicon_err(OE_PROTO, EIO, "%s: Not unix socket", sock);
+	    return -1;
+	}
+	return clicon_connect_unix(h, sock);
+    case AF_INET:
+	if ((port = clicon_sock_port(h)) < 0){
+	    clicon_err(OE_FATAL, 0, "CLICON_SOCK_PORT not set");
+	    return -1;
+	}
+	return clicon_connect_inet(h, sock, port);
+    }
+    clicon_err(OE_FATAL, 0, "Unsupported CLICON_SOCK_FAMILY");
+    return -1;
+}
+
+/*! Send a message on the persistent backend connection of the handle and wait for reply
+ *
+ * The connection is opened on first use and then kept open.
+ * If a kept connection has been closed by the backend, eg due to restart or
+ * kill-session, it is detected before sending and a new connection is opened.
+ * If sending then fails on a reused connection before any of the message was
+ * written, the message is sent again on a new connection. Any other send or
+ * receive error is returned: the backend may have received and executed the
+ * message, and sending it again could execute it twice.
+ * @param[in]  h       CLICON handle
+ * @param[in]  msg     Encoded message
+ * @param[in]  shm     Accept reply in shared memory, see clicon_rpc_shm
+ * @param[out] retdata Reply as string. Free with free, or munmap if maplen > 0
+ * @param[out] maplen  Length of reply in mapped shared memory, or 0
+ * @retval     0       OK
+ * @retval    -1       Error
+ * @see clicon_rpc_close  Close the connection
+ */
+static int
+clicon_rpc_persistent(clicon_handle      h, 
+		      struct clicon_msg *msg,
+		      int                shm,
+		      char             **retdata,
+		      size_t            *maplen)
+{
+    int     retval = -1;
+    int     s;
+    int     reused = 0;
+    size_t  sent = 0;
+    sigfn_t oldhandler;
+    int     ret;
+
+    if ((s = clicon_client_socket_get(h)) >= 0){
+	/* An idle connection should have nothing to read, if it has the backend
+	 * closed it */
+	if ((ret = clixon_event_poll(s)) < 0)
+	    goto done;
+	if (ret > 0){
+	    clicon_debug(1, "%s backend connection closed, reconnect", __FUNCTION__);
+	    close(s);
+	    clicon_client_socket_set(h, -1);
+	    s = -1;
+	}
+	else
+	    reused++;
+    }
+    /* Write errors on a closed connection are handled below instead of by SIGPIPE */
+    if (set_signal(SIGPIPE, SIG_IGN, &oldhandler) < 0)
+	goto done;
+    while (1){
+	if (s < 0){
+	    if ((s = clicon_rpc_connect(h)) < 0)
+		goto restore;
+	    if (clicon_client_socket_set(h, s) < 0){
+		close(s);
+		goto restore;
+	    }
+	}
+	if (clicon_rpc_sent(s, msg, shm, retdata, maplen, &sent) == 0)
+	    break;
+	close(s);
+	clicon_client_socket_set(h, -1);
+	s = -1;
+	if (!reused || sent > 0)
+	    goto restore;
+	clicon_debug(1, "%s backend connection closed before send, reconnect", __FUNCTION__);
+	clicon_err_reset();
+	reused = 0;
+    }
+    retval = 0;
+ restore:
+    set_signal(SIGPIPE, oldhandler, NULL);
+ done:
+    return retval;
+}
+
+/*! Close the persistent and asynchronous backend connections of the handle, if any
+ * @param[in]  h   CLICON handle
+ * @retval     0   OK
+ * @see clicon_rpc_persistent
+ * @see clicon_rpc_async_close
  */
 int
-clicon_rpc_msg(clicon_handle      h, 
-	       struct clicon_msg *msg, 
-	       cxobj            **xret0,
-	       int               *sock0)
+clicon_rpc_close(clicon_handle h)
+{
+    int s;
+
+    if ((s = clicon_client_socket_get(h)) >= 0){
+	close(s);
+	clicon_client_socket_set(h, -1);
+    }
+    clicon_rpc_async_close(h);
+    return 0;
+}
+
+/*! Send internal netconf rpc from client to backend and return the reply unparsed
+ * @param[in]    h       CLICON handle
+ * @param[in]    msg     Encoded message. Deallocate with free
+ * @param[out]   retdata Reply body: XML text, binary encoding or JSON. Free with
+ *                       munmap if maplen is set, else with free
+ * @param[out]   maplen  Length of mapping if reply is in shared memory, else 0
+ * @param[inout] sock0   See clicon_rpc_msg
+ * @retval       0       OK
+ * @retval      -1       Error
+ * @see clicon_rpc_msg
+ */
+static int
+rpc_msg_send(clicon_handle      h, 
+	     struct clicon_msg *msg, 
+	     char             **retdata,
+	     size_t            *maplen,
+	     int               *sock0)
 {
     int                retval = -1;
     char              *sock;
     int                port;
-    char              *retdata = NULL;
-    cxobj             *xret = NULL;
+    int                shm;
+    int                s;
 
 #ifdef RPC_USERNAME_ASSERT
     assert(strstr(msg->op_body, "username")!=NULL); /* XXX */
 #endif
     clicon_debug(1, "%s request:%s", __FUNCTION__, msg->op_body);
+    /* Ask for binary reply, the backend decides if it is used */
+    if (clicon_client_binary_get(h))
+	msg->op_len = htonl(ntohl(msg->op_len) | CLICON_MSG_BINARY);
+    shm = sock0 == NULL && clicon_sock_family(h) == AF_UNIX &&
+	clicon_option_bool(h, "CLICON_CLIENT_SHM");
+    if (sock0 == NULL && clicon_option_bool(h, "CLICON_CLIENT_PERSISTENT")){
+	if (clicon_rpc_persistent(h, msg, shm, retdata, maplen) < 0)
+	    goto done;
+	goto ok;
+    }
+    if (shm){
+	if ((s = clicon_rpc_connect(h)) < 0)
+	    goto done;
+	if (clicon_rpc_shm(s, msg, retdata, maplen) < 0){
+	    close(s);
+	    goto done;
+	}
+	close(s);
+	goto ok;
+    }
     if ((sock = clicon_sock(h)) == NULL){
 	clicon_err(OE_FATAL, 0, "CLICON_SOCK option not set");
 	goto done;
@@ -114,7 +279,7 @@ clicon_rpc_msg(clicon_handle      h,
     /* What to do if inet socket? */
     switch (clicon_sock_family(h)){
     case AF_UNIX:
-	if (clicon_rpc_connect_unix(h, msg, sock, &retdata, sock0) < 0){
+	if (clicon_rpc_connect_unix(h, msg, sock, retdata, sock0) < 0){
 #if 0
 	    if (errno == ESHUTDOWN)
 		/* Maybe could reconnect on a higher layer, but lets fail
@@ -133,26 +298,116 @@ clicon_rpc_msg(clicon_handle      h,
 	    clicon_err(OE_FATAL, 0, "CLICON_SOCK_PORT not set");
 	    goto done;
 	}
-	if (clicon_rpc_connect_inet(h, msg, sock, port, &retdata, sock0) < 0)
+	if (clicon_rpc_connect_inet(h, msg, sock, port, retdata, sock0) < 0)
 	    goto done;
 	break;
     }
-    clicon_debug(1, "%s retdata:%s", __FUNCTION__, retdata);
+ ok:
+    retval = 0;
+ done:
+    msg->op_len = htonl(ntohl(msg->op_len) & ~CLICON_MSG_BINARY);
+    return retval;
+}
+
+/*! Parse a reply body from the backend to an XML tree
+ * A raw JSON reply is given as <rpc-reply><data encoding="json">, with the JSON 
+ * text as body, see clicon_rpc_get_json
+ * @param[in]  retdata Reply body: XML text, binary encoding or JSON, or NULL
+ * @param[out] xret    XML tree, or NULL if no reply. Free with xml_free
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+static int
+rpc_msg_parse(char   *retdata,
+	      cxobj **xret)
+{
+    int    retval = -1;
+    size_t blen;
+    cxobj *xr;
+    cxobj *xd;
+    cxobj *xa;
+    cxobj *xb;
+    char  *json;
 
-    if (retdata){
-	/* Cannot populate xret here because need to know RPC name (eg "lock") in order to associate yang
-	 * to reply.
-	 */
-	if (clixon_xml_parse_string(retdata, YB_NONE, NULL, &xret, NULL) < 0)
+    if ((blen = clixon_xml_bin_len(retdata)) > 0){
+	clicon_debug(1, "%s retdata: binary len:%zu", __FUNCTION__, blen);
+	if (clixon_xml_parse_bin(retdata, blen, xret) < 0)
+	    goto done;
+    }
+    else if (retdata && strncmp(retdata, CLICON_MSG_JSON_MAGIC, strlen(CLICON_MSG_JSON_MAGIC)) == 0){
+	json = retdata + strlen(CLICON_MSG_JSON_MAGIC);
+	clicon_debug(1, "%s retdata: json:%s", __FUNCTION__, json);
+	if ((*xret = xml_new("top", NULL, CX_ELMNT)) == NULL)
+	    goto done;
+	if ((xr = xml_new("rpc-reply", *xret, CX_ELMNT)) == NULL)
+	    goto done;
+	if (xmlns_set(xr, NULL, NETCONF_BASE_NAMESPACE) < 0)
+	    goto done;
+	if ((xd = xml_new("data", xr, CX_ELMNT)) == NULL)
+	    goto done;
+	if ((xa = xml_new("encoding", xd, CX_ATTR)) == NULL)
+	    goto done;
+	if (xml_value_set(xa, "json") < 0)
 	    goto done;
+	if (*json){
+	    if ((xb = xml_new("body", xd, CX_BODY)) == NULL)
+		goto done;
+	    if (xml_value_set(xb, json) < 0)
+		goto done;
+	}
     }
+    else if (retdata){
+	clicon_debug(1, "%s retdata:%s", __FUNCTION__, retdata);
+	if (clixon_xml_parse_string(retdata, YB_NONE, NULL, xret, NULL) < 0)
+	    goto done;
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Send internal netconf rpc from client to backend
+ * @param[in]    h      CLICON handle
+ * @param[in]    msg    Encoded message. Deallocate with free
+ * @param[out]   xret0  Return value from backend as xml tree. Free w xml_free
+ * @param[inout] sock0  If pointer exists, do not close socket to backend on success 
+ *                      and return it here. For keeping a notify socket open
+ * @note sock0 is if connection should be persistent, like a notification/subscribe api
+ * @note xret is populated with yangspec according to standard handle yangspec
+ * @note If CLICON_CLIENT_PERSISTENT is set and sock0 is NULL, one connection per handle
+ *       is used for all messages, otherwise a new connection is made per message
+ * @note If binary encoding has been negotiated in hello, the reply may be binary 
+ *       encoded instead of XML text, see clicon_client_binary_get
+ * @note If CLICON_CLIENT_SHM is set and sock0 is NULL, a large reply on a unix socket
+ *       may be passed in shared memory, see clicon_rpc_shm
+ */
+int
+clicon_rpc_msg(clicon_handle      h, 
+	       struct clicon_msg *msg, 
+	       cxobj            **xret0,
+	       int               *sock0)
+{
+    int                retval = -1;
+    char              *retdata = NULL;
+    size_t             maplen = 0;
+    cxobj             *xret = NULL;
+
+    if (rpc_msg_send(h, msg, &retdata, &maplen, sock0) < 0)
+	goto done;
+    /* Cannot populate xret here because need to know RPC name (eg "lock") in order to associate yang
+     * to reply.
+     */
+    if (rpc_msg_parse(retdata, &xret) < 0)
+	goto done;
     if (xret0){
 	*xret0 = xret;
 	xret = NULL;
     }
     retval = 0;
  done:
-    if (retdata)
+    if (maplen)
+	munmap(retdata, maplen);
+    else if (retdata)
 	free(retdata);
     if (xret)
 	xml_free(xret);
@@ -160,7 +415,8 @@ clicon_rpc_msg(clicon_handle      h,
 }
 
 /*! Check if there is a valid (cached) session-id. If not, send a hello request to backend 
- * Session-ids survive TCP sessions that are created for each message sent to the backend.
+ * Session-ids survive TCP sessions, which are created for each message sent to the backend
+ * unless CLICON_CLIENT_PERSISTENT is set.
  * Clients use two approaches, either:
  * (1) Once at the beginning of the session. Netconf and restconf does this
  * (2) First usage, ie "lazy" evaluation when first needed
@@ -280,6 +536,416 @@ clicon_rpc_netconf_xml(clicon_handle  h,
     return retval;
 }
 
+/*
+ * Asynchronous RPC
+ * Many requests may be sent on one backend connection without waiting for the
+ * replies. The backend handles the messages of a connection one at a time and
+ * replies in the same order, so a reply is matched with the oldest pending
+ * request. Replies are delivered to callbacks, either from the event loop
+ * (the connection is registered with clixon_event_reg_fd) or from
+ * clicon_rpc_async_wait.
+ * The asynchronous connection is separate from the synchronous (persistent) one.
+ */
+
+/* One asynchronous request */
+struct rpc_async_req {
+    struct rpc_async_req *rr_next;  /* Next request in pending or done queue */
+    uint32_t              rr_id;    /* Request id */
+    clicon_rpc_async_cb  *rr_fn;    /* Completion callback */
+    void                 *rr_arg;   /* Callback argument */
+    struct clicon_msg    *rr_reply; /* Reply message, set when done */
+};
+
+/* Asynchronous connection state of a handle */
+struct rpc_async {
+    int                   ra_s;         /* Socket to backend, -1 if not connected */
+    uint32_t              ra_id;        /* Last request id */
+    struct rpc_async_req *ra_pending;   /* Sent requests waiting for reply, oldest first */
+    struct rpc_async_req *ra_pendlast;  /* Last in ra_pending */
+    struct rpc_async_req *ra_done;      /* Replied requests waiting for callback */
+    struct rpc_async_req *ra_donelast;  /* Last in ra_done */
+};
+
+static int rpc_async_input(int s, void *arg);
+
+/*! Get asynchronous connection state of handle, create if not exist
+ */
+static struct rpc_async *
+rpc_async_get(clicon_handle h,
+	      int           create)
+{
+    clicon_hash_t    *cdat = clicon_data(h);
+    struct rpc_async *ra = NULL;
+    void             *p;
+
+    if ((p = clicon_hash_value(cdat, "rpc-async", NULL)) != NULL)
+	return *(struct rpc_async **)p;
+    if (!create)
+	return NULL;
+    if ((ra = malloc(sizeof(*ra))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	return NULL;
+    }
+    memset(ra, 0, sizeof(*ra));
+    ra->ra_s = -1;
+    if (clicon_hash_add(cdat, "rpc-async", &ra, sizeof(ra)) == NULL){
+	free(ra);
+	return NULL;
+    }
+    return ra;
+}
+
+/*! Call callbacks of replied requests in order
+ * A request is removed from the queue before its callback is called, so callbacks
+ * may send new requests.
+ * @retval  0  OK
+ * @retval -1  Error in callback or reply parsing
+ */
+static int
+rpc_async_dispatch(clicon_handle     h,
+		   struct rpc_async *ra)
+{
+    int                   retval = -1;
+    struct rpc_async_req *rr;
+    cxobj                *xret = NULL;
+
+    while ((rr = ra->ra_done) != NULL){
+	if ((ra->ra_done = rr->rr_next) == NULL)
+	    ra->ra_donelast = NULL;
+	if (rr->rr_reply && rr->rr_reply->op_body[0] != '\0')
+	    if (clixon_xml_parse_string(rr->rr_reply->op_body, YB_NONE, NULL, &xret, NULL) < 0)
+		goto done;
+	clicon_debug(1, "%s reply id:%u", __FUNCTION__, rr->rr_id);
+	if (rr->rr_fn(h, rr->rr_id, xret, rr->rr_arg) < 0)
+	    goto done;
+	if (xret){
+	    xml_free(xret);
+	    xret = NULL;
+	}
+	if (rr->rr_reply)
+	    free(rr->rr_reply);
+	free(rr);
+    }
+    retval = 0;
+ done:
+    if (retval < 0){
+	if (rr->rr_reply)
+	    free(rr->rr_reply);
+	free(rr);
+    }
+    if (xret)
+	xml_free(xret);
+    return retval;
+}
+
+/*! Close asynchronous connection, pending requests are completed without reply
+ */
+static void
+rpc_async_disconnect(struct rpc_async *ra)
+{
+    struct rpc_async_req *rr;
+
+    if (ra->ra_s != -1){
+	clixon_event_unreg_fd(ra->ra_s, rpc_async_input);
+	close(ra->ra_s);
+	ra->ra_s = -1;
+    }
+    /* Move pending requests last to done queue with NULL reply */
+    while ((rr = ra->ra_pending) != NULL){
+	ra->ra_pending = rr->rr_next;
+	rr->rr_next = NULL;
+	if (ra->ra_donelast)
+	    ra->ra_donelast->rr_next = rr;
+	else
+	    ra->ra_done = rr;
+	ra->ra_donelast = rr;
+    }
+    ra->ra_pendlast = NULL;
+}
+
+/*! Read one reply from backend and move the oldest pending request to done queue
+ * Callbacks are not called.
+ * On close, all pending requests are moved to done with no reply.
+ * @retval  0  OK
+ * @retval -1  Error
+ */
+static int
+rpc_async_read(struct rpc_async *ra)
+{
+    struct clicon_msg    *reply = NULL;
+    struct rpc_async_req *rr;
+    int                   eof = 0;
+
+    if (clicon_msg_rcv(ra->ra_s, &reply, &eof) < 0)
+	return -1;
+    if (eof){
+	clicon_log(LOG_WARNING, "%s: Unexpected close of CLICON_SOCK", __FUNCTION__);
+	rpc_async_disconnect(ra);
+	return 0;
+    }
+    if ((rr = ra->ra_pending) == NULL){
+	clicon_log(LOG_WARNING, "%s: Unexpected reply from backend", __FUNCTION__);
+	free(reply);
+	return 0;
+    }
+    if ((ra->ra_pending = rr->rr_next) == NULL)
+	ra->ra_pendlast = NULL;
+    rr->rr_next = NULL;
+    rr->rr_reply = reply;
+    if (ra->ra_donelast)
+	ra->ra_donelast->rr_next = rr;
+    else
+	ra->ra_done = rr;
+    ra->ra_donelast = rr;
+    return 0;
+}
+
+/*! Event loop callback: reply on asynchronous connection
+ */
+static int
+rpc_async_input(int   s,
+		void *arg)
+{
+    clicon_handle     h = (clicon_handle)arg;
+    struct rpc_async *ra;
+
+    if ((ra = rpc_async_get(h, 0)) == NULL)
+	return 0;
+    if (rpc_async_read(ra) < 0)
+	return -1;
+    return rpc_async_dispatch(h, ra);
+}
+
+/*! Send a message on the asynchronous connection without blocking on replies
+ * While the socket is not writable, replies are read so that the backend is not
+ * blocked in writing them.
+ * @retval  0  OK
+ * @retval -1  Error, connection closed
+ */
+static int
+rpc_async_send(struct rpc_async  *ra,
+	       struct clicon_msg *msg)
+{
+    int            retval = -1;
+    char          *buf = (char *)msg;
+    size_t         len = ntohl(msg->op_len);
+    size_t         off = 0;
+    ssize_t        n;
+    struct pollfd  pfd;
+    sigfn_t        oldhandler;
+
+    /* Write errors on a closed connection are handled below instead of by SIGPIPE */
+    if (set_signal(SIGPIPE, SIG_IGN, &oldhandler) < 0)
+	return -1;
+    while (off < len){
+	pfd.fd = ra->ra_s;
+	pfd.events = POLLOUT | (ra->ra_pending ? POLLIN : 0);
+	pfd.revents = 0;
+	if (poll(&pfd, 1, -1) < 0){
+	    if (errno == EINTR)
+		continue;
+	    clicon_err(OE_PROTO, errno, "poll");
+	    goto done;
+	}
+	if (ra->ra_pending && (pfd.revents & (POLLIN|POLLHUP))){
+	    if (rpc_async_read(ra) < 0)
+		goto done;
+	    if (ra->ra_s == -1){
+		clicon_err(OE_PROTO, ESHUTDOWN, "Unexpected close of CLICON_SOCK");
+		goto done;
+	    }
+	    continue;
+	}
+	if ((n = send(ra->ra_s, buf+off, len-off, MSG_DONTWAIT)) < 0){
+	    if (errno == EINTR || errno == EAGAIN || errno == EWOULDBLOCK)
+		continue;
+	    clicon_err(OE_PROTO, errno, "send");
+	    goto done;
+	}
+	off += n;
+    }
+    retval = 0;
+ done:
+    set_signal(SIGPIPE, oldhandler, NULL);
+    if (retval < 0)
+	rpc_async_disconnect(ra);
+    return retval;
+}
+
+/*! Send a message to backend asynchronously, the reply is given to a callback
+ *
+ * The message is sent on an asynchronous connection of the handle, which is
+ * opened on first use and registered in the event loop.
+ * The callback is called with the reply when it arrives, from the event loop or
+ * clicon_rpc_async_wait. If the connection is closed before the reply, the
+ * callback is called with xret set to NULL.
+ * @param[in]  h      CLICON handle
+ * @param[in]  msg    Encoded message. Deallocate with free
+ * @param[in]  fn     Callback called with reply
+ * @param[in]  arg    Argument to callback
+ * @param[out] reqid  Request id, also given to callback (if not NULL)
+ * @retval     0      OK, request sent
+ * @retval    -1      Error
+ * @code
+ *   int cb(clicon_handle h, uint32_t reqid, cxobj *xret, void *arg){
+ *      ...
+ *   }
+ *   for (i=0; i<n; i++)
+ *      if (clicon_rpc_async(h, msg[i], cb, NULL, NULL) < 0)
+ *         err;
+ *   if (clicon_rpc_async_wait(h, 0) < 0)
+ *      err;
+ * @endcode
+ * @see clicon_rpc_msg  for synchronous rpc
+ */
+int
+clicon_rpc_async(clicon_handle        h,
+		 struct clicon_msg   *msg,
+		 clicon_rpc_async_cb *fn,
+		 void                *arg,
+		 uint32_t            *reqid)
+{
+    int                   retval = -1;
+    struct rpc_async     *ra;
+    struct rpc_async_req *rr = NULL;
+
+    clicon_debug(1, "%s request:%s", __FUNCTION__, msg->op_body);
+    if ((ra = rpc_async_get(h, 1)) == NULL)
+	goto done;
+    if (ra->ra_s == -1){
+	if ((ra->ra_s = clicon_rpc_connect(h)) < 0)
+	    goto done;
+	if (clixon_event_reg_fd(ra->ra_s, rpc_async_input, h, "backend async rpc") < 0){
+	    close(ra->ra_s);
+	    ra->ra_s = -1;
+	    goto done;
+	}
+    }
+    if ((rr = malloc(sizeof(*rr))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    memset(rr, 0, sizeof(*rr));
+    rr->rr_id = ++ra->ra_id;
+    rr->rr_fn = fn;
+    rr->rr_arg = arg;
+    if (rpc_async_send(ra, msg) < 0)
+	goto done;
+    /* Sent: append to pending queue */
+    if (ra->ra_pendlast)
+	ra->ra_pendlast->rr_next = rr;
+    else
+	ra->ra_pending = rr;
+    ra->ra_pendlast = rr;
+    if (reqid)
+	*reqid = rr->rr_id;
+    rr = NULL;
+    /* Deliver replies read while sending */
+    if (rpc_async_dispatch(h, ra) < 0)
+	goto done;
+    retval = 0;
+ done:
+    if (rr)
+	free(rr);
+    return retval;
+}
+
+/*! Send a netconf rpc as string to backend asynchronously
+ * @param[in]  h      CLICON handle
+ * @param[in]  xmlstr XML netconf tree as string
+ * @param[in]  fn     Callback called with reply
+ * @param[in]  arg    Argument to callback
+ * @param[out] reqid  Request id, also given to callback (if not NULL)
+ * @retval     0      OK, request sent
+ * @retval    -1      Error
+ * @see clicon_rpc_netconf  synchronous version
+ */
+int
+clicon_rpc_netconf_async(clicon_handle        h, 
+			 char                *xmlstr,
+			 clicon_rpc_async_cb *fn,
+			 void                *arg,
+			 uint32_t            *reqid)
+{
+    int                retval = -1;
+    uint32_t           session_id;
+    struct clicon_msg *msg = NULL;
+
+    if (session_id_check(h, &session_id) < 0)
+	goto done;
+    if ((msg = clicon_msg_encode(session_id, "%s", xmlstr)) == NULL)
+	goto done;
+    if (clicon_rpc_async(h, msg, fn, arg, reqid) < 0)
+	goto done;
+    retval = 0;
+ done:
+    if (msg)
+	free(msg);
+    return retval;
+}
+
+/*! Wait for replies of asynchronous requests and call their callbacks
+ * @param[in]  h      CLICON handle
+ * @param[in]  reqid  Wait until this request (and all before) is done, or 0 for all
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+int
+clicon_rpc_async_wait(clicon_handle h,
+		      uint32_t      reqid)
+{
+    struct rpc_async *ra;
+
+    if ((ra = rpc_async_get(h, 0)) == NULL)
+	return 0;
+    while (ra->ra_pending != NULL &&
+	   (reqid == 0 || ra->ra_pending->rr_id <= reqid))
+	if (rpc_async_read(ra) < 0)
+	    return -1;
+    return rpc_async_dispatch(h, ra);
+}
+
+/*! Get number of asynchronous requests waiting for reply
+ * @param[in]  h      CLICON handle
+ * @retval     n      Number of pending requests
+ */
+int
+clicon_rpc_async_pending(clicon_handle h)
+{
+    struct rpc_async     *ra;
+    struct rpc_async_req *rr;
+    int                   n = 0;
+
+    if ((ra = rpc_async_get(h, 0)) == NULL)
+	return 0;
+    for (rr = ra->ra_pending; rr; rr = rr->rr_next)
+	n++;
+    return n;
+}
+
+/*! Close asynchronous connection and free its state
+ * Callbacks of pending requests are called with no reply.
+ * @param[in]  h      CLICON handle
+ * @retval     0      OK
+ * @retval    -1      Error in callback
+ */
+int
+clicon_rpc_async_close(clicon_handle h)
+{
+    int               retval;
+    struct rpc_async *ra;
+
+    if ((ra = rpc_async_get(h, 0)) == NULL)
+	return 0;
+    rpc_async_disconnect(ra);
+    retval = rpc_async_dispatch(h, ra);
+    while (ra->ra_done) /* If dispatch failed */
+	rpc_async_dispatch(h, ra);
+    clicon_hash_del(clicon_data(h), "rpc-async");
+    free(ra);
+    return retval;
+}
+
 
 /*! Get database configuration
  * Same as clicon_proto_change just with a cvec instead of lvec
@@ -771,6 +1437,310 @@ clicon_rpc_get(clicon_handle   h,
     return retval;
 }
 
+/*! Get configuration and state data encoded as RFC 7951 JSON by the backend
+ *
+ * Clixon extension: encoding and pretty attributes on get. The backend replies with
+ * a raw JSON payload (CLICON_MSG_JSON_MAGIC and the text given by xml2json_cbuf_xpath)
+ * that is copied as is, so the reply is not parsed as XML nor bound to YANG.
+ * Error replies are XML. If the backend returns XML data, it is translated to JSON here.
+ * @param[in]  h         Clicon handle
+ * @param[in]  xpath     XPath in a filter stmt (or NULL/"" for no filter)
+ * @param[in]  nsc       Namespace context for filter
+ * @param[in]  content   Clixon extension: all, config, noconfig. -1 means all
+ * @param[in]  pretty    Set if JSON is pretty-printed
+ * @param[out] cb        JSON text. Empty if xpath selects nothing
+ * @param[out] xerr      <rpc-reply> with <rpc-error> if error, else NULL. Free with xml_free
+ * @retval    0          OK
+ * @retval   -1          Error, fatal or xml
+ * @see clicon_rpc_get
+ */
+int
+clicon_rpc_get_json(clicon_handle   h, 
+		    char           *xpath,
+		    cvec           *nsc,
+		    netconf_content content,
+		    int             pretty,
+		    cbuf           *cb,
+		    cxobj         **xerr)
+{
+    int                retval = -1;
+    struct clicon_msg *msg = NULL;
+    cbuf              *cbmsg = NULL;
+    cxobj             *xret = NULL;
+    cxobj             *xe = NULL;
+    cxobj             *xd;
+    char              *username;
+    cg_var            *cv = NULL;
+    char              *prefix;
+    char              *retdata = NULL;
+    size_t             maplen = 0;
+    uint32_t           session_id;
+    int                ret;
+    yang_stmt         *yspec;
+    
+    *xerr = NULL;
+    if (session_id_check(h, &session_id) < 0)
+	goto done;
+    if ((cbmsg = cbuf_new()) == NULL)
+	goto done;
+    cprintf(cbmsg, "<rpc xmlns=\"%s\"", NETCONF_BASE_NAMESPACE);
+    if ((username = clicon_username_get(h)) != NULL)
+	cprintf(cbmsg, " username=\"%s\"", username);
+    cprintf(cbmsg, " xmlns:%s=\"%s\"",
+	    NETCONF_BASE_PREFIX, NETCONF_BASE_NAMESPACE);
+    cprintf(cbmsg, "><get");
+    /* Clixon extension, content=all,config, or nonconfig */
+    if ((int)content != -1)
+	cprintf(cbmsg, " content=\"%s\"", netconf_content_int2str(content));
+    /* Clixon extension, encoding=json and pretty=true */
+    cprintf(cbmsg, " encoding=\"json\"");
+    if (pretty)
+	cprintf(cbmsg, " pretty=\"true\"");
+    cprintf(cbmsg, ">");
+    if (xpath && strlen(xpath)) {
+	cprintf(cbmsg, "<%s:filter %s:type=\"xpath\" %s:select=\"%s\"",
+		NETCONF_BASE_PREFIX, NETCONF_BASE_PREFIX, NETCONF_BASE_PREFIX,
+		xpath);
+	while ((cv = cvec_each(nsc, cv)) != NULL){
+	    cprintf(cbmsg, " xmlns");
+	    if ((prefix = cv_name_get(cv)))
+		cprintf(cbmsg, ":%s", prefix);
+	    cprintf(cbmsg, "=\"%s\"", cv_string_get(cv));
+	}
+	cprintf(cbmsg, "/>");
+    }
+    cprintf(cbmsg, "</get></rpc>");
+    if ((msg = clicon_msg_encode(session_id, "%s", cbuf_get(cbmsg))) == NULL)
+	goto done;
+    if (rpc_msg_send(h, msg, &retdata, &maplen, NULL) < 0)
+	goto done;
+    if (retdata && strncmp(retdata, CLICON_MSG_JSON_MAGIC, strlen(CLICON_MSG_JSON_MAGIC)) == 0){
+	cbuf_append_str(cb, retdata + strlen(CLICON_MSG_JSON_MAGIC));
+	goto ok;
+    }
+    if (rpc_msg_parse(retdata, &xret) < 0)
+	goto done;
+    if ((xd = xpath_first(xret, NULL, "/rpc-reply/rpc-error")) != NULL){
+	xd = xml_parent(xd); /* point to rpc-reply */
+	if (xml_rm(xd) < 0)
+	    goto done;
+	*xerr = xd;
+	goto ok;
+    }
+    if ((xd = xpath_first(xret, NULL, "/rpc-reply/data")) == NULL){
+	if ((xd = xml_new("data", xret, CX_ELMNT)) == NULL)
+	    goto done;
+    }
+    /* Backend returned XML data: translate here */
+    yspec = clicon_dbspec_yang(h);
+    if ((ret = xml_bind_yang(xd, YB_MODULE, yspec, &xe)) < 0)
+	goto done;
+    if (ret == 0){
+	if (clixon_netconf_internal_error(xe,
+					  ". Internal error, backend returned invalid XML.",
+					  NULL) < 0)
+	    goto done;
+	*xerr = xe;
+	xe = NULL;
+	goto ok;
+    }
+    if (xml_rm(xd) < 0)
+	goto done;
+    xml_free(xret);
+    xret = xd;
+    if (xml2json_cbuf_xpath(cb, xd, nsc, xpath, pretty) < 0)
+	goto done;
+ ok:
+    retval = 0;
+  done:
+    if (cbmsg)
+	cbuf_free(cbmsg);
+    if (xe)
+	xml_free(xe);
+    if (xret)
+	xml_free(xret);
+    if (maplen)
+	munmap(retdata, maplen);
+    else if (retdata)
+	free(retdata);
+    if (msg)
+	free(msg);
+    return retval;
+}
+
+/*! Append an XML attribute with escaped value to a cbuf
+ * @param[in]  cb     CLIgen buf
+ * @param[in]  name   Attribute name
+ * @param[in]  value  Not-encoded attribute value
+ */
+static void
+rpc_attr_append(cbuf *cb,
+		char *name,
+		char *value)
+{
+    char *s;
+
+    cprintf(cb, " %s=\"", name);
+    for (s = value; *s; s++)
+	switch (*s){
+	case '&':
+	    cprintf(cb, "&amp;");
+	    break;
+	case '<':
+	    cprintf(cb, "&lt;");
+	    break;
+	case '>':
+	    cprintf(cb, "&gt;");
+	    break;
+	case '"':
+	    cprintf(cb, "&quot;");
+	    break;
+	default:
+	    cbuf_append(cb, *s);
+	}
+    cprintf(cb, "\"");
+}
+
+/*! Get a page of list entries from database or configuration and state data
+ * 
+ * Clixon extension: list pagination attributes on get and get-config
+ * @param[in]  h         Clicon handle
+ * @param[in]  db        Name of database for get-config, or NULL for get
+ * @param[in]  xpath     XPath selecting list or leaf-list entries
+ * @param[in]  nsc       Namespace context for filter and where
+ * @param[in]  content   If get: all, config, noconfig. -1 means all
+ * @param[in]  pg        Pagination parameters: offset, limit, direction, where, cursor
+ * @param[out] xt        XML tree. Free with xml_free. 
+ *                       Either <data> or <rpc-error>. 
+ * @param[out] next      Cursor of next page, or NULL if last page. Free after use
+ * @retval    0          OK
+ * @retval   -1          Error, fatal or xml
+ * @code
+ *  clixon_page pg = {0, 10, 0, NULL, NULL};
+ *  char       *next = NULL;
+ *
+ *  if (clicon_rpc_get_page(h, "running", "/ex:x/ex:y", nsc, -1, &pg, &xt, &next) < 0)
+ *     err;
+ *  pg.pg_cursor = next; # Get next page
+ * @endcode
+ * @see clicon_rpc_get
+ * @see clicon_rpc_get_config
+ */
+int
+clicon_rpc_get_page(clicon_handle   h, 
+		    char           *db,
+		    char           *xpath,
+		    cvec           *nsc,
+		    netconf_content content,
+		    clixon_page    *pg,
+		    cxobj         **xt,
+		    char          **next)
+{
+    int                retval = -1;
+    struct clicon_msg *msg = NULL;
+    cbuf              *cb = NULL;
+    cxobj             *xret = NULL;
+    cxobj             *xerr = NULL;
+    cxobj             *xd;
+    cxobj             *xa;
+    char              *username;
+    cg_var            *cv = NULL;
+    char              *prefix;
+    uint32_t           session_id;
+    int                ret;
+    yang_stmt         *yspec;
+    
+    *next = NULL;
+    if (session_id_check(h, &session_id) < 0)
+	goto done;
+    if ((cb = cbuf_new()) == NULL)
+	goto done;
+    cprintf(cb, "<rpc xmlns=\"%s\"", NETCONF_BASE_NAMESPACE);
+    if ((username = clicon_username_get(h)) != NULL)
+	cprintf(cb, " username=\"%s\"", username);
+    cprintf(cb, " xmlns:%s=\"%s\"",
+	    NETCONF_BASE_PREFIX, NETCONF_BASE_NAMESPACE);
+    cprintf(cb, "><%s", db?"get-config":"get");
+    /* Clixon extension, content=all,config, or nonconfig */
+    if (db == NULL && (int)content != -1)
+	cprintf(cb, " content=\"%s\"", netconf_content_int2str(content));
+    /* Clixon extension, list pagination */
+    if (pg->pg_offset)
+	cprintf(cb, " offset=\"%u\"", pg->pg_offset);
+    if (pg->pg_limit)
+	cprintf(cb, " limit=\"%u\"", pg->pg_limit);
+    cprintf(cb, " direction=\"%s\"", pg->pg_backwards?"backwards":"forwards");
+    if (pg->pg_where)
+	rpc_attr_append(cb, "where", pg->pg_where);
+    if (pg->pg_cursor)
+	rpc_attr_append(cb, "cursor", pg->pg_cursor);
+    cprintf(cb, ">");
+    if (db)
+	cprintf(cb, "<source><%s/></source>", db);
+    if (xpath && strlen(xpath)) {
+	cprintf(cb, "<%s:filter %s:type=\"xpath\" %s:select=\"%s\"",
+		NETCONF_BASE_PREFIX, NETCONF_BASE_PREFIX, NETCONF_BASE_PREFIX,
+		xpath);
+	while ((cv = cvec_each(nsc, cv)) != NULL){
+	    cprintf(cb, " xmlns");
+	    if ((prefix = cv_name_get(cv)))
+		cprintf(cb, ":%s", prefix);
+	    cprintf(cb, "=\"%s\"", cv_string_get(cv));
+	}
+	cprintf(cb, "/>");
+    }
+    cprintf(cb, "</%s></rpc>", db?"get-config":"get");
+    if ((msg = clicon_msg_encode(session_id, "%s", cbuf_get(cb))) == NULL)
+	goto done;
+    if (clicon_rpc_msg(h, msg, &xret, NULL) < 0)
+	goto done;
+    /* Send xml error back: first check error, then ok */
+    if ((xd = xpath_first(xret, NULL, "/rpc-reply/rpc-error")) != NULL)
+	xd = xml_parent(xd); /* point to rpc-reply */
+    else if ((xd = xpath_first(xret, NULL, "/rpc-reply/data")) == NULL){
+	if ((xd = xml_new("data", NULL, CX_ELMNT)) == NULL)
+	    goto done;
+    }
+    else{
+	if ((xa = xml_find_type(xd, NULL, "next-cursor", CX_ATTR)) != NULL){
+	    if ((*next = strdup(xml_value(xa))) == NULL){
+		clicon_err(OE_UNIX, errno, "strdup");
+		goto done;
+	    }
+	    xml_purge(xa);
+	}
+	yspec = clicon_dbspec_yang(h);
+	if ((ret = xml_bind_yang(xd, YB_MODULE, yspec, &xerr)) < 0)
+	    goto done;
+	if (ret == 0){
+	    if (clixon_netconf_internal_error(xerr,
+					      ". Internal error, backend returned invalid XML.",
+					      NULL) < 0)
+		goto done;
+	    if ((xd = xpath_first(xerr, NULL, "rpc-error")) == NULL){
+		clicon_err(OE_XML, ENOENT, "Expected rpc-error tag but none found(internal)");
+		goto done;
+	    }
+	}
+    }
+    if (xt){
+	if (xml_rm(xd) < 0)
+	    goto done;
+	*xt = xd;
+    }
+    retval = 0;
+  done:
+    if (cb)
+	cbuf_free(cb);
+    if (xerr)
+	xml_free(xerr);
+    if (xret)
+	xml_free(xret);
+    if (msg)
+	free(msg);
+    return retval;
+}
+
 /*! Close a (user) session
  * @param[in] h        CLICON handle
  * @retval    0        OK
@@ -801,6 +1771,7 @@ clicon_rpc_close_session(clicon_handle h)
     }
     retval = 0;
  done:
+    clicon_rpc_close(h);
     if (xret)
 	xml_free(xret);
     if (msg)
@@ -1062,6 +2033,8 @@ clicon_rpc_debug(clicon_handle h,
 }
 
 /*! Send a hello request to the backend server
+ * If CLICON_CLIENT_BINARY is set and the backend announces CLIXON_BINARY_CAPABILITY
+ * in its hello, replies are thereafter asked for in binary encoding.
  * @param[in] h        CLICON handle
  * @param[in] level    Debug level
  * @retval    0        OK
@@ -1079,14 +2052,23 @@ clicon_hello_req(clicon_handle h,
     cxobj             *xret = NULL;
     cxobj             *xerr;
     cxobj             *x;
+    cxobj             *xc;
     char              *username;
     char              *b;
     int                ret;
+    int                binary;
 
     username = clicon_username_get(h);
-    if ((msg = clicon_msg_encode(0, "<hello username=\"%s\" xmlns=\"%s\"><capabilities><capability>urn:ietf:params:netconf:base:1.0</capability></capabilities></hello>",
+    binary = clicon_option_bool(h, "CLICON_CLIENT_BINARY");
+    if ((msg = clicon_msg_encode(0, "<hello username=\"%s\" xmlns=\"%s\"><capabilities><capability>urn:ietf:params:netconf:base:1.0</capability>%s%s%s</capabilities></hello>",
 				 username?username:"",
-				 NETCONF_BASE_NAMESPACE)) == NULL)
+				 NETCONF_BASE_NAMESPACE,
+				 binary?"<capability>":"",
+				 binary?CLIXON_BINARY_CAPABILITY:"",
+				 binary?"</capability>":"")) == NULL)
+	goto done;
+    /* Hello itself is always XML text */
+    if (clicon_client_binary_set(h, 0) < 0)
 	goto done;
     if (clicon_rpc_msg(h, msg, &xret, NULL) < 0)
 	goto done;
@@ -1103,6 +2085,15 @@ clicon_hello_req(clicon_handle h,
 	clicon_err(OE_XML, errno, "parse_uint32"); 
 	goto done;
     }
+    if (binary && (x = xpath_first(xret, NULL, "hello/capabilities")) != NULL){
+	xc = NULL;
+	while ((xc = xml_child_each(x, xc, CX_ELMNT)) != NULL)
+	    if ((b = xml_body(xc)) != NULL && strcmp(b, CLIXON_BINARY_CAPABILITY) == 0){
+		if (clicon_client_binary_set(h, 1) < 0)
+		    goto done;
+		break;
+	    }
+    }
     retval = 0;
  done:
     if (msg)
@@ -363,6 +363,7 @@ stream_ss_add(clicon_handle     h,
     }
     ss->ss_fn     = fn;
     ss->ss_arg    = arg;
+    ss->ss_es     = es;
     ADDQ(ss, es->es_subscription);
     return ss;
   done:
@@ -371,6 +372,21 @@ stream_ss_add(clicon_handle     h,
     return NULL;
 }
 
+/*! Remove subscription from list of its owner, if any
+ * @param[in]  ss     Subscription
+ * @see stream_ss_owner
+ */
+static void
+stream_ss_unlink(struct stream_subscription *ss)
+{
+    if (ss->ss_oprev == NULL)
+	return;
+    if ((*ss->ss_oprev = ss->ss_onext) != NULL)
+	ss->ss_onext->ss_oprev = ss->ss_oprev;
+    ss->ss_onext = NULL;
+    ss->ss_oprev = NULL;
+}
+
 /*! Delete event stream subscription to a stream given a callback and arg
  * @param[in]  h      Clicon handle
  * @param[in]  stream Name of stream or NULL for all streams
@@ -387,6 +403,7 @@ stream_ss_rm(clicon_handle                h,
 {
     clicon_debug(1, "%s", __FUNCTION__);
     DELQ(ss, es->es_subscription, struct stream_subscription *);
+    stream_ss_unlink(ss);
     /* Remove from upper layers - close socket etc. */
     (*ss->ss_fn)(h, 1, NULL, ss->ss_arg);
     if (force){
@@ -452,6 +469,53 @@ stream_ss_delete_all(clicon_handle     h,
     return retval;
 }
 
+/*! Add subscription to a list of subscriptions of an owner, eg a client
+ * The owner can then remove all its subscriptions without searching the streams.
+ * A subscription removed by stream_ss_rm, eg when its stoptime has passed, is
+ * also removed from the list.
+ * @param[in]     ss     Subscription, see stream_ss_add
+ * @param[in,out] owner  Head of list of subscriptions of owner, initially NULL
+ * @retval        0      OK
+ * @see stream_ss_delete_owner
+ */
+int
+stream_ss_owner(struct stream_subscription  *ss,
+		struct stream_subscription **owner)
+{
+    stream_ss_unlink(ss);
+    if ((ss->ss_onext = *owner) != NULL)
+	(*owner)->ss_oprev = &ss->ss_onext;
+    ss->ss_oprev = owner;
+    *owner = ss;
+    return 0;
+}
+
+/*! Remove and free all subscriptions of an owner
+ * The subscription callbacks are not called, since the removal is made by the
+ * owner itself.
+ * @param[in]     h      Clicon handle
+ * @param[in,out] owner  Head of list of subscriptions of owner, NULL on return
+ * @retval        0      OK
+ * @see stream_ss_owner
+ */
+int
+stream_ss_delete_owner(clicon_handle                h,
+		       struct stream_subscription **owner)
+{
+    struct stream_subscription *ss;
+
+    while ((ss = *owner) != NULL){
+	stream_ss_unlink(ss);
+	DELQ(ss, ss->ss_es->es_subscription, struct stream_subscription *);
+	if (ss->ss_stream)
+	    free(ss->ss_stream);
+	if (ss->ss_xpath)
+	    free(ss->ss_xpath);
+	free(ss);
+    }
+    return 0;
+}
+
 /*! Delete a single stream
  * @see stream_ss_delete_all (merge with this?)
  */
@@ -45,6 +45,12 @@
 #include <errno.h>
 #include <ctype.h>
 
+/* Vectorized XML character data scanning with runtime CPU dispatch */
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define XML_CHARDATA_X86
+#include <immintrin.h>
+#endif
+
 #include <cligen/cligen.h>
 
 /* clicon */
@@ -344,6 +350,57 @@ uri_percent_decode(char  *enc,
     return retval;
 }
 
+/*! Encode a string according to XML definition, or compute its encoded length
+ * Unchanged parts of the string and CDATA sections are copied as a whole
+ * @param[in]   str    Not-encoded input string
+ * @param[out]  esc    Encoded string, not null-terminated. If NULL only compute length
+ * @retval      len    Length of encoded string
+ * @see xml_chardata_encode
+ */
+static size_t
+xml_chardata_encode_buf(const char *str,
+			char       *esc)
+{
+    size_t      len = 0;
+    size_t      n;
+    const char *enc;
+
+    while (*str){
+	if ((n = xml_chardata_span(str)) > 0){
+	    if (esc)
+		memcpy(&esc[len], str, n);
+	    len += n;
+	    str += n;
+	    continue;
+	}
+	switch (*str){
+	case '&':
+	    enc = "&amp;";
+	    break;
+	case '<':
+	    if ((n = xml_chardata_cdata(str)) > 0){
+		if (esc)
+		    memcpy(&esc[len], str, n);
+		len += n;
+		str += n;
+		continue;
+	    }
+	    enc = "&lt;";
+	    break;
+	case '>':
+	default:
+	    enc = "&gt;";
+	    break;
+	}
+	n = strlen(enc);
+	if (esc)
+	    memcpy(&esc[len], enc, n);
+	len += n;
+	str++;
+    }
+    return len;
+}
+
 /*! Escape characters according to XML definition
  * @param[out]  encp   Encoded malloced output string
  * @param[in]   fmt    Not-encoded input string (stdarg format string)
@@ -377,10 +434,7 @@ xml_chardata_encode(char      **escp,
     char   *str = NULL;  /* Expanded format string w stdarg */
     int     fmtlen;
     char   *esc = NULL;
-    int     l;
-    int     len;
-    int     i, j;
-    int     cdata; /* when set, skip encoding */
+    size_t  len;
     va_list args;
     
     /* Two steps: (1) read in the complete format string */
@@ -399,84 +453,15 @@ xml_chardata_encode(char      **escp,
 
     /* Step (2) encode and expand str --> enc */
     /* First compute length (do nothing) */
-    len = 0; cdata = 0;
-    for (i=0; i<strlen(str); i++){
-	if (cdata){
-	    if (strncmp(&str[i], "]]>", strlen("]]>")) == 0)
-		cdata = 0;
-	    len++;
-	}
-	else
-	    switch (str[i]){
-	    case '&':
-		len += strlen("&amp;");
-		break;
-	    case '<':
-		if (strncmp(&str[i], "<![CDATA[", strlen("<![CDATA[")) == 0){
-		    len++;
-		    cdata++;
-		}
-		else
-		    len += strlen("&lt;");
-		break;
-	    case '>':
-		len += strlen("&gt;");
-		break;
-	    default:
-		len++;
-	    }
-    }
-    len++; /* trailing \0 */
+    len = xml_chardata_encode_buf(str, NULL);
     /* We know length, allocate encoding buffer  */
-    if ((esc = malloc(len)) == NULL){
+    if ((esc = malloc(len + 1)) == NULL){
 	clicon_err(OE_UNIX, errno, "malloc"); 
 	goto done;
     }
-    memset(esc, 0, len);
-
     /* Same code again, but now actually encode into output buffer */
-    j = 0; cdata = 0;
-    for (i=0; i<strlen(str); i++){
-	if (cdata){
-	    if (strncmp(&str[i], "]]>", strlen("]]>")) == 0){
-		cdata = 0;
-		esc[j++] = str[i++];
-		esc[j++] = str[i++];
-	    }
-	    esc[j++] = str[i];
-	}
-	else
-	switch (str[i]){
-	case '&':
-	    if ((l=snprintf(&esc[j], 6, "&amp;")) < 0){
-		clicon_err(OE_UNIX, errno, "snprintf");
-		goto done;
-	    }
-	    j += l;
-	    break;
-	case '<':
-	    if (strncmp(&str[i], "<![CDATA[", strlen("<![CDATA[")) == 0){
-		esc[j++] = str[i];
-		cdata++;
-		break;
-	    }
-	    if ((l=snprintf(&esc[j], 5, "&lt;")) < 0){
-		clicon_err(OE_UNIX, errno, "snprintf");
-		goto done;
-	    }
-	    j += l;
-	    break;
-	case '>':
-	    if ((l=snprintf(&esc[j], 5, "&gt;")) < 0){
-		clicon_err(OE_UNIX, errno, "snprintf");
-		goto done;
-	    }
-	    j += l;
-	    break;
-	default:
-	    esc[j++] = str[i];
-	}
-    }
+    xml_chardata_encode_buf(str, esc);
+    esc[len] = '\0';
     *escp = esc;
     retval = 0;
  done:
@@ -487,7 +472,206 @@ xml_chardata_encode(char      **escp,
     return retval;
 }
 
+/* Characters where xml_chardata_span stops: '&', '<', '>' and end of string */
+static const unsigned char xml_chardata_stop[256] = {
+    ['\0'] = 1,
+    ['&']  = 1,
+    ['<']  = 1,
+    ['>']  = 1,
+};
+
+/*! Scalar xml_chardata_span: table lookup, four characters per iteration */
+static size_t
+xml_chardata_span_scalar(const char *str)
+{
+    const unsigned char *s = (const unsigned char *)str;
+
+    for (;;){
+	if (xml_chardata_stop[s[0]])
+	    break;
+	if (xml_chardata_stop[s[1]]){
+	    s += 1;
+	    break;
+	}
+	if (xml_chardata_stop[s[2]]){
+	    s += 2;
+	    break;
+	}
+	if (xml_chardata_stop[s[3]]){
+	    s += 3;
+	    break;
+	}
+	s += 4;
+    }
+    return (const char *)s - str;
+}
+
+#ifdef XML_CHARDATA_X86
+/*! Bitmask of stop characters in 16 bytes */
+__attribute__((target("sse2")))
+static inline unsigned int
+xml_chardata_mask_sse2(__m128i v)
+{
+    __m128i m;
+
+    m = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('&')),
+		     _mm_cmpeq_epi8(v, _mm_set1_epi8('<')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_set1_epi8('>')));
+    m = _mm_or_si128(m, _mm_cmpeq_epi8(v, _mm_setzero_si128()));
+    return (unsigned int)_mm_movemask_epi8(m);
+}
+
+/*! SSE2 xml_chardata_span: 16 characters per iteration
+ * The string is read in aligned 16-byte blocks, so the first block may start before
+ * str and the last may end after the terminating null. This over-read is safe: an
+ * aligned block never crosses a page boundary, so every byte read is in a page that
+ * also holds a byte of the string and the read cannot fault. The bytes outside the
+ * string do not affect the result either: bytes before str are masked out of the 
+ * first block, and the span ends at the first stop character, at the latest the 
+ * null, so bytes after it are never used.
+ * Memory checkers cannot know this, so the function is not instrumented by
+ * AddressSanitizer, and valgrind reports are suppressed in test/valgrind-clixon.supp
+ */
+__attribute__((target("sse2"), no_sanitize_address))
+static size_t
+xml_chardata_span_sse2(const char *str)
+{
+    const char  *p = (const char *)((uintptr_t)str & ~(uintptr_t)15);
+    unsigned int mask;
+
+    mask = xml_chardata_mask_sse2(_mm_load_si128((const __m128i *)p));
+    mask = (mask >> (str - p)) << (str - p);
+    while (mask == 0){
+	p += 16;
+	mask = xml_chardata_mask_sse2(_mm_load_si128((const __m128i *)p));
+    }
+    return p + __builtin_ctz(mask) - str;
+}
+
+/*! Bitmask of stop characters in 32 bytes */
+__attribute__((target("avx2")))
+static inline uint32_t
+xml_chardata_mask_avx2(__m256i v)
+{
+    __m256i m;
+
+    m = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('&')),
+			_mm256_cmpeq_epi8(v, _mm256_set1_epi8('<')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('>')));
+    m = _mm256_or_si256(m, _mm256_cmpeq_epi8(v, _mm256_setzero_si256()));
+    return (uint32_t)_mm256_movemask_epi8(m);
+}
+
+/*! AVX2 xml_chardata_span: 32 characters per iteration
+ * Aligned 32-byte blocks are read beyond the string, see xml_chardata_span_sse2 why
+ * this is safe
+ */
+__attribute__((target("avx2"), no_sanitize_address))
+static size_t
+xml_chardata_span_avx2(const char *str)
+{
+    const char *p = (const char *)((uintptr_t)str & ~(uintptr_t)31);
+    uint32_t    mask;
+
+    mask = xml_chardata_mask_avx2(_mm256_load_si256((const __m256i *)p));
+    mask = (mask >> (str - p)) << (str - p);
+    while (mask == 0){
+	p += 32;
+	mask = xml_chardata_mask_avx2(_mm256_load_si256((const __m256i *)p));
+    }
+    return p + __builtin_ctz(mask) - str;
+}
+#endif /* XML_CHARDATA_X86 */
+
+static size_t xml_chardata_span_init(const char *str);
+
+/* Implementation of xml_chardata_span, selected on first call */
+static size_t (*xml_chardata_span_fn)(const char *str) = xml_chardata_span_init;
+static char    *xml_chardata_simd_name = NULL;
+
+/*! Select implementation of XML character data scanning
+ * @param[in]  name  "scalar", "sse2", "avx2", or NULL/"auto" for the best the CPU supports
+ * @retval     0     OK
+ * @retval    -1     Error: unknown implementation or not supported by CPU
+ * @see xml_chardata_span
+ */
+int
+xml_chardata_simd_set(char *name)
+{
+    int auto_ = (name == NULL || strcmp(name, "auto") == 0);
+
+#ifdef XML_CHARDATA_X86
+    __builtin_cpu_init();
+    if ((auto_ || strcmp(name, "avx2") == 0) && __builtin_cpu_supports("avx2")){
+	xml_chardata_span_fn = xml_chardata_span_avx2;
+	xml_chardata_simd_name = "avx2";
+	return 0;
+    }
+    if ((auto_ || strcmp(name, "sse2") == 0) && __builtin_cpu_supports("sse2")){
+	xml_chardata_span_fn = xml_chardata_span_sse2;
+	xml_chardata_simd_name = "sse2";
+	return 0;
+    }
+#endif
+    if (auto_ || strcmp(name, "scalar") == 0){
+	xml_chardata_span_fn = xml_chardata_span_scalar;
+	xml_chardata_simd_name = "scalar";
+	return 0;
+    }
+    clicon_err(OE_UNIX, EINVAL, "%s not supported", name);
+    return -1;
+}
+
+/*! Get name of selected implementation of XML character data scanning
+ * @see xml_chardata_simd_set
+ */
+char *
+xml_chardata_simd_get(void)
+{
+    if (xml_chardata_simd_name == NULL)
+	xml_chardata_simd_set(NULL);
+    return xml_chardata_simd_name;
+}
+
+/*! Select implementation on first call of xml_chardata_span */
+static size_t
+xml_chardata_span_init(const char *str)
+{
+    xml_chardata_simd_set(NULL);
+    return xml_chardata_span_fn(str);
+}
+
+/*! Length of initial part of a string that is not changed by XML encoding
+ * Vectorized with SSE2 or AVX2 if supported by the CPU, see xml_chardata_simd_set
+ * @param[in]   str    Not-encoded input string
+ * @retval      len    Number of chars before the first '&', '<', '>' or end of string
+ * @see xml_chardata_encode
+ */
+size_t
+xml_chardata_span(const char *str)
+{
+    return xml_chardata_span_fn(str);
+}
+
+/*! Length of a CDATA section, which is not changed by XML encoding
+ * @param[in]   str    String
+ * @retval      len    Length of section including "]]>", or of rest of string if not ended
+ * @retval      0      str does not start with a CDATA section
+ */
+size_t
+xml_chardata_cdata(const char *str)
+{
+    char *end;
+
+    if (strncmp(str, "<![CDATA[", strlen("<![CDATA[")) != 0)
+	return 0;
+    if ((end = strstr(str + strlen("<![CDATA["), "]]>")) == NULL)
+	return strlen(str);
+    return end - str + strlen("]]>");
+}
+
 /*! Escape characters according to XML definition and append to cbuf
+ * Unchanged parts of the string are appended as a whole
  * @param[in]   cb     CLIgen buf
  * @param[in]   str    Not-encoded input string
  * @see xml_chardata_encode for the generic function
@@ -496,45 +680,44 @@ int
 xml_chardata_cbuf_append(cbuf *cb,
 			 char *str)
 {
-    int  retval = -1;
-    int  i;
-    int  cdata; /* when set, skip encoding */
+    int    retval = -1;
+    size_t len;
 
-    /* The orignal of this code is in xml_chardata_encode */
-    /* Step: encode and expand str --> enc */
-    /* Same code again, but now actually encode into output buffer */
-    cdata = 0;
-    for (i=0; i<strlen(str); i++){
-	if (cdata){
-	    if (strncmp(&str[i], "]]>", strlen("]]>")) == 0){
-		cdata = 0;
-		cbuf_append(cb, str[i++]);
-		cbuf_append(cb, str[i++]);
+    while (*str){
+	if ((len = xml_chardata_span(str)) > 0){
+	    if (cbuf_append_buf(cb, str, len) < 0){
+		clicon_err(OE_UNIX, errno, "cbuf_append_buf");
+		goto done;
 	    }
-	    cbuf_append(cb, str[i]);
+	    str += len;
 	}
-	else
-	switch (str[i]){
+	switch (*str){
+	case '\0':
+	    break;
 	case '&':
 	    cbuf_append_str(cb, "&amp;");
+	    str++;
 	    break;
 	case '<':
-	    if (strncmp(&str[i], "<![CDATA[", strlen("<![CDATA[")) == 0){
-		cbuf_append(cb, str[i]);
-		cdata++;
+	    if ((len = xml_chardata_cdata(str)) > 0){
+		if (cbuf_append_buf(cb, str, len) < 0){
+		    clicon_err(OE_UNIX, errno, "cbuf_append_buf");
+		    goto done;
+		}
+		str += len;
 		break;
 	    }
 	    cbuf_append_str(cb, "&lt;");
+	    str++;
 	    break;
 	case '>':
 	    cbuf_append_str(cb, "&gt;");
+	    str++;
 	    break;
-	default:
-	    cbuf_append(cb, str[i]);
 	}
     }
     retval = 0;
-    // done:
+ done:
     return retval;
 }
 
@@ -71,14 +71,266 @@
 #include "clixon_xml.h"
 #include "clixon_netconf_lib.h"
 #include "clixon_options.h"
+#include "clixon_data.h"
 #include "clixon_xml_nsctx.h"
 #include "clixon_xpath_ctx.h"
 #include "clixon_xpath.h"
+#include "clixon_xpath_function.h"
 #include "clixon_yang_module.h"
 #include "clixon_yang_type.h"
 #include "clixon_xml_map.h"
+#include "clixon_xml_sort.h"
 #include "clixon_validate.h"
 
+/*
+ * Leafref target cache
+ * During a validation, the target nodes of a leafref path are computed once per
+ * context and kept in a cache. Large target sets are also indexed by their value,
+ * so that each leafref instance is checked in constant time.
+ * The cache is only active between xml_leafref_cache_begin and xml_leafref_cache_end,
+ * ie the XML tree may not be modified in between.
+ */
+#define LEAFREF_HASH_MIN 16 /* Index target sets by value from this size */
+
+/* Target nodes of one leafref path in one context */
+typedef struct {
+    cxobj        **lt_vec;  /* Target nodes */
+    size_t         lt_len;  /* Length of lt_vec */
+    clicon_hash_t *lt_hash; /* Target value -> first target node, if many targets */
+} leafref_targets;
+
+/* Leafref path context -> leafref_targets */
+static clicon_hash_t *_leafref_cache = NULL;
+static int            _leafref_cache_refs = 0;
+
+/*! Start using the leafref target cache, the XML tree may not be changed until end
+ * Calls may be nested, the cache is freed when the outermost validation ends.
+ * @retval  0   OK
+ * @retval -1   Error
+ * @see xml_leafref_cache_end
+ */
+int
+xml_leafref_cache_begin(void)
+{
+    if (_leafref_cache_refs++ == 0 &&
+	(_leafref_cache = clicon_hash_init()) == NULL)
+	return -1;
+    return 0;
+}
+
+/*! Stop using the leafref target cache, free it if outermost
+ * @retval  0   OK
+ * @see xml_leafref_cache_begin
+ */
+int
+xml_leafref_cache_end(void)
+{
+    char           **keys = NULL;
+    size_t           klen = 0;
+    leafref_targets *lt;
+    int              i;
+
+    if (_leafref_cache_refs == 0 || --_leafref_cache_refs > 0)
+	return 0;
+    if (_leafref_cache == NULL)
+	return 0;
+    if (clicon_hash_keys(_leafref_cache, &keys, &klen) == 0){
+	for (i=0; i<klen; i++){
+	    if ((lt = clicon_hash_value(_leafref_cache, keys[i], NULL)) == NULL)
+		continue;
+	    if (lt->lt_vec)
+		free(lt->lt_vec);
+	    if (lt->lt_hash)
+		clicon_hash_free(lt->lt_hash);
+	}
+    }
+    if (keys)
+	free(keys);
+    clicon_hash_free(_leafref_cache);
+    _leafref_cache = NULL;
+    return 0;
+}
+
+/*! Get context node of a leafref path whose targets do not depend on the leafref node
+ *
+ * The path is "../../a/b" or "/a/b" without current() or later parent steps. The
+ * targets are then the same for all leafref nodes with the same ancestor.
+ * @param[in]  xt      XML leafref node
+ * @param[in]  path    Leafref path
+ * @param[out] xanchor Context node of rest, or NULL if path is not cacheable
+ * @param[out] rest    Path to evaluate from xanchor
+ */
+static void
+leafref_anchor(cxobj  *xt,
+	       char   *path,
+	       cxobj **xanchor,
+	       char  **rest)
+{
+    cxobj *x = xt;
+    char  *p = path;
+
+    *xanchor = NULL;
+    if (strstr(path, "current") != NULL || strstr(path, "deref") != NULL)
+	return;
+    if (*p == '/'){
+	*xanchor = xml_root(xt);
+	*rest = path;
+	return;
+    }
+    while (strncmp(p, "../", 3) == 0){
+	if ((x = xml_parent(x)) == NULL)
+	    return;
+	p += 3;
+    }
+    if (x == xt || strstr(p, "..") != NULL)
+	return;
+    *xanchor = x;
+    *rest = p;
+}
+
+/*! Get target nodes of a leafref path, possibly from cache
+ * @param[in]  xt    XML leafref node, context node of path
+ * @param[in]  nsc   Namespace context of path
+ * @param[in]  ymod  Yang module of nsc, part of cache key
+ * @param[in]  path  Leafref path
+ * @param[out] ltp   Target nodes, either pointing into cache or to lt0
+ * @param[out] lt0   Uncached target nodes. Free lt_vec after use if set
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+leafref_targets_get(cxobj            *xt,
+		    cvec             *nsc,
+		    yang_stmt        *ymod,
+		    char             *path,
+		    leafref_targets **ltp,
+		    leafref_targets  *lt0)
+{
+    int              retval = -1;
+    cxobj           *xanchor = NULL;
+    char            *rest = NULL;
+    cbuf            *cbkey = NULL;
+    leafref_targets  lt = {NULL, 0, NULL};
+    leafref_targets *ltc;
+    char            *body;
+    int              i;
+
+    if (_leafref_cache != NULL)
+	leafref_anchor(xt, path, &xanchor, &rest);
+    if (xanchor == NULL){ /* No caching */
+	memset(lt0, 0, sizeof(*lt0));
+	if (xpath_vec(xt, nsc, "%s", &lt0->lt_vec, &lt0->lt_len, path) < 0) 
+	    goto done;
+	*ltp = lt0;
+	goto ok;
+    }
+    if ((cbkey = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    cprintf(cbkey, "%p %p %s", xanchor, ymod, path);
+    if ((ltc = clicon_hash_value(_leafref_cache, cbuf_get(cbkey), NULL)) == NULL){
+	if (xpath_vec(xanchor, nsc, "%s", &lt.lt_vec, &lt.lt_len, rest) < 0) 
+	    goto done;
+	if (lt.lt_len >= LEAFREF_HASH_MIN){
+	    if ((lt.lt_hash = clicon_hash_init()) == NULL)
+		goto done;
+	    for (i=0; i<lt.lt_len; i++){
+		if ((body = xml_body(lt.lt_vec[i])) == NULL)
+		    continue;
+		if (clicon_hash_lookup(lt.lt_hash, body) != NULL)
+		    continue;
+		if (clicon_hash_add(lt.lt_hash, body, &lt.lt_vec[i], sizeof(cxobj *)) == NULL)
+		    goto done;
+	    }
+	}
+	if (clicon_hash_add(_leafref_cache, cbuf_get(cbkey), &lt, sizeof(lt)) == NULL)
+	    goto done;
+	memset(&lt, 0, sizeof(lt)); /* Now owned by cache */
+	if ((ltc = clicon_hash_value(_leafref_cache, cbuf_get(cbkey), NULL)) == NULL)
+	    goto done;
+    }
+    *ltp = ltc;
+ ok:
+    retval = 0;
+ done:
+    if (lt.lt_vec)
+	free(lt.lt_vec);
+    if (lt.lt_hash)
+	clicon_hash_free(lt.lt_hash);
+    if (cbkey)
+	cbuf_free(cbkey);
+    return retval;
+}
+
+/*! Find the node referred to by a leafref node, ie the target with the same value
+ *
+ * Uses the leafref target cache if active.
+ * @param[in]  xt      XML leaf node of type leafref
+ * @param[in]  ys      Yang spec of leaf
+ * @param[in]  ytype   Yang type statement of type leafref
+ * @param[out] xtarget Target node or NULL if not found
+ * @retval     0       OK
+ * @retval    -1       Error
+ * @see validate_leafref  for context node rules
+ * @see xml_leafref_cache_begin
+ */
+int
+xml_leafref_target(cxobj      *xt,
+		   yang_stmt  *ys,
+		   yang_stmt  *ytype,
+		   cxobj     **xtarget)
+{
+    int              retval = -1;
+    yang_stmt       *ypath;
+    yang_stmt       *yp;
+    yang_stmt       *yns;
+    cvec            *nsc = NULL;
+    char            *leafrefbody;
+    char            *leafbody;
+    leafref_targets *lt = NULL;
+    leafref_targets  lt0 = {NULL, 0, NULL};
+    cxobj          **xp;
+    int              i;
+
+    *xtarget = NULL;
+    if ((leafrefbody = xml_body(xt)) == NULL)
+	goto ok;
+    if ((ypath = yang_find(ytype, Y_PATH, NULL)) == NULL)
+	goto ok;
+    /* See comment^: If path is defined in typedef or not */
+    if ((yp = yang_parent_get(ytype)) != NULL &&
+	yang_keyword_get(yp) == Y_TYPEDEF)
+	yns = ys;
+    else
+	yns = ytype;
+    if (xml_nsctx_yang(yns, &nsc) < 0)
+	goto done;
+    if (leafref_targets_get(xt, nsc, ys_module(yns), yang_argument_get(ypath), &lt, &lt0) < 0)
+	goto done;
+    if (lt->lt_hash){
+	if ((xp = clicon_hash_value(lt->lt_hash, leafrefbody, NULL)) != NULL)
+	    *xtarget = *xp;
+    }
+    else
+	for (i = 0; i < lt->lt_len; i++) {
+	    if ((leafbody = xml_body(lt->lt_vec[i])) == NULL)
+		continue;
+	    if (strcmp(leafbody, leafrefbody) == 0){
+		*xtarget = lt->lt_vec[i];
+		break;
+	    }
+	}
+ ok:
+    retval = 0;
+ done:
+    if (lt0.lt_vec)
+	free(lt0.lt_vec);
+    if (nsc)
+	xml_nsctx_free(nsc);
+    return retval;
+}
+
 /*! Validate xml node of type leafref, ensure the value is one of that path's reference
  * @param[in]  xt    XML leaf node of type leafref
  * @param[in]  ys    Yang spec of leaf
@@ -95,6 +347,7 @@
  *      references the typedef. (ie ys)
  *   o  Otherwise, the context node is the node in the data tree for which
  *      the "path" statement is defined. (ie yc)
+ * If require-instance is false, the target need not exist (RFC7950 Sec 9.9.3)
  */
 static int
 validate_leafref(cxobj     *xt,
@@ -104,16 +357,10 @@ validate_leafref(cxobj     *xt,
 {
     int          retval = -1;
     yang_stmt   *ypath;
-    yang_stmt   *yp;
-    cxobj      **xvec = NULL;
+    yang_stmt   *yreq;
     cxobj       *x;
-    int          i;
-    size_t       xlen = 0;
     char        *leafrefbody;
-    char        *leafbody;
-    cvec        *nsc = NULL;
     cbuf        *cberr = NULL;
-    char        *path;
     
     if ((leafrefbody = xml_body(xt)) == NULL)
 	goto ok;
@@ -122,31 +369,18 @@ validate_leafref(cxobj     *xt,
 	    goto done;
 	goto fail;
     }
-    /* See comment^: If path is defined in typedef or not */
-    if ((yp = yang_parent_get(ytype)) != NULL &&
-	yang_keyword_get(yp) == Y_TYPEDEF){
-	if (xml_nsctx_yang(ys, &nsc) < 0)
-	    goto done;
-    }
-    else
-	if (xml_nsctx_yang(ytype, &nsc) < 0)
-	    goto done;
-    path = yang_argument_get(ypath);
-    if (xpath_vec(xt, nsc, "%s", &xvec, &xlen, path) < 0) 
+    if ((yreq = yang_find(ytype, Y_REQUIRE_INSTANCE, NULL)) != NULL &&
+	strcmp(yang_argument_get(yreq), "false") == 0)
+	goto ok;
+    if (xml_leafref_target(xt, ys, ytype, &x) < 0)
 	goto done;
-    for (i = 0; i < xlen; i++) {
-	x = xvec[i];
-	if ((leafbody = xml_body(x)) == NULL)
-	    continue;
-	if (strcmp(leafbody, leafrefbody) == 0)
-	    break;
-    }
-    if (i==xlen){
+    if (x == NULL){
 	if ((cberr = cbuf_new()) == NULL){
 	    clicon_err(OE_UNIX, errno, "cbuf_new");
 	    goto done;
 	}
-	cprintf(cberr, "Leafref validation failed: No leaf %s matching path %s", leafrefbody, path);
+	cprintf(cberr, "Leafref validation failed: No leaf %s matching path %s",
+		leafrefbody, yang_argument_get(ypath));
 	if (netconf_bad_element_xml(xret, "application", leafrefbody, cbuf_get(cberr)) < 0)
 	    goto done;
 	goto fail;
@@ -156,10 +390,6 @@ validate_leafref(cxobj     *xt,
  done:
     if (cberr)
 	cbuf_free(cberr);
-    if (nsc)
-	xml_nsctx_free(nsc);
-    if (xvec)
-	free(xvec);
     return retval;
  fail:
     retval = 0;
@@ -595,24 +825,50 @@ check_mandatory(cxobj     *xt,
     goto done;
 }
 
+/*! Hash a tuple of unique/key values
+ * @param[in]  tuple Vector of values
+ * @param[in]  vlen  Number of values
+ */
+static uint32_t
+unique_tuple_hash(char **tuple,
+		  int    vlen)
+{
+    uint32_t h = 5381;
+    int      v;
+    char    *b;
+
+    for (v=0; v<vlen; v++){
+	for (b = tuple[v]; *b; b++)
+	    h = (h << 5) + h + (uint8_t)*b;
+	h = (h << 5) + h + 0xff; /* separator, ("ab","c") != ("a","bc") */
+    }
+    return h;
+}
+
 /*! New element last in list, check if already exists if sp return -1
  * @param[in]  vec   Vector of existing entries (new is last)
  * @param[in]  i1    The new entry is placed at vec[i1]
  * @param[in]  vlen  Lenght of entry
  * @param[in]  sorted Sorted by system, ie sorted by key, otherwise no assumption
+ * @param[in]  tab   Open addressing hash table of entry index+1, 0 is free. Not used if sorted
+ * @param[in]  tsize Size of tab, power of 2 and larger than number of entries
  * @retval     0     OK, entry is unique
  * @retval    -1     Duplicate detected
- * @note This is currently quadratic complexity. It could be improved by inserting new element sorted and binary search.
+ * If sorted, only the previous element is compared, otherwise the entry is looked
+ * up in and then added to the hash table. Both are constant time.
  */
 static int
-check_insert_duplicate(char **vec,
-		       int    i1,
-		       int    vlen,
-		       int    sorted)
+check_insert_duplicate(char  **vec,
+		       int     i1,
+		       int     vlen,
+		       int     sorted,
+		       int    *tab,
+		       size_t  tsize)
 {
-    int i;
-    int v;
-    char *b;
+    int      i;
+    int      v;
+    char    *b;
+    uint32_t h;
 
     if (sorted){
 	/* Just go look at previous element to see if it is duplicate (sorted by system) */
@@ -628,16 +884,20 @@ check_insert_duplicate(char **vec,
 	return -1;
     }
     else{
-	for (i=0; i<i1; i++){
+	h = unique_tuple_hash(&vec[i1*vlen], vlen) & (tsize-1);
+	while (tab[h] != 0){
+	    i = tab[h]-1;
 	    for (v=0; v<vlen; v++){
 		b = vec[i*vlen+v];
-		if (b == NULL || strcmp(b, vec[i1*vlen+v]))
+		if (strcmp(b, vec[i1*vlen+v]))
 		    break;
 	    }
 	    if (v==vlen) /* duplicate */
-		break;
+		return -1;
+	    h = (h+1) & (tsize-1);
 	}
-	return i==i1?0:-1;
+	tab[h] = i1+1;
+	return 0;
     }
 }
 
@@ -670,10 +930,13 @@ check_unique_list(cxobj     *x,
     int        v;
     char      *bi;
     int        sorted;
+    int       *tab = NULL; /* hash table of entries, if not sorted */
+    size_t     tsize = 0;
     
-    /* If list and is sorted by system, then it is assumed elements are in key-order which is optimized
-     * Other cases are "unique" constraint or list sorted by user which is quadratic in complexity
-     * This second case COULD be optimized if binary insert is made on the vec vector.
+    /* If list and is sorted by system, then it is assumed elements are in key-order,
+     * and only the previous element need to be compared.
+     * Other cases are "unique" constraint or list sorted by user where a hash table
+     * of the value tuples is used.
      */
     sorted = (yang_keyword_get(yu) == Y_LIST &&
 	      yang_find(y, Y_ORDERED_BY, "user") == NULL);
@@ -683,8 +946,16 @@ check_unique_list(cxobj     *x,
 	clicon_err(OE_UNIX, errno, "calloc");
 	goto done;
     }
-    /* A vector is built with key-values, for each iteration check "backward" in the vector
-     * for duplicates
+    if (!sorted){
+	/* At most half full */
+	for (tsize = 16; tsize < 2*(size_t)xml_child_nr(xt); tsize <<= 1);
+	if ((tab = calloc(tsize, sizeof(int))) == NULL){
+	    clicon_err(OE_UNIX, errno, "calloc");
+	    goto done;
+	}
+    }
+    /* A vector is built with key-values, for each iteration check if the new entry
+     * already exists
      */
     i = 0; /* x element index */
     do {
@@ -701,7 +972,7 @@ check_unique_list(cxobj     *x,
 	}
 	if (cvi==NULL){
 	    /* Last element (i) is newly inserted, see if it is already there */
-	    if (check_insert_duplicate(vec, i, vlen, sorted) < 0){
+	    if (check_insert_duplicate(vec, i, vlen, sorted, tab, tsize) < 0){
 		if (netconf_data_not_unique_xml(xret, x, cvk) < 0)
 		    goto done;
 		goto fail;
@@ -713,6 +984,8 @@ check_unique_list(cxobj     *x,
     /* It would be possible to cache vec here as an optimization */
     retval = 1;
  done:
+    if (tab)
+	free(tab);
     if (vec)
 	free(vec);
     return retval;
@@ -1093,6 +1366,140 @@ xml_yang_validate_list_key_only(cxobj        *xt,
     goto done;
 }
 
+/*! Validate constraints of a single XML node that may depend on other parts of the tree
+ *
+ * Node-local part of xml_yang_validate_all: leafref, identityref, must and when
+ * Children are not validated.
+ * @param[in]  xt    XML node to be validated
+ * @param[in]  ys    Yang spec of xt, config and not anyxml/anydata
+ * @param[out] xret  Error XML tree (if retval=0). Free with xml_free after use
+ * @retval     1     Validation OK
+ * @retval     0     Validation failed (xret set)
+ * @retval    -1     Error
+ * @see xml_yang_validate_all
+ */
+static int
+xml_yang_validate_node(cxobj     *xt, 
+		       yang_stmt *ys,
+		       cxobj    **xret)
+{
+    int        retval = -1;
+    yang_stmt *yc;  /* yang child */
+    yang_stmt *ye;  /* yang must error-message */
+    char      *xpath;
+    int        nr;
+    int        ret;
+    cbuf      *cb = NULL;
+    cvec      *nsc = NULL;
+
+    /* Node-specific validation */
+    switch (yang_keyword_get(ys)){
+    case Y_LEAF:
+	/* fall thru */
+    case Y_LEAF_LIST:
+	/* Special case if leaf is leafref, then first check against
+	   current xml tree
+	*/
+	/* Get base type yc */
+	if (yang_type_get(ys, NULL, &yc, NULL, NULL, NULL, NULL, NULL) < 0)
+	    goto done;
+	if (strcmp(yang_argument_get(yc), "leafref") == 0){
+	    if ((ret = validate_leafref(xt, ys, yc, xret)) < 0)
+		goto done;
+	    if (ret == 0)
+		goto fail;
+	}
+	else if (strcmp(yang_argument_get(yc), "identityref") == 0){
+	    if ((ret = validate_identityref(xt, ys, yc, xret)) < 0)
+		goto done;
+	    if (ret == 0)
+		goto fail;
+	}
+	break;
+    default:
+	break;
+    }
+    /* must sub-node RFC 7950 Sec 7.5.3. Can be several. 
+     * XXX. use yang path instead? */
+    yc = NULL;
+    while ((yc = yn_each(ys, yc)) != NULL) {
+	if (yang_keyword_get(yc) != Y_MUST)
+	    continue;
+	xpath = yang_argument_get(yc); /* "must" has xpath argument */
+	if (xml_nsctx_yang(yc, &nsc) < 0)
+	    goto done;
+	if ((nr = xpath_vec_bool(xt, nsc, "%s", xpath)) < 0)
+	    goto done;
+	if (!nr){
+	    ye = yang_find(yc, Y_ERROR_MESSAGE, NULL);
+	    if (netconf_operation_failed_xml(xret, "application", 
+					     ye?yang_argument_get(ye):"must xpath validation failed") < 0)
+		goto done;
+	    goto fail;
+	}
+	if (nsc){
+	    xml_nsctx_free(nsc);
+	    nsc = NULL;
+	}
+    }
+    /* "when" sub-node RFC 7950 Sec 7.21.5. Can only be one. */
+    if ((yc = yang_find(ys, Y_WHEN, NULL)) != NULL){
+	xpath = yang_argument_get(yc); /* "when" has xpath argument */
+	/* WHEN xpath needs namespace context */
+	if (xml_nsctx_yang(ys, &nsc) < 0)
+	    goto done;
+	if ((nr = xpath_vec_bool(xt, nsc, "%s", xpath)) < 0)
+	    goto done;
+	if (nsc){
+	    xml_nsctx_free(nsc);
+	    nsc = NULL;
+	}
+	if (nr == 0){
+	    if ((cb = cbuf_new()) == NULL){
+		clicon_err(OE_UNIX, errno, "cbuf_new");
+		goto done;
+	    }
+	    cprintf(cb, "Failed WHEN condition of %s in module %s",
+		    xml_name(xt),
+		    yang_argument_get(ys_module(ys)));
+	    if (netconf_operation_failed_xml(xret, "application", 
+					     cbuf_get(cb)) < 0)
+		goto done;
+	    goto fail;
+	}
+    }
+    /* Augmented when using special struct. */
+    if ((xpath = yang_when_xpath_get(ys)) != NULL){
+	if ((nr = xpath_vec_bool(xml_parent(xt), yang_when_nsc_get(ys),
+				 "%s", xpath)) < 0)
+	    goto done;
+	if (nr == 0){
+	    if ((cb = cbuf_new()) == NULL){
+		clicon_err(OE_UNIX, errno, "cbuf_new");
+		goto done;
+	    }
+	    cprintf(cb, "Failed augmented WHEN condition %s of node %s in module %s",
+		    xpath,
+		    xml_name(xt),
+		    yang_argument_get(ys_module(ys)));
+	    if (netconf_operation_failed_xml(xret, "application", 
+					     cbuf_get(cb)) < 0)
+		goto done;
+	    goto fail;
+	}
+    }
+    retval = 1;
+ done:
+    if (cb)
+	cbuf_free(cb);
+    if (nsc)
+	xml_nsctx_free(nsc);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
 /*! Validate a single XML node with yang specification for all (not only added) entries
  * 1. Check leafrefs. Eg you delete a leaf and a leafref references it.
  * @param[in]  xt  XML node to be validated
@@ -1120,16 +1527,11 @@ xml_yang_validate_all(clicon_handle h,
 {
     int        retval = -1;
     yang_stmt *ys;  /* yang node */
-    yang_stmt *yc;  /* yang child */
-    yang_stmt *ye;  /* yang must error-message */
-    char      *xpath;
-    int        nr;
     int        ret;
     cxobj     *x;
     cxobj     *xp;
     char      *ns = NULL;
     cbuf      *cb = NULL;
-    cvec      *nsc = NULL;
 
     /* if not given by argument (overide) use default link 
        and !Node has a config sub-statement and it is false */
@@ -1157,106 +1559,13 @@ xml_yang_validate_all(clicon_handle h,
 	goto fail;
     }
     if (yang_config(ys) != 0){
-	/* Node-specific validation */
-	switch (yang_keyword_get(ys)){
-	case Y_ANYXML:
-	case Y_ANYDATA:
+	if (yang_keyword_get(ys) == Y_ANYXML ||
+	    yang_keyword_get(ys) == Y_ANYDATA)
 	    goto ok;
-	    break;
-	case Y_LEAF:
-	    /* fall thru */
-	case Y_LEAF_LIST:
-	    /* Special case if leaf is leafref, then first check against
-	       current xml tree
- 	    */
-	    /* Get base type yc */
-	    if (yang_type_get(ys, NULL, &yc, NULL, NULL, NULL, NULL, NULL) < 0)
-		goto done;
-	    if (strcmp(yang_argument_get(yc), "leafref") == 0){
-		if ((ret = validate_leafref(xt, ys, yc, xret)) < 0)
-		    goto done;
-		if (ret == 0)
-		    goto fail;
-		}
-	    else if (strcmp(yang_argument_get(yc), "identityref") == 0){
-		if ((ret = validate_identityref(xt, ys, yc, xret)) < 0)
-		    goto done;
-		if (ret == 0)
-		    goto fail;
-	    }
-	    break;
-	default:
-	    break;
-	}
-	/* must sub-node RFC 7950 Sec 7.5.3. Can be several. 
-	 * XXX. use yang path instead? */
-	yc = NULL;
-	while ((yc = yn_each(ys, yc)) != NULL) {
-	    if (yang_keyword_get(yc) != Y_MUST)
-		continue;
-	    xpath = yang_argument_get(yc); /* "must" has xpath argument */
-	    if (xml_nsctx_yang(yc, &nsc) < 0)
-		goto done;
-	    if ((nr = xpath_vec_bool(xt, nsc, "%s", xpath)) < 0)
-		goto done;
-	    if (!nr){
-		ye = yang_find(yc, Y_ERROR_MESSAGE, NULL);
-		if (netconf_operation_failed_xml(xret, "application", 
-						 ye?yang_argument_get(ye):"must xpath validation failed") < 0)
-		    goto done;
-		goto fail;
-	    }
-	    if (nsc){
-		xml_nsctx_free(nsc);
-		nsc = NULL;
-	    }
-	}
-	/* "when" sub-node RFC 7950 Sec 7.21.5. Can only be one. */
-	if ((yc = yang_find(ys, Y_WHEN, NULL)) != NULL){
-	    xpath = yang_argument_get(yc); /* "when" has xpath argument */
-	    /* WHEN xpath needs namespace context */
-	    if (xml_nsctx_yang(ys, &nsc) < 0)
-		goto done;
-	    if ((nr = xpath_vec_bool(xt, nsc, "%s", xpath)) < 0)
-		goto done;
-	    if (nsc){
-		xml_nsctx_free(nsc);
-		nsc = NULL;
-	    }
-	    if (nr == 0){
-		if ((cb = cbuf_new()) == NULL){
-		    clicon_err(OE_UNIX, errno, "cbuf_new");
-		    goto done;
-		}
-		cprintf(cb, "Failed WHEN condition of %s in module %s",
-			xml_name(xt),
-			yang_argument_get(ys_module(ys)));
-		if (netconf_operation_failed_xml(xret, "application", 
-						 cbuf_get(cb)) < 0)
-		    goto done;
-		goto fail;
-	    }
-	}
-	/* Augmented when using special struct. */
-	if ((xpath = yang_when_xpath_get(ys)) != NULL){
-	    if ((nr = xpath_vec_bool(xml_parent(xt), yang_when_nsc_get(ys),
-				     "%s", xpath)) < 0)
-		goto done;
-	    if (nr == 0){
-		if ((cb = cbuf_new()) == NULL){
-		    clicon_err(OE_UNIX, errno, "cbuf_new");
-		    goto done;
-		}
-		cprintf(cb, "Failed augmented WHEN condition %s of node %s in module %s",
-			xpath,
-			xml_name(xt),
-			yang_argument_get(ys_module(ys)));
-		if (netconf_operation_failed_xml(xret, "application", 
-						 cbuf_get(cb)) < 0)
-		    goto done;
-		goto fail;
-	    }
-	}
+	if ((ret = xml_yang_validate_node(xt, ys, xret)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto fail;
     }
     x = NULL;
     while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
@@ -1278,8 +1587,6 @@ xml_yang_validate_all(clicon_handle h,
  done:
     if (cb)
 	cbuf_free(cb);
-    if (nsc)
-	xml_nsctx_free(nsc);
     return retval;
  fail:
     retval = 0;
@@ -1296,15 +1603,844 @@ xml_yang_validate_all_top(clicon_handle h,
 			  cxobj        *xt, 
 			  cxobj       **xret)
 {
+    int    retval = -1;
     int    ret;
     cxobj *x;
 
+    if (xml_leafref_cache_begin() < 0)
+	goto done;
     x = NULL;
     while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
-	if ((ret = xml_yang_validate_all(h, x, xret)) < 1)
-	    return ret;
+	if ((ret = xml_yang_validate_all(h, x, xret)) < 1){
+	    retval = ret;
+	    goto done;
+	}
     }
-    if ((ret = check_list_unique_minmax(xt, xret)) < 1)
-	return ret;
-    return 1;
+    if ((retval = check_list_unique_minmax(xt, xret)) < 1)
+	goto done;
+    retval = 1;
+ done:
+    xml_leafref_cache_end();
+    return retval;
+}
+
+/*
+ * Incremental validation
+ * A dependency index is built from the yang spec: it maps a schema node to the
+ * schema nodes whose constraints (must, when, leafref path) refer to it.
+ * The xpath of each constraint is resolved on the schema tree, starting from the
+ * schema node of its context node, to the nodes it selects. Prefixes are ignored,
+ * ie a step selects same-named children of all modules.
+ * On commit, only the following are re-validated:
+ * - added and changed subtrees (fully)
+ * - parents and ancestors of added, changed and deleted nodes (must, when, unique,
+ *   min/max-elements)
+ * - all instances of schema nodes whose constraints refer to an added, changed or
+ *   deleted node, or to one of its ancestors (must, when, leafref)
+ * Constraints that cannot be resolved on the schema tree (other axes than child,
+ * self and parent, '//', node tests, deref(), unknown names) depend on any node.
+ * Ie, the index may contain false dependencies but not miss any.
+ */
+/* Name of clicon data entry holding the dependency index */
+#define VALIDATE_DEPS_KEY "validate_deps"
+/* Index entry for constraints that may depend on any node */
+#define VALIDATE_DEPS_ANY "*"
+
+/*! Get dependency index key of a schema node
+ * @param[in]  y     Schema node, or NULL for any node
+ * @param[out] buf   Buffer for the key
+ * @param[in]  len   Length of buf
+ * @retval     key   Key, either buf or VALIDATE_DEPS_ANY
+ */
+static char *
+validate_deps_key(yang_stmt *y,
+		  char      *buf,
+		  size_t     len)
+{
+    if (y == NULL)
+	return VALIDATE_DEPS_ANY;
+    snprintf(buf, len, "%p", y);
+    return buf;
+}
+
+/*! Add a schema node to a vector unless already there
+ * @param[in]     y     Schema node
+ * @param[in,out] yvec  Vector of schema nodes
+ * @param[in,out] ylen  Length of yvec
+ * @retval        0     OK
+ * @retval       -1     Error
+ */
+static int
+validate_deps_vec_add(yang_stmt   *y,
+		      yang_stmt ***yvec,
+		      int         *ylen)
+{
+    int i;
+
+    for (i=0; i<*ylen; i++)
+	if ((*yvec)[i] == y)
+	    return 0;
+    if ((*yvec = realloc(*yvec, (*ylen+1)*sizeof(yang_stmt *))) == NULL){
+	clicon_err(OE_UNIX, errno, "realloc");
+	return -1;
+    }
+    (*yvec)[(*ylen)++] = y;
+    return 0;
+}
+
+/*! Add a schema node as depending on another schema node in the dependency index
+ * @param[in]  deps  Dependency index
+ * @param[in]  yref  Schema node referred to by a constraint of ys, NULL for any node
+ * @param[in]  ys    Yang node with the constraint
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+validate_deps_add(clicon_hash_t *deps,
+		  yang_stmt     *yref,
+		  yang_stmt     *ys)
+{
+    int         retval = -1;
+    char        buf[32];
+    char       *key;
+    yang_stmt **vec;
+    yang_stmt **vec1 = NULL;
+    size_t      vlen = 0;
+    int         n;
+    int         i;
+
+    /* The root changes with any node */
+    if (yref && yang_keyword_get(yref) == Y_SPEC)
+	yref = NULL;
+    key = validate_deps_key(yref, buf, sizeof(buf));
+    n = 0;
+    if ((vec = clicon_hash_value(deps, key, &vlen)) != NULL)
+	n = vlen/sizeof(yang_stmt *);
+    for (i=0; i<n; i++)
+	if (vec[i] == ys)
+	    goto ok;
+    if ((vec1 = malloc((n+1)*sizeof(yang_stmt *))) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	goto done;
+    }
+    if (n)
+	memcpy(vec1, vec, n*sizeof(yang_stmt *));
+    vec1[n] = ys;
+    if (clicon_hash_add(deps, key, vec1, (n+1)*sizeof(yang_stmt *)) == NULL)
+	goto done;
+ ok:
+    retval = 0;
+ done:
+    if (vec1)
+	free(vec1);
+    return retval;
+}
+
+/*! Get schema node of the parent data node, skipping choice and case
+ * @param[in]  ys    Schema node
+ * @retval     yp    Schema node of parent, the yang spec for top-level nodes
+ * @retval     NULL  No parent, ys is the yang spec
+ */
+static yang_stmt *
+validate_deps_parent(yang_stmt *ys)
+{
+    yang_stmt *yp = ys;
+
+    while ((yp = yang_parent_get(yp)) != NULL){
+	switch (yang_keyword_get(yp)){
+	case Y_CHOICE:
+	case Y_CASE:
+	    break;
+	case Y_MODULE:
+	case Y_SUBMODULE:
+	    return ys_spec(yp);
+	default:
+	    return yp;
+	}
+    }
+    return NULL;
+}
+
+/*! Add schema nodes of child data nodes with a name to a vector
+ * Module, submodule, choice and case are transparent
+ * @param[in]     yp    Schema node of parent, or yang spec
+ * @param[in]     name  Name of child, NULL for any name
+ * @param[in,out] yvec  Vector of schema nodes
+ * @param[in,out] ylen  Length of yvec
+ * @retval        0     OK
+ * @retval       -1     Error
+ */
+static int
+validate_deps_children(yang_stmt   *yp,
+		       char        *name,
+		       yang_stmt ***yvec,
+		       int         *ylen)
+{
+    yang_stmt *yc = NULL;
+
+    while ((yc = yn_each(yp, yc)) != NULL) {
+	switch (yang_keyword_get(yc)){
+	case Y_MODULE:
+	case Y_SUBMODULE:
+	case Y_CHOICE:
+	case Y_CASE:
+	    if (validate_deps_children(yc, name, yvec, ylen) < 0)
+		return -1;
+	    break;
+	case Y_CONTAINER:
+	case Y_LIST:
+	case Y_LEAF:
+	case Y_LEAF_LIST:
+	case Y_ANYXML:
+	case Y_ANYDATA:
+	    if (name != NULL && strcmp(name, yang_argument_get(yc)) != 0)
+		break;
+	    if (validate_deps_vec_add(yc, yvec, ylen) < 0)
+		return -1;
+	    break;
+	default:
+	    break;
+	}
+    }
+    return 0;
+}
+
+/*! Resolve an xpath parse tree on the schema tree and add its dependencies
+ *
+ * Every path (pathexpr) in the expression, including paths in predicates and
+ * function arguments, adds the schema nodes it selects as dependencies of ys.
+ * @param[in]  deps  Dependency index
+ * @param[in]  ys    Yang node with the constraint
+ * @param[in]  ycur  Schema node of the context node of the constraint, ie current()
+ * @param[in]  xs    XPath parse tree
+ * @param[in]  yctx  Schema nodes of context
+ * @param[in]  nctx  Length of yctx
+ * @param[out] yres  Schema nodes selected by xs, if a node-set (NULL if not needed)
+ * @param[out] nres  Length of yres
+ * @retval     1     OK
+ * @retval     0     Not resolvable on the schema tree
+ * @retval    -1     Error
+ */
+static int
+validate_deps_expr(clicon_hash_t *deps,
+		   yang_stmt     *ys,
+		   yang_stmt     *ycur,
+		   xpath_tree    *xs,
+		   yang_stmt    **yctx,
+		   int            nctx,
+		   yang_stmt   ***yres,
+		   int           *nres)
+{
+    int         retval = -1;
+    yang_stmt **vec0 = NULL;
+    int         n0 = 0;
+    yang_stmt **vec1 = NULL;
+    int         n1 = 0;
+    yang_stmt  *yspec;
+    yang_stmt  *yp;
+    int         i;
+    int         ret = 0;
+
+    if (xs == NULL)
+	goto ok;
+    switch (xs->xs_type){
+    case XP_EXP:
+    case XP_AND:
+    case XP_RELEX:
+    case XP_ADD:
+    case XP_UNION:
+    case XP_PRI0:
+    case XP_FILTEREXPR:
+    case XP_LOCPATH:
+	if ((ret = validate_deps_expr(deps, ys, ycur, xs->xs_c0, yctx, nctx, &vec0, &n0)) <= 0)
+	    goto unresolved;
+	if ((ret = validate_deps_expr(deps, ys, ycur, xs->xs_c1, yctx, nctx, &vec1, &n1)) <= 0)
+	    goto unresolved;
+	/* Node-set is passed up from single child or union, other operators do not
+	 * return node-sets */
+	if (xs->xs_type == XP_UNION){
+	    for (i=0; i<n1; i++)
+		if (validate_deps_vec_add(vec1[i], &vec0, &n0) < 0)
+		    goto done;
+	}
+	else if (xs->xs_c1 != NULL)
+	    n0 = 0;
+	break;
+    case XP_PATHEXPR: /* locationpath or filterexpr [/ rellocpath] */
+	if ((ret = validate_deps_expr(deps, ys, ycur, xs->xs_c0, yctx, nctx, &vec0, &n0)) <= 0)
+	    goto unresolved;
+	if (xs->xs_c1 != NULL){
+	    if ((ret = validate_deps_expr(deps, ys, ycur, xs->xs_c1, vec0, n0, &vec1, &n1)) <= 0)
+		goto unresolved;
+	    free(vec0);
+	    vec0 = vec1;
+	    n0 = n1;
+	    vec1 = NULL;
+	    n1 = 0;
+	}
+	for (i=0; i<n0; i++)
+	    if (validate_deps_add(deps, vec0[i], ys) < 0)
+		goto done;
+	break;
+    case XP_ABSPATH:
+	if (xs->xs_int != A_ROOT)
+	    goto unresolved;
+	yspec = ys_spec(ys);
+	if (xs->xs_c0 == NULL){
+	    if (validate_deps_vec_add(yspec, &vec0, &n0) < 0)
+		goto done;
+	}
+	else if ((ret = validate_deps_expr(deps, ys, ycur, xs->xs_c0, &yspec, 1, &vec0, &n0)) <= 0)
+	    goto unresolved;
+	break;
+    case XP_RELLOCPATH:
+	if (xs->xs_int == A_DESCENDANT_OR_SELF)
+	    goto unresolved;
+	if ((ret = validate_deps_expr(deps, ys, ycur, xs->xs_c0, yctx, nctx, &vec0, &n0)) <= 0)
+	    goto unresolved;
+	if (xs->xs_c1 != NULL){
+	    if ((ret = validate_deps_expr(deps, ys, ycur, xs->xs_c1, vec0, n0, &vec1, &n1)) <= 0)
+		goto unresolved;
+	    free(vec0);
+	    vec0 = vec1;
+	    n0 = n1;
+	    vec1 = NULL;
+	    n1 = 0;
+	}
+	break;
+    case XP_STEP:
+	switch (xs->xs_int){
+	case A_CHILD:
+	    if (xs->xs_c0 == NULL || xs->xs_c0->xs_type != XP_NODE)
+		goto unresolved;
+	    for (i=0; i<nctx; i++)
+		if (validate_deps_children(yctx[i], xs->xs_c0->xs_s1, &vec0, &n0) < 0)
+		    goto done;
+	    /* Unknown name, maybe a schema construct not handled here */
+	    if (nctx && n0 == 0)
+		goto unresolved;
+	    break;
+	case A_SELF:
+	    for (i=0; i<nctx; i++)
+		if (validate_deps_vec_add(yctx[i], &vec0, &n0) < 0)
+		    goto done;
+	    break;
+	case A_PARENT:
+	    for (i=0; i<nctx; i++)
+		if ((yp = validate_deps_parent(yctx[i])) != NULL &&
+		    validate_deps_vec_add(yp, &vec0, &n0) < 0)
+		    goto done;
+	    break;
+	default:
+	    goto unresolved;
+	}
+	/* Predicates have the selected nodes as context */
+	if ((ret = validate_deps_expr(deps, ys, ycur, xs->xs_c1, vec0, n0, NULL, NULL)) <= 0)
+	    goto unresolved;
+	break;
+    case XP_PRED:
+	if ((ret = validate_deps_expr(deps, ys, ycur, xs->xs_c0, yctx, nctx, NULL, NULL)) <= 0)
+	    goto unresolved;
+	if ((ret = validate_deps_expr(deps, ys, ycur, xs->xs_c1, yctx, nctx, NULL, NULL)) <= 0)
+	    goto unresolved;
+	break;
+    case XP_PRIME_NR:
+    case XP_PRIME_STR:
+	break;
+    case XP_PRIME_FN:
+	switch (xs->xs_int){
+	case XPATHFN_CURRENT:
+	    if (validate_deps_vec_add(ycur, &vec0, &n0) < 0)
+		goto done;
+	    break;
+	case XPATHFN_DEREF:
+	    goto unresolved;
+	    break;
+	default: /* Arguments only */
+	    if ((ret = validate_deps_expr(deps, ys, ycur, xs->xs_c0, yctx, nctx, NULL, NULL)) <= 0)
+		goto unresolved;
+	    break;
+	}
+	break;
+    default:
+	goto unresolved;
+	break;
+    }
+ ok:
+    if (yres){
+	*yres = vec0;
+	*nres = n0;
+	vec0 = NULL;
+    }
+    retval = 1;
+ done:
+    if (vec0)
+	free(vec0);
+    if (vec1)
+	free(vec1);
+    return retval;
+ unresolved:
+    if (ret < 0)
+	goto done;
+    retval = 0;
+    goto done;
+}
+
+/*! Parse xpath of a constraint and add the schema nodes it refers to to the dependency index
+ * @param[in]  deps  Dependency index
+ * @param[in]  xpath XPath of must, when or leafref path
+ * @param[in]  ys    Yang node with the constraint
+ * @param[in]  yctx  Schema node of the context node of the xpath
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+validate_deps_xpath(clicon_hash_t *deps,
+		    char          *xpath,
+		    yang_stmt     *ys,
+		    yang_stmt     *yctx)
+{
+    int         retval = -1;
+    xpath_tree *xptree = NULL;
+    yang_stmt **yvec = NULL;
+    int         ylen = 0;
+    int         i;
+    int         ret;
+
+    /* Not parseable or resolvable here: assume it may depend on anything */
+    if (yctx == NULL || xpath_parse(xpath, &xptree) < 0)
+	ret = 0;
+    else if ((ret = validate_deps_expr(deps, ys, yctx, xptree, &yctx, 1, &yvec, &ylen)) < 0)
+	goto done;
+    if (ret == 0){
+	if (validate_deps_add(deps, NULL, ys) < 0)
+	    goto done;
+    }
+    else
+	for (i=0; i<ylen; i++)
+	    if (validate_deps_add(deps, yvec[i], ys) < 0)
+		goto done;
+    retval = 0;
+ done:
+    if (yvec)
+	free(yvec);
+    if (xptree)
+	xpath_tree_free(xptree);
+    return retval;
+}
+
+/*! Recursively add constraints of config data nodes to the dependency index
+ * @param[in]  deps  Dependency index
+ * @param[in]  yn    Yang node whose children are traversed
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+validate_deps_build(clicon_hash_t *deps,
+		    yang_stmt     *yn)
+{
+    yang_stmt   *ys = NULL;
+    yang_stmt   *yc;
+    yang_stmt   *yrestype;
+    char        *xpath;
+    enum rfc_6020 keyw;
+
+    while ((ys = yn_each(yn, ys)) != NULL) {
+	keyw = yang_keyword_get(ys);
+	switch (keyw){
+	case Y_MODULE:
+	case Y_SUBMODULE:
+	case Y_CHOICE:
+	case Y_CASE:
+	    if (validate_deps_build(deps, ys) < 0)
+		return -1;
+	    continue;
+	case Y_CONTAINER:
+	case Y_LIST:
+	case Y_LEAF:
+	case Y_LEAF_LIST:
+	    break;
+	default:
+	    continue;
+	}
+	if (yang_config(ys) == 0)
+	    continue;
+	yc = NULL;
+	while ((yc = yn_each(ys, yc)) != NULL) 
+	    if (yang_keyword_get(yc) == Y_MUST &&
+		validate_deps_xpath(deps, yang_argument_get(yc), ys, ys) < 0)
+		return -1;
+	if ((yc = yang_find(ys, Y_WHEN, NULL)) != NULL &&
+	    validate_deps_xpath(deps, yang_argument_get(yc), ys, ys) < 0)
+	    return -1;
+	/* Augmented when has the parent as context node */
+	if ((xpath = yang_when_xpath_get(ys)) != NULL &&
+	    validate_deps_xpath(deps, xpath, ys, validate_deps_parent(ys)) < 0)
+	    return -1;
+	if (keyw == Y_LEAF || keyw == Y_LEAF_LIST){
+	    yrestype = NULL;
+	    if (yang_type_get(ys, NULL, &yrestype, NULL, NULL, NULL, NULL, NULL) < 0)
+		return -1;
+	    if (yrestype && strcmp(yang_argument_get(yrestype), "leafref") == 0 &&
+		(yc = yang_find(yrestype, Y_PATH, NULL)) != NULL &&
+		validate_deps_xpath(deps, yang_argument_get(yc), ys, ys) < 0)
+		return -1;
+	}
+	if (keyw == Y_CONTAINER || keyw == Y_LIST)
+	    if (validate_deps_build(deps, ys) < 0)
+		return -1;
+    }
+    return 0;
+}
+
+/*! Get dependency index, build it from the yang spec if not done before
+ * @param[in]  h     Clicon handle
+ * @retval     deps  Dependency index
+ * @retval     NULL  Error
+ */
+static clicon_hash_t *
+validate_deps_get(clicon_handle h)
+{
+    clicon_hash_t *cdat = clicon_data(h);
+    clicon_hash_t *deps = NULL;
+    yang_stmt     *yspec;
+    void          *p;
+
+    if ((p = clicon_hash_value(cdat, VALIDATE_DEPS_KEY, NULL)) != NULL)
+	return *(clicon_hash_t **)p;
+    if ((yspec = clicon_dbspec_yang(h)) == NULL){
+	clicon_err(OE_YANG, ENOENT, "No yang spec");
+	goto err;
+    }
+    if ((deps = clicon_hash_init()) == NULL)
+	goto err;
+    if (validate_deps_build(deps, yspec) < 0)
+	goto err;
+    if (clicon_hash_add(cdat, VALIDATE_DEPS_KEY, &deps, sizeof(deps)) == NULL)
+	goto err;
+    return deps;
+ err:
+    if (deps)
+	clicon_hash_free(deps);
+    return NULL;
+}
+
+/*! Free dependency index used by incremental validation
+ * @param[in]  h     Clicon handle
+ * @retval     0     OK
+ * @see xml_yang_validate_changes
+ */
+int
+xml_yang_validate_deps_free(clicon_handle h)
+{
+    clicon_hash_t *cdat = clicon_data(h);
+    void          *p;
+
+    if ((p = clicon_hash_value(cdat, VALIDATE_DEPS_KEY, NULL)) != NULL){
+	clicon_hash_free(*(clicon_hash_t **)p);
+	clicon_hash_del(cdat, VALIDATE_DEPS_KEY);
+    }
+    return 0;
+}
+
+/*! Add schema nodes depending on a schema node (from the dependency index) to a vector
+ * @param[in]     deps  Dependency index
+ * @param[in]     y     Schema node, NULL for constraints depending on any node
+ * @param[in,out] yvec  Vector of schema nodes, no duplicates
+ * @param[in,out] ylen  Length of yvec
+ * @retval        0     OK
+ * @retval       -1     Error
+ */
+static int
+validate_deps_lookup(clicon_hash_t *deps,
+		     yang_stmt     *y,
+		     yang_stmt   ***yvec,
+		     int           *ylen)
+{
+    char        buf[32];
+    yang_stmt **vec;
+    size_t      vlen = 0;
+    int         i;
+
+    if ((vec = clicon_hash_value(deps, validate_deps_key(y, buf, sizeof(buf)), &vlen)) == NULL)
+	return 0;
+    for (i=0; i<vlen/sizeof(yang_stmt *); i++)
+	if (validate_deps_vec_add(vec[i], yvec, ylen) < 0)
+	    return -1;
+    return 0;
+}
+
+/*! Add schema nodes depending on the descendants of an XML node to a vector
+ * @param[in]     deps    Dependency index
+ * @param[in]     x       Added or deleted XML node
+ * @param[in,out] yvec    Vector of schema nodes, no duplicates
+ * @param[in,out] ylen    Length of yvec
+ * @retval        0       OK
+ * @retval       -1       Error
+ */
+static int
+validate_deps_descendants(clicon_hash_t *deps,
+			  cxobj         *x,
+			  yang_stmt   ***yvec,
+			  int           *ylen)
+{
+    cxobj *xc = NULL;
+
+    while ((xc = xml_child_each(x, xc, CX_ELMNT)) != NULL){
+	if (xml_spec(xc) != NULL &&
+	    validate_deps_lookup(deps, xml_spec(xc), yvec, ylen) < 0)
+	    return -1;
+	if (validate_deps_descendants(deps, xc, yvec, ylen) < 0)
+	    return -1;
+    }
+    return 0;
+}
+
+/*! Add schema nodes depending on an XML node, and optionally its subtree, to a vector
+ * Nodes depending on ancestors of x are also added, since the string value of an
+ * ancestor changes with x.
+ * @param[in]     deps    Dependency index
+ * @param[in]     x       Added, deleted or changed XML node
+ * @param[in]     recurse If set, also nodes depending on the subtree of x
+ * @param[in,out] yvec    Vector of schema nodes, no duplicates
+ * @param[in,out] ylen    Length of yvec
+ * @retval        0       OK
+ * @retval       -1       Error
+ */
+static int
+validate_deps_observers(clicon_hash_t *deps,
+			cxobj         *x,
+			int            recurse,
+			yang_stmt   ***yvec,
+			int           *ylen)
+{
+    cxobj *xa;
+
+    for (xa = x; xa != NULL; xa = xml_parent(xa))
+	if (xml_spec(xa) != NULL &&
+	    validate_deps_lookup(deps, xml_spec(xa), yvec, ylen) < 0)
+	    return -1;
+    if (recurse && validate_deps_descendants(deps, x, yvec, ylen) < 0)
+	return -1;
+    return 0;
+}
+
+/*! Find all instances of a schema node in an XML tree
+ * Only descends into children whose schema node is an ancestor of ys
+ * @param[in]     xt     XML tree
+ * @param[in]     ys     Yang schema node
+ * @param[in,out] vec    Vector of XML nodes with spec ys
+ * @param[in,out] veclen Length of vec
+ * @retval        0      OK
+ * @retval       -1      Error
+ */
+static int
+xml_yang_instances(cxobj     *xt,
+		   yang_stmt *ys,
+		   cxobj   ***vec,
+		   int       *veclen)
+{
+    cxobj     *x = NULL;
+    yang_stmt *yc;
+    yang_stmt *ya;
+
+    while ((x = xml_child_each(xt, x, CX_ELMNT)) != NULL) {
+	if ((yc = xml_spec(x)) == NULL)
+	    continue;
+	if (yc == ys){
+	    if (cxvec_append(x, vec, veclen) < 0)
+		return -1;
+	    continue;
+	}
+	for (ya = yang_parent_get(ys); ya != NULL; ya = yang_parent_get(ya))
+	    if (ya == yc)
+		break;
+	if (ya != NULL && xml_yang_instances(x, ys, vec, veclen) < 0)
+	    return -1;
+    }
+    return 0;
+}
+
+/*! Find node in XML tree corresponding to a node in another tree with same structure
+ * @param[in]  xt    Top of XML tree to search in
+ * @param[in]  x     XML node in other tree, eg a deleted node in running
+ * @param[out] xp    Corresponding node in xt, or NULL if not found
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+xml_same_node(cxobj  *xt,
+	      cxobj  *x,
+	      cxobj **xp)
+{
+    cxobj *xparent;
+
+    *xp = NULL;
+    if ((xparent = xml_parent(x)) == NULL){
+	*xp = xt;
+	return 0;
+    }
+    if (xml_same_node(xt, xparent, &xparent) < 0)
+	return -1;
+    if (xparent == NULL)
+	return 0;
+    return match_base_child(xparent, x, xml_spec(x), xp);
+}
+
+/*! Add an XML node and its ancestors to a vector
+ */
+static int
+cxvec_append_ancestors(cxobj   *x,
+		       cxobj ***vec,
+		       int     *veclen)
+{
+    for (; x != NULL; x = xml_parent(x))
+	if (cxvec_append(x, vec, veclen) < 0)
+	    return -1;
+    return 0;
+}
+
+/*! Sort XML node pointers, for removing duplicates
+ */
+static int
+cxvec_ptr_cmp(const void *a,
+	      const void *b)
+{
+    cxobj *xa = *(cxobj **)a;
+    cxobj *xb = *(cxobj **)b;
+    
+    return (xa > xb) - (xa < xb);
+}
+
+/*! Validate an XML tree incrementally given the changes from a valid tree
+ *
+ * Same result as xml_yang_validate_all_top, assuming the tree was valid before
+ * the changes, but only constraints that may be affected by the changes are checked.
+ * @param[in]  h     Clicon handle
+ * @param[in]  xt    XML tree to be validated (target)
+ * @param[in]  dvec  Deleted nodes (in source tree)
+ * @param[in]  dlen  Length of dvec
+ * @param[in]  avec  Added nodes (in target tree)
+ * @param[in]  alen  Length of avec
+ * @param[in]  cvec  Changed nodes (in target tree)
+ * @param[in]  clen  Length of cvec
+ * @param[out] xret  Error XML tree (if ret == 0). Free with xml_free after use
+ * @retval     1     Validation OK
+ * @retval     0     Validation failed (xret set)
+ * @retval    -1     Error
+ * @see xml_yang_validate_all_top  for full validation
+ * @see xml_diff  for computing the changes
+ */
+int
+xml_yang_validate_changes(clicon_handle h,
+			  cxobj        *xt, 
+			  cxobj       **dvec,
+			  int           dlen,
+			  cxobj       **avec,
+			  int           alen,
+			  cxobj       **cvec,
+			  int           clen,
+			  cxobj       **xret)
+{
+    int            retval = -1;
+    clicon_hash_t *deps;
+    cxobj        **xvec = NULL; /* Nodes to check locally */
+    int            xlen = 0;
+    cxobj        **ivec = NULL; /* Instances of depending schema nodes */
+    int            ilen = 0;
+    yang_stmt    **yvec = NULL; /* Depending schema nodes */
+    int            ylen = 0;
+    yang_stmt     *ys;
+    cxobj         *x;
+    cxobj         *xp;
+    int            i;
+    int            j;
+    int            ret;
+    int            cache = 0;
+
+    if (dlen + alen + clen == 0)
+	goto ok;
+    if (xml_leafref_cache_begin() < 0)
+	goto done;
+    cache = 1;
+    if ((deps = validate_deps_get(h)) == NULL)
+	goto done;
+    if (validate_deps_lookup(deps, NULL, &yvec, &ylen) < 0)
+	goto done;
+    /* Added and changed subtrees are validated fully */
+    for (i=0; i<alen+clen; i++){
+	x = i<alen ? avec[i] : cvec[i-alen];
+	if ((ret = xml_yang_validate_all(h, x, xret)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto fail;
+	if (cxvec_append_ancestors(xml_parent(x), &xvec, &xlen) < 0)
+	    goto done;
+	if (validate_deps_observers(deps, x, i<alen, &yvec, &ylen) < 0)
+	    goto done;
+    }
+    /* Deleted subtrees: check where they were removed from */
+    for (i=0; i<dlen; i++){
+	x = dvec[i];
+	if (xml_same_node(xt, xml_parent(x), &xp) < 0)
+	    goto done;
+	if (xp == NULL){ /* Should not happen, fall back to full validation */
+	    retval = xml_yang_validate_all_top(h, xt, xret);
+	    goto done;
+	}
+	if (cxvec_append_ancestors(xp, &xvec, &xlen) < 0)
+	    goto done;
+	if (validate_deps_observers(deps, x, 1, &yvec, &ylen) < 0)
+	    goto done;
+    }
+    /* Parents and ancestors: must, when, unique and min/max-elements */
+    qsort(xvec, xlen, sizeof(cxobj *), cxvec_ptr_cmp);
+    for (i=0; i<xlen; i++){
+	x = xvec[i];
+	if (i>0 && x == xvec[i-1])
+	    continue;
+	if (xml_parent(x) != NULL){
+	    if ((ys = xml_spec(x)) == NULL ||
+		yang_config(ys) == 0 ||
+		yang_keyword_get(ys) == Y_ANYXML ||
+		yang_keyword_get(ys) == Y_ANYDATA)
+		continue;
+	    if ((ret = xml_yang_validate_node(x, ys, xret)) < 0)
+		goto done;
+	    if (ret == 0)
+		goto fail;
+	}
+	if ((ret = check_list_unique_minmax(x, xret)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto fail;
+    }
+    /* Nodes whose constraints refer to changed nodes */
+    for (j=0; j<ylen; j++){
+	ys = yvec[j];
+	ilen = 0;
+	if (xml_yang_instances(xt, ys, &ivec, &ilen) < 0)
+	    goto done;
+	for (i=0; i<ilen; i++){
+	    if ((ret = xml_yang_validate_node(ivec[i], ys, xret)) < 0)
+		goto done;
+	    if (ret == 0)
+		goto fail;
+	}
+    }
+ ok:
+    retval = 1;
+ done:
+    if (cache)
+	xml_leafref_cache_end();
+    if (xvec)
+	free(xvec);
+    if (ivec)
+	free(ivec);
+    if (yvec)
+	free(yvec);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
 }
@@ -126,6 +126,20 @@ struct search_index{
 };
 #endif
 
+static int xml_dirty_free(cxobj *x);
+static int xml_dirty_child_rm(cxobj *xp, cxobj *xc);
+
+/* Children of an XML node modified by edits since the dirty marks were reset
+ * Removed children are kept as copies of their name and keys only
+ * @see xml_dirty_mark
+ */
+struct xml_dirty{
+    cxobj      **xd_vec;   /* Children marked with XML_FLAG_DIRTY */
+    int          xd_len;   /* Length of xd_vec */
+    cxobj      **xd_rmvec; /* Name and key copies of removed children */
+    int          xd_rmlen; /* Length of xd_rmvec */
+};
+
 /*! xml tree node, with name, type, parent, children, etc 
  * Note that this is a private type not visible from externally, use
  * access functions.
@@ -185,6 +199,7 @@ struct xml{
 #ifdef XML_EXPLICIT_INDEX
     struct search_index *x_search_index; /* explicit search index vectors */
 #endif
+    struct xml_dirty *x_dirty;      /* Children modified by edits, see xml_dirty_mark */
 };
 
 /* Variant of struct xml for use by non-elements to save space
@@ -273,6 +288,9 @@ xml_stats_one(cxobj    *x,
 		sz += clixon_xvec_len(x->x_search_index->si_xvec)*sizeof(struct cxobj*);
 	}
 #endif
+	if (x->x_dirty)
+	    sz += sizeof(struct xml_dirty) +
+		(x->x_dirty->xd_len + x->x_dirty->xd_rmlen)*sizeof(struct xml*);
 	break;
     case CX_BODY:
     case CX_ATTR:
@@ -1411,6 +1429,9 @@ xml_child_rm(cxobj *xp,
 
     }
 #endif
+    if (xml_type(xc) == CX_ELMNT && xml_flag(xc, XML_FLAG_DIRTY))
+	if (xml_dirty_child_rm(xp, xc) < 0)
+	    goto done;
     retval = 0;
  done:
     return retval;
@@ -1481,6 +1502,241 @@ xml_rm_children(cxobj          *xp,
     return retval;
 }
 
+/*! Get the record of modified children of an XML node, create it if it does not exist
+ * @param[in]  x    XML element
+ * @retval     xd   Record of dirty and removed children
+ * @retval     NULL Error
+ */
+static struct xml_dirty *
+xml_dirty_record(cxobj *x)
+{
+    if (x->x_dirty == NULL){
+	if ((x->x_dirty = malloc(sizeof(struct xml_dirty))) == NULL){
+	    clicon_err(OE_XML, errno, "malloc");
+	    return NULL;
+	}
+	memset(x->x_dirty, 0, sizeof(struct xml_dirty));
+    }
+    return x->x_dirty;
+}
+
+/*! Free the record of modified children of an XML node
+ * @param[in]  x    XML element
+ * @retval     0    OK
+ */
+static int
+xml_dirty_free(cxobj *x)
+{
+    struct xml_dirty *xd;
+    int               i;
+
+    if ((xd = x->x_dirty) == NULL)
+	return 0;
+    if (xd->xd_vec)
+	free(xd->xd_vec);
+    for (i=0; i<xd->xd_rmlen; i++)
+	xml_free(xd->xd_rmvec[i]);
+    if (xd->xd_rmvec)
+	free(xd->xd_rmvec);
+    free(xd);
+    x->x_dirty = NULL;
+    return 0;
+}
+
+/*! Copy name, yang spec and keys of an XML element
+ *
+ * The copy is xml_cmp() equal to the original and can be used to look it up, 
+ * see match_base_child.
+ * @param[in]  x    XML element
+ * @retval     xk   Copy, free with xml_free
+ * @retval     NULL Error
+ */
+static cxobj *
+xml_dirty_keycopy(cxobj *x)
+{
+    cxobj     *xk = NULL;
+    cxobj     *xc;
+    cxobj     *xkc;
+    yang_stmt *y;
+    cvec      *cvk;
+    cg_var    *cvi = NULL;
+    char      *keyname;
+
+    if ((xk = xml_new(xml_name(x), NULL, CX_ELMNT)) == NULL)
+	goto err;
+    if (xml_prefix(x) && xml_prefix_set(xk, xml_prefix(x)) < 0)
+	goto err;
+    if ((y = xml_spec(x)) == NULL)
+	return xk;
+    xml_spec_set(xk, y);
+    switch (yang_keyword_get(y)){
+    case Y_LEAF_LIST:
+	if ((xc = xml_body_get(x)) != NULL){
+	    if ((xkc = xml_new("body", xk, CX_BODY)) == NULL)
+		goto err;
+	    if (xml_copy_one(xc, xkc) < 0)
+		goto err;
+	}
+	break;
+    case Y_LIST:
+	cvk = yang_cvec_get(y); /* Use Y_LIST cache, see ys_populate_list() */
+	while ((cvi = cvec_each(cvk, cvi)) != NULL) {
+	    keyname = cv_string_get(cvi);
+	    if ((xc = xml_find(x, keyname)) == NULL)
+		continue;
+	    if ((xkc = xml_new(keyname, xk, CX_ELMNT)) == NULL)
+		goto err;
+	    if (xml_copy(xc, xkc) < 0)
+		goto err;
+	}
+	break;
+    default:
+	break;
+    }
+    return xk;
+ err:
+    if (xk)
+	xml_free(xk);
+    return NULL;
+}
+
+/*! Mark an XML node as modified by an edit
+ *
+ * The node and its ancestors are marked with XML_FLAG_DIRTY and each is added to the
+ * record of dirty children of its parent. Only recorded children can differ from
+ * the tree the node was copied from, see xml_diff_dirty.
+ * A node that is not (yet) in a tree is only marked when it is inserted and marked
+ * again. The top node is not marked.
+ * @param[in]  x    XML element
+ * @param[in]  new  If set, x is created by the edit and marked with XML_FLAG_NEW
+ * @retval     0    OK
+ * @retval    -1    Error
+ * @see xml_flag_reset_dirty  to reset the marks
+ */
+int
+xml_dirty_mark(cxobj *x,
+	       int    new)
+{
+    int               retval = -1;
+    cxobj            *xp;
+    struct xml_dirty *xd;
+
+    if (!is_element(x))
+	return 0;
+    if (new)
+	xml_flag_set(x, XML_FLAG_NEW);
+    while (xml_flag(x, XML_FLAG_DIRTY) == 0 &&
+	   (xp = xml_parent(x)) != NULL){
+	if ((xd = xml_dirty_record(xp)) == NULL)
+	    goto done;
+	if (cxvec_append(x, &xd->xd_vec, &xd->xd_len) < 0)
+	    goto done;
+	xml_flag_set(x, XML_FLAG_DIRTY);
+	x = xp;
+    }
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Remove a dirty child from the record of its parent
+ *
+ * Called when the child is removed from the parent. Unless the child was created by
+ * an edit, a copy of its keys is recorded as removed.
+ * @param[in]  xp   XML parent
+ * @param[in]  xc   XML child marked with XML_FLAG_DIRTY
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+xml_dirty_child_rm(cxobj *xp,
+		   cxobj *xc)
+{
+    int               retval = -1;
+    struct xml_dirty *xd;
+    cxobj            *xk;
+    int               i;
+
+    xml_flag_reset(xc, XML_FLAG_DIRTY);
+    if ((xd = xp->x_dirty) == NULL)
+	goto ok;
+    for (i=xd->xd_len-1; i>=0; i--)
+	if (xd->xd_vec[i] == xc)
+	    break;
+    if (i < 0)
+	goto ok;
+    xd->xd_len--;
+    if (i < xd->xd_len)
+	memmove(&xd->xd_vec[i], &xd->xd_vec[i+1], (xd->xd_len-i)*sizeof(cxobj*));
+    if (xml_flag(xc, XML_FLAG_NEW) == 0){
+	if ((xk = xml_dirty_keycopy(xc)) == NULL)
+	    goto done;
+	if (cxvec_append(xk, &xd->xd_rmvec, &xd->xd_rmlen) < 0){
+	    xml_free(xk);
+	    goto done;
+	}
+    }
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Get the children of an XML node modified by edits
+ * @param[in]  x      XML element
+ * @param[out] vec    Children marked with XML_FLAG_DIRTY, do not free
+ * @param[out] len    Length of vec
+ * @param[out] rmvec  Name and key copies of removed children, do not free
+ * @param[out] rmlen  Length of rmvec
+ * @retval     0      OK
+ * @see xml_dirty_mark
+ */
+int
+xml_dirty_get(cxobj   *x,
+	      cxobj ***vec,
+	      int     *len,
+	      cxobj ***rmvec,
+	      int     *rmlen)
+{
+    struct xml_dirty *xd = NULL;
+
+    if (is_element(x))
+	xd = x->x_dirty;
+    *vec = xd ? xd->xd_vec : NULL;
+    *len = xd ? xd->xd_len : 0;
+    *rmvec = xd ? xd->xd_rmvec : NULL;
+    *rmlen = xd ? xd->xd_rmlen : 0;
+    return 0;
+}
+
+/*! Reset flags of an XML node and of its children modified by edits, recursively
+ *
+ * Only nodes recorded by xml_dirty_mark are traversed. If XML_FLAG_DIRTY is reset,
+ * the records are freed as well.
+ * @param[in]  x      XML element
+ * @param[in]  flags  Flags to reset
+ * @retval     0      OK
+ * @see xml_dirty_mark
+ */
+int
+xml_flag_reset_dirty(cxobj   *x,
+		     uint16_t flags)
+{
+    struct xml_dirty *xd;
+    int               i;
+
+    if (!is_element(x))
+	return 0;
+    if ((xd = x->x_dirty) != NULL){
+	for (i=0; i<xd->xd_len; i++)
+	    xml_flag_reset_dirty(xd->xd_vec[i], flags);
+	if (flags & XML_FLAG_DIRTY)
+	    xml_dirty_free(x);
+    }
+    xml_flag_reset(x, flags);
+    return 0;
+}
+
 /*! Remove top XML object and all children except a single child
  * Given a root xml node, and the i:th child, remove the child from its parent
  * and return it, remove the parent and all other children. (unwrap)
@@ -1856,6 +2112,7 @@ xml_free(cxobj *x)
 #ifdef XML_EXPLICIT_INDEX
 	xml_search_index_free(x);
 #endif
+	xml_dirty_free(x);
 	break;
     case CX_BODY:
     case CX_ATTR:
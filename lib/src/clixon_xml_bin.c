@@ -0,0 +1,597 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2020 Olof Hagsand and Rubicon Communications, LLC(Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2,
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ * Binary encoding of XML trees
+ * Used in the internal protocol between clients and backend as an alternative
+ * to XML text, so that a client can build a tree without lexing and parsing.
+ *
+ * An encoding is a header followed by a sequence of nodes:
+ *   header:  XML_BIN_MAGIC (4 bytes) and length of the whole encoding (4 bytes,
+ *            network byte order)
+ *   element: XB_ELMNT name prefix, attributes and children, XB_END
+ *   attr:    XB_ATTR name prefix value
+ *   body:    XB_STRING <len> <bytes> | XB_INT <zigzag varint> | XB_TRUE | XB_FALSE
+ * Names, prefixes and attribute values (eg namespaces) are interned, ie sent 
+ * once and then referred to by id. A string reference is a varint:
+ *   0      No string (eg no prefix)
+ *   1      New string follows as <len> <bytes>, and gets the next id
+ *   n>1    String with id n-2
+ * Lengths and integers are unsigned LEB128 varints.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <arpa/inet.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clixon */
+#include "clixon_err.h"
+#include "clixon_queue.h"
+#include "clixon_hash.h"
+#include "clixon_handle.h"
+#include "clixon_yang.h"
+#include "clixon_xml.h"
+#include "clixon_xml_nsctx.h"
+#include "clixon_xml_bin.h"
+
+/* First bytes of a binary encoding. Cannot be the start of an XML text */
+#define XML_BIN_MAGIC "\001CXB"
+#define XML_BIN_HDRLEN 8
+
+/* Name of xml top object created by parse functions */
+#define XML_BIN_TOP_SYMBOL "top"
+
+/* Node tags */
+enum xml_bin_tag{
+    XB_END = 0, /* End of attributes and children of an element */
+    XB_ELMNT,   /* Element */
+    XB_ATTR,    /* Attribute */
+    XB_STRING,  /* Body as string */
+    XB_INT,     /* Body of an integer in canonical decimal form */
+    XB_TRUE,    /* Body "true" */
+    XB_FALSE,   /* Body "false" */
+};
+
+/* Encoder state */
+struct xml_bin_enc{
+    cbuf          *xe_cb;       /* Encoding is appended here */
+    clicon_hash_t *xe_strings;  /* Interned strings: string -> id */
+    uint32_t       xe_nstrings; /* Number of interned strings */
+};
+
+/* Decoder state */
+struct xml_bin_dec{
+    const unsigned char *xd_p;        /* Next byte to decode */
+    const unsigned char *xd_end;      /* End of encoding */
+    char               **xd_strings;  /* Interned strings by id */
+    uint32_t             xd_nstrings; /* Number of interned strings */
+    uint32_t             xd_size;     /* Allocated length of xd_strings */
+    char                *xd_buf;      /* Scratch buffer for body strings */
+    size_t               xd_buflen;   /* Allocated length of xd_buf */
+};
+
+/*! Append an unsigned varint
+ */
+static void
+bin_varint_put(cbuf    *cb,
+	       uint64_t v)
+{
+    while (v >= 0x80){
+	cbuf_append(cb, (int)((v & 0x7f) | 0x80));
+	v >>= 7;
+    }
+    cbuf_append(cb, (int)v);
+}
+
+/*! Append a string reference, interning the string
+ * @param[in]  xe   Encoder state
+ * @param[in]  str  String, or NULL
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+bin_ref_put(struct xml_bin_enc *xe,
+	    char               *str)
+{
+    uint32_t *id;
+    size_t    len;
+
+    if (str == NULL){
+	bin_varint_put(xe->xe_cb, 0);
+	return 0;
+    }
+    if ((id = clicon_hash_value(xe->xe_strings, str, NULL)) != NULL){
+	bin_varint_put(xe->xe_cb, *id + 2);
+	return 0;
+    }
+    if (clicon_hash_add(xe->xe_strings, str, &xe->xe_nstrings, sizeof(xe->xe_nstrings)) == NULL)
+	return -1;
+    xe->xe_nstrings++;
+    len = strlen(str);
+    bin_varint_put(xe->xe_cb, 1);
+    bin_varint_put(xe->xe_cb, len);
+    cbuf_append_buf(xe->xe_cb, str, len);
+    return 0;
+}
+
+/*! Check if a string is an integer in canonical decimal form
+ * Only such strings are sent as integers, so that they are decoded to the same
+ * string. Eg "007", "+7" and "-0" are sent as strings.
+ * @param[in]  str  String
+ * @param[out] val  Integer value
+ * @retval     1    Yes, val set
+ * @retval     0    No
+ */
+static int
+bin_int_canonical(const char *str,
+		  int64_t    *val)
+{
+    const char *s = str;
+    int64_t     v = 0;
+    int         neg = 0;
+
+    if (*s == '-'){
+	neg++;
+	s++;
+    }
+    if (*s < '0' || *s > '9')
+	return 0;
+    if (*s == '0'){ /* Only "0" itself */
+	if (s[1] != '\0' || neg)
+	    return 0;
+	*val = 0;
+	return 1;
+    }
+    while (*s >= '0' && *s <= '9'){
+	if (s - str >= 18) /* No overflow */
+	    return 0;
+	v = v*10 + (*s++ - '0');
+    }
+    if (*s != '\0')
+	return 0;
+    *val = neg ? -v : v;
+    return 1;
+}
+
+/*! Encode an XML node and its children
+ * @param[in]  xe     Encoder state
+ * @param[in]  x      XML node
+ * @param[in]  depth  Limit levels of child resources: -1 is all, 0 is none, 1 is node itself
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+xml2bin_recurse(struct xml_bin_enc *xe,
+		cxobj              *x,
+		int32_t             depth)
+{
+    int      retval = -1;
+    cxobj   *xc;
+    char    *val;
+    int64_t  i;
+    size_t   len;
+
+    if (depth == 0)
+	goto ok;
+    switch (xml_type(x)){
+    case CX_BODY:
+	/* Empty body is not sent, as it is not parsed from text */
+	if ((val = xml_value(x)) == NULL || *val == '\0')
+	    break;
+	if (strcmp(val, "true") == 0)
+	    cbuf_append(xe->xe_cb, XB_TRUE);
+	else if (strcmp(val, "false") == 0)
+	    cbuf_append(xe->xe_cb, XB_FALSE);
+	else if (bin_int_canonical(val, &i)){
+	    cbuf_append(xe->xe_cb, XB_INT);
+	    bin_varint_put(xe->xe_cb, ((uint64_t)i << 1) ^ (uint64_t)(i >> 63)); /* zigzag */
+	}
+	else{
+	    len = strlen(val);
+	    cbuf_append(xe->xe_cb, XB_STRING);
+	    bin_varint_put(xe->xe_cb, len);
+	    cbuf_append_buf(xe->xe_cb, val, len);
+	}
+	break;
+    case CX_ATTR:
+	cbuf_append(xe->xe_cb, XB_ATTR);
+	if (bin_ref_put(xe, xml_name(x)) < 0 ||
+	    bin_ref_put(xe, xml_prefix(x)) < 0 ||
+	    bin_ref_put(xe, xml_value(x)) < 0)
+	    goto done;
+	break;
+    case CX_ELMNT:
+	cbuf_append(xe->xe_cb, XB_ELMNT);
+	if (bin_ref_put(xe, xml_name(x)) < 0 ||
+	    bin_ref_put(xe, xml_prefix(x)) < 0)
+	    goto done;
+	/* Attributes first, as when printed as text */
+	xc = NULL;
+	while ((xc = xml_child_each(x, xc, CX_ATTR)) != NULL) 
+	    if (xml2bin_recurse(xe, xc, -1) < 0)
+		goto done;
+	xc = NULL;
+	while ((xc = xml_child_each(x, xc, -1)) != NULL) 
+	    if (xml_type(xc) != CX_ATTR)
+		if (xml2bin_recurse(xe, xc, depth-1) < 0)
+		    goto done;
+	cbuf_append(xe->xe_cb, XB_END);
+	break;
+    default:
+	break;
+    }
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Encode an XML tree in binary form and append it to a cbuf
+ * Encodes the node x itself and its children, as clicon_xml2cbuf prints it.
+ * @param[in,out] cb     Cligen buffer to append encoding to
+ * @param[in]     x      XML tree
+ * @param[in]     depth  Limit levels of child resources: -1 is all, 0 is none, 1 is node itself
+ * @retval        0      OK
+ * @retval       -1      Error
+ * @code
+ *   cbuf *cb = cbuf_new();
+ *   if (clixon_xml2bin(cb, xn, -1) < 0)
+ *     goto err;
+ *   ...
+ *   if (clixon_xml_parse_bin(cbuf_get(cb), cbuf_len(cb), &xt) < 0)
+ *     goto err;
+ * @endcode
+ * @see clixon_xml_parse_bin  For decoding
+ * @see clicon_xml2cbuf       XML text encoding
+ */
+int
+clixon_xml2bin(cbuf   *cb,
+	       cxobj  *x,
+	       int32_t depth)
+{
+    int                retval = -1;
+    struct xml_bin_enc xe = {0,};
+    int                start;
+    uint32_t           len;
+
+    xe.xe_cb = cb;
+    if ((xe.xe_strings = clicon_hash_init()) == NULL)
+	goto done;
+    start = cbuf_len(cb);
+    cbuf_append_buf(cb, XML_BIN_MAGIC, 4);
+    cbuf_append_buf(cb, "\0\0\0\0", 4); /* Length, set below */
+    if (xml2bin_recurse(&xe, x, depth) < 0)
+	goto done;
+    len = htonl(cbuf_len(cb) - start);
+    memcpy(cbuf_get(cb) + start + 4, &len, sizeof(len));
+    retval = 0;
+ done:
+    if (xe.xe_strings)
+	clicon_hash_free(xe.xe_strings);
+    return retval;
+}
+
+/*! Check if a buffer starts with a binary encoding and return its length
+ * @param[in]  buf  Either a binary encoding or a null-terminated string
+ * @retval     len  Length of binary encoding, including header
+ * @retval     0    Not a binary encoding
+ * @note The length is read from the header and must be checked against the buffer
+ */
+size_t
+clixon_xml_bin_len(const char *buf)
+{
+    uint32_t len;
+
+    if (buf == NULL || strncmp(buf, XML_BIN_MAGIC, 4) != 0)
+	return 0;
+    memcpy(&len, buf + 4, sizeof(len));
+    return ntohl(len);
+}
+
+/*! Decode an unsigned varint
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+bin_varint_get(struct xml_bin_dec *xd,
+	       uint64_t           *val)
+{
+    uint64_t v = 0;
+    int      shift = 0;
+    int      c;
+
+    do {
+	if (xd->xd_p >= xd->xd_end || shift > 63){
+	    clicon_err(OE_XML, EINVAL, "binary encoding: bad varint");
+	    return -1;
+	}
+	c = *xd->xd_p++;
+	v |= (uint64_t)(c & 0x7f) << shift;
+	shift += 7;
+    } while (c & 0x80);
+    *val = v;
+    return 0;
+}
+
+/*! Decode a length and check it against remaining encoding
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+bin_len_get(struct xml_bin_dec *xd,
+	    size_t             *len)
+{
+    uint64_t v;
+
+    if (bin_varint_get(xd, &v) < 0)
+	return -1;
+    if (v > (uint64_t)(xd->xd_end - xd->xd_p)){
+	clicon_err(OE_XML, EINVAL, "binary encoding: bad length");
+	return -1;
+    }
+    *len = v;
+    return 0;
+}
+
+/*! Decode a string reference
+ * @param[in]  xd   Decoder state
+ * @param[out] str  Interned string or NULL, owned by decoder
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+bin_ref_get(struct xml_bin_dec *xd,
+	    char              **str)
+{
+    uint64_t v;
+    size_t   len;
+    char   **vec;
+    char    *s;
+
+    if (bin_varint_get(xd, &v) < 0)
+	return -1;
+    if (v == 0){
+	*str = NULL;
+	return 0;
+    }
+    if (v > 1){
+	if (v - 2 >= xd->xd_nstrings){
+	    clicon_err(OE_XML, EINVAL, "binary encoding: bad string id");
+	    return -1;
+	}
+	*str = xd->xd_strings[v - 2];
+	return 0;
+    }
+    if (bin_len_get(xd, &len) < 0)
+	return -1;
+    if (xd->xd_nstrings == xd->xd_size){
+	xd->xd_size = xd->xd_size ? 2*xd->xd_size : 32;
+	if ((vec = realloc(xd->xd_strings, xd->xd_size*sizeof(char*))) == NULL){
+	    clicon_err(OE_UNIX, errno, "realloc");
+	    return -1;
+	}
+	xd->xd_strings = vec;
+    }
+    if ((s = malloc(len + 1)) == NULL){
+	clicon_err(OE_UNIX, errno, "malloc");
+	return -1;
+    }
+    memcpy(s, xd->xd_p, len);
+    s[len] = '\0';
+    xd->xd_p += len;
+    xd->xd_strings[xd->xd_nstrings++] = s;
+    *str = s;
+    return 0;
+}
+
+/*! Decode a body string into the scratch buffer
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+bin_string_get(struct xml_bin_dec *xd,
+	       char              **str)
+{
+    size_t len;
+    char  *buf;
+
+    if (bin_len_get(xd, &len) < 0)
+	return -1;
+    if (len + 1 > xd->xd_buflen){
+	if ((buf = realloc(xd->xd_buf, len + 1)) == NULL){
+	    clicon_err(OE_UNIX, errno, "realloc");
+	    return -1;
+	}
+	xd->xd_buf = buf;
+	xd->xd_buflen = len + 1;
+    }
+    memcpy(xd->xd_buf, xd->xd_p, len);
+    xd->xd_buf[len] = '\0';
+    xd->xd_p += len;
+    *str = xd->xd_buf;
+    return 0;
+}
+
+/*! Decode one node and its children and add it to a parent
+ * @param[in]  xd      Decoder state
+ * @param[in]  xp      Parent XML node
+ * @param[out] xn      New node, or NULL if end of children (XB_END)
+ * @retval     0       OK
+ * @retval    -1       Error
+ */
+static int
+bin2xml_recurse(struct xml_bin_dec *xd,
+		cxobj              *xp,
+		cxobj             **xn)
+{
+    int      retval = -1;
+    cxobj   *x = NULL;
+    cxobj   *xc;
+    char    *name;
+    char    *prefix;
+    char    *val;
+    uint64_t v;
+    int64_t  i;
+    char     ibuf[24];
+    int      tag;
+
+    *xn = NULL;
+    if (xd->xd_p >= xd->xd_end){
+	clicon_err(OE_XML, EINVAL, "binary encoding: truncated");
+	goto done;
+    }
+    tag = *xd->xd_p++;
+    switch (tag){
+    case XB_END:
+	break;
+    case XB_ELMNT:
+    case XB_ATTR:
+	if (bin_ref_get(xd, &name) < 0 ||
+	    bin_ref_get(xd, &prefix) < 0)
+	    goto done;
+	if (name == NULL){
+	    clicon_err(OE_XML, EINVAL, "binary encoding: node without name");
+	    goto done;
+	}
+	if ((x = xml_new(name, xp, tag==XB_ELMNT?CX_ELMNT:CX_ATTR)) == NULL)
+	    goto done;
+	if (prefix && xml_prefix_set(x, prefix) < 0)
+	    goto done;
+	if (tag == XB_ATTR){
+	    if (bin_ref_get(xd, &val) < 0)
+		goto done;
+	    if (val && xml_value_set(x, val) < 0)
+		goto done;
+	    break;
+	}
+	do {
+	    if (bin2xml_recurse(xd, x, &xc) < 0)
+		goto done;
+	} while (xc != NULL);
+	break;
+    case XB_STRING:
+    case XB_INT:
+    case XB_TRUE:
+    case XB_FALSE:
+	if (tag == XB_STRING){
+	    if (bin_string_get(xd, &val) < 0)
+		goto done;
+	}
+	else if (tag == XB_INT){
+	    if (bin_varint_get(xd, &v) < 0)
+		goto done;
+	    i = (int64_t)(v >> 1) ^ -(int64_t)(v & 1); /* zigzag */
+	    snprintf(ibuf, sizeof(ibuf), "%" PRId64, i);
+	    val = ibuf;
+	}
+	else
+	    val = tag==XB_TRUE?"true":"false";
+	if ((x = xml_new("body", xp, CX_BODY)) == NULL)
+	    goto done;
+	if (xml_value_set(x, val) < 0)
+	    goto done;
+	break;
+    default:
+	clicon_err(OE_XML, EINVAL, "binary encoding: bad tag %d", tag);
+	goto done;
+    }
+    *xn = x;
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Decode a binary encoded XML tree
+ * The decoded nodes are added as children of xt, as clixon_xml_parse_string does
+ * @param[in]     buf    Binary encoding, see clixon_xml2bin
+ * @param[in]     len    Length of buf
+ * @param[in,out] xt     Top of XML tree. If NULL on entry, a top element called
+ *                       'top' will be created. Call xml_free() after use
+ * @retval        0      OK
+ * @retval       -1      Error with clicon_err called, eg malformed encoding
+ * @see clixon_xml2bin  For encoding
+ */
+int
+clixon_xml_parse_bin(const char *buf,
+		     size_t      len,
+		     cxobj     **xt)
+{
+    int                retval = -1;
+    struct xml_bin_dec xd = {0,};
+    size_t             blen;
+    cxobj             *x;
+    int                i;
+
+    if (xt == NULL){
+	clicon_err(OE_XML, EINVAL, "xt is NULL");
+	return -1;
+    }
+    if ((blen = clixon_xml_bin_len(buf)) < XML_BIN_HDRLEN || blen > len){
+	clicon_err(OE_XML, EINVAL, "binary encoding: bad header");
+	return -1;
+    }
+    if (*xt == NULL)
+	if ((*xt = xml_new(XML_BIN_TOP_SYMBOL, NULL, CX_ELMNT)) == NULL)
+	    goto done;
+    xd.xd_p = (const unsigned char *)buf + XML_BIN_HDRLEN;
+    xd.xd_end = (const unsigned char *)buf + blen;
+    while (xd.xd_p < xd.xd_end){
+	if (bin2xml_recurse(&xd, *xt, &x) < 0)
+	    goto done;
+	if (x == NULL){
+	    clicon_err(OE_XML, EINVAL, "binary encoding: unexpected end");
+	    goto done;
+	}
+	/* Verify namespaces, as after parsing */
+	if (xml_type(x) == CX_ELMNT && xml2ns_recurse(x) < 0)
+	    goto done;
+    }
+    retval = 0;
+ done:
+    for (i=0; i<xd.xd_nstrings; i++)
+	free(xd.xd_strings[i]);
+    if (xd.xd_strings)
+	free(xd.xd_strings);
+    if (xd.xd_buf)
+	free(xd.xd_buf);
+    return retval;
+}
@@ -84,116 +84,366 @@
 #define XML_INDENT 3
 /* Name of xml top object created by xml parse functions */
 #define XML_TOP_SYMBOL "top" 
+/* Size of xml print output buffer */
+#define XML_WBUF_SIZE 8192
+
+/*
+ * Types
+ */
+/* Output buffer of the xml print functions. Output is collected in a fixed-size
+ * buffer that is flushed when full to one of: a cligen buffer, a file descriptor,
+ * a write callback, or a stream (using a print callback if given), see xml_wbuf_flush
+ */
+typedef struct {
+    char              wb_buf[XML_WBUF_SIZE+1]; /* +1 for print callback \0 */
+    size_t            wb_len; /* Bytes in buffer */
+    cbuf             *wb_cb;  /* Cligen buffer, or NULL */
+    int               wb_fd;  /* File descriptor, or -1 */
+    clicon_write_cb  *wb_wfn; /* Write callback, or NULL */
+    void             *wb_arg; /* Argument of write callback */
+    FILE             *wb_f;   /* Stream */
+    clicon_output_cb *wb_fn;  /* Print callback of stream, if NULL use fwrite */
+} xml_wbuf;
+
+/* An element being printed by xml_stream_cbuf */
+struct xml_stream_elmnt{
+    cxobj  *xe_x;       /* Element */
+    cxobj  *xe_xc;      /* Last child printed */
+    int32_t xe_depth;   /* Remaining depth of element */
+};
+
+/* State of an XML tree printed in chunks, see xml_stream_new */
+struct xml_stream{
+    cxobj                   *xs_x;     /* Top of XML tree */
+    int32_t                  xs_depth; /* Depth limit of tree */
+    int                      xs_begun; /* Top element has been started */
+    struct xml_stream_elmnt *xs_stack; /* Elements started but not ended */
+    int                      xs_len;   /* Number of elements on stack */
+    int                      xs_max;   /* Allocated size of stack */
+};
 
 
 /*------------------------------------------------------------------------
  * XML printing functions. Output a parse tree to file, string cligen buf
  *------------------------------------------------------------------------*/
 
-/*! Print an XML tree structure to an output stream and encode chars "<>&"
+/*! Write output buffer to its destination
+ * @param[in]  wb   Output buffer
+ * @retval     0    OK
+ * @retval    -1    Error
+ */
+static int
+xml_wbuf_flush(xml_wbuf *wb)
+{
+    int     retval = -1;
+    char   *buf = wb->wb_buf;
+    size_t  len = wb->wb_len;
+    ssize_t n;
+
+    if (len == 0)
+	goto ok;
+    if (wb->wb_cb){
+	if (cbuf_append_buf(wb->wb_cb, buf, len) < 0){
+	    clicon_err(OE_XML, errno, "cbuf_append_buf");
+	    goto done;
+	}
+    }
+    else if (wb->wb_fd != -1){
+	while (len > 0){
+	    if ((n = write(wb->wb_fd, buf, len)) < 0){
+		if (errno == EINTR)
+		    continue;
+		clicon_err(OE_UNIX, errno, "write");
+		goto done;
+	    }
+	    buf += n;
+	    len -= n;
+	}
+    }
+    else if (wb->wb_wfn){
+	if ((*wb->wb_wfn)(wb->wb_arg, buf, len) < 0)
+	    goto done;
+    }
+    else if (wb->wb_fn){
+	buf[len] = '\0';
+	(*wb->wb_fn)(wb->wb_f, "%s", buf);
+    }
+    else if (fwrite(buf, 1, len, wb->wb_f) != len){
+	clicon_err(OE_UNIX, errno, "fwrite");
+	goto done;
+    }
+    wb->wb_len = 0;
+ ok:
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Append bytes to output buffer, flush when full
+ * @param[in]  wb   Output buffer
+ * @param[in]  str  Bytes to append, need not be NULL-terminated
+ * @param[in]  len  Number of bytes
+ */
+static int
+xml_wbuf_append(xml_wbuf   *wb,
+		const char *str,
+		size_t      len)
+{
+    size_t n;
+
+    while (len > 0){
+	if (wb->wb_len == XML_WBUF_SIZE && xml_wbuf_flush(wb) < 0)
+	    return -1;
+	n = XML_WBUF_SIZE - wb->wb_len;
+	if (n > len)
+	    n = len;
+	memcpy(&wb->wb_buf[wb->wb_len], str, n);
+	wb->wb_len += n;
+	str += n;
+	len -= n;
+    }
+    return 0;
+}
+
+/*! Append a string to output buffer */
+static int
+xml_wbuf_str(xml_wbuf   *wb,
+	     const char *str)
+{
+    return xml_wbuf_append(wb, str, strlen(str));
+}
+
+/*! Append spaces to output buffer */
+static int
+xml_wbuf_indent(xml_wbuf *wb,
+		int       len)
+{
+    int n;
+    
+    while (len > 0){
+	if (wb->wb_len == XML_WBUF_SIZE && xml_wbuf_flush(wb) < 0)
+	    return -1;
+	n = XML_WBUF_SIZE - wb->wb_len;
+	if (n > len)
+	    n = len;
+	memset(&wb->wb_buf[wb->wb_len], ' ', n);
+	wb->wb_len += n;
+	len -= n;
+    }
+    return 0;
+}
+
+/*! Append an XML name on the form [<prefix>:]<name> to output buffer */
+static int
+xml_wbuf_name(xml_wbuf *wb,
+	      char     *prefix,
+	      size_t    plen,
+	      char     *name,
+	      size_t    nlen)
+{
+    if (prefix){
+	if (xml_wbuf_append(wb, prefix, plen) < 0 ||
+	    xml_wbuf_append(wb, ":", 1) < 0)
+	    return -1;
+    }
+    return xml_wbuf_append(wb, name, nlen);
+}
+
+/*! Escape characters according to XML definition and append to output buffer
+ * Single pass: unchanged parts of the string (and CDATA sections) are copied as a whole
+ * @param[in]  wb   Output buffer
+ * @param[in]  str  Not-encoded input string
+ * @see xml_chardata_cbuf_append
+ */
+static int
+xml_wbuf_chardata(xml_wbuf *wb,
+		  char     *str)
+{
+    size_t len;
+
+    while (*str){
+	if ((len = xml_chardata_span(str)) > 0){
+	    if (xml_wbuf_append(wb, str, len) < 0)
+		return -1;
+	    str += len;
+	}
+	switch (*str){
+	case '\0':
+	    break;
+	case '&':
+	    if (xml_wbuf_append(wb, "&amp;", 5) < 0)
+		return -1;
+	    str++;
+	    break;
+	case '<':
+	    if ((len = xml_chardata_cdata(str)) > 0){
+		if (xml_wbuf_append(wb, str, len) < 0)
+		    return -1;
+		str += len;
+		break;
+	    }
+	    if (xml_wbuf_append(wb, "&lt;", 4) < 0)
+		return -1;
+	    str++;
+	    break;
+	case '>':
+	    if (xml_wbuf_append(wb, "&gt;", 4) < 0)
+		return -1;
+	    str++;
+	    break;
+	}
+    }
+    return 0;
+}
+
+/*! Append an attribute on the form " [<prefix>:]<name>="<value>" to output buffer */
+static int
+xml_wbuf_attr(xml_wbuf *wb,
+	      cxobj    *xa)
+{
+    char *prefix;
+    char *val;
+
+    if (xml_wbuf_append(wb, " ", 1) < 0)
+	return -1;
+    prefix = xml_prefix(xa);
+    if (xml_wbuf_name(wb, prefix, prefix?strlen(prefix):0,
+		      xml_name(xa), strlen(xml_name(xa))) < 0)
+	return -1;
+    if (xml_wbuf_append(wb, "=\"", 2) < 0)
+	return -1;
+    if ((val = xml_value(xa)) != NULL && xml_wbuf_str(wb, val) < 0)
+	return -1;
+    return xml_wbuf_append(wb, "\"", 1);
+}
+
+/*! Append the start of an element to output buffer: name and attributes
  *
- * @param[in]   f           UNIX output stream
- * @param[in]   xn          clicon xml tree
- * @param[in]   level       how many spaces to insert before each line
- * @param[in]   prettyprint insert \n and spaces tomake the xml more readable.
- * @param[in]   fn          Callback to make print function
- * @see clicon_xml2cbuf
- * One can use clicon_xml2cbuf to get common code, but using fprintf is
- * much faster than using cbuf and then printing that,...
+ * Attributes, including namespace declarations, are printed as they are in the tree
+ * @param[in]  wb          Output buffer
+ * @param[in]  x           XML element
+ * @param[in]  level       Indentation level for prettyprint
+ * @param[in]  prettyprint Insert spaces to make the xml more readable
+ * @param[out] hasbody     Element has body child
+ * @param[out] haselement  Element has element child
  */
-int
-xml2file_recurse(FILE             *f, 
-		 cxobj            *x, 
-		 int               level, 
-		 int               prettyprint,
-		 clicon_output_cb *fn)
+static int
+xml_wbuf_begin(xml_wbuf *wb,
+	       cxobj    *x,
+	       int       level,
+	       int       prettyprint,
+	       int      *hasbody,
+	       int      *haselement)
 {
-    int    retval = -1;
-    char  *name;
-    char  *namespace;
     cxobj *xc;
-    int    hasbody;
-    int    haselement;
-    char  *val;
-    char  *encstr = NULL; /* xml encoded string */
+    char  *prefix;
+
+    if (prettyprint && xml_wbuf_indent(wb, level*XML_INDENT) < 0)
+	return -1;
+    if (xml_wbuf_append(wb, "<", 1) < 0)
+	return -1;
+    prefix = xml_prefix(x);
+    if (xml_wbuf_name(wb, prefix, prefix?strlen(prefix):0,
+		      xml_name(x), strlen(xml_name(x))) < 0)
+	return -1;
+    *hasbody = 0;
+    *haselement = 0;
+    xc = NULL;
+    /* print attributes only */
+    while ((xc = xml_child_each(x, xc, -1)) != NULL) 
+	switch (xml_type(xc)){
+	case CX_ATTR:
+	    if (xml_wbuf_attr(wb, xc) < 0)
+		return -1;
+	    break;
+	case CX_BODY:
+	    *hasbody = 1;
+	    break;
+	case CX_ELMNT:
+	    *haselement = 1;
+	    break;
+	default:
+	    break;
+	}
+    return 0;
+}
+
+/*! Print an XML tree structure to an output buffer and encode chars "<>&"
+ *
+ * Core of all XML printing functions
+ * @param[in]  wb          Output buffer
+ * @param[in]  x           Clicon xml tree
+ * @param[in]  level       Indentation level for prettyprint
+ * @param[in]  prettyprint insert \n and spaces to make the xml more readable.
+ * @param[in]  depth       Limit levels of child resources: -1 is all, 0 is none, 1 is node itself
+ * @retval     0           OK
+ * @retval    -1           Error
+ */
+static int
+xml_wbuf_print(xml_wbuf *wb,
+	       cxobj    *x,
+	       int       level,
+	       int       prettyprint,
+	       int32_t   depth)
+{
+    cxobj  *xc;
+    char   *name;
+    char   *prefix;
+    size_t  nlen;
+    size_t  plen;
+    int     hasbody;
+    int     haselement;
+    char   *val;
     
-    if (x == NULL)
-	goto ok;
-    name = xml_name(x);
-    namespace = xml_prefix(x);
+    if (x == NULL || depth == 0)
+	return 0;
     switch(xml_type(x)){
     case CX_BODY:
 	if ((val = xml_value(x)) == NULL) /* incomplete tree */
 	    break;
-	if (xml_chardata_encode(&encstr, "%s", val) < 0)
-	    goto done;
-	(*fn)(f, "%s", encstr);
+	if (xml_wbuf_chardata(wb, val) < 0)
+	    return -1;
 	break;
     case CX_ATTR:
-	(*fn)(f, " ");
-	if (namespace)
-	    (*fn)(f, "%s:", namespace);
-	(*fn)(f, "%s=\"%s\"", name, xml_value(x));
+	if (xml_wbuf_attr(wb, x) < 0)
+	    return -1;
 	break;
     case CX_ELMNT:
-	(*fn)(f, "%*s<", prettyprint?(level*XML_INDENT):0, "");
-	if (namespace)
-	    (*fn)(f, "%s:", namespace);
-	(*fn)(f, "%s", name);
-	hasbody = 0;
-	haselement = 0;
-	xc = NULL;
-	/* print attributes only */
-	while ((xc = xml_child_each(x, xc, -1)) != NULL) {
-	    switch (xml_type(xc)){
-	    case CX_ATTR:
-		if (xml2file_recurse(f, xc, level+1, prettyprint, fn) <0)
-		    goto done;
-		break;
-	    case CX_BODY:
-		hasbody=1;
-		break;
-	    case CX_ELMNT:
-		haselement=1;
-		break;
-	    default:
-		break;
-	    }
+	if (xml_wbuf_begin(wb, x, level, prettyprint, &hasbody, &haselement) < 0)
+	    return -1;
+	/* Check for special case <a/> instead of <a></a> */
+	if (hasbody==0 && haselement==0){
+	    if (xml_wbuf_append(wb, "/>", 2) < 0)
+		return -1;
 	}
-	/* Check for special case <a/> instead of <a></a>:
-	 * Ie, no CX_BODY or CX_ELMNT child.
-	 */
-	if (hasbody==0 && haselement==0) 
-	    (*fn)(f, "/>");
 	else{
-	    (*fn)(f, ">");
-	    if (prettyprint && hasbody == 0)
-		    (*fn)(f, "\n");
+	    if (xml_wbuf_append(wb, ">", 1) < 0)
+		return -1;
+	    if (prettyprint && hasbody == 0 && xml_wbuf_append(wb, "\n", 1) < 0)
+		return -1;
 	    xc = NULL;
-	    while ((xc = xml_child_each(x, xc, -1)) != NULL) {
+	    while ((xc = xml_child_each(x, xc, -1)) != NULL) 
 		if (xml_type(xc) != CX_ATTR)
-		    if (xml2file_recurse(f, xc, level+1, prettyprint, fn) <0)
-			goto done;
-	    }
-	    if (prettyprint && hasbody==0)
-		(*fn)(f, "%*s", level*XML_INDENT, "");
-	    (*fn)(f, "</");
-	    if (namespace)
-		(*fn)(f, "%s:", namespace);
-	    (*fn)(f, "%s>", name);
+		    if (xml_wbuf_print(wb, xc, level+1, prettyprint, depth-1) < 0)
+			return -1;
+	    if (prettyprint && hasbody == 0 && xml_wbuf_indent(wb, level*XML_INDENT) < 0)
+		return -1;
+	    name = xml_name(x);
+	    nlen = strlen(name);
+	    prefix = xml_prefix(x);
+	    plen = prefix ? strlen(prefix) : 0;
+	    if (xml_wbuf_append(wb, "</", 2) < 0 ||
+		xml_wbuf_name(wb, prefix, plen, name, nlen) < 0 ||
+		xml_wbuf_append(wb, ">", 1) < 0)
+		return -1;
 	}
-	if (prettyprint)
-	    (*fn)(f, "\n");
+	if (prettyprint && xml_wbuf_append(wb, "\n", 1) < 0)
+	    return -1;
 	break;
     default:
 	break;
     }/* switch */
- ok:
-    retval = 0;
- done:
-    if (encstr)
-	free(encstr);
-    return retval;
+    return 0;
 }
 
 /*! Print an XML tree structure to an output stream and encode chars "<>&"
@@ -204,6 +454,7 @@ xml2file_recurse(FILE             *f,
  * @param[in]   prettyprint insert \n and spaces tomake the xml more readable.
  * @see clicon_xml2cbuf print to a cbuf string
  * @see clicon_xml2cbuf_cb print using a callback
+ * @see clicon_xml2fd print to a file descriptor
  */
 int
 clicon_xml2file(FILE  *f, 
@@ -211,7 +462,7 @@ clicon_xml2file(FILE  *f,
 		int    level, 
 		int    prettyprint)
 {
-    return xml2file_recurse(f, x, level, prettyprint, fprintf);
+    return clicon_xml2file_cb(f, x, level, prettyprint, NULL);
 }
 
 /*! Print an XML tree structure to an output stream and encode chars "<>&"
@@ -220,6 +471,8 @@ clicon_xml2file(FILE  *f,
  * @param[in]   xn          clicon xml tree
  * @param[in]   level       how many spaces to insert before each line
  * @param[in]   prettyprint insert \n and spaces tomake the xml more readable.
+ * @param[in]   fn          Callback to make print function, NULL writes to f directly
+ * @note fn is called with output in chunks of (at most) XML_WBUF_SIZE bytes
  * @see clicon_xml2cbuf
  */
 int
@@ -229,7 +482,81 @@ clicon_xml2file_cb(FILE             *f,
 		   int               prettyprint,
 		   clicon_output_cb *fn)
 {
-    return xml2file_recurse(f, x, level, prettyprint, fn);
+    xml_wbuf wb;
+
+    wb.wb_len = 0;
+    wb.wb_fd = -1;
+    wb.wb_wfn = NULL;
+    wb.wb_f = f;
+    wb.wb_fn = fn;
+    wb.wb_cb = NULL;
+    if (xml_wbuf_print(&wb, x, level, prettyprint, -1) < 0)
+	return -1;
+    return xml_wbuf_flush(&wb);
+}
+
+/*! Print an XML tree structure to a file descriptor and encode chars "<>&"
+ *
+ * The output is collected in a buffer that is written with write(2) when full.
+ * @param[in]   fd          File descriptor
+ * @param[in]   xn          clicon xml tree
+ * @param[in]   level       how many spaces to insert before each line
+ * @param[in]   prettyprint insert \n and spaces tomake the xml more readable.
+ * @see clicon_xml2file
+ */
+int
+clicon_xml2fd(int    fd, 
+	      cxobj *x, 
+	      int    level, 
+	      int    prettyprint)
+{
+    xml_wbuf wb;
+
+    wb.wb_len = 0;
+    wb.wb_fd = fd;
+    wb.wb_wfn = NULL;
+    wb.wb_f = NULL;
+    wb.wb_fn = NULL;
+    wb.wb_cb = NULL;
+    if (xml_wbuf_print(&wb, x, level, prettyprint, -1) < 0)
+	return -1;
+    return xml_wbuf_flush(&wb);
+}
+
+/*! Print an XML tree structure with a write callback and encode chars "<>&"
+ *
+ * The output is collected in a buffer that is passed to the callback when full,
+ * so that the tree can be printed to any destination without an intermediate copy.
+ * @param[in]   x           clicon xml tree
+ * @param[in]   level       how many spaces to insert before each line
+ * @param[in]   prettyprint insert \n and spaces tomake the xml more readable.
+ * @param[in]   depth       Limit levels of child resources: -1 is all, 0 is none, 1 is node itself
+ * @param[in]   fn          Write callback, called with output in chunks of (at most) XML_WBUF_SIZE bytes
+ * @param[in]   arg         Argument of write callback
+ * @retval      0           OK
+ * @retval     -1           Error, also if callback fails
+ * @see clicon_xml2cbuf
+ */
+int
+clicon_xml2write_cb(cxobj           *x, 
+		    int              level, 
+		    int              prettyprint,
+		    int32_t          depth,
+		    clicon_write_cb *fn,
+		    void            *arg)
+{
+    xml_wbuf wb;
+
+    wb.wb_len = 0;
+    wb.wb_fd = -1;
+    wb.wb_wfn = fn;
+    wb.wb_arg = arg;
+    wb.wb_f = NULL;
+    wb.wb_fn = NULL;
+    wb.wb_cb = NULL;
+    if (xml_wbuf_print(&wb, x, level, prettyprint, depth) < 0)
+	return -1;
+    return xml_wbuf_flush(&wb);
 }
 
 /*! Print an XML tree structure to an output stream
@@ -245,7 +572,7 @@ int
 xml_print(FILE  *f, 
 	  cxobj *x)
 {
-    return xml2file_recurse(f, x, 0, 1, fprintf);
+    return clicon_xml2file(f, x, 0, 1);
 }
 
 /*! Print an XML tree structure to a cligen buffer and encode chars "<>&"
@@ -273,94 +600,180 @@ clicon_xml2cbuf(cbuf   *cb,
 		int     prettyprint,
 		int32_t depth)
 {
-    int    retval = -1;
-    cxobj *xc;
-    char  *name;
-    int    hasbody;
-    int    haselement;
-    char  *namespace;
-    char  *val;
-    
+    xml_wbuf wb;
+
+    wb.wb_len = 0;
+    wb.wb_fd = -1;
+    wb.wb_wfn = NULL;
+    wb.wb_f = NULL;
+    wb.wb_fn = NULL;
+    wb.wb_cb = cb;
+    if (xml_wbuf_print(&wb, x, level, prettyprint, depth) < 0)
+	return -1;
+    return xml_wbuf_flush(&wb);
+}
+
+/*! Create state for printing an XML tree to cligen buffers in chunks
+ *
+ * Prints the same as clicon_xml2cbuf without prettyprint, but a part at a time,
+ * so that a large tree can be output without printing all of it to memory.
+ * The tree must not be changed while it is printed.
+ * @param[in]  x     XML tree
+ * @param[in]  depth Limit levels of child resources: -1 is all, 0 is none, 1 is node itself
+ * @retval     xs    Stream state, free with xml_stream_free
+ * @retval     NULL  Error
+ * @code
+ *   xml_stream_t *xs;
+ *   if ((xs = xml_stream_new(x, -1)) == NULL)
+ *      goto err;
+ *   do {
+ *      cbuf_reset(cb);
+ *      if ((ret = xml_stream_cbuf(xs, cb, 65536)) < 0)
+ *         goto err;
+ *      write(fd, cbuf_get(cb), cbuf_len(cb));
+ *   } while (ret == 1);
+ *   xml_stream_free(xs);
+ * @endcode
+ * @see clicon_xml2cbuf
+ */
+xml_stream_t *
+xml_stream_new(cxobj  *x,
+	       int32_t depth)
+{
+    xml_stream_t *xs;
+
+    if ((xs = malloc(sizeof(*xs))) == NULL){
+	clicon_err(OE_XML, errno, "malloc");
+	return NULL;
+    }
+    memset(xs, 0, sizeof(*xs));
+    xs->xs_x = x;
+    xs->xs_depth = depth;
+    return xs;
+}
+
+/*! Free XML stream state, but not the XML tree
+ * @param[in]  xs   Stream state
+ */
+int
+xml_stream_free(xml_stream_t *xs)
+{
+    if (xs->xs_stack)
+	free(xs->xs_stack);
+    free(xs);
+    return 0;
+}
+
+/*! Print start of an XML node, and push element on stack if it has children
+ * @see xml_wbuf_print
+ */
+static int
+xml_stream_begin(xml_stream_t *xs,
+		 xml_wbuf     *wb,
+		 cxobj        *x,
+		 int32_t       depth)
+{
+    struct xml_stream_elmnt *vec;
+    char                    *val;
+    int                      hasbody = 0;
+    int                      haselement = 0;
+    int                      max;
+
     if (depth == 0)
-	goto ok;
-    name = xml_name(x);
-    namespace = xml_prefix(x);
-    switch(xml_type(x)){
+	return 0;
+    switch (xml_type(x)){
     case CX_BODY:
-	if ((val = xml_value(x)) == NULL) /* incomplete tree */
-	    break;
-	if (xml_chardata_cbuf_append(cb, val) < 0)
-	    goto done;
-	break;
-    case CX_ATTR:
-	cbuf_append_str(cb, " ");
-	if (namespace){
-	    cbuf_append_str(cb, namespace);
-	    cbuf_append_str(cb, ":");
-	}
-	cprintf(cb, "%s=\"%s\"", name, xml_value(x));
+	if ((val = xml_value(x)) != NULL) /* incomplete tree */
+	    if (xml_wbuf_chardata(wb, val) < 0)
+		return -1;
 	break;
     case CX_ELMNT:
-	if (prettyprint)
-	    cprintf(cb, "%*s<", level*XML_INDENT, "");
-	else
-	    cbuf_append_str(cb, "<");
-	if (namespace){
-	    cbuf_append_str(cb, namespace);
-	    cbuf_append_str(cb, ":");
-	}
-	cbuf_append_str(cb, name);
-	hasbody = 0;
-	haselement = 0;
-	xc = NULL;
-	/* print attributes only */
-	while ((xc = xml_child_each(x, xc, -1)) != NULL) 
-	    switch (xml_type(xc)){
-	    case CX_ATTR:
-		if (clicon_xml2cbuf(cb, xc, level+1, prettyprint, -1) < 0)
-		    goto done;
-		break;
-	    case CX_BODY:
-		hasbody=1;
-		break;
-	    case CX_ELMNT:
-		haselement=1;
-		break;
-	    default:
-		break;
-	    }
+	if (xml_wbuf_begin(wb, x, 0, 0, &hasbody, &haselement) < 0)
+	    return -1;
 	/* Check for special case <a/> instead of <a></a> */
-	if (hasbody==0 && haselement==0) 
-	    cbuf_append_str(cb, "/>");
-	else{
-	    cbuf_append_str(cb, ">");
-	    if (prettyprint && hasbody == 0)
-		cbuf_append_str(cb, "\n");
-	    xc = NULL;
-	    while ((xc = xml_child_each(x, xc, -1)) != NULL) 
-		if (xml_type(xc) != CX_ATTR)
-		    if (clicon_xml2cbuf(cb, xc, level+1, prettyprint, depth-1) < 0)
-			goto done;
-	    if (prettyprint && hasbody == 0)
-		cprintf(cb, "%*s", level*XML_INDENT, "");
-	    cbuf_append_str(cb, "</");
-	    if (namespace){
-		cbuf_append_str(cb, namespace);
-		cbuf_append_str(cb, ":");
+	if (hasbody == 0 && haselement == 0){
+	    if (xml_wbuf_append(wb, "/>", 2) < 0)
+		return -1;
+	    break;
+	}
+	if (xml_wbuf_append(wb, ">", 1) < 0)
+	    return -1;
+	if (xs->xs_len == xs->xs_max){
+	    max = xs->xs_max ? 2*xs->xs_max : 16;
+	    if ((vec = realloc(xs->xs_stack, max*sizeof(*vec))) == NULL){
+		clicon_err(OE_XML, errno, "realloc");
+		return -1;
 	    }
-	    cbuf_append_str(cb, name);
-	    cbuf_append_str(cb, ">");
+	    xs->xs_stack = vec;
+	    xs->xs_max = max;
 	}
-	if (prettyprint)
-	    cbuf_append_str(cb, "\n");
+	xs->xs_stack[xs->xs_len].xe_x = x;
+	xs->xs_stack[xs->xs_len].xe_xc = NULL;
+	xs->xs_stack[xs->xs_len].xe_depth = depth;
+	xs->xs_len++;
 	break;
     default:
 	break;
-    }/* switch */
- ok:
-    retval = 0;
- done:
-    return retval;
+    }
+    return 0;
+}
+
+/*! Print next part of an XML tree to a cligen buffer
+ * Print until at least len bytes are in cb, or the tree is printed. 
+ * The printing stops at node boundaries, so cb may hold more than len bytes.
+ * @param[in]  xs   Stream state, see xml_stream_new
+ * @param[in]  cb   Cligen buffer to append to
+ * @param[in]  len  Stop printing when cb holds this number of bytes
+ * @retval     1    More remains to print
+ * @retval     0    All of tree is printed
+ * @retval    -1    Error
+ */
+int
+xml_stream_cbuf(xml_stream_t *xs,
+		cbuf         *cb,
+		size_t        len)
+{
+    struct xml_stream_elmnt *xe;
+    cxobj                   *xc;
+    char                    *prefix;
+    char                    *name;
+    xml_wbuf                 wb;
+
+    wb.wb_len = 0;
+    wb.wb_fd = -1;
+    wb.wb_wfn = NULL;
+    wb.wb_f = NULL;
+    wb.wb_fn = NULL;
+    wb.wb_cb = cb;
+    if (!xs->xs_begun){
+	xs->xs_begun = 1;
+	if (xml_stream_begin(xs, &wb, xs->xs_x, xs->xs_depth) < 0)
+	    return -1;
+    }
+    while (xs->xs_len > 0 && cbuf_len(cb) + wb.wb_len < len){
+	xe = &xs->xs_stack[xs->xs_len-1];
+	xc = xe->xe_xc;
+	while ((xc = xml_child_each(xe->xe_x, xc, -1)) != NULL &&
+	       xml_type(xc) == CX_ATTR)
+	    ;
+	if (xc != NULL){ /* Next child, note may realloc stack */
+	    xe->xe_xc = xc;
+	    if (xml_stream_begin(xs, &wb, xc, xe->xe_depth-1) < 0)
+		return -1;
+	    continue;
+	}
+	/* No more children: end element */
+	name = xml_name(xe->xe_x);
+	prefix = xml_prefix(xe->xe_x);
+	if (xml_wbuf_append(&wb, "</", 2) < 0 ||
+	    xml_wbuf_name(&wb, prefix, prefix?strlen(prefix):0, name, strlen(name)) < 0 ||
+	    xml_wbuf_append(&wb, ">", 1) < 0)
+	    return -1;
+	xs->xs_len--;
+    }
+    if (xml_wbuf_flush(&wb) < 0)
+	return -1;
+    return xs->xs_len > 0;
 }
 
 /*! Return an xml tree as a pretty-printed malloced string.
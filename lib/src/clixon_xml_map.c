@@ -91,6 +91,11 @@ typedef struct  {
     yang_stmt *mt_yc;
 } merge_twophase;
 
+/* Forward */
+static int xml_diff1(cxobj *x0, cxobj *x1, cxobj ***x0vec, int *x0veclen,
+		     cxobj ***x1vec, int *x1veclen, cxobj ***changed_x0,
+		     cxobj ***changed_x1, int *changedlen, int dirty);
+
 /*! Is attribute and is either of form xmlns="", or xmlns:x="" */
 int
 isxmlns(cxobj *x)
@@ -503,6 +508,185 @@ cvec2xml_1(cvec   *cvv,
     return retval;
 }
 
+/*! Compute differences between two yang-equal xml nodes
+ * @param[in]  x0c        Node in first XML tree
+ * @param[in]  x1c        Node in second XML tree, xml_cmp() equal to x0c
+ * @param[out] x0vec      Pointervector to XML nodes existing in only first tree
+ * @param[out] x0veclen   Length of first vector
+ * @param[out] x1vec      Pointervector to XML nodes existing in only second tree
+ * @param[out] x1veclen   Length of x1vec vector
+ * @param[out] changed_x0 Pointervector to XML nodes changed orig value
+ * @param[out] changed_x1 Pointervector to XML nodes changed wanted value
+ * @param[out] changedlen Length of changed vector
+ * @param[in]  dirty      If set, only descend into x1 nodes marked with XML_FLAG_DIRTY
+ *                        and not XML_FLAG_NEW
+ * @see xml_diff1
+ */
+static int
+xml_diff_equal(cxobj     *x0c, 
+	       cxobj     *x1c,
+	       cxobj   ***x0vec,
+	       int       *x0veclen,
+	       cxobj   ***x1vec,
+	       int       *x1veclen,
+	       cxobj   ***changed_x0,
+	       cxobj   ***changed_x1,
+	       int       *changedlen,
+	       int        dirty)
+{
+    int        retval = -1;
+    yang_stmt *yc;
+    char      *b1;
+    char      *b2;
+
+    /* xml-spec NULL could happen with anydata children for example,
+     * if so, continute compare children but without yang
+     */
+    yc = xml_spec(x0c);
+    /* A node created by an edit replaces x0c, it has no dirty marks relative to it */
+    if (dirty && xml_flag(x1c, XML_FLAG_NEW))
+	dirty = 0;
+    if (dirty && !xml_flag(x1c, XML_FLAG_DIRTY))
+	; /* Not modified since copied from x0 */
+    else if (yc && yang_keyword_get(yc) == Y_LEAF){
+	/* if x0c and x1c are leafs w bodies, then they may be changed */
+	b1 = xml_body(x0c);
+	b2 = xml_body(x1c);
+	if (b1 == NULL && b2 == NULL)
+	    ;
+	else if (b1 == NULL || b2 == NULL || strcmp(b1, b2) != 0){
+	    if (cxvec_append(x0c, changed_x0, changedlen) < 0) 
+		goto done;
+	    (*changedlen)--; /* append two vectors */
+	    if (cxvec_append(x1c, changed_x1, changedlen) < 0) 
+		goto done;
+	}
+    }
+    else if (xml_diff1(x0c, x1c,   
+		       x0vec, x0veclen, 
+		       x1vec, x1veclen, 
+		       changed_x0, changed_x1, changedlen, dirty)< 0)
+	goto done;
+    retval = 0;
+ done:
+    return retval;
+}
+
+/*! Find the node in the first tree that is yang-equal to a node of the second tree
+ *
+ * Uses binary search in x0 if x1c is bound to yang, see match_base_child
+ * @param[in]  x0    Parent in first XML tree, sorted
+ * @param[in]  x1c   Child in second XML tree
+ * @param[out] x0cp  Child of x0 that is xml_cmp() equal to x1c, or NULL
+ * @retval     0     OK
+ * @retval    -1     Error
+ */
+static int
+xml_diff_find(cxobj  *x0,
+	      cxobj  *x1c,
+	      cxobj **x0cp)
+{
+    cxobj *x0c = NULL;
+
+    if (match_base_child(x0, x1c, xml_spec(x1c), &x0c) < 0)
+	return -1;
+    /* match_base_child may return another case of a choice, or a node without yang */
+    if (x0c && xml_cmp(x0c, x1c, 0, 0, NULL) != 0)
+	x0c = NULL;
+    *x0cp = x0c;
+    return 0;
+}
+
+/*! Compute differences of the children of two xml nodes, using dirty marks
+ *
+ * Only the children of x1 recorded as dirty or removed can differ from x0, see
+ * xml_dirty_mark. They are looked up with binary search instead of traversing all
+ * children in lock-step.
+ * A removed child may have been re-added as a default value after the edit, and
+ * is then compared in full. So is a child created by an edit that replaces an
+ * existing node.
+ * Default values of choice cases are not recorded, if a recorded child belongs to a
+ * choice the caller falls back to lock-step.
+ * @param[in]  x0         First XML tree
+ * @param[in]  x1         Second XML tree, with dirty marks relative to x0
+ * @param[out] x0vec      Pointervector to XML nodes existing in only first tree
+ * @param[out] x0veclen   Length of first vector
+ * @param[out] x1vec      Pointervector to XML nodes existing in only second tree
+ * @param[out] x1veclen   Length of x1vec vector
+ * @param[out] changed_x0 Pointervector to XML nodes changed orig value
+ * @param[out] changed_x1 Pointervector to XML nodes changed wanted value
+ * @param[out] changedlen Length of changed vector
+ * @retval     1          OK, differences computed
+ * @retval     0          A choice was modified, use lock-step
+ * @retval    -1          Error
+ */
+static int
+xml_diff1_dirty(cxobj     *x0, 
+		cxobj     *x1,
+		cxobj   ***x0vec,
+		int       *x0veclen,
+		cxobj   ***x1vec,
+		int       *x1veclen,
+		cxobj   ***changed_x0,
+		cxobj   ***changed_x1,
+		int       *changedlen)
+{
+    int        retval = -1;
+    cxobj    **vec;
+    int        len;
+    cxobj    **rmvec;
+    int        rmlen;
+    cxobj     *x0c;
+    cxobj     *x1c;
+    yang_stmt *y;
+    int        i;
+
+    if (xml_dirty_get(x1, &vec, &len, &rmvec, &rmlen) < 0)
+	goto done;
+    for (i=0; i<len+rmlen; i++){
+	x1c = i<len ? vec[i] : rmvec[i-len];
+	if ((y = xml_spec(x1c)) != NULL && yang_choice(y) != NULL){
+	    retval = 0;
+	    goto done;
+	}
+    }
+    for (i=0; i<len; i++){
+	x1c = vec[i];
+	if (xml_diff_find(x0, x1c, &x0c) < 0)
+	    goto done;
+	if (x0c == NULL){
+	    if (cxvec_append(x1c, x1vec, x1veclen) < 0) 
+		goto done;
+	}
+	else if (xml_diff_equal(x0c, x1c,
+				x0vec, x0veclen, 
+				x1vec, x1veclen, 
+				changed_x0, changed_x1, changedlen, 1) < 0)
+	    goto done;
+    }
+    for (i=0; i<rmlen; i++){
+	if (xml_diff_find(x0, rmvec[i], &x0c) < 0)
+	    goto done;
+	if (x0c == NULL) /* Not in x0 */
+	    continue;
+	if (xml_diff_find(x1, rmvec[i], &x1c) < 0)
+	    goto done;
+	if (x1c == NULL){
+	    if (cxvec_append(x0c, x0vec, x0veclen) < 0) 
+		goto done;
+	}
+	else if (!xml_flag(x1c, XML_FLAG_DIRTY) && /* Dirty: compared above */
+		 xml_diff_equal(x0c, x1c,
+				x0vec, x0veclen, 
+				x1vec, x1veclen, 
+				changed_x0, changed_x1, changedlen, 0) < 0)
+	    goto done;
+    }
+    retval = 1;
+ done:
+    return retval;
+}
+
 /*! Recursive help function to compute differences between two xml trees
  * @param[in]  x0         First XML tree
  * @param[in]  x1         Second XML tree
@@ -513,6 +697,7 @@ cvec2xml_1(cvec   *cvv,
  * @param[out] changed_x0 Pointervector to XML nodes changed orig value
  * @param[out] changed_x1 Pointervector to XML nodes changed wanted value
  * @param[out] changedlen Length of changed vector
+ * @param[in]  dirty      If set, only descend into x1 nodes marked with XML_FLAG_DIRTY
  * Algorithm to compare two sorted lists A, B:
  *   A 0 1 2 3 5 6
  *   B 0 2 4 5 6
@@ -525,6 +710,8 @@ cvec2xml_1(cvec   *cvv,
  * (*) "comparing" a&b here is made by xml_cmp() which judges equality from a structural
  *     perspective, ie both have the same yang spec, if they are lists, they have the
  *     the same keys. NOT that the values are equal!
+ * If dirty is set, only children recorded as dirty or removed are compared, see
+ * xml_diff1_dirty.
  * @see xml_diff  API function, this one is internal and recursive
  */
 static int
@@ -536,16 +723,24 @@ xml_diff1(cxobj     *x0,
 	  int       *x1veclen,
 	  cxobj   ***changed_x0,
 	  cxobj   ***changed_x1,
-	  int       *changedlen)
+	  int       *changedlen,
+	  int        dirty)
 {
     int        retval = -1;
     cxobj     *x0c = NULL; /* x0 child */
     cxobj     *x1c = NULL; /* x1 child */
-    yang_stmt *yc;
-    char      *b1;
-    char      *b2;
     int        eq;
+    int        ret;
 
+    if (dirty){
+	if ((ret = xml_diff1_dirty(x0, x1,
+				   x0vec, x0veclen, 
+				   x1vec, x1veclen, 
+				   changed_x0, changed_x1, changedlen)) < 0)
+	    goto done;
+	if (ret == 1)
+	    goto ok;
+    }
     /* Traverse x0 and x1 in lock-step */
     x0c = x1c = NULL;    
     x0c = xml_child_each(x0, x0c, CX_ELMNT);
@@ -579,31 +774,11 @@ xml_diff1(cxobj     *x0,
 	    x1c = xml_child_each(x1, x1c, CX_ELMNT);
 	    continue;
 	}
-	else{ /* equal */
-	    /* xml-spec NULL could happen with anydata children for example,
-	     * if so, continute compare children but without yang
-	     */
-	    yc = xml_spec(x0c);
-	    if (yc && yang_keyword_get(yc) == Y_LEAF){
-		/* if x0c and x1c are leafs w bodies, then they may be changed */
-		b1 = xml_body(x0c);
-		b2 = xml_body(x1c);
-		if (b1 == NULL && b2 == NULL)
-		    ;
-		else if (b1 == NULL || b2 == NULL || strcmp(b1, b2) != 0){
-		    if (cxvec_append(x0c, changed_x0, changedlen) < 0) 
-			goto done;
-		    (*changedlen)--; /* append two vectors */
-		    if (cxvec_append(x1c, changed_x1, changedlen) < 0) 
-			goto done;
-		}
-	    }
-	    else if (xml_diff1(x0c, x1c,   
-			       x0vec, x0veclen, 
-			       x1vec, x1veclen, 
-			       changed_x0, changed_x1, changedlen)< 0)
-		goto done;
-	}
+	else if (xml_diff_equal(x0c, x1c,
+				x0vec, x0veclen, 
+				x1vec, x1veclen, 
+				changed_x0, changed_x1, changedlen, dirty) < 0)
+	    goto done;
 	x0c = xml_child_each(x0, x0c, CX_ELMNT);
 	x1c = xml_child_each(x1, x1c, CX_ELMNT);
     }
@@ -658,7 +833,7 @@ xml_diff(yang_stmt *yspec,
     if (xml_diff1(x0, x1,
 		  first, firstlen, 
 		  second, secondlen, 
-		  changed_x0, changed_x1, changedlen) < 0)
+		  changed_x0, changed_x1, changedlen, 0) < 0)
 	goto done;
  ok:
     retval = 0;
@@ -666,6 +841,52 @@ xml_diff(yang_stmt *yspec,
     return retval;
 }
 
+/*! Compute differences between two xml trees, only considering dirty subtrees
+ *
+ * Same as xml_diff, but x1 must be a copy of x0 that has since been modified with
+ * all modified nodes and their ancestors recorded by xml_dirty_mark, as done by
+ * xmldb_put. Only recorded nodes are visited, other subtrees of x1 are assumed to
+ * be equal to x0, which makes the cost proportional to the size of the
+ * modifications instead of the size of the trees.
+ * The top-level nodes x0 and x1 are always traversed.
+ * @param[in]  yspec      Yang specification
+ * @param[in]  x0         First XML tree
+ * @param[in]  x1         Second XML tree, with dirty marks relative to x0
+ * @param[out] first      Pointervector to XML nodes existing in only first tree
+ * @param[out] firstlen   Length of first vector
+ * @param[out] second     Pointervector to XML nodes existing in only second tree
+ * @param[out] secondlen  Length of second vector
+ * @param[out] changed_x0 Pointervector to XML nodes changed orig value
+ * @param[out] changed_x1 Pointervector to XML nodes changed wanted value
+ * @param[out] changedlen Length of changed vector
+ * All xml vectors should be freed after use.
+ * @see xml_diff
+ * @see xmldb_dirty_get  to check if dirty marks of a datastore are valid
+ */
+int
+xml_diff_dirty(yang_stmt *yspec, 
+	       cxobj     *x0, 
+	       cxobj     *x1,
+	       cxobj   ***first,
+	       int       *firstlen,
+	       cxobj   ***second,
+	       int       *secondlen,
+	       cxobj   ***changed_x0,
+	       cxobj   ***changed_x1,
+	       int       *changedlen)
+{
+    *firstlen = 0;
+    *secondlen = 0;    
+    *changedlen = 0;
+    if (x0 == NULL || x1 == NULL)
+	return xml_diff(yspec, x0, x1, first, firstlen, second, secondlen,
+			changed_x0, changed_x1, changedlen);
+    return xml_diff1(x0, x1,
+		     first, firstlen, 
+		     second, secondlen, 
+		     changed_x0, changed_x1, changedlen, 1);
+}
+
 /*! Prune everything that does not pass test or have at least a child* does not
  * @param[in]   xt      XML tree with some node marked
  * @param[in]   flag    Which flag to test for
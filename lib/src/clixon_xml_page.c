@@ -0,0 +1,580 @@
+/*
+ *
+  ***** BEGIN LICENSE BLOCK *****
+
+  Copyright (C) 2020 Olof Hagsand and Rubicon Communications, LLC(Netgate)
+
+  This file is part of CLIXON.
+
+  Licensed under the Apache License, Version 2.0 (the "License");
+  you may not use this file except in compliance with the License.
+  You may obtain a copy of the License at
+
+    http://www.apache.org/licenses/LICENSE-2.0
+
+  Unless required by applicable law or agreed to in writing, software
+  distributed under the License is distributed on an "AS IS" BASIS,
+  WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+  See the License for the specific language governing permissions and
+  limitations under the License.
+
+  Alternatively, the contents of this file may be used under the terms of
+  the GNU General Public License Version 3 or later (the "GPL"),
+  in which case the provisions of the GPL are applicable instead
+  of those above. If you wish to allow use of your version of this file only
+  under the terms of the GPL, and not to allow others to
+  use your version of this file under the terms of Apache License version 2,
+  indicate your decision by deleting the provisions above and replace them with
+  the  notice and other provisions required by the GPL. If you do not delete
+  the provisions above, a recipient may use your version of this file under
+  the terms of any one of the Apache License version 2 or the GPL.
+
+  ***** END LICENSE BLOCK *****
+
+ * List pagination
+ * A page is a part of the list or leaf-list entries selected by an xpath:
+ *   - in document order, or reverse order if backwards,
+ *   - starting after the entry of a cursor, if given,
+ *   - only entries for which the where xpath is true, if given,
+ *   - only entries kept by the filter, eg read access control, if given,
+ *   - skipping offset entries, and at most limit entries.
+ * If the xpath selects all entries of one list, ie the last step has no predicate,
+ * entries are taken directly from the (sorted) child vector of the parent: a page
+ * only visits the entries it skips and returns, and a cursor is found by binary
+ * search if the list is ordered by system. Otherwise the xpath is evaluated and
+ * the page is taken from the result.
+ * A cursor is an opaque string encoding the list name and keys (or value of a 
+ * leaf-list) of an entry, in hex.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include "clixon_config.h" /* generated by config & autoconf */
+#endif
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <errno.h>
+
+/* cligen */
+#include <cligen/cligen.h>
+
+/* clixon */
+#include "clixon_string.h"
+#include "clixon_err.h"
+#include "clixon_queue.h"
+#include "clixon_hash.h"
+#include "clixon_handle.h"
+#include "clixon_yang.h"
+#include "clixon_xml.h"
+#include "clixon_xml_nsctx.h"
+#include "clixon_xml_sort.h"
+#include "clixon_xpath_ctx.h"
+#include "clixon_xpath.h"
+#include "clixon_xml_page.h"
+
+/*
+ * Types
+ */
+/* Candidate entries of a page: either children [pe_first, pe_last) of pe_xp
+ * (fast path), or a vector of nodes selected by xpath */
+struct page_entries{
+    cxobj   *pe_xp;     /* Parent, or NULL if pe_vec is used */
+    int      pe_first;  /* First child index of list in pe_xp */
+    int      pe_last;   /* Index after last child of list in pe_xp */
+    cxobj  **pe_vec;    /* Nodes selected by xpath */
+    size_t   pe_len;    /* Length of pe_vec */
+    int      pe_sorted; /* Entries ordered by system: binary search on cursor */
+};
+
+/*! Number of candidate entries */
+static int
+page_len(struct page_entries *pe)
+{
+    if (pe->pe_xp)
+	return pe->pe_last - pe->pe_first;
+    return pe->pe_len;
+}
+
+/*! Candidate entry i */
+static cxobj *
+page_entry(struct page_entries *pe,
+	   int                  i)
+{
+    if (pe->pe_xp)
+	return xml_child_i(pe->pe_xp, pe->pe_first + i);
+    return pe->pe_vec[i];
+}
+
+/*! Find position of last '/' of an xpath that is not in a predicate or literal
+ * @param[in]  xpath  XPath
+ * @retval     p      Pointer to last step separator
+ * @retval     NULL   None, or xpath is not a plain location path
+ */
+static char *
+page_last_step(char *xpath)
+{
+    char *s;
+    char *p = NULL;
+    char  q = 0;
+    int   depth = 0;
+
+    for (s = xpath; *s; s++){
+	if (q){
+	    if (*s == q)
+		q = 0;
+	    continue;
+	}
+	switch (*s){
+	case '"':
+	case '\'':
+	    q = *s;
+	    break;
+	case '[':
+	    depth++;
+	    break;
+	case ']':
+	    depth--;
+	    break;
+	case '|':
+	case '(':
+	    if (depth == 0)
+		return NULL;
+	    break;
+	case '/':
+	    if (depth == 0)
+		p = s;
+	    break;
+	}
+    }
+    return p;
+}
+
+/*! Try to find list of a page directly in the child vector of its parent
+ * Possible if the last step of xpath is a name without predicates, and the rest
+ * of xpath selects one parent.
+ * @param[in]  xt     XML tree
+ * @param[in]  nsc    Namespace context of xpath
+ * @param[in]  xpath  XPath
+ * @param[out] pe     Set pe_xp, pe_first, pe_last and pe_sorted if found
+ * @retval     1      Found, or there are no entries (pe_xp is NULL and pe_len 0)
+ * @retval     0      Not possible
+ * @retval    -1      Error
+ */
+static int
+page_list_find(cxobj               *xt,
+	       cvec                *nsc,
+	       char                *xpath,
+	       struct page_entries *pe)
+{
+    int         retval = -1;
+    char       *step;
+    char       *name;
+    char       *prefix = NULL;
+    char       *ns;
+    char       *xns = NULL;
+    char       *parent = NULL;
+    cxobj     **xvec = NULL;
+    size_t      xlen = 0;
+    cxobj      *xp;
+    cxobj      *xc;
+    yang_stmt  *y;
+    int         n;
+    int         i;
+    int         low;
+    int         high;
+    int         mid;
+
+    if ((step = page_last_step(xpath)) == NULL)
+	goto fail;
+    name = step+1;
+    if (*name == '\0' || strpbrk(name, "[]*@.()=<> \t") != NULL)
+	goto fail;
+    if ((parent = strdup(xpath)) == NULL){
+	clicon_err(OE_UNIX, errno, "strdup");
+	goto done;
+    }
+    parent[step-xpath] = '\0';
+    name = parent + (step-xpath) + 1;
+    if ((step = strchr(name, ':')) != NULL){
+	*step = '\0';
+	prefix = name;
+	name = step+1;
+    }
+    if (strlen(parent) == 0)
+	xp = xt;
+    else {
+	if (strstr(parent, "//") != NULL || parent[strlen(parent)-1] == '/')
+	    goto fail;
+	if (xpath_vec(xt, nsc, "%s", &xvec, &xlen, parent) < 0)
+	    goto done;
+	if (xlen == 0){ /* No parent: no entries */
+	    pe->pe_xp = NULL;
+	    pe->pe_len = 0;
+	    goto ok;
+	}
+	if (xlen != 1)
+	    goto fail;
+	xp = xvec[0];
+    }
+    /* First entry */
+    n = xml_child_nr(xp);
+    for (i=0; i<n; i++){
+	xc = xml_child_i(xp, i);
+	if (xml_type(xc) == CX_ELMNT && strcmp(xml_name(xc), name) == 0)
+	    break;
+    }
+    if (i == n){
+	pe->pe_xp = NULL;
+	pe->pe_len = 0;
+	goto ok;
+    }
+    if ((y = xml_spec(xc)) == NULL ||
+	(yang_keyword_get(y) != Y_LIST && yang_keyword_get(y) != Y_LEAF_LIST))
+	goto fail;
+    /* Check namespace, another module may augment a list with the same name */
+    ns = xml_nsctx_get(nsc, prefix);
+    if (ns != NULL){
+	if (xml2ns(xc, xml_prefix(xc), &xns) < 0)
+	    goto done;
+	if (xns == NULL || strcmp(ns, xns) != 0)
+	    goto fail;
+    }
+    pe->pe_xp = xp;
+    pe->pe_first = i;
+    /* Entries of a list are adjacent in a sorted tree: find the end */
+    low = i+1;
+    high = n;
+    while (low < high){
+	mid = (low + high)/2;
+	if (xml_spec(xml_child_i(xp, mid)) == y)
+	    low = mid+1;
+	else
+	    high = mid;
+    }
+    pe->pe_last = low;
+    pe->pe_sorted = yang_config(y) && yang_find(y, Y_ORDERED_BY, "user") == NULL;
+ ok:
+    retval = 1;
+ done:
+    if (parent)
+	free(parent);
+    if (xvec)
+	free(xvec);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Encode cursor of a list or leaf-list entry
+ * @param[in]  x      Entry
+ * @param[out] cursor Cursor, malloced. Free after use
+ * @retval     0      OK
+ * @retval    -1      Error
+ */
+static int
+page_cursor_encode(cxobj *x,
+		   char **cursor)
+{
+    int        retval = -1;
+    cbuf      *cb = NULL;
+    yang_stmt *y;
+    cg_var    *cvi = NULL;
+    char      *str;
+    char      *s;
+
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_UNIX, errno, "cbuf_new");
+	goto done;
+    }
+    y = xml_spec(x);
+    for (s = xml_name(x); *s; s++)
+	cprintf(cb, "%02x", (unsigned char)*s);
+    if (y && yang_keyword_get(y) == Y_LIST){
+	while ((cvi = cvec_each(yang_cvec_get(y), cvi)) != NULL){
+	    cprintf(cb, "00");
+	    if ((str = xml_find_body(x, cv_string_get(cvi))) != NULL)
+		for (s = str; *s; s++)
+		    cprintf(cb, "%02x", (unsigned char)*s);
+	}
+    }
+    else{
+	cprintf(cb, "00");
+	if ((str = xml_body(x)) != NULL)
+	    for (s = str; *s; s++)
+		cprintf(cb, "%02x", (unsigned char)*s);
+    }
+    if ((*cursor = strdup(cbuf_get(cb))) == NULL){
+	clicon_err(OE_UNIX, errno, "strdup");
+	goto done;
+    }
+    retval = 0;
+ done:
+    if (cb)
+	cbuf_free(cb);
+    return retval;
+}
+
+/*! Decode a cursor into an entry that can be compared with list entries
+ * @param[in]  cursor Cursor
+ * @param[in]  x0     An entry of the list, for yang spec
+ * @param[out] xp     Entry with keys (or value) of cursor, free with xml_free
+ * @retval     1      OK
+ * @retval     0      Invalid cursor, or not a cursor of this list
+ * @retval    -1      Error
+ */
+static int
+page_cursor_decode(char   *cursor,
+		   cxobj  *x0,
+		   cxobj **xp)
+{
+    int        retval = -1;
+    char      *buf = NULL;
+    size_t     len;
+    size_t     i;
+    unsigned   c;
+    char      *s;
+    yang_stmt *y;
+    yang_stmt *yk;
+    cxobj     *x = NULL;
+    cxobj     *xk;
+    cg_var    *cvi = NULL;
+
+    len = strlen(cursor);
+    if (len % 2)
+	goto fail;
+    if ((buf = calloc(len/2 + 2, 1)) == NULL){
+	clicon_err(OE_UNIX, errno, "calloc");
+	goto done;
+    }
+    for (i=0; i<len/2; i++){
+	if (sscanf(cursor + 2*i, "%2x", &c) != 1)
+	    goto fail;
+	buf[i] = c;
+    }
+    /* buf: name \0 value [\0 value]... \0\0 */
+    y = xml_spec(x0);
+    if (strcmp(buf, xml_name(x0)) != 0)
+	goto fail;
+    s = buf + strlen(buf);
+    if ((size_t)(s - buf) >= len/2)
+	goto fail;
+    s++;
+    if ((x = xml_new(xml_name(x0), NULL, CX_ELMNT)) == NULL)
+	goto done;
+    xml_spec_set(x, y);
+    if (yang_keyword_get(y) == Y_LIST){
+	while ((cvi = cvec_each(yang_cvec_get(y), cvi)) != NULL){
+	    if ((size_t)(s - buf) > len/2)
+		goto fail;
+	    if ((xk = xml_new_body(cv_string_get(cvi), x, s)) == NULL)
+		goto done;
+	    if ((yk = yang_find(y, Y_LEAF, cv_string_get(cvi))) != NULL)
+		xml_spec_set(xk, yk);
+	    s += strlen(s) + 1;
+	}
+    }
+    else {
+	cxobj *xb;
+	if ((xb = xml_new("body", x, CX_BODY)) == NULL)
+	    goto done;
+	if (xml_value_set(xb, s) < 0)
+	    goto done;
+    }
+    *xp = x;
+    x = NULL;
+    retval = 1;
+ done:
+    if (buf)
+	free(buf);
+    if (x)
+	xml_free(x);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
+
+/*! Find index of first candidate entry after cursor, in page order
+ * @param[in]  pe      Candidate entries
+ * @param[in]  xc      Entry decoded from cursor
+ * @param[in]  back    Backwards, ie "after" means before in document order
+ * @param[out] start   Index of first entry after cursor (forwards), or of last 
+ *                     entry before cursor (backwards), may be -1 or page_len
+ * @retval     1       OK
+ * @retval     0       Cursor entry not found (unsorted entries only)
+ */
+static int
+page_cursor_start(struct page_entries *pe,
+		  cxobj               *xc,
+		  int                  back,
+		  int                 *start)
+{
+    int low;
+    int high;
+    int mid;
+    int n = page_len(pe);
+    int i;
+
+    if (pe->pe_sorted){
+	/* First entry > cursor (forwards), or first entry >= cursor (backwards) */
+	low = 0;
+	high = n;
+	while (low < high){
+	    mid = (low + high)/2;
+	    if (xml_cmp(page_entry(pe, mid), xc, 0, 0, NULL) < (back?0:1))
+		low = mid+1;
+	    else
+		high = mid;
+	}
+	*start = back ? low-1 : low;
+	return 1;
+    }
+    for (i=0; i<n; i++)
+	if (xml_spec(page_entry(pe, i)) == xml_spec(xc) &&
+	    xml_cmp(page_entry(pe, i), xc, 0, 0, NULL) == 0)
+	    break;
+    if (i == n)
+	return 0;
+    *start = back ? i-1 : i+1;
+    return 1;
+}
+
+/*! Check if a candidate entry is part of the selection, before offset and limit
+ * @param[in]  x    Candidate entry
+ * @param[in]  nsc  Namespace context of where
+ * @param[in]  pg   Pagination parameters
+ * @retval     1    Entry is selected
+ * @retval     0    Entry is not selected: where is false, or filtered out
+ * @retval    -1    Error
+ */
+static int
+page_entry_match(cxobj       *x,
+		 cvec        *nsc,
+		 clixon_page *pg)
+{
+    int ret;
+
+    if (pg->pg_where){
+	if ((ret = xpath_vec_bool(x, nsc, "%s", pg->pg_where)) < 1)
+	    return ret;
+    }
+    if (pg->pg_filter)
+	return pg->pg_filter(x, pg->pg_filterarg);
+    return 1;
+}
+
+/*! Select a page of list or leaf-list entries
+ * @param[in]  xt      XML tree
+ * @param[in]  nsc     Namespace context of xpath and where
+ * @param[in]  xpath   XPath selecting list or leaf-list entries
+ * @param[in]  pg      Pagination parameters
+ * @param[out] vec     Vector of entries in page, in page order. Free after use
+ * @param[out] veclen  Length of vector
+ * @param[out] next    Cursor of next page if there are more entries, else NULL. Free after use
+ * @retval     1       OK
+ * @retval     0       Invalid cursor
+ * @retval    -1       Error
+ * Entries skipped by where or the filter are not counted by offset and limit,
+ * and the cursor of the next page is made from the last entry of the page.
+ * @code
+ *   clixon_page pg = {0, 10, 0, NULL, NULL}; // First 10 entries
+ *   if (clixon_page_select(xt, nsc, "/ex:x/ex:y", &pg, &vec, &veclen, &next) < 0)
+ *      err;
+ *   free(vec);
+ *   if (next) free(next);
+ * @endcode
+ */
+int
+clixon_page_select(cxobj       *xt,
+		   cvec        *nsc,
+		   char        *xpath,
+		   clixon_page *pg,
+		   cxobj     ***vec,
+		   size_t      *veclen,
+		   char       **next)
+{
+    int                 retval = -1;
+    struct page_entries pe = {0,};
+    cxobj             **pvec = NULL;
+    size_t              plen = 0;
+    cxobj              *xcursor = NULL;
+    cxobj              *x;
+    uint32_t            skip;
+    int                 n;
+    int                 i;
+    int                 step;
+    int                 ret;
+
+    *vec = NULL;
+    *veclen = 0;
+    *next = NULL;
+    if (xpath == NULL)
+	xpath = "/";
+    if ((ret = page_list_find(xt, nsc, xpath, &pe)) < 0)
+	goto done;
+    if (ret == 0){
+	if (xpath_vec(xt, nsc, "%s", &pe.pe_vec, &pe.pe_len, xpath) < 0)
+	    goto done;
+    }
+    if ((n = page_len(&pe)) == 0)
+	goto ok;
+    step = pg->pg_backwards ? -1 : 1;
+    i = pg->pg_backwards ? n-1 : 0;
+    if (pg->pg_cursor){
+	if ((ret = page_cursor_decode(pg->pg_cursor, page_entry(&pe, 0), &xcursor)) < 0)
+	    goto done;
+	if (ret == 0)
+	    goto fail;
+	if (page_cursor_start(&pe, xcursor, pg->pg_backwards, &i) == 0)
+	    goto fail;
+    }
+    if ((pvec = calloc(pg->pg_limit && pg->pg_limit < n ? pg->pg_limit : n,
+		       sizeof(cxobj*))) == NULL){
+	clicon_err(OE_UNIX, errno, "calloc");
+	goto done;
+    }
+    skip = pg->pg_offset;
+    for (; i >= 0 && i < n; i += step){
+	if (pg->pg_limit && plen == pg->pg_limit)
+	    break;
+	x = page_entry(&pe, i);
+	if ((ret = page_entry_match(x, nsc, pg)) < 0)
+	    goto done;
+	if (ret == 0)
+	    continue;
+	if (skip){
+	    skip--;
+	    continue;
+	}
+	pvec[plen++] = x;
+    }
+    /* Page is full: next page only if there is another selected entry */
+    for (; plen && i >= 0 && i < n; i += step){
+	if ((ret = page_entry_match(page_entry(&pe, i), nsc, pg)) < 0)
+	    goto done;
+	if (ret == 1){
+	    if (page_cursor_encode(pvec[plen-1], next) < 0)
+		goto done;
+	    break;
+	}
+    }
+    *vec = pvec;
+    *veclen = plen;
+    pvec = NULL;
+ ok:
+    retval = 1;
+ done:
+    if (pe.pe_vec)
+	free(pe.pe_vec);
+    if (pvec)
+	free(pvec);
+    if (xcursor)
+	xml_free(xcursor);
+    return retval;
+ fail:
+    retval = 0;
+    goto done;
+}
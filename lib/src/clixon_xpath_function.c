@@ -173,8 +173,6 @@ xp_function_deref(xp_ctx            *xc0,
     cxobj      *xref;
     yang_stmt  *ys;
     yang_stmt  *yt;
-    yang_stmt  *ypath;
-    char       *path;
     
     /* Create new xc */
     if ((xc = ctx_dup(xc0)) == NULL)
@@ -187,21 +185,24 @@ xp_function_deref(xp_ctx            *xc0,
 	if (yang_type_get(ys, NULL, &yt, NULL, NULL, NULL, NULL, NULL) < 0)
 	    goto done;
 	if (strcmp(yang_argument_get(yt), "leafref") == 0){
-	    if ((ypath = yang_find(yt, Y_PATH, NULL)) != NULL){
-		path = yang_argument_get(ypath);
-		if ((xref = xpath_first(xv, nsc, "%s", path)) != NULL)
-		    if (cxvec_append(xref, &vec, &veclen) < 0)
-			goto done;
-	    }
-	    ctx_nodeset_replace(xc, vec, veclen);
+	    /* The referred node is the target with the same value, RFC7950 10.3.1 */
+	    if (xml_leafref_target(xv, ys, yt, &xref) < 0)
+		goto done;
+	    if (xref != NULL)
+		if (cxvec_append(xref, &vec, &veclen) < 0)
+		    goto done;
 	}
 	else if (strcmp(yang_argument_get(yt), "identityref") == 0){
 	}
     }
+    ctx_nodeset_replace(xc, vec, veclen);
+    vec = NULL;
     *xrp = xc;
     xc = NULL;
     retval = 0;
  done:
+    if (vec)
+	free(vec);
     if (xc)
 	ctx_free(xc);
     return retval;
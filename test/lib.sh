@@ -302,6 +302,60 @@ wait_backend(){
     done
 }
 
+# Write config file $cfg for backend tests of application $APPNAME with yang $fyang
+# and backend socket $sock. The arguments are added as extra config options, eg:
+#   backend_config "<CLICON_BACKEND_WORKERS>4</CLICON_BACKEND_WORKERS>"
+backend_config(){
+    cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_CLISPEC_DIR>/usr/local/lib/$APPNAME/clispec</CLICON_CLISPEC_DIR>
+  <CLICON_CLI_DIR>/usr/local/lib/$APPNAME/cli</CLICON_CLI_DIR>
+  <CLICON_CLI_MODE>$APPNAME</CLICON_CLI_MODE>
+  <CLICON_SOCK>$sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_MODULE_LIBRARY_RFC7895>false</CLICON_MODULE_LIBRARY_RFC7895>
+  $*
+</clixon-config>
+EOF
+}
+
+# Kill old backend, start a new with config file $cfg and wait until it is up
+# The arguments are passed to start_backend after -f $cfg, eg -s init -- -s
+testrun_start_backend(){
+    new "test params: -f $cfg"
+    if [ $BE -ne 0 ]; then
+	new "kill old backend"
+	sudo clixon_backend -zf $cfg
+	if [ $? -ne 0 ]; then
+	    err
+	fi
+	new "start backend -f $cfg $*"
+	start_backend -f $cfg $*
+
+	new "waiting"
+	wait_backend
+    fi
+}
+
+# Check that the backend with config file $cfg is still running and stop it
+testrun_stop_backend(){
+    if [ $BE -ne 0 ]; then
+	new "Kill backend"
+	# Check if premature kill
+	pid=$(pgrep -u root -f clixon_backend)
+	if [ -z "$pid" ]; then
+	    err "backend already dead"
+	fi
+	# kill backend
+	stop_backend -f $cfg
+    fi
+}
+
 # Start restconf daemon
 # @see wait_restconf
 start_restconf(){
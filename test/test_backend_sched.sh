@@ -0,0 +1,178 @@
+#!/usr/bin/env bash
+# Backend request scheduler: CLICON_BACKEND_SCHEDULER
+# Serve requests of different priority classes with and without scheduler, with
+# pipelined requests from one client and concurrent requests from several clients,
+# and check that replies of each client are in order.
+# With the scheduler, check that a lock behind many pipelined large gets of another
+# client is answered before them, and that a get behind many pipelined edits of
+# another client is not starved (SCHED_WAIT_MAX in backend_sched.c).
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+# Raw unit tester of backend unix socket
+: ${clixon_util_socket:=clixon_util_socket}
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/test.yang
+sock=/usr/local/var/$APPNAME/$APPNAME.sock
+
+# Number of list entries in startup
+: ${perfnr:=5000}
+
+# Number of pipelined requests of the client that is overtaken
+: ${pipenr:=40}
+
+# Max number of requests of another client served before a request of a higher
+# class, and of a lower class (SCHED_WAIT_MAX), plus some slack for timing
+lockmax=3
+waitmax=20
+
+cat <<EOF > $fyang
+module $APPNAME{
+  yang-version 1.1;
+  namespace "urn:example:clixon";
+  prefix ex;
+  container c{
+    list x{
+      key name;
+      leaf name{
+        type string;
+      }
+      leaf value{
+        type int32;
+      }
+    }
+  }
+}
+EOF
+
+# Large startup db, so that replies of get-config are streamed in several frames
+new "generate startup with $perfnr entries"
+echo -n "<config><c xmlns=\"urn:example:clixon\">" > $dir/startup_db
+for (( i=0; i<$perfnr; i++ )); do
+    echo -n "<x><name>$i</name><value>$i</value></x>" >> $dir/startup_db
+done
+echo "</c></config>" >> $dir/startup_db
+
+# Large edit, so that each edit takes some time
+EDIT="<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:clixon\">"
+for (( i=0; i<500; i++ )); do
+    EDIT="$EDIT<x><name>$i</name><value>$i</value></x>"
+done
+EDIT="$EDIT</c></config></edit-config></rpc>"
+
+# Count replies matching a pattern in a file
+# 1: file
+# 2: pattern
+nreplies(){
+    grep -o "$2" $1 2> /dev/null | wc -l
+}
+
+# Wait until there is a reply matching a pattern in a file
+# 1: file
+# 2: pattern
+waitreply(){
+    for (( j=0; j<1000; j++ )); do
+	if [ $(nreplies $1 "$2") -gt 0 ]; then
+	    return
+	fi
+	sleep 0.01
+    done
+    err "reply in $1" "none"
+}
+
+# 1: scheduler true or false
+testrun(){
+    sched=$1
+
+    backend_config "<CLICON_BACKEND_REPLY_CHUNK>1000</CLICON_BACKEND_REPLY_CHUNK><CLICON_BACKEND_SCHEDULER>$sched</CLICON_BACKEND_SCHEDULER>"
+
+    testrun_start_backend -s startup
+
+    new "lock, edit, get-config, commit and unlock in one session"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><lock><target><candidate/></target></lock></rpc>]]>]]><rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:clixon\"><x><name>a</name><value>1</value></x></c></config></edit-config></rpc>]]>]]><rpc $DEFAULTNS><get-config><source><candidate/></source><filter type=\"xpath\" select=\"/ex:c/ex:x[ex:name='a']\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>]]>]]><rpc $DEFAULTNS><commit/></rpc>]]>]]><rpc $DEFAULTNS><unlock><target><candidate/></target></unlock></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><x><name>a</name><value>1</value></x></c></data></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "get running after commit"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:c/ex:x[ex:name='a']\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><x><name>a</name><value>1</value></x></c></data></rpc-reply>]]>]]>$"
+
+    new "lock and unlock while other clients read"
+    pids=""
+    for (( i=0; i<4; i++ )); do
+	(echo "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>" | $clixon_util_socket -s $sock -D $DBG -p 20 > $dir/read$i 2>&1) &
+	pids="$pids $!"
+    done
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><lock><target><running/></target></lock></rpc>]]>]]><rpc $DEFAULTNS><unlock><target><running/></target></unlock></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+    wait $pids
+    for (( i=0; i<4; i++ )); do
+	new "reader $i replies"
+	nr=$(grep -o "<name>$((perfnr-1))</name>" $dir/read$i | wc -l)
+	if [ $nr -ne 20 ]; then
+	    err "20 replies" "$nr replies"
+	fi
+    done
+
+    if [ $sched = true ]; then
+	new "lock behind $pipenr pipelined gets of other client"
+	(echo "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>" | $clixon_util_socket -s $sock -D $DBG -p $pipenr > $dir/gets 2>&1) &
+	pid=$!
+	waitreply $dir/gets "<name>$((perfnr-1))</name>"
+	nr0=$(nreplies $dir/gets "<name>$((perfnr-1))</name>")
+	ret=$(echo "<rpc $DEFAULTNS><lock><target><running/></target></lock></rpc>" | $clixon_util_socket -s $sock -D $DBG)
+	nr=$(nreplies $dir/gets "<name>$((perfnr-1))</name>")
+	match=$(echo "$ret" | grep --null -o "<ok/>")
+	if [ -z "$match" ]; then
+	    err "<ok/>" "$ret"
+	fi
+	new "lock answered after at most $lockmax gets: $((nr-nr0))"
+	if [ $nr -ge $pipenr -o $((nr-nr0)) -gt $lockmax ]; then
+	    err "lock before gets" "lock after $((nr-nr0)) of $((pipenr-nr0)) gets"
+	fi
+	wait $pid
+	new "all gets answered"
+	nr=$(nreplies $dir/gets "<name>$((perfnr-1))</name>")
+	if [ $nr -ne $pipenr ]; then
+	    err "$pipenr replies" "$nr replies"
+	fi
+
+	new "get behind $pipenr pipelined edits of other client is not starved"
+	(echo "$EDIT" | $clixon_util_socket -s $sock -D $DBG -p $pipenr > $dir/edits 2>&1) &
+	pid=$!
+	waitreply $dir/edits "<ok/>"
+	nr0=$(nreplies $dir/edits "<ok/>")
+	ret=$(echo "<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:c/ex:x[ex:name='a']\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>" | $clixon_util_socket -s $sock -D $DBG)
+	nr=$(nreplies $dir/edits "<ok/>")
+	match=$(echo "$ret" | grep --null -o "<name>a</name>")
+	if [ -z "$match" ]; then
+	    err "<name>a</name>" "$ret"
+	fi
+	new "get answered after at most $waitmax edits: $((nr-nr0))"
+	if [ $nr -ge $pipenr -o $((nr-nr0)) -gt $waitmax ]; then
+	    err "get before edits" "get after $((nr-nr0)) of $((pipenr-nr0)) edits"
+	fi
+	wait $pid
+	new "all edits answered"
+	nr=$(nreplies $dir/edits "<ok/>")
+	if [ $nr -ne $pipenr ]; then
+	    err "$pipenr replies" "$nr replies"
+	fi
+
+	new "discard edits"
+	expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><discard-changes/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+    fi
+
+    new "kill-session of other session"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><kill-session><session-id>44</session-id></kill-session></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    testrun_stop_backend
+} # testrun
+
+new "Backend scheduler"
+testrun true
+
+new "No backend scheduler"
+testrun false
+
+rm -rf $dir
@@ -0,0 +1,178 @@
+#!/usr/bin/env bash
+# Backend clients indexed by session id, and notification subscriptions of clients
+# - Open many sessions, one of them takes a lock. kill-session of its session id
+#   releases the lock.
+# - Disconnect sessions with active subscriptions, by closing them and by
+#   kill-session, and check that the backend continues to send notifications to
+#   the remaining subscriber.
+# Uses the EXAMPLE stream of the example backend plugin, with a notification every 5s
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/test.yang
+sock=/usr/local/var/$APPNAME/$APPNAME.sock
+
+# Number of open sessions
+: ${nr:=40}
+
+# Number of subscribing sessions
+: ${subnr:=4}
+
+cat <<EOF > $fyang
+module $APPNAME{
+  yang-version 1.1;
+  namespace "urn:example:clixon";
+  prefix ex;
+  notification event {
+    leaf event-class {
+      type string;
+    }
+    container reportingEntity {
+      leaf card {
+        type string;
+      }
+    }
+    leaf severity {
+      type string;
+    }
+  }
+}
+EOF
+
+# Open netconf session, kept open until closed with session_close
+# 1: session number
+session_open(){
+    rm -f $dir/fifo$1
+    mkfifo $dir/fifo$1
+    $clixon_netconf -f $cfg < $dir/fifo$1 > $dir/out$1 2>&1 &
+    pids[$1]=$!
+    exec {fd}> $dir/fifo$1
+    fds[$1]=$fd
+}
+
+# Send rpc on open session
+# 1: session number
+# 2: rpc
+session_send(){
+    echo "<rpc $DEFAULTNS>$2</rpc>]]>]]>" >&${fds[$1]}
+}
+
+# Close open session, ie eof, and wait for it to exit
+# 1: session number
+session_close(){
+    eval "exec ${fds[$1]}>&-"
+    wait ${pids[$1]}
+}
+
+# Wait until output of open session matches a pattern
+# 1: session number
+# 2: pattern
+session_wait(){
+    for (( j=0; j<1000; j++ )); do
+	if grep -q "$2" $dir/out$1 2> /dev/null; then
+	    return
+	fi
+	sleep 0.01
+    done
+    err "$2" "$(cat $dir/out$1)"
+}
+
+# Get session id of open session from its hello
+# 1: session number
+session_id(){
+    session_wait $1 "<session-id>[0-9]*</session-id>"
+    grep -o "<session-id>[0-9]*</session-id>" $dir/out$1 | head -1 | grep -o "[0-9]*"
+}
+
+# Count notifications in output of open session
+# 1: session number
+session_notifications(){
+    grep -o "<notification " $dir/out$1 | wc -l
+}
+
+backend_config "<CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR><CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP><CLICON_STREAM_DISCOVERY_RFC5277>true</CLICON_STREAM_DISCOVERY_RFC5277>"
+
+testrun_start_backend -s init
+
+new "open $nr sessions"
+for (( i=0; i<$nr; i++ )); do
+    session_open $i
+done
+for (( i=0; i<$nr; i++ )); do
+    ids[$i]=$(session_id $i)
+done
+
+k=$((nr/2))
+new "session $k with session id ${ids[$k]} locks candidate"
+session_send $k "<lock><target><candidate/></target></lock>"
+session_wait $k "<rpc-reply $DEFAULTNS><ok/></rpc-reply>"
+
+new "lock by other session is denied with session id ${ids[$k]}"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><lock><target><candidate/></target></lock></rpc>]]>]]>" "<error-tag>lock-denied</error-tag><error-info><session-id>${ids[$k]}</session-id></error-info>"
+
+new "kill-session of other session id"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><kill-session><session-id>${ids[$((k+1))]}</session-id></kill-session></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "lock is still held"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><lock><target><candidate/></target></lock></rpc>]]>]]>" "<error-tag>lock-denied</error-tag><error-info><session-id>${ids[$k]}</session-id></error-info>"
+
+new "kill-session ${ids[$k]}"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><kill-session><session-id>${ids[$k]}</session-id></kill-session></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "lock released by kill-session"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><lock><target><candidate/></target></lock></rpc>]]>]]><rpc $DEFAULTNS><unlock><target><candidate/></target></unlock></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "close $nr sessions"
+for (( i=0; i<$nr; i++ )); do
+    session_close $i
+done
+
+new "open $subnr subscribing sessions"
+for (( i=0; i<$subnr; i++ )); do
+    session_open $i
+    ids[$i]=$(session_id $i)
+    session_send $i "<create-subscription xmlns=\"urn:ietf:params:xml:ns:netmod:notification\"><stream>EXAMPLE</stream></create-subscription>"
+done
+for (( i=0; i<$subnr; i++ )); do
+    session_wait $i "<notification "
+done
+
+new "close subscribing session 0"
+session_close 0
+
+new "kill subscribing session 1"
+kill ${pids[1]}
+eval "exec ${fds[1]}>&-"
+wait ${pids[1]}
+
+new "kill-session of subscribing session 2 with session id ${ids[2]}"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><kill-session><session-id>${ids[2]}</session-id></kill-session></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "remaining subscriber gets notifications"
+n0=$(session_notifications 3)
+sleep 6
+n1=$(session_notifications 3)
+if [ $n1 -le $n0 ]; then
+    err "more than $n0 notifications" "$n1"
+fi
+
+new "backend is alive"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><ping xmlns=\"http://clicon.org/lib\"/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "close remaining subscribing sessions"
+kill ${pids[2]} ${pids[3]} 2> /dev/null
+for i in 2 3; do
+    eval "exec ${fds[$i]}>&-"
+    wait ${pids[$i]}
+done
+
+new "backend is alive"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><ping xmlns=\"http://clicon.org/lib\"/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+testrun_stop_backend
+
+rm -rf $dir
@@ -0,0 +1,87 @@
+#!/usr/bin/env bash
+# Streamed replies from backend in frames: CLICON_BACKEND_REPLY_CHUNK
+# Get a config larger than the frame size with streaming enabled and disabled,
+# also with depth and in pipelined requests, and check that replies are whole.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+# Raw unit tester of backend unix socket
+: ${clixon_util_socket:=clixon_util_socket}
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/test.yang
+sock=/usr/local/var/$APPNAME/$APPNAME.sock
+
+# Number of list entries
+: ${perfnr:=500}
+
+cat <<EOF > $fyang
+module $APPNAME{
+  yang-version 1.1;
+  namespace "urn:example:clixon";
+  prefix ex;
+  container c{
+    list x{
+      key name;
+      leaf name{
+        type int32;
+      }
+      leaf value{
+        type string;
+      }
+    }
+  }
+}
+EOF
+
+# Startup db with perfnr entries
+new "generate startup db with $perfnr entries"
+echo -n "<config><c xmlns=\"urn:example:clixon\">" > $dir/startup_db
+for (( i=0; i<$perfnr; i++ )); do
+    echo -n "<x><name>$i</name><value>value of entry $i</value></x>" >> $dir/startup_db
+done
+echo "</c></config>" >> $dir/startup_db
+
+# 1: frame size
+testrun(){
+    chunk=$1
+
+    backend_config "<CLICON_BACKEND_REPLY_CHUNK>$chunk</CLICON_BACKEND_REPLY_CHUNK>"
+
+    testrun_start_backend -s startup
+
+    new "get-config running"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><x><name>0</name><value>value of entry 0</value></x><x><name>1</name>.*<x><name>$((perfnr-1))</name><value>value of entry $((perfnr-1))</value></x></c></data></rpc-reply>]]>]]>$"
+
+    new "get with xpath"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:c/ex:x[ex:name='7']\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><x><name>7</name><value>value of entry 7</value></x></c></data></rpc-reply>]]>]]>$"
+
+    new "get-config with depth"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config depth=\"1\"><source><running/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"/></data></rpc-reply>]]>]]>$"
+
+    new "get-config followed by edit-config in one session"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>]]>]]><rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:clixon\"><x><name>0</name><value>new</value></x></c></config></edit-config></rpc>]]>]]>" "<x><name>$((perfnr-1))</name><value>value of entry $((perfnr-1))</value></x></c></data></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "pipelined get-config"
+    ret=$(echo "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>" | $clixon_util_socket -s $sock -D $DBG -p 5)
+    nr=$(echo "$ret" | grep -o "<name>$((perfnr-1))</name>" | wc -l)
+    if [ $nr -ne 5 ]; then
+	err "5 replies" "$nr replies"
+    fi
+
+    testrun_stop_backend
+} # testrun
+
+new "Small frames"
+testrun 1000
+
+new "Default frame size"
+testrun 65536
+
+new "No streaming"
+testrun 0
+
+rm -rf $dir
@@ -0,0 +1,138 @@
+#!/usr/bin/env bash
+# Backend workers for read-only requests: CLICON_BACKEND_WORKERS
+# Serve get-config, get and validate with and without workers, interleaved with
+# edits and commits, and check that replies of pipelined requests are in order.
+# With workers, a slow get (state callback delay) does not block a concurrent
+# edit and commit, and the worker process is reaped when it has replied.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/test.yang
+sock=/usr/local/var/$APPNAME/$APPNAME.sock
+pidfile=/usr/local/var/$APPNAME/$APPNAME.pidfile
+
+# Delay of state callback of example backend plugin in ms
+: ${delay:=3000}
+
+cat <<EOF > $fyang
+module $APPNAME{
+  yang-version 1.1;
+  namespace "urn:example:clixon";
+  prefix ex;
+  container c{
+    list x{
+      key name;
+      leaf name{
+        type string;
+      }
+      leaf value{
+        type int32;
+        must ". < 100" {
+          error-message "value too large";
+        }
+      }
+    }
+  }
+  container state{
+    config false;
+    leaf-list op{
+      type string;
+    }
+  }
+}
+EOF
+
+# 1: number of workers
+testrun(){
+    workers=$1
+
+    backend_config "<CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR><CLICON_BACKEND_WORKERS>$workers</CLICON_BACKEND_WORKERS>"
+
+    testrun_start_backend -s init -- -s -d $delay
+
+    new "edit-config"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:clixon\"><x><name>a</name><value>1</value></x></c></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "get-config candidate"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config><source><candidate/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><x><name>a</name><value>1</value></x></c></data></rpc-reply>]]>]]>$"
+
+    new "validate"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "commit"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "edit invalid value"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:clixon\"><x><name>a</name><value>200</value></x></c></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "validate fails"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>]]>]]>" "value too large"
+
+    new "discard-changes"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><discard-changes/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "edit, get-config and commit in one session"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:clixon\"><x><name>b</name><value>2</value></x></c></config></edit-config></rpc>]]>]]><rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>]]>]]><rpc $DEFAULTNS><commit/></rpc>]]>]]><rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><x><name>a</name><value>1</value></x></c></data></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><x><name>a</name><value>1</value></x><x><name>b</name><value>2</value></x></c></data></rpc-reply>]]>]]>$"
+
+    new "slow get of state in background"
+    (echo "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:state\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>]]>]]>" | $clixon_netconf -qf $cfg > $dir/get 2>&1) &
+    pid=$!
+    sleep 0.5
+
+    bpid=$(cat $pidfile)
+    nr=$(pgrep -P $bpid | wc -l)
+    if [ $workers -gt 0 ]; then
+	new "worker process serves get"
+	if [ $nr -ne 1 ]; then
+	    err "1 worker" "$nr workers"
+	fi
+    fi
+
+    new "edit and commit while get is served"
+    t0=$(date +%s%N)
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:clixon\"><x><name>c</name><value>3</value></x></c></config></edit-config></rpc>]]>]]><rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+    t1=$(date +%s%N)
+    ms=$(( (t1-t0)/1000000 ))
+    if [ $workers -gt 0 ]; then
+	new "edit and commit not blocked by get: $ms ms"
+	if [ $ms -ge $((delay/2)) ]; then
+	    err "less than $((delay/2)) ms" "$ms ms"
+	fi
+    else
+	new "edit and commit blocked by get: $ms ms"
+	if [ $ms -lt $((delay/3)) ]; then
+	    err "at least $((delay/3)) ms" "$ms ms"
+	fi
+    fi
+
+    wait $pid
+    new "slow get reply"
+    ret=$(cat $dir/get)
+    match=$(echo "$ret" | grep --null -o "^<rpc-reply $DEFAULTNS><data><state xmlns=\"urn:example:clixon\"><op>42</op><op>41</op><op>43</op></state></data></rpc-reply>]]>]]>$")
+    if [ -z "$match" ]; then
+	err "<state> reply" "$ret"
+    fi
+
+    new "worker is reaped"
+    nr=$(pgrep -P $bpid | wc -l)
+    if [ $nr -ne 0 ]; then
+	err "no child processes" "$(ps -o pid,stat,cmd --ppid $bpid)"
+    fi
+
+    new "get running after commits"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><x><name>a</name><value>1</value></x><x><name>b</name><value>2</value></x><x><name>c</name><value>3</value></x></c></data></rpc-reply>]]>]]>$"
+
+    testrun_stop_backend
+} # testrun
+
+new "Backend workers"
+testrun 4
+
+new "No backend workers"
+testrun 0
+
+rm -rf $dir
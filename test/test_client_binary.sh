@@ -0,0 +1,144 @@
+#!/usr/bin/env bash
+# Binary encoded replies from backend to clients: CLICON_CLIENT_BINARY
+# Get config with integers, booleans, strings that look like integers, empty
+# leafs and several namespaces, with binary encoding enabled and disabled.
+# The replies should be the same.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+# Raw unit tester of backend unix socket
+: ${clixon_util_socket:=clixon_util_socket}
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/test.yang
+fyang2=$dir/test2.yang
+sock=/usr/local/var/$APPNAME/$APPNAME.sock
+
+cat <<EOF > $fyang
+module $APPNAME{
+  yang-version 1.1;
+  namespace "urn:example:clixon";
+  prefix ex;
+  container c{
+    list x{
+      key name;
+      leaf name{
+        type string;
+      }
+      leaf i{
+        type int32;
+      }
+      leaf b{
+        type boolean;
+      }
+      leaf s{
+        type string;
+      }
+      leaf e{
+        type empty;
+      }
+    }
+  }
+}
+EOF
+
+cat <<EOF > $fyang2
+module example2{
+  yang-version 1.1;
+  namespace "urn:example:augment";
+  prefix ex2;
+  import $APPNAME {
+    prefix ex;
+  }
+  augment "/ex:c" {
+    leaf y{
+      type uint64;
+    }
+  }
+}
+EOF
+
+XML="<c xmlns=\"urn:example:clixon\"><x><name>a</name><i>-42</i><b>true</b><s>007</s><e/></x><x><name>b</name><i>0</i><b>false</b><s>a &amp; b &lt;c&gt;</s></x><x><name>c</name><s>+5</s></x><y xmlns=\"urn:example:augment\">18446744073709551615</y></c>"
+
+# 1: binary true or false
+testrun(){
+    binary=$1
+
+    cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$dir</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_DIR>$dir</CLICON_YANG_MAIN_DIR>
+  <CLICON_CLISPEC_DIR>/usr/local/lib/$APPNAME/clispec</CLICON_CLISPEC_DIR>
+  <CLICON_CLI_DIR>/usr/local/lib/$APPNAME/cli</CLICON_CLI_DIR>
+  <CLICON_CLI_MODE>$APPNAME</CLICON_CLI_MODE>
+  <CLICON_SOCK>$sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_MODULE_LIBRARY_RFC7895>false</CLICON_MODULE_LIBRARY_RFC7895>
+  <CLICON_CLIENT_BINARY>$binary</CLICON_CLIENT_BINARY>
+</clixon-config>
+EOF
+
+    new "test params: -f $cfg"
+    if [ $BE -ne 0 ]; then
+	new "kill old backend"
+	sudo clixon_backend -zf $cfg
+	if [ $? -ne 0 ]; then
+	    err
+	fi
+	new "start backend -s init -f $cfg"
+	start_backend -s init -f $cfg
+
+	new "waiting"
+	wait_backend
+    fi
+
+    new "edit-config"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config>$XML</config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "get-config candidate"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config><source><candidate/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data>$XML</data></rpc-reply>]]>]]>$"
+
+    new "commit"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "get with xpath"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:c/ex:x[ex:name='b']\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><x><name>b</name><i>0</i><b>false</b><s>a &amp; b &lt;c&gt;</s></x></c></data></rpc-reply>]]>]]>$"
+
+    new "get-config with depth"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config depth=\"2\"><source><running/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><x/><x/><x/><y xmlns=\"urn:example:augment\"/></c></data></rpc-reply>]]>]]>$"
+
+    new "get-config error"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config><source><notexist/></source></get-config></rpc>]]>]]>" "<rpc-error>"
+
+    new "cli show config"
+    expectpart "$($clixon_cli -1 -f $cfg show configuration xml)" 0 "<name>a</name>" "<i>-42</i>" "<s>007</s>" "18446744073709551615"
+
+    new "hello with binary capability"
+    expecteof "$clixon_util_socket -s $sock -D $DBG" 0 "<hello $DEFAULTNS><capabilities><capability>http://clicon.org/capability/binary</capability></capabilities></hello>" "<hello $DEFAULTNS><capabilities><capability>http://clicon.org/capability/binary</capability></capabilities><session-id>[0-9]*</session-id></hello>"
+
+    if [ $BE -ne 0 ]; then
+	new "Kill backend"
+	# Check if premature kill
+	pid=$(pgrep -u root -f clixon_backend)
+	if [ -z "$pid" ]; then
+	    err "backend already dead"
+	fi
+	# kill backend
+	stop_backend -f $cfg
+    fi
+} # testrun
+
+new "Binary encoded replies"
+testrun true
+
+new "XML text replies"
+testrun false
+
+rm -rf $dir
@@ -0,0 +1,103 @@
+#!/usr/bin/env bash
+# Persistent client connections to backend: CLICON_CLIENT_PERSISTENT
+# Send several requests in one netconf and cli session, with and without
+# persistent connections, and check that a restarted backend is reconnected to.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/test.yang
+
+cat <<EOF > $fyang
+module $APPNAME{
+  yang-version 1.1;
+  namespace "urn:example:clixon";
+  prefix ex;
+  container c{
+    list x{
+      key name;
+      leaf name {
+        type string;
+      }
+    }
+  }
+}
+EOF
+
+# 1: persistent true or false
+testrun(){
+    persistent=$1
+
+    cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_CLISPEC_DIR>/usr/local/lib/$APPNAME/clispec</CLICON_CLISPEC_DIR>
+  <CLICON_CLI_DIR>/usr/local/lib/$APPNAME/cli</CLICON_CLI_DIR>
+  <CLICON_CLI_MODE>$APPNAME</CLICON_CLI_MODE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_CLIENT_PERSISTENT>$persistent</CLICON_CLIENT_PERSISTENT>
+</clixon-config>
+EOF
+
+    new "test params: -f $cfg"
+    if [ $BE -ne 0 ]; then
+	new "kill old backend"
+	sudo clixon_backend -zf $cfg
+	if [ $? -ne 0 ]; then
+	    err
+	fi
+	new "start backend -s init -f $cfg"
+	start_backend -s init -f $cfg
+
+	new "waiting"
+	wait_backend
+    fi
+
+    new "netconf edit, commit and get in one session"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:clixon\"><x><name>a</name></x></c></config></edit-config></rpc>]]>]]><rpc $DEFAULTNS><commit/></rpc>]]>]]><rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><x><name>a</name></x></c></data></rpc-reply>]]>]]>$"
+
+    new "cli set"
+    expectfn "$clixon_cli -1 -f $cfg set c x b" 0 "^$"
+
+    new "cli commit"
+    expectfn "$clixon_cli -1 -f $cfg commit" 0 "^$"
+
+    if [ $BE -ne 0 ]; then
+	new "restart backend"
+	stop_backend -f $cfg
+	start_backend -s running -f $cfg
+
+	new "waiting"
+	wait_backend
+    fi
+
+    new "netconf get after backend restart"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>]]>]]><rpc $DEFAULTNS><get-config><source><candidate/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><x><name>a</name></x><x><name>b</name></x></c></data></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><x><name>a</name></x><x><name>b</name></x></c></data></rpc-reply>]]>]]>$"
+
+    if [ $BE -ne 0 ]; then
+	new "Kill backend"
+	# Check if premature kill
+	pid=$(pgrep -u root -f clixon_backend)
+	if [ -z "$pid" ]; then
+	    err "backend already dead"
+	fi
+	# kill backend
+	stop_backend -f $cfg
+    fi
+} # testrun
+
+new "Persistent connections"
+testrun true
+
+new "Connection per request"
+testrun false
+
+rm -rf $dir
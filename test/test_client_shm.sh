@@ -0,0 +1,125 @@
+#!/usr/bin/env bash
+# Replies in shared memory from backend to clients: CLICON_CLIENT_SHM
+# Get a config larger than CLICON_BACKEND_SHM_THRESHOLD with shared memory
+# enabled and disabled, and with XML text and binary encoding.
+# Also check that small replies and errors are still sent on the socket.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/test.yang
+
+# Number of list entries
+: ${perfnr:=500}
+
+cat <<EOF > $fyang
+module $APPNAME{
+  yang-version 1.1;
+  namespace "urn:example:clixon";
+  prefix ex;
+  container c{
+    list x{
+      key name;
+      leaf name{
+        type int32;
+      }
+      leaf value{
+        type string;
+      }
+    }
+  }
+}
+EOF
+
+new "generate startup db with $perfnr entries"
+echo -n "<config><c xmlns=\"urn:example:clixon\">" > $dir/startup_db
+for (( i=0; i<$perfnr; i++ )); do
+    echo -n "<x><name>$i</name><value>value of entry $i</value></x>" >> $dir/startup_db
+done
+echo "</c></config>" >> $dir/startup_db
+
+# 1: shared memory true or false
+# 2: binary encoding true or false
+# 3: persistent connection true or false
+testrun(){
+    shm=$1
+    binary=$2
+    persistent=$3
+
+    cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_CLISPEC_DIR>/usr/local/lib/$APPNAME/clispec</CLICON_CLISPEC_DIR>
+  <CLICON_CLI_DIR>/usr/local/lib/$APPNAME/cli</CLICON_CLI_DIR>
+  <CLICON_CLI_MODE>$APPNAME</CLICON_CLI_MODE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_MODULE_LIBRARY_RFC7895>false</CLICON_MODULE_LIBRARY_RFC7895>
+  <CLICON_CLIENT_SHM>$shm</CLICON_CLIENT_SHM>
+  <CLICON_CLIENT_BINARY>$binary</CLICON_CLIENT_BINARY>
+  <CLICON_CLIENT_PERSISTENT>$persistent</CLICON_CLIENT_PERSISTENT>
+  <CLICON_BACKEND_SHM_THRESHOLD>1024</CLICON_BACKEND_SHM_THRESHOLD>
+</clixon-config>
+EOF
+
+    new "test params: -f $cfg"
+    if [ $BE -ne 0 ]; then
+	new "kill old backend"
+	sudo clixon_backend -zf $cfg
+	if [ $? -ne 0 ]; then
+	    err
+	fi
+	new "start backend -s startup -f $cfg"
+	start_backend -s startup -f $cfg
+
+	new "waiting"
+	wait_backend
+    fi
+
+    new "get-config running"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><x><name>0</name><value>value of entry 0</value></x><x><name>1</name>.*<x><name>$((perfnr-1))</name><value>value of entry $((perfnr-1))</value></x></c></data></rpc-reply>]]>]]>$"
+
+    new "small get below threshold"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:c/ex:x[ex:name='7']\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><x><name>7</name><value>value of entry 7</value></x></c></data></rpc-reply>]]>]]>$"
+
+    new "get-config error"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config><source><notexist/></source></get-config></rpc>]]>]]>" "<rpc-error>"
+
+    new "several get-config and edit-config in one session"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>]]>]]><rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:clixon\"><x><name>0</name><value>new</value></x></c></config></edit-config></rpc>]]>]]><rpc $DEFAULTNS><get-config><source><candidate/></source></get-config></rpc>]]>]]>" "<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><x><name>0</name><value>new</value></x><x><name>1</name>.*<x><name>$((perfnr-1))</name><value>value of entry $((perfnr-1))</value></x></c></data></rpc-reply>]]>]]>$"
+
+    new "cli show config"
+    expectpart "$($clixon_cli -1 -f $cfg show configuration xml)" 0 "<name>0</name>" "<value>value of entry $((perfnr-1))</value>"
+
+    if [ $BE -ne 0 ]; then
+	new "Kill backend"
+	# Check if premature kill
+	pid=$(pgrep -u root -f clixon_backend)
+	if [ -z "$pid" ]; then
+	    err "backend already dead"
+	fi
+	# kill backend
+	stop_backend -f $cfg
+    fi
+} # testrun
+
+new "Shared memory, XML text"
+testrun true false true
+
+new "Shared memory, binary encoding"
+testrun true true true
+
+new "Shared memory, connection per request"
+testrun true false false
+
+new "No shared memory"
+testrun false false true
+
+rm -rf $dir
@@ -0,0 +1,100 @@
+#!/usr/bin/env bash
+# Event loop with input file descriptors of different kinds:
+# netconf stdin from a pipe, from a regular file, and from a large here-document
+# (bash uses a temporary file for here-documents larger than a pipe buffer).
+# epoll cannot poll regular files, they are always ready.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fin=$dir/in.xml
+
+# Number of list entries, more than 64KB of edit-config
+: ${perfnr:=2000}
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_MODULE_MAIN>clixon-example</CLICON_YANG_MODULE_MAIN>
+  <CLICON_SOCK>$dir/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_MODULE_LIBRARY_RFC7895>false</CLICON_MODULE_LIBRARY_RFC7895>
+</clixon-config>
+EOF
+
+new "test params: -f $cfg"
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+
+    new "waiting"
+    wait_backend
+fi
+
+new "netconf from pipe"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config><source><candidate/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data/></rpc-reply>]]>]]>$"
+
+new "netconf from file"
+echo "<rpc $DEFAULTNS><get-config><source><candidate/></source></get-config></rpc>]]>]]>" > $fin
+expecteof_file "$clixon_netconf -qf $cfg" 0 "$fin" "^<rpc-reply $DEFAULTNS><data/></rpc-reply>]]>]]>$"
+
+new "generate large edit-config with $perfnr entries"
+rpc="<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><table xmlns=\"urn:example:clixon\">"
+for (( i=0; i<$perfnr; i++ )); do
+    rpc+="<parameter><name>name-of-parameter-$i</name><value>value-of-parameter-$i</value></parameter>"
+done
+rpc+="</table></config></edit-config></rpc>]]>]]>"
+echo "$rpc" > $fin
+if [ $(stat -c %s $fin) -le 65536 ]; then
+    err "file larger than 64KB" "$(stat -c %s $fin)"
+fi
+
+new "netconf large edit-config from file"
+expecteof_file "$clixon_netconf -qf $cfg" 0 "$fin" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "netconf several messages from file"
+cat <<EOF > $fin
+<rpc $DEFAULTNS message-id="1"><discard-changes/></rpc>]]>]]>
+<rpc $DEFAULTNS message-id="2"><get-config><source><candidate/></source></get-config></rpc>]]>]]>
+EOF
+expecteof_file "$clixon_netconf -qf $cfg" 0 "$fin" "<rpc-reply $DEFAULTNS message-id=\"2\"><data/></rpc-reply>]]>]]>"
+
+new "netconf large edit-config from here-document"
+ret=$($clixon_netconf -qf $cfg <<EOF
+$rpc
+EOF
+)
+if [ $? -ne 0 ]; then
+    err 0 $?
+fi
+match=$(echo "$ret" | grep --null -Eo "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$")
+if [ -z "$match" ]; then
+    err "<ok/>" "$ret"
+fi
+
+new "netconf get-config last entry"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config><source><candidate/></source><filter type=\"xpath\" select=\"/ex:table/ex:parameter[ex:name='name-of-parameter-$((perfnr-1))']\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><table xmlns=\"urn:example:clixon\"><parameter><name>name-of-parameter-$((perfnr-1))</name><value>value-of-parameter-$((perfnr-1))</value></parameter></table></data></rpc-reply>]]>]]>$"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
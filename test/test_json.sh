@@ -2,6 +2,9 @@
 # Test: JSON parser tests. See RFC7951
 # - Multi-line + pretty-print 
 # - Empty values
+# - Array framing of single-element and interleaved lists and leaf-lists
+# - Anydata/anyxml and elements without yang
+# - Escaping of strings
 # Note that members should not be quoted. See test_restconf2.sh for typed
 #PROG="valgrind --leak-check=full --show-leak-kinds=all ../util/clixon_util_json"
 # Magic line must be first in script (see README.md)
@@ -47,6 +50,19 @@ module json{
       description "indirect type";
       type gtype;
    }
+   container d{
+     list l{
+       key k;
+       leaf k{
+         type string;
+       }
+     }
+     leaf-list ll{
+       type string;
+     }
+     anydata ad;
+     anyxml ax;
+   }
 }
 EOF
 
@@ -121,6 +137,62 @@ expecteofx "$clixon_util_json -jy $fyang" 0 "$JSON" '{"json:g2":"blues"}'
 new "xml indirect identity with explicit ns to json"
 expecteofx "$clixon_util_xml -ojvy $fyang" 0 '<g2 xmlns="urn:example:clixon" xmlns:ex="urn:example:clixon">ex:blues</g2>' '{"json:g2":"blues"}'
 
+# Array framing is given by yang: list and leaf-list entries are arrays, also
+# single entries
+JSON='{"json:d":{"l":[{"k":"a"}],"ll":["b"]}}'
+
+new "json single-element list and leaf-list"
+expecteofeq "$clixon_util_json -jy $fyang" 0 "$JSON" "$JSON"
+
+new "xml single-element list and leaf-list to json"
+expecteofeq "$clixon_util_xml -ojvy $fyang" 0 '<d xmlns="urn:example:clixon"><l><k>a</k></l><ll>b</ll></d>' "$JSON"
+
+JSON='{"json:d":{"l":[{"k":"a"},{"k":"b"}],"ll":["x","y"]}}'
+
+new "json interleaved list and leaf-list"
+expecteofeq "$clixon_util_json -jy $fyang" 0 '{"json:d":{"l":[{"k":"b"}],"ll":["y"],"l":[{"k":"a"}],"ll":["x"]}}' "$JSON"
+
+new "xml interleaved list and leaf-list to json"
+expecteofeq "$clixon_util_xml -ojvy $fyang" 0 '<d xmlns="urn:example:clixon"><l><k>b</k></l><ll>y</ll><l><k>a</k></l><ll>x</ll></d>' "$JSON"
+
+# Without yang, neighbours with the same name are arrays
+new "xml interleaved elements without yang to json"
+expecteofeq "$clixon_util_xml -oj" 0 '<d><l>1</l><m>x</m><l>2</l><l>3</l></d>' '{"d":{"l":"1","m":"x","l":["2","3"]}}'
+
+new "xml elements without yang in other namespace to json"
+expecteofeq "$clixon_util_xml -oj" 0 '<d><l>1</l><l xmlns="urn:example:other">2</l></d>' '{"d":{"l":"1","l":"2"}}'
+
+# Anydata and anyxml children have no yang
+new "xml anydata and anyxml to json"
+expecteofeq "$clixon_util_xml -ojy $fyang" 0 '<d xmlns="urn:example:clixon"><ad><e>1</e><f><g>x</g></f><e>2</e><e>3</e></ad><ax><h>y</h></ax></d>' '{"json:d":{"ad":{"e":"1","f":{"g":"x"},"e":["2","3"]},"ax":{"h":"y"}}}'
+
+new "xml single anydata child to json"
+expecteofeq "$clixon_util_xml -ojy $fyang" 0 '<d xmlns="urn:example:clixon"><ad><e>1</e></ad></d>' '{"json:d":{"ad":{"e":"1"}}}'
+
+# Escaping of strings: quote, backslash and newline are escaped, other control
+# characters are not. Escapes also at the start and end of strings and in long
+# runs of unescaped characters
+T=$'\t'
+P="0123456789abcdef0123456789abcdef"
+JSON="{\"json:c\":{\"s\":\"\\\"a\\\\b\\\"$P\\\\$P\\\"\\\\\"}}"
+
+new "json quotes and backslashes"
+expecteofeq "$clixon_util_json -jy $fyang" 0 "$JSON" "$JSON"
+
+new "xml quotes and backslashes to json"
+expecteofeq "$clixon_util_xml -ojvy $fyang" 0 "<c xmlns=\"urn:example:clixon\"><s>\"a\\b\"$P\\$P\"\\</s></c>" "$JSON"
+
+new "json control characters"
+expecteofeq "$clixon_util_json -jy $fyang" 0 "{\"json:c\":{\"s\":\"a${T}b$P
+$P${T}\"}}" "{\"json:c\":{\"s\":\"a${T}b$P\\n$P${T}\"}}"
+
+new "xml control characters to json"
+expecteofeq "$clixon_util_xml -ojvy $fyang" 0 "<c xmlns=\"urn:example:clixon\"><s>${T}a
+b${T}</s></c>" "{\"json:c\":{\"s\":\"${T}a\\nb${T}\"}}"
+
+new "xml encoded characters and cdata to json"
+expecteofeq "$clixon_util_xml -ojvy $fyang" 0 '<c xmlns="urn:example:clixon"><s>a&lt;b]c&amp;<![CDATA[<x>]]>]]&gt;</s></c>' '{"json:c":{"s":"a<b]c&<x>]]>"}}'
+
 # XXX CDATA translation, should work bit does not
 if false; then
 JSON='{"json:c": {"s": "<![CDATA[  z > x  & x < y ]]>"}}'
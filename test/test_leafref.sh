@@ -61,6 +61,13 @@ module example{
                     + "/ip:ipv4/ip:address/ip:ip";
             }
          }
+         leaf optional {
+             description "Target need not exist";
+             type leafref {
+                 path "../../if:interfaces/if:interface/if:name";
+                 require-instance false;
+             }
+         }
          leaf wrong {
              description "References leading nowhere in yang";
              type leafref {
@@ -187,6 +194,32 @@ expectfn "$clixon_cli -1f $cfg -l o set sender a" 0 "^$"
 new "cli sender template"
 expectfn "$clixon_cli -1f $cfg -l o set sender b template a" 0 "^$"
 
+new "leafref require-instance false, no target"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><default-address xmlns=\"urn:example:clixon\"><optional>eth99</optional></default-address></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "leafref require-instance false validate (ok)"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+# Many targets: the target values are then indexed in a hash
+new "leafref many senders"
+XML="<sender xmlns=\"urn:example:clixon\"><name>s0</name><template>s19</template></sender>"
+for (( i=1; i<20; i++ )); do
+    XML="$XML<sender xmlns=\"urn:example:clixon\"><name>s$i</name><template>s$((i-1))</template></sender>"
+done
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config>$XML</config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "leafref many senders validate (ok)"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "leafref many senders dangling template"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><sender xmlns=\"urn:example:clixon\"><name>s20</name><template>s99</template></sender></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "leafref many senders validate (should fail)"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>bad-element</error-tag><error-info><bad-element>s99</bad-element></error-info><error-severity>error</error-severity><error-message>Leafref validation failed: No leaf s99 matching path /sender/name</error-message></rpc-error></rpc-reply>]]>]]>$"
+
+new "leafref discard-changes"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><discard-changes/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
 if [ $BE -eq 0 ]; then
     exit # BE
 fi
@@ -0,0 +1,295 @@
+#!/usr/bin/env bash
+# Authentication and authorization and IETF NACM
+# NACM rules are compiled and rpc decisions cached per user. Check that rpc,
+# read and write decisions follow changes of rules and group membership
+# between requests, for a user without groups, and with external NACM.
+# Each request is made twice, the second is decided by the compiled (cached) rules
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+# Common NACM scripts
+. ./nacm.sh
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/nacm-example.yang
+nacmfile=$dir/nacmfile
+
+# Set config, internal or external NACM mode
+# 1: mode
+setconfig(){
+    cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_MODULE_LIBRARY_RFC7895>false</CLICON_MODULE_LIBRARY_RFC7895>
+  <CLICON_NACM_MODE>$1</CLICON_NACM_MODE>
+  <CLICON_NACM_FILE>$nacmfile</CLICON_NACM_FILE>
+  <CLICON_NACM_CREDENTIALS>none</CLICON_NACM_CREDENTIALS>
+  <CLICON_NACM_DISABLED_ON_EMPTY>true</CLICON_NACM_DISABLED_ON_EMPTY>
+</clixon-config>
+EOF
+}
+
+cat <<EOF > $fyang
+module nacm-example{
+  yang-version 1.1;
+  namespace "urn:example:nacm";
+  prefix ex;
+  import ietf-netconf-acm {
+    prefix nacm;
+  }
+  leaf x{
+    type int32;
+  }
+  leaf y{
+    type int32;
+  }
+}
+EOF
+
+# NACM rules for limited group (wilma), guest group may do nothing.
+# 1: action of get rpc rule
+# 2: action of read rule of y
+# 3: action of write rule of x
+# 4: user-names of limited group
+rules(){
+    cat <<EOF
+   <nacm xmlns="urn:ietf:params:xml:ns:yang:ietf-netconf-acm">
+     <enable-nacm>true</enable-nacm>
+     <read-default>permit</read-default>
+     <write-default>deny</write-default>
+     <exec-default>permit</exec-default>
+     <groups>
+       <group>
+         <name>admin</name>
+         <user-name>andy</user-name>
+         <user-name>$USER</user-name>
+       </group>
+       <group>
+         <name>limited</name>
+         $4
+       </group>
+       <group>
+         <name>guest</name>
+         <user-name>guest</user-name>
+       </group>
+     </groups>
+     <rule-list>
+       <name>guest-acl</name>
+       <group>guest</group>
+       <rule>
+         <name>deny-all</name>
+         <module-name>*</module-name>
+         <access-operations>*</access-operations>
+         <action>deny</action>
+       </rule>
+     </rule-list>
+     <rule-list>
+       <name>limited-acl</name>
+       <group>limited</group>
+       <rule>
+         <name>get</name>
+         <module-name>*</module-name>
+         <rpc-name>get</rpc-name>
+         <access-operations>exec</access-operations>
+         <action>$1</action>
+       </rule>
+       <rule>
+         <name>read-y</name>
+         <module-name>*</module-name>
+         <path xmlns:ex="urn:example:nacm">/ex:y</path>
+         <access-operations>read</access-operations>
+         <action>$2</action>
+       </rule>
+       <rule>
+         <name>write-x</name>
+         <module-name>*</module-name>
+         <path xmlns:ex="urn:example:nacm">/ex:x</path>
+         <access-operations>*</access-operations>
+         <action>$3</action>
+       </rule>
+     </rule-list>
+     $NADMIN
+   </nacm>
+EOF
+}
+
+FY="<filter type=\"xpath\" select=\"/ex:y\" xmlns:ex=\"urn:example:nacm\"/>"
+DENIED="<error-tag>access-denied</error-tag>"
+
+# Check rpc, read and write access of a user, twice
+# 1: user
+# 2: get rpc permitted (true/false)
+# 3: y readable (true/false)
+# 4: x writable (true/false)
+testaccess(){
+    u=$1
+    for i in 1 2; do
+	new "$u get rpc $2 #$i"
+	if $2; then
+	    expecteof "$clixon_netconf -U $u -qf $cfg" 0 "<rpc $DEFAULTNS><get>$FY</get></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data"
+	else
+	    expecteof "$clixon_netconf -U $u -qf $cfg" 0 "<rpc $DEFAULTNS><get>$FY</get></rpc>]]>]]>" "$DENIED"
+	fi
+	new "$u read y $3 #$i"
+	if $3; then
+	    expecteof "$clixon_netconf -U $u -qf $cfg" 0 "<rpc $DEFAULTNS><get-config><source><running/></source>$FY</get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><y xmlns=\"urn:example:nacm\">2</y></data></rpc-reply>]]>]]>$"
+	else
+	    expecteof "$clixon_netconf -U $u -qf $cfg" 0 "<rpc $DEFAULTNS><get-config><source><running/></source>$FY</get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data/></rpc-reply>]]>]]>$"
+	fi
+	new "$u write x $4 #$i"
+	if $4; then
+	    expecteof "$clixon_netconf -U $u -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><x xmlns=\"urn:example:nacm\">$i</x></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+	else
+	    expecteof "$clixon_netconf -U $u -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><x xmlns=\"urn:example:nacm\">$i</x></config></edit-config></rpc>]]>]]>" "$DENIED"
+	fi
+    done
+    new "discard-changes"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><discard-changes/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+}
+
+# Replace NACM rules in running, see rules()
+setrules(){
+    new "set nacm rules"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><default-operation>replace</default-operation><config>$(rules "$@")<x xmlns=\"urn:example:nacm\">1</x><y xmlns=\"urn:example:nacm\">2</y></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "commit nacm rules"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+}
+
+setconfig internal
+new "test params: -f $cfg"
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+
+    new "waiting"
+    wait_backend
+fi
+
+setrules deny deny deny "<user-name>wilma</user-name>"
+
+new "limited user, all denied"
+testaccess wilma false false false
+
+new "user without groups, defaults"
+testaccess nobody true true false
+
+new "admin user"
+testaccess andy true true true
+
+# Rules changed between requests
+setrules permit permit permit "<user-name>wilma</user-name>"
+
+new "limited user, rules changed to permit"
+testaccess wilma true true true
+
+new "user without groups, not changed"
+testaccess nobody true true false
+
+# Group membership changed between requests
+setrules permit permit permit "<user-name>nobody</user-name>"
+
+new "wilma removed from limited group, defaults"
+testaccess wilma true true false
+
+new "nobody added to limited group"
+testaccess nobody true true true
+
+setrules deny deny deny "<user-name>nobody</user-name><user-name>wilma</user-name>"
+
+new "wilma added to limited group again, all denied"
+testaccess wilma false false false
+
+new "nobody in limited group, all denied"
+testaccess nobody false false false
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+# External NACM: rules are read from file at start, running has no NACM config
+# 1: action of get rpc rule
+# 2: action of read rule of y
+# 3: action of write rule of x
+testext(){
+    rules $1 $2 $3 "<user-name>wilma</user-name>" > $nacmfile
+    setconfig external
+    if [ $BE -ne 0 ]; then
+	new "kill old backend"
+	sudo clixon_backend -zf $cfg
+	if [ $? -ne 0 ]; then
+	    err
+	fi
+	new "start backend -s init -f $cfg"
+	start_backend -s init -f $cfg
+
+	new "waiting"
+	wait_backend
+    fi
+
+    new "add x and y"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><x xmlns=\"urn:example:nacm\">1</x><y xmlns=\"urn:example:nacm\">2</y></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "commit"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+}
+
+testext deny deny deny
+
+new "external limited user, all denied"
+testaccess wilma false false false
+
+new "external user without groups, defaults"
+testaccess nobody true true false
+
+new "commit to running does not change external decisions"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><x xmlns=\"urn:example:nacm\">3</x></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "commit"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "external limited user after commit, all denied"
+testaccess wilma false false false
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    stop_backend -f $cfg
+fi
+
+testext permit permit permit
+
+new "external limited user, file changed to permit"
+testaccess wilma true true true
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
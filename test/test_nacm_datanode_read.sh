@@ -282,6 +282,22 @@ testrun permit permit deny   permit true  true  false false
 testrun permit permit permit deny   true  true  true  false
 testrun permit permit permit permit true  true  true  true
 
+# Rule path with instance predicate, a deny rule first in rule-list for parameter b
+new "add parameter b"
+expectpart "$(curl -u andy:bar $CURLOPTS -X POST -H "Content-Type: application/yang-data+json" $RCPROTO://localhost/restconf/data/nacm-example:table/parameters -d '{"nacm-example:parameter":[{"name":"b","value":"73"}]}')" 0 "HTTP/1.1 201 Created"
+
+new "add deny rule for parameter b first"
+expectpart "$(curl -u andy:bar $CURLOPTS -X POST -H "Content-Type: application/yang-data+json" "$RCPROTO://localhost/restconf/data/ietf-netconf-acm:nacm/rule-list=limited-acl?insert=first" -d "{\"ietf-netconf-acm:rule\":[{\"name\":\"param-b\",\"module-name\":\"*\",\"access-operations\":\"read\",\"path\":\"/ex:table/ex:parameters/ex:parameter[ex:name='b']\",\"action\":\"deny\"}]}")" 0 "HTTP/1.1 201 Created"
+
+new "get parameter a"
+expectpart "$(curl -u wilma:bar $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/nacm-example:table/parameters/parameter=a)" 0 'HTTP/1.1 200 OK' '{"nacm-example:parameter":\[{"name":"a","value":"72"}\]}'
+
+new "get parameter b denied"
+expectpart "$(curl -u wilma:bar $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/nacm-example:table/parameters/parameter=b)" 0 'HTTP/1.1 404 Not Found'
+
+new "get parameters without b"
+expectpart "$(curl -u wilma:bar $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/nacm-example:table/parameters)" 0 'HTTP/1.1 200 OK' '{"nacm-example:parameters":{"parameter":\[{"name":"a","value":"72"}\]}}'
+
 if [ $RC -ne 0 ]; then
     new "Kill restconf daemon"
     stop_restconf 
@@ -0,0 +1,214 @@
+#!/usr/bin/env bash
+# List pagination: offset, limit, direction, where and cursor attributes
+# of get and get-config (clixon extension)
+# A cursor is the list name and keys of the last entry of a page in hex,
+# eg y and key 2: 790032
+# Entries a user may not read (NACM) are skipped, as if not in the list
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+# Common NACM scripts
+. ./nacm.sh
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/test.yang
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_MODULE_LIBRARY_RFC7895>false</CLICON_MODULE_LIBRARY_RFC7895>
+  <CLICON_NACM_MODE>internal</CLICON_NACM_MODE>
+  <CLICON_NACM_CREDENTIALS>none</CLICON_NACM_CREDENTIALS>
+  <CLICON_NACM_DISABLED_ON_EMPTY>true</CLICON_NACM_DISABLED_ON_EMPTY>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module $APPNAME{
+  yang-version 1.1;
+  namespace "urn:example:clixon";
+  prefix ex;
+  import ietf-netconf-acm {
+    prefix nacm;
+  }
+  container x{
+    list y{
+      key a;
+      leaf a{
+        type int32;
+      }
+      leaf b{
+        type string;
+      }
+    }
+    leaf-list z{
+      type string;
+      ordered-by user;
+    }
+  }
+}
+EOF
+
+# Filter selecting all y entries
+F="<filter type=\"xpath\" select=\"/ex:x/ex:y\" xmlns:ex=\"urn:example:clixon\"/>"
+Y1="<y><a>1</a><b>odd</b></y>"
+Y2="<y><a>2</a><b>even</b></y>"
+Y3="<y><a>3</a><b>odd</b></y>"
+Y4="<y><a>4</a><b>even</b></y>"
+Y5="<y><a>5</a><b>odd</b></y>"
+
+new "test params: -f $cfg"
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+
+    new "waiting"
+    wait_backend
+fi
+
+new "add list entries in reverse order"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><x xmlns=\"urn:example:clixon\">$Y5$Y4$Y3$Y2$Y1<z>c</z><z>a</z><z>b</z></x></config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "commit"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "get-config first page"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config limit=\"2\"><source><running/></source>$F</get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data next-cursor=\"790032\"><x xmlns=\"urn:example:clixon\">$Y1$Y2</x></data></rpc-reply>]]>]]>$"
+
+new "get-config second page"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config limit=\"2\" cursor=\"790032\"><source><running/></source>$F</get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data next-cursor=\"790034\"><x xmlns=\"urn:example:clixon\">$Y3$Y4</x></data></rpc-reply>]]>]]>$"
+
+new "get-config last page has no cursor"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config limit=\"2\" cursor=\"790034\"><source><running/></source>$F</get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\">$Y5</x></data></rpc-reply>]]>]]>$"
+
+new "get-config offset"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config offset=\"3\"><source><running/></source>$F</get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\">$Y4$Y5</x></data></rpc-reply>]]>]]>$"
+
+new "get-config offset and limit"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config offset=\"1\" limit=\"1\"><source><running/></source>$F</get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data next-cursor=\"790032\"><x xmlns=\"urn:example:clixon\">$Y2</x></data></rpc-reply>]]>]]>$"
+
+new "get-config backwards first page"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config limit=\"2\" direction=\"backwards\"><source><running/></source>$F</get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data next-cursor=\"790034\"><x xmlns=\"urn:example:clixon\">$Y5$Y4</x></data></rpc-reply>]]>]]>$"
+
+new "get-config backwards second page"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config limit=\"2\" direction=\"backwards\" cursor=\"790034\"><source><running/></source>$F</get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data next-cursor=\"790032\"><x xmlns=\"urn:example:clixon\">$Y3$Y2</x></data></rpc-reply>]]>]]>$"
+
+new "get-config where"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config where=\"ex:b='even'\"><source><running/></source>$F</get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\">$Y2$Y4</x></data></rpc-reply>]]>]]>$"
+
+new "get-config where and limit"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config where=\"ex:b='odd'\" limit=\"2\"><source><running/></source>$F</get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data next-cursor=\"790033\"><x xmlns=\"urn:example:clixon\">$Y1$Y3</x></data></rpc-reply>]]>]]>$"
+
+new "get-config ordered-by user leaf-list page"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config limit=\"2\"><source><running/></source><filter type=\"xpath\" select=\"/ex:x/ex:z\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data next-cursor=\"7a0061\"><x xmlns=\"urn:example:clixon\"><z>c</z><z>a</z></x></data></rpc-reply>]]>]]>$"
+
+new "get-config ordered-by user leaf-list next page"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config limit=\"2\" cursor=\"7a0061\"><source><running/></source><filter type=\"xpath\" select=\"/ex:x/ex:z\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\"><z>b</z></x></data></rpc-reply>]]>]]>$"
+
+new "get page"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get limit=\"2\" cursor=\"790031\">$F</get></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data next-cursor=\"790033\"><x xmlns=\"urn:example:clixon\">$Y2$Y3</x></data></rpc-reply>]]>]]>$"
+
+new "get backwards page"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get limit=\"2\" direction=\"backwards\">$F</get></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data next-cursor=\"790034\"><x xmlns=\"urn:example:clixon\">$Y5$Y4</x></data></rpc-reply>]]>]]>$"
+
+new "get-config invalid cursor"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config limit=\"2\" cursor=\"zz\"><source><running/></source>$F</get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>bad-attribute</error-tag><error-info><bad-attribute>cursor</bad-attribute></error-info><error-severity>error</error-severity><error-message>Invalid cursor</error-message></rpc-error></rpc-reply>]]>]]>$"
+
+new "get-config cursor of other list"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config limit=\"2\" cursor=\"7a0061\"><source><running/></source>$F</get-config></rpc>]]>]]>" "<error-tag>bad-attribute</error-tag><error-info><bad-attribute>cursor</bad-attribute></error-info>"
+
+new "get-config invalid limit"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config limit=\"abc\"><source><running/></source>$F</get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>bad-attribute</error-tag><error-info><bad-attribute>limit</bad-attribute></error-info><error-severity>error</error-severity><error-message>Unrecognized value of limit attribute</error-message></rpc-error></rpc-reply>]]>]]>$"
+
+new "get-config invalid direction"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config direction=\"up\"><source><running/></source>$F</get-config></rpc>]]>]]>" "<bad-attribute>direction</bad-attribute>"
+
+# NACM: limited group (wilma) may not read entries 2 and 3
+RULES=$(cat <<EOF
+   <nacm xmlns="urn:ietf:params:xml:ns:yang:ietf-netconf-acm">
+     <enable-nacm>true</enable-nacm>
+     <read-default>permit</read-default>
+     <write-default>deny</write-default>
+     <exec-default>permit</exec-default>
+
+     $NGROUPS
+
+     <rule-list>
+       <name>limited-acl</name>
+       <group>limited</group>
+       <rule>
+         <name>deny-y2</name>
+         <module-name>*</module-name>
+         <access-operations>read</access-operations>
+         <path xmlns:ex="urn:example:clixon">/ex:x/ex:y[ex:a='2']</path>
+         <action>deny</action>
+       </rule>
+       <rule>
+         <name>deny-y3</name>
+         <module-name>*</module-name>
+         <access-operations>read</access-operations>
+         <path xmlns:ex="urn:example:clixon">/ex:x/ex:y[ex:a='3']</path>
+         <action>deny</action>
+       </rule>
+     </rule-list>
+
+     $NADMIN
+
+   </nacm>
+EOF
+)
+
+new "add nacm rules"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config>$RULES</config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "commit nacm rules"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "get-config admin page not restricted"
+expecteof "$clixon_netconf -U andy -qf $cfg" 0 "<rpc $DEFAULTNS><get-config limit=\"2\"><source><running/></source>$F</get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data next-cursor=\"790032\"><x xmlns=\"urn:example:clixon\">$Y1$Y2</x></data></rpc-reply>]]>]]>$"
+
+new "get-config nacm first page skips denied entries"
+expecteof "$clixon_netconf -U wilma -qf $cfg" 0 "<rpc $DEFAULTNS><get-config limit=\"2\"><source><running/></source>$F</get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data next-cursor=\"790034\"><x xmlns=\"urn:example:clixon\">$Y1$Y4</x></data></rpc-reply>]]>]]>$"
+
+new "get-config nacm next page"
+expecteof "$clixon_netconf -U wilma -qf $cfg" 0 "<rpc $DEFAULTNS><get-config limit=\"2\" cursor=\"790034\"><source><running/></source>$F</get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\">$Y5</x></data></rpc-reply>]]>]]>$"
+
+new "get-config nacm offset does not count denied entries"
+expecteof "$clixon_netconf -U wilma -qf $cfg" 0 "<rpc $DEFAULTNS><get-config offset=\"1\" limit=\"1\"><source><running/></source>$F</get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data next-cursor=\"790034\"><x xmlns=\"urn:example:clixon\">$Y4</x></data></rpc-reply>]]>]]>$"
+
+# Cursor is not made from a denied entry, and no cursor if only denied entries follow
+new "get-config nacm backwards page"
+expecteof "$clixon_netconf -U wilma -qf $cfg" 0 "<rpc $DEFAULTNS><get-config limit=\"2\" direction=\"backwards\" cursor=\"790034\"><source><running/></source>$F</get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\">$Y1</x></data></rpc-reply>]]>]]>$"
+
+new "get-config nacm page ending before denied entries has no cursor"
+expecteof "$clixon_netconf -U wilma -qf $cfg" 0 "<rpc $DEFAULTNS><get-config limit=\"1\" where=\"ex:a&lt;4\"><source><running/></source>$F</get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><x xmlns=\"urn:example:clixon\">$Y1</x></data></rpc-reply>]]>]]>$"
+
+new "get nacm page skips denied entries"
+expecteof "$clixon_netconf -U wilma -qf $cfg" 0 "<rpc $DEFAULTNS><get limit=\"2\">$F</get></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data next-cursor=\"790034\"><x xmlns=\"urn:example:clixon\">$Y1$Y4</x></data></rpc-reply>]]>]]>$"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
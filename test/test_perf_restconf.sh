@@ -16,6 +16,9 @@ s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
 # Number of requests made get/put
 : ${perfreq:=10}
 
+# Let the backend encode restconf JSON replies
+: ${backendjson:=true}
+
 # time function (this is a mess to get right on freebsd/linux)
 # -f %e gives elapsed wall clock time but is not available on all systems
 # so we use time -p for POSIX compliance and awk to get wall clock time
@@ -61,6 +64,7 @@ cat <<EOF > $cfg
   <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
   <CLICON_BACKEND_PIDFILE>/usr/local/var/example/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
   <CLICON_RESTCONF_PRETTY>false</CLICON_RESTCONF_PRETTY>
+  <CLICON_RESTCONF_BACKEND_JSON>$backendjson</CLICON_RESTCONF_BACKEND_JSON>
   <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
   <CLICON_XMLDB_PRETTY>false</CLICON_XMLDB_PRETTY>
   <CLICON_XMLDB_FORMAT>$format</CLICON_XMLDB_FORMAT>
@@ -140,6 +144,9 @@ new "restconf get large config"
 # XXX for some reason cannot expand $TIMEFN next two tests, need keep variable?
 $TIMEFN curl $CURLOPTS -X GET $RCPROTO://localhost/restconf/data 2>&1 > /dev/null | awk '/real/ {print $2}'
 
+new "restconf get large list"
+$TIMEFN curl $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/scaling:x 2>&1 > /dev/null | awk '/real/ {print $2}'
+
 # Delete entries (last since entries are removed from db)
 # netconf
 new "cli delete $perfreq small config"
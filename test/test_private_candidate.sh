@@ -0,0 +1,175 @@
+#!/usr/bin/env bash
+# Per-session private candidate datastores: CLICON_XMLDB_PRIVATE_CANDIDATE
+# Each netconf invocation below is a separate session.
+# Check that edits on candidate are only visible in the editing session,
+# that commit and discard-changes only apply to the session's own candidate,
+# and that a session without edits sees running as its candidate.
+# Sessions kept open while others commit check that commits conflicting with
+# edits of the open session are detected when it is rebased, and not overwritten.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/test.yang
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_CLISPEC_DIR>/usr/local/lib/$APPNAME/clispec</CLICON_CLISPEC_DIR>
+  <CLICON_CLI_DIR>/usr/local/lib/$APPNAME/cli</CLICON_CLI_DIR>
+  <CLICON_CLI_MODE>$APPNAME</CLICON_CLI_MODE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_XMLDB_PRIVATE_CANDIDATE>true</CLICON_XMLDB_PRIVATE_CANDIDATE>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module $APPNAME{
+  yang-version 1.1;
+  namespace "urn:example:clixon";
+  prefix ex;
+  container c{
+    list x{
+      key name;
+      leaf name {
+        type string;
+      }
+      leaf value {
+        type string;
+      }
+    }
+  }
+}
+EOF
+
+new "test params: -f $cfg"
+
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s init -f $cfg"
+    start_backend -s init -f $cfg
+
+    new "waiting"
+    wait_backend
+fi
+
+new "session 1: edit and read own candidate"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:clixon\"><x><name>a</name><value>1</value></x></c></config></edit-config></rpc>]]>]]><rpc $DEFAULTNS><get-config><source><candidate/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><x><name>a</name><value>1</value></x></c></data></rpc-reply>]]>]]>$"
+
+new "session 2: uncommitted edits of session 1 not visible"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config><source><candidate/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data/></rpc-reply>]]>]]>$"
+
+new "session 3: edit, discard-changes and read own candidate"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:clixon\"><x><name>b</name></x></c></config></edit-config></rpc>]]>]]><rpc $DEFAULTNS><discard-changes/></rpc>]]>]]><rpc $DEFAULTNS><get-config><source><candidate/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><data/></rpc-reply>]]>]]>$"
+
+new "session 4: lock candidate is not shared"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><lock><target><candidate/></target></lock></rpc>]]>]]><rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:clixon\"><x><name>c</name><value>3</value></x></c></config></edit-config></rpc>]]>]]><rpc $DEFAULTNS><validate><source><candidate/></source></validate></rpc>]]>]]><rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "session 5: committed edits of session 4 in running"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><x><name>c</name><value>3</value></x></c></data></rpc-reply>]]>]]>$"
+
+new "session 6: candidate without edits follows running"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config><source><candidate/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><x><name>c</name><value>3</value></x></c></data></rpc-reply>]]>]]>$"
+
+new "session 7: edit is rebased on running at commit"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:clixon\"><x><name>d</name></x></c></config></edit-config></rpc>]]>]]><rpc $DEFAULTNS><commit/></rpc>]]>]]><rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><x><name>c</name><value>3</value></x><x><name>d</name></x></c></data></rpc-reply>]]>]]>$"
+
+new "session 8: delete-config candidate and commit"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><delete-config><target><candidate/></target></delete-config></rpc>]]>]]><rpc $DEFAULTNS><commit/></rpc>]]>]]><rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><data/></rpc-reply>]]>]]>$"
+
+new "sessions that disconnect without close-session leave no private candidates"
+if ls $dir/candidate-*_db > /dev/null 2>&1; then
+    err "no private candidate datastores" "$(ls $dir/candidate-*_db)"
+fi
+
+# Sessions kept open while other sessions commit: rpcs are written to fd 7
+fifo=$dir/session.fifo
+fout=$dir/session.out
+mkfifo $fifo
+
+# Open a netconf session in the background, reading rpcs from fifo
+session_open(){
+    $clixon_netconf -qf $cfg < $fifo > $fout &
+    exec 7> $fifo
+}
+
+# Send rpc on open session
+# 1: rpc
+session_send(){
+    echo "<rpc $DEFAULTNS>$1</rpc>]]>]]>" >&7
+    sleep 1
+}
+
+# Close open session, ie eof, and wait for it to exit
+session_close(){
+    exec 7>&-
+    wait
+}
+
+new "commit x=a in running"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:clixon\"><x><name>a</name><value>1</value></x></c></config></edit-config></rpc>]]>]]><rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "open session edits x=b, other session commits x=a: no conflict"
+session_open
+session_send "<edit-config><target><candidate/></target><config><c xmlns=\"urn:example:clixon\"><x><name>b</name><value>2</value></x></c></config></edit-config>"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:clixon\"><x><name>a</name><value>3</value></x></c></config></edit-config></rpc>]]>]]><rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+session_send "<commit/>"
+session_close
+expectpart "$(cat $fout)" 0 "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+new "both commits in running"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><x><name>a</name><value>3</value></x><x><name>b</name><value>2</value></x></c></data></rpc-reply>]]>]]>$"
+
+new "open session edits x=a, other session commits x=a: conflict"
+session_open
+session_send "<edit-config><target><candidate/></target><config><c xmlns=\"urn:example:clixon\"><x><name>a</name><value>4</value></x></c></config></edit-config>"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:clixon\"><x><name>a</name><value>5</value></x></c></config></edit-config></rpc>]]>]]><rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+session_send "<commit/>"
+session_close
+expectpart "$(cat $fout)" 0 "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>operation-failed</error-tag><error-severity>error</error-severity><error-message>Private candidate conflicts with running: /c/x\[name=\"a\"\]/value has been changed by another session</error-message></rpc-error></rpc-reply>]]>]]>$"
+
+new "other commit not overwritten"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:c/ex:x[ex:name='a']\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><x><name>a</name><value>5</value></x></c></data></rpc-reply>]]>]]>$"
+
+new "open session replaces candidate, other session commits: conflict"
+session_open
+session_send "<delete-config><target><candidate/></target></delete-config>"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:clixon\"><x><name>e</name></x></c></config></edit-config></rpc>]]>]]><rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+session_send "<commit/>"
+session_close
+expectpart "$(cat $fout)" 0 "<error-message>Private candidate conflicts with running"
+
+new "other commit not overwritten"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:c/ex:x[ex:name='e']\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><x><name>e</name></x></c></data></rpc-reply>]]>]]>$"
+
+new "no private candidates left"
+if ls $dir/candidate-*_db > /dev/null 2>&1; then
+    err "no private candidate datastores" "$(ls $dir/candidate-*_db)"
+fi
+
+if [ $BE -eq 0 ]; then
+    exit # BE
+fi
+
+new "Kill backend"
+# Check if premature kill
+pid=$(pgrep -u root -f clixon_backend)
+if [ -z "$pid" ]; then
+    err "backend already dead"
+fi
+# kill backend
+stop_backend -f $cfg
+
+rm -rf $dir
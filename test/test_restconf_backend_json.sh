@@ -0,0 +1,140 @@
+#!/usr/bin/env bash
+# JSON replies encoded by the backend: encoding="json" attribute of get (clixon
+# extension) and CLICON_RESTCONF_BACKEND_JSON.
+# Restconf JSON GETs should be the same whether the JSON is encoded by the backend
+# or by restconf.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/test.yang
+
+cat <<EOF > $fyang
+module $APPNAME{
+  yang-version 1.1;
+  namespace "urn:example:clixon";
+  prefix ex;
+  container c{
+    list x{
+      key name;
+      leaf name{
+        type string;
+      }
+      leaf i{
+        type int32;
+      }
+      leaf s{
+        type string;
+      }
+    }
+    leaf-list y{
+      type string;
+    }
+  }
+}
+EOF
+
+XML="<c xmlns=\"urn:example:clixon\"><x><name>a</name><i>-42</i><s>a &amp; b</s></x><x><name>b</name><i>0</i></x><y>foo</y><y>bar</y></c>"
+
+# 1: CLICON_RESTCONF_BACKEND_JSON true or false
+testrun(){
+    backendjson=$1
+
+    cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_MODULE_LIBRARY_RFC7895>false</CLICON_MODULE_LIBRARY_RFC7895>
+  <CLICON_RESTCONF_PRETTY>false</CLICON_RESTCONF_PRETTY>
+  <CLICON_RESTCONF_BACKEND_JSON>$backendjson</CLICON_RESTCONF_BACKEND_JSON>
+  $RESTCONFIG
+</clixon-config>
+EOF
+
+    new "test params: -f $cfg"
+    if [ $BE -ne 0 ]; then
+	new "kill old backend"
+	sudo clixon_backend -zf $cfg
+	if [ $? -ne 0 ]; then
+	    err
+	fi
+	new "start backend -s init -f $cfg"
+	start_backend -s init -f $cfg
+
+	new "waiting"
+	wait_backend
+    fi
+
+    if [ $RC -ne 0 ]; then
+	new "kill old restconf daemon"
+	stop_restconf_pre
+
+	new "start restconf daemon"
+	start_restconf -f $cfg
+
+	new "waiting"
+	wait_restconf
+    fi
+
+    new "edit-config"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config>$XML</config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "commit"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "netconf get json encoding"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get encoding=\"json\"><filter type=\"xpath\" select=\"/ex:c/ex:x[ex:name='b']\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data encoding=\"json\">{\"example:x\":\[{\"name\":\"b\",\"i\":0}\]}</data></rpc-reply>]]>]]>$"
+
+    new "netconf get-config json encoding, not found"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config encoding=\"json\"><source><running/></source><filter type=\"xpath\" select=\"/ex:c/ex:x[ex:name='z']\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data encoding=\"json\"/></rpc-reply>]]>]]>$"
+
+    new "netconf get json encoding with depth is xml"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get encoding=\"json\" depth=\"1\"><filter type=\"xpath\" select=\"/ex:c\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"/></data></rpc-reply>]]>]]>$"
+
+    new "restconf get container"
+    expectpart "$(curl $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/example:c)" 0 'HTTP/1.1 200 OK' '{"example:c":{"x":\[{"name":"a","i":-42,"s":"a & b"},{"name":"b","i":0}\],"y":\["foo","bar"\]}}'
+
+    new "restconf get list entry"
+    expectpart "$(curl $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/example:c/x=b)" 0 'HTTP/1.1 200 OK' '{"example:x":\[{"name":"b","i":0}\]}'
+
+    new "restconf get leaf"
+    expectpart "$(curl $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/example:c/x=a/s)" 0 'HTTP/1.1 200 OK' '{"example:s":"a & b"}'
+
+    new "restconf get not found"
+    expectpart "$(curl $CURLOPTS -X GET $RCPROTO://localhost/restconf/data/example:c/x=z)" 0 'HTTP/1.1 404 Not Found' '{"ietf-restconf:errors":{"error":{"error-type":"application","error-tag":"invalid-value","error-severity":"error","error-message":"Instance does not exist"}}}'
+
+    new "restconf get xml"
+    expectpart "$(curl $CURLOPTS -X GET -H 'Accept: application/yang-data+xml' $RCPROTO://localhost/restconf/data/example:c/x=b)" 0 'HTTP/1.1 200 OK' '<x xmlns="urn:example:clixon"><name>b</name><i>0</i></x>'
+
+    if [ $RC -ne 0 ]; then
+	new "Kill restconf daemon"
+	stop_restconf
+    fi
+
+    if [ $BE -ne 0 ]; then
+	new "Kill backend"
+	# Check if premature kill
+	pid=$(pgrep -u root -f clixon_backend)
+	if [ -z "$pid" ]; then
+	    err "backend already dead"
+	fi
+	# kill backend
+	stop_backend -f $cfg
+    fi
+} # testrun
+
+new "JSON encoded by backend"
+testrun true
+
+new "JSON encoded by restconf"
+testrun false
+
+rm -rf $dir
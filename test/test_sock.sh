@@ -43,6 +43,7 @@ cat <<EOF > $cfg
   <CLICON_XMLDB_DIR>/usr/local/var/$APPNAME</CLICON_XMLDB_DIR>
   <CLICON_STARTUP_MODE>init</CLICON_STARTUP_MODE>
   <CLICON_MODULE_LIBRARY_RFC7895>false</CLICON_MODULE_LIBRARY_RFC7895>
+  <CLICON_BACKEND_OUTPUT_MAX>256</CLICON_BACKEND_OUTPUT_MAX>
 </clixon-config>
 EOF
 
@@ -69,6 +70,13 @@ EOF
     new "hello session-id 2"
     expecteof "$clixon_util_socket -a $family -s $sock -D $DBG" 0 "<hello $DEFAULTNS/>" "<hello $DEFAULTNS><session-id>4</session-id></hello>"
 
+    new "pipelined hellos, replies in order"
+    expectpart "$(echo "<hello $DEFAULTNS/>" | $clixon_util_socket -a $family -s $sock -D $DBG -p 3)" 0 "<hello $DEFAULTNS><session-id>5</session-id></hello>" "<hello $DEFAULTNS><session-id>6</session-id></hello>" "<hello $DEFAULTNS><session-id>7</session-id></hello>"
+
+    # Small CLICON_BACKEND_OUTPUT_MAX makes backend stop reading until replies are read
+    new "many pipelined hellos exceeding output queue limit"
+    expectpart "$(echo "<hello $DEFAULTNS/>" | $clixon_util_socket -a $family -s $sock -D $DBG -p 100)" 0 "<hello $DEFAULTNS><session-id>8</session-id></hello>" "<hello $DEFAULTNS><session-id>107</session-id></hello>"
+
     if [ $BE -ne 0 ]; then
 	new "Kill backend"
 	# Check if premature kill
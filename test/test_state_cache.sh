@@ -0,0 +1,102 @@
+#!/usr/bin/env bash
+# State data cache: CLICON_BACKEND_STATE_CACHE_TTL
+# The example plugin reads state data from a file on every get. Change the file
+# and check that cached state data is returned until the TTL has passed, that
+# different xpaths are cached separately, and check cache statistics.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/test.yang
+fstate=$dir/state.xml
+
+# TTL in ms
+ttl=2000
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_MODULE_LIBRARY_RFC7895>false</CLICON_MODULE_LIBRARY_RFC7895>
+  <CLICON_BACKEND_STATE_CACHE_TTL>$ttl</CLICON_BACKEND_STATE_CACHE_TTL>
+</clixon-config>
+EOF
+
+cat <<EOF > $fyang
+module $APPNAME{
+  yang-version 1.1;
+  namespace "urn:example:clixon";
+  prefix ex;
+  container c{
+    config false;
+    leaf counter{
+      type int32;
+    }
+    leaf name{
+      type string;
+    }
+  }
+}
+EOF
+
+cat <<EOF > $fstate
+<c xmlns="urn:example:clixon"><counter>1</counter><name>a</name></c>
+EOF
+
+new "test params: -f $cfg -- -sS $fstate"
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s init -f $cfg -- -sS $fstate"
+    start_backend -s init -f $cfg -- -sS $fstate
+
+    new "waiting"
+    wait_backend
+fi
+
+new "get state"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:c\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><counter>1</counter><name>a</name></c></data></rpc-reply>]]>]]>$"
+
+cat <<EOF > $fstate
+<c xmlns="urn:example:clixon"><counter>2</counter><name>a</name></c>
+EOF
+
+new "get cached state"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:c\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><counter>1</counter><name>a</name></c></data></rpc-reply>]]>]]>$"
+
+new "get state with other xpath is not cached"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:c/ex:counter\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><counter>2</counter></c></data></rpc-reply>]]>]]>$"
+
+new "cache statistics"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><stats xmlns=\"http://clicon.org/lib\"/></rpc>]]>]]>" "<statedata-cache><entries>2</entries><hits>1</hits><misses>2</misses></statedata-cache>"
+
+sleep $((ttl/1000+1))
+
+new "get state after ttl"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:c\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><counter>2</counter><name>a</name></c></data></rpc-reply>]]>]]>$"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
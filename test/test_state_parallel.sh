@@ -0,0 +1,115 @@
+#!/usr/bin/env bash
+# Concurrent state data collection: CLIXON_PLUGIN_PARALLEL, CLICON_BACKEND_STATE_TIMEOUT
+# The example plugin is started with a statedata callback (-sS) and a state data
+# provider (-p) that both take one second (-d 1000), and are declared parallel.
+# A get of all state should take about one second, not two.
+# Then restart with a timeout shorter than the delay and check the get fails.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/test.yang
+fstate=$dir/state.xml
+
+# Delay of each callback in ms
+delay=1000
+
+# Create config file with timeout as argument
+function testconfig(){
+    timeout=$1
+    cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_BACKEND_REGEXP>example_backend.so$</CLICON_BACKEND_REGEXP>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_MODULE_LIBRARY_RFC7895>false</CLICON_MODULE_LIBRARY_RFC7895>
+  <CLICON_BACKEND_STATE_TIMEOUT>$timeout</CLICON_BACKEND_STATE_TIMEOUT>
+</clixon-config>
+EOF
+}
+
+cat <<EOF > $fyang
+module $APPNAME{
+  yang-version 1.1;
+  namespace "urn:example:clixon";
+  prefix ex;
+  container c{
+    config false;
+    leaf counter{
+      type int32;
+    }
+  }
+  container state{
+    config false;
+    leaf-list op{
+      type string;
+    }
+  }
+}
+EOF
+
+cat <<EOF > $fstate
+<c xmlns="urn:example:clixon"><counter>1</counter></c>
+EOF
+
+# Start backend with timeout as argument
+function startbackend(){
+    testconfig $1
+    new "test params: -f $cfg -- -sS $fstate -p -d $delay"
+    if [ $BE -ne 0 ]; then
+	new "kill old backend"
+	sudo clixon_backend -zf $cfg
+	if [ $? -ne 0 ]; then
+	    err
+	fi
+	new "start backend -s init -f $cfg -- -sS $fstate -p -d $delay"
+	start_backend -s init -f $cfg -- -sS $fstate -p -d $delay
+
+	new "waiting"
+	wait_backend
+    fi
+}
+
+function stopbackend(){
+    if [ $BE -ne 0 ]; then
+	new "Kill backend"
+	# Check if premature kill
+	pid=$(pgrep -u root -f clixon_backend)
+	if [ -z "$pid" ]; then
+	    err "backend already dead"
+	fi
+	# kill backend
+	stop_backend -f $cfg
+    fi
+}
+
+startbackend 0
+
+new "get state of both callbacks"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:c | /ex:state\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><counter>1</counter></c><state xmlns=\"urn:example:clixon\"><op>1</op></state></data></rpc-reply>]]>]]>$"
+
+new "get state of both callbacks in parallel"
+t=$({ time -p echo "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:c | /ex:state\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>]]>]]>" | $clixon_netconf -qf $cfg > /dev/null; } 2>&1 | awk '/real/ {print $2}')
+if [ $(echo "$t $delay" | awk '{print ($1*1000 < $2*1.8)}') -ne 1 ]; then
+    err "get in less than $((delay*18/10)) ms" "$t s"
+fi
+
+stopbackend
+
+startbackend $((delay/2))
+
+new "get state times out"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get><filter type=\"xpath\" select=\"/ex:c | /ex:state\" xmlns:ex=\"urn:example:clixon\"/></get></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>operation-failed</error-tag><error-severity>error</error-severity><error-message>Internal error, state callback in plugin example_backend returned invalid XML: Timeout after $((delay/2)) ms</error-message></rpc-error></rpc-reply>]]>]]>$"
+
+stopbackend
+
+rm -rf $dir
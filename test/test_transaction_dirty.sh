@@ -0,0 +1,167 @@
+#!/usr/bin/env bash
+# Transaction data vectors of commits computed from dirty marks of candidate
+# (xml_diff_dirty), where only modified subtrees are traversed.
+# Add, delete and modify of leafs and list entries deep in a large list, checked
+# against the transaction log of the example backend plugin (-- -t).
+# Also entries deleted and added again, and leafs deleted back to their default.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/dirty.yang
+flog=$dir/backend.log
+touch $flog
+
+# Number of list entries
+: ${perfnr:=1000}
+
+cat <<EOF > $fyang
+module dirty{
+   yang-version 1.1;
+   namespace "urn:example:clixon";
+   prefix ex;
+   container c {
+     list x {
+       key "name";
+       leaf name {
+         type int32;
+       }
+       container y {
+         list z {
+           key "k";
+           leaf k {
+             type int32;
+           }
+           leaf v {
+             type int32;
+           }
+         }
+       }
+     }
+   }
+   leaf d {
+     type int32;
+     default 0;
+   }
+}
+EOF
+
+cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_BACKEND_DIR>/usr/local/lib/$APPNAME/backend</CLICON_BACKEND_DIR>
+  <CLICON_SOCK>$dir/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_DATASTORE_CACHE>cache-zerocopy</CLICON_DATASTORE_CACHE>
+</clixon-config>
+EOF
+
+NCNS="xmlns:nc=\"urn:ietf:params:xml:ns:netconf:base:1.0\""
+
+# Edit candidate without commit
+# 1: edit-config config content
+edit(){
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config $NCNS>$1</config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+}
+
+# Edit candidate, commit, and check commit callback of last transaction in log
+# 1: edit-config <c> content
+# 2: Expected main_commit log entries of transaction, eg "add: <v>1</v>"
+# 3: (optional) second expected entry
+commitlog(){
+    commitlogtop "<c xmlns=\"urn:example:clixon\">$1</c>" "${@:2}"
+}
+
+# Same as commitlog but with config content
+# 1: edit-config config content
+# 2: Expected main_commit log entries of transaction
+commitlogtop(){
+    l0=$(wc -l < $flog)
+    edit "$1"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+    ret=$(tail -n +$((l0+1)) $flog | grep -o "main_commit .*")
+    shift
+    expect=$(for e in "$@"; do echo "main_commit $e"; done)
+    if [ "$ret" != "$expect" ]; then
+	err "$expect" "$ret"
+    fi
+}
+
+new "test params: -f $cfg -l f$flog -- -t"
+if [ $BE -ne 0 ]; then
+    new "kill old backend"
+    sudo clixon_backend -zf $cfg
+    if [ $? -ne 0 ]; then
+	err
+    fi
+    new "start backend -s init -f $cfg -l f$flog -- -t"
+    start_backend -s init -f $cfg -l f$flog -- -t # -t means transaction logging
+
+    new "waiting"
+    wait_backend
+fi
+
+new "generate config with $perfnr list entries"
+xml=""
+for (( i=0; i<$perfnr; i++ )); do
+    xml+="<x><name>$i</name><y><z><k>1</k><v>1</v></z><z><k>2</k><v>2</v></z></y></x>"
+done
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config><c xmlns=\"urn:example:clixon\">$xml</c></config></edit-config></rpc>]]>]]><rpc $DEFAULTNS><commit/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]><rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+mid=$((perfnr/2))
+
+new "modify deep leaf"
+commitlog "<x><name>$mid</name><y><z><k>1</k><v>9</v></z></y></x>" "change: <v>1</v><v>9</v>"
+
+new "add deep leaf"
+commitlog "<x><name>$mid</name><y><z><k>3</k><v>3</v></z></y></x>" "add: <z><k>3</k><v>3</v></z>"
+
+new "delete deep leaf"
+commitlog "<x><name>$mid</name><y><z><k>2</k><v nc:operation=\"delete\"/></z></y></x>" "del: <v>2</v>"
+
+new "delete, add and modify deep leafs in one commit"
+commitlog "<x><name>$mid</name><y><z><k>1</k><v nc:operation=\"delete\"/></z><z><k>2</k><v>5</v></z><z><k>3</k><v>7</v></z></y></x>" "del: <v>9</v>" "add: <v>5</v>" "change: <v>3</v><v>7</v>"
+
+new "add list entry"
+commitlog "<x><name>$perfnr</name></x>" "add: <x><name>$perfnr</name></x>"
+
+new "delete list entry"
+commitlog "<x nc:operation=\"delete\"><name>$mid</name></x>" "del: <x><name>$mid</name><y><z><k>1</k></z><z><k>2</k><v>5</v></z><z><k>3</k><v>7</v></z></y></x>"
+
+new "running is consistent"
+expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config><source><running/></source><filter type=\"xpath\" select=\"/ex:c/ex:x[ex:name='$((mid+1))' or ex:name='$mid' or ex:name='$perfnr']\" xmlns:ex=\"urn:example:clixon\"/></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><x><name>$((mid+1))</name><y><z><k>1</k><v>1</v></z><z><k>2</k><v>2</v></z></y></x><x><name>$perfnr</name></x></c></data></rpc-reply>]]>]]>$"
+
+new "delete list entry"
+edit "<c xmlns=\"urn:example:clixon\"><x nc:operation=\"delete\"><name>$((mid-1))</name></x></c>"
+
+new "add list entry again, modified, in same commit"
+commitlog "<x><name>$((mid-1))</name><y><z><k>1</k><v>4</v></z></y></x>" "del: <z><k>2</k><v>2</v></z>" "change: <v>1</v><v>4</v>"
+
+new "delete and add deep leaf, unchanged, in same commit"
+edit "<c xmlns=\"urn:example:clixon\"><x><name>$((mid-1))</name><y><z><k>1</k><v nc:operation=\"delete\"/></z></y></x></c>"
+commitlog "<x><name>$((mid-1))</name><y><z><k>1</k><v>4</v></z></y></x>"
+
+new "set leaf with default"
+commitlogtop "<d xmlns=\"urn:example:clixon\">5</d>" "change: <d>0</d><d>5</d>"
+
+new "delete leaf back to default"
+commitlogtop "<d xmlns=\"urn:example:clixon\" nc:operation=\"delete\"/>" "change: <d>5</d><d>0</d>"
+
+if [ $BE -ne 0 ]; then
+    new "Kill backend"
+    # Check if premature kill
+    pid=$(pgrep -u root -f clixon_backend)
+    if [ -z "$pid" ]; then
+	err "backend already dead"
+    fi
+    # kill backend
+    stop_backend -f $cfg
+fi
+
+rm -rf $dir
@@ -0,0 +1,172 @@
+#!/usr/bin/env bash
+# Incremental commit validation: CLICON_VALIDATE_INCREMENTAL
+# Make changes that break must, when, leafref and max-elements constraints of
+# nodes that are not themselves changed, and check that commit detects them.
+# Constraints are referred to via predicates, current() and through choice/case.
+# Run the same tests with incremental validation enabled and disabled.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+APPNAME=example
+
+cfg=$dir/conf_yang.xml
+fyang=$dir/test.yang
+
+cat <<EOF > $fyang
+module $APPNAME{
+  yang-version 1.1;
+  namespace "urn:example:clixon";
+  prefix ex;
+  container c{
+    list server{
+      key name;
+      leaf name{
+        type string;
+      }
+      leaf port{
+        type uint16;
+      }
+    }
+    leaf default-server{
+      type leafref{
+        path "../server/name";
+      }
+    }
+    leaf mode{
+      type string;
+    }
+    leaf extra{
+      when "../mode = 'full'";
+      type string;
+    }
+    leaf-list item{
+      type int32;
+      max-elements 2;
+    }
+    leaf mgmt-port{
+      type uint16;
+      must "/ex:c/ex:server[ex:name=current()/../ex:default-server]/ex:port = ." {
+        error-message "mgmt-port is not port of default server";
+      }
+    }
+    choice proto{
+      case tcp{
+        leaf tcp-port{
+          type uint16;
+        }
+      }
+    }
+    leaf limit{
+      type uint16;
+      must "not(../tcp-port) or . >= ../tcp-port" {
+        error-message "limit below tcp-port";
+      }
+    }
+    must "not(server[port=22])" {
+      error-message "port 22 not allowed";
+    }
+  }
+}
+EOF
+
+# Edit candidate and commit
+# 1: config
+# 2: expected reply pattern of commit
+editcommit(){
+    config=$1
+    expect=$2
+
+    new "edit-config $config"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><edit-config><target><candidate/></target><config>$config</config></edit-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "commit"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><commit/></rpc>]]>]]>" "$expect"
+
+    new "discard-changes"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><discard-changes/></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+}
+
+# 1: incremental validation true or false
+testrun(){
+    incremental=$1
+
+    cat <<EOF > $cfg
+<clixon-config xmlns="http://clicon.org/config">
+  <CLICON_CONFIGFILE>$cfg</CLICON_CONFIGFILE>
+  <CLICON_YANG_DIR>/usr/local/share/clixon</CLICON_YANG_DIR>
+  <CLICON_YANG_DIR>$IETFRFC</CLICON_YANG_DIR>
+  <CLICON_YANG_MAIN_FILE>$fyang</CLICON_YANG_MAIN_FILE>
+  <CLICON_CLISPEC_DIR>/usr/local/lib/$APPNAME/clispec</CLICON_CLISPEC_DIR>
+  <CLICON_CLI_DIR>/usr/local/lib/$APPNAME/cli</CLICON_CLI_DIR>
+  <CLICON_CLI_MODE>$APPNAME</CLICON_CLI_MODE>
+  <CLICON_SOCK>/usr/local/var/$APPNAME/$APPNAME.sock</CLICON_SOCK>
+  <CLICON_BACKEND_PIDFILE>/usr/local/var/$APPNAME/$APPNAME.pidfile</CLICON_BACKEND_PIDFILE>
+  <CLICON_XMLDB_DIR>$dir</CLICON_XMLDB_DIR>
+  <CLICON_VALIDATE_INCREMENTAL>$incremental</CLICON_VALIDATE_INCREMENTAL>
+</clixon-config>
+EOF
+
+    new "test params: -f $cfg"
+    if [ $BE -ne 0 ]; then
+	new "kill old backend"
+	sudo clixon_backend -zf $cfg
+	if [ $? -ne 0 ]; then
+	    err
+	fi
+	new "start backend -s init -f $cfg"
+	start_backend -s init -f $cfg
+
+	new "waiting"
+	wait_backend
+    fi
+
+    new "Initial valid config"
+    editcommit "<c xmlns=\"urn:example:clixon\"><server><name>a</name><port>80</port></server><server><name>b</name><port>80</port></server><default-server>a</default-server><mode>full</mode><extra>x</extra><item>1</item><mgmt-port>80</mgmt-port><tcp-port>10</tcp-port><limit>100</limit></c>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "Delete leafref target"
+    editcommit "<c xmlns=\"urn:example:clixon\"><server nc:operation=\"delete\" xmlns:nc=\"urn:ietf:params:xml:ns:netconf:base:1.0\"><name>a</name></server></c>" "^<rpc-reply $DEFAULTNS><rpc-error><error-type>application</error-type><error-tag>bad-element</error-tag><error-info><bad-element>a</bad-element></error-info>"
+
+    new "Delete other server ok"
+    editcommit "<c xmlns=\"urn:example:clixon\"><server nc:operation=\"delete\" xmlns:nc=\"urn:ietf:params:xml:ns:netconf:base:1.0\"><name>b</name></server></c>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "Change when condition of other leaf"
+    editcommit "<c xmlns=\"urn:example:clixon\"><mode>basic</mode></c>" "Failed WHEN condition of extra"
+
+    new "Break must of ancestor"
+    editcommit "<c xmlns=\"urn:example:clixon\"><server><name>c</name><port>22</port></server></c>" "port 22 not allowed"
+
+    new "Change port referred to by predicate and current()"
+    editcommit "<c xmlns=\"urn:example:clixon\"><server><name>a</name><port>8080</port></server></c>" "mgmt-port is not port of default server"
+
+    new "Change node in choice referred to by must"
+    editcommit "<c xmlns=\"urn:example:clixon\"><tcp-port>200</tcp-port></c>" "limit below tcp-port"
+
+    new "Add one item ok"
+    editcommit "<c xmlns=\"urn:example:clixon\"><item>2</item></c>" "^<rpc-reply $DEFAULTNS><ok/></rpc-reply>]]>]]>$"
+
+    new "Add item above max-elements"
+    editcommit "<c xmlns=\"urn:example:clixon\"><item>3</item></c>" "too-many-elements"
+
+    new "Check running"
+    expecteof "$clixon_netconf -qf $cfg" 0 "<rpc $DEFAULTNS><get-config><source><running/></source></get-config></rpc>]]>]]>" "^<rpc-reply $DEFAULTNS><data><c xmlns=\"urn:example:clixon\"><server><name>a</name><port>80</port></server><default-server>a</default-server><mode>full</mode><extra>x</extra><item>1</item><item>2</item><mgmt-port>80</mgmt-port><tcp-port>10</tcp-port><limit>100</limit></c></data></rpc-reply>]]>]]>$"
+
+    if [ $BE -ne 0 ]; then
+	new "Kill backend"
+	# Check if premature kill
+	pid=$(pgrep -u root -f clixon_backend)
+	if [ -z "$pid" ]; then
+	    err "backend already dead"
+	fi
+	# kill backend
+	stop_backend -f $cfg
+    fi
+} # testrun
+
+new "Incremental validation"
+testrun true
+
+new "Full validation"
+testrun false
+
+rm -rf $dir
@@ -0,0 +1,51 @@
+#!/usr/bin/env bash
+# XML character data encoding with the vectorized scans of xml_chardata_span:
+# output of every scan implementation (-S) must be byte-identical.
+# Bodies have characters to encode and CDATA sections at all offsets up to and
+# across 16 and 32 byte blocks.
+
+# Magic line must be first in script (see README.md)
+s="$_" ; . ./lib.sh || if [ "$s" = $0 ]; then exit 0; else return 0; fi
+
+: ${clixon_util_xml:="clixon_util_xml"}
+
+fxml=$dir/chardata.xml
+
+# Bodies: <n chars>&amp;..., <n chars>&lt;..., <n chars>&gt;..., <n chars><![CDATA[..]]>...
+pad=""
+XML="<a>"
+for (( i=0; i<70; i++ )); do
+    XML="$XML<b>$pad&amp;x</b><b>$pad&lt;$pad</b><b>x$pad&gt;&gt;&amp;$pad</b><b>$pad<![CDATA[<&>]]>&lt;$pad</b>"
+    pad="${pad}y"
+done
+XML="$XML<b>$pad$pad$pad</b><b/></a>"
+echo -n "$XML" > $fxml
+
+new "xml chardata encoding, default scan"
+ret=$($clixon_util_xml -o -f $fxml)
+if [ "$ret" != "$XML" ]; then
+    err "$XML" "$ret"
+fi
+
+new "xml chardata encoding, scalar scan"
+ref=$($clixon_util_xml -o -S scalar -f $fxml)
+if [ "$ref" != "$XML" ]; then
+    err "$XML" "$ref"
+fi
+
+for impl in sse2 avx2; do
+    if ! $clixon_util_xml -S $impl -f $fxml 2> /dev/null; then
+	echo "...skipped: $impl not supported"
+	continue
+    fi
+    new "xml chardata encoding, $impl scan is same as scalar"
+    ret=$($clixon_util_xml -o -S $impl -f $fxml)
+    if [ "$ret" != "$ref" ]; then
+	err "$ref" "$ret"
+    fi
+done
+
+new "xml chardata unknown scan"
+expectpart "$($clixon_util_xml -o -S foo -f $fxml 2>&1)" 255 "foo not supported"
+
+rm -rf $dir
@@ -59,6 +59,28 @@
 /* clixon */
 #include "clixon/clixon.h"
 
+/*! Asynchronous reply callback, print reply
+ */
+static int
+async_reply(clicon_handle h,
+	    uint32_t      reqid,
+	    cxobj        *xret,
+	    void         *arg)
+{
+    cxobj *xc;
+
+    if (xret == NULL){
+	fprintf(stderr, "No reply for request %u\n", reqid);
+	return -1;
+    }
+    if ((xc = xml_child_i(xret, 0)) != NULL)
+	clicon_xml2file(stdout, xc, 0, 0);
+    fprintf(stdout, "\n");
+    /* Replies can be followed while requests are pending */
+    fflush(stdout);
+    return 0;
+}
+
 static int
 usage(char *argv0)
 {
@@ -70,6 +92,7 @@ usage(char *argv0)
 	    "\t-s <sockpath> \tPath to unix domain socket (or IP addr)\n"
 	    "\t-f <file>\tXML input file (overrides stdin)\n"
 	    "\t-J \t\tInput as JSON (instead of XML)\n"
+	    "\t-p <nr>\tSend request nr times asynchronously without waiting for replies\n"
 	    ,
 	    argv0);
     exit(0);
@@ -96,6 +119,8 @@ main(int    argc,
     cbuf              *cb = cbuf_new();
     clicon_handle      h;
     int                dbg = 0;
+    int                pipeline = 0;
+    int                i;
 
     /* In the startup, logs to stderr & debug flag set later */
     clicon_log_init(__FILE__, LOG_INFO, CLICON_LOG_STDERR); 
@@ -105,7 +130,7 @@ main(int    argc,
 
     optind = 1;
     opterr = 0;
-    while ((c = getopt(argc, argv, "hD:s:f:Ja:")) != -1)
+    while ((c = getopt(argc, argv, "hD:s:f:Ja:p:")) != -1)
 	switch (c) {
 	case 'h':
 	    usage(argv[0]);
@@ -126,6 +151,10 @@ main(int    argc,
 	case 'a':
 	    family = optarg;
 	    break;
+	case 'p':
+	    if (sscanf(optarg, "%d", &pipeline) != 1)
+		usage(argv[0]);
+	    break;
 	default:
 	    usage(argv[0]);
 	    break;
@@ -166,6 +195,20 @@ main(int    argc,
 	goto done;
     if ((msg = clicon_msg_encode(getpid(), "%s", cbuf_get(cb))) < 0)
 	goto done;
+    if (pipeline > 0){
+	/* Send all requests before reading any reply */
+	clicon_option_str_set(h, "CLICON_SOCK", sockpath);
+	clicon_option_str_set(h, "CLICON_SOCK_FAMILY", strcmp(family, "UNIX")==0?"UNIX":"IPv4");
+	clicon_option_str_set(h, "CLICON_SOCK_PORT", "4535");
+	for (i=0; i<pipeline; i++)
+	    if (clicon_rpc_async(h, msg, async_reply, NULL, NULL) < 0)
+		goto done;
+	if (clicon_rpc_async_wait(h, 0) < 0)
+	    goto done;
+	clicon_rpc_async_close(h);
+	retval = 0;
+	goto done;
+    }
     if (strcmp(family, "UNIX")==0){
 	if (clicon_rpc_connect_unix(h, msg, sockpath, &retdata, NULL) < 0)
 	    goto done;
@@ -66,7 +66,7 @@
 #include "clixon/clixon.h"
 
 /* Command line options passed to getopt(3) */
-#define UTIL_XML_OPTS "hD:f:Jjl:pvoy:Y:t:T:u"
+#define UTIL_XML_OPTS "hD:f:Jjl:pvoy:Y:t:T:ub:S:"
 
 static int
 validate_tree(clicon_handle h,
@@ -107,6 +107,75 @@ validate_tree(clicon_handle h,
     return retval;
 }
 
+/*! Benchmark XML printing: print tree n times to a cligen buffer, to /dev/null and as JSON
+ * Timing is printed on stderr
+ */
+static int
+benchmark_tree(cxobj *xt,
+	       int    n,
+	       int    pretty)
+{
+    int            retval = -1;
+    cbuf          *cb = NULL;
+    cxobj         *xc;
+    int            fd = -1;
+    int            i;
+    struct timeval t0;
+    struct timeval t1;
+    struct timeval td;
+
+    if ((cb = cbuf_new()) == NULL){
+	clicon_err(OE_XML, errno, "cbuf_new");
+	goto done;
+    }
+    gettimeofday(&t0, NULL);
+    for (i=0; i<n; i++){
+	cbuf_reset(cb);
+	xc = NULL;
+	while ((xc = xml_child_each(xt, xc, -1)) != NULL) 
+	    if (clicon_xml2cbuf(cb, xc, 0, pretty, -1) < 0)
+		goto done;
+    }
+    gettimeofday(&t1, NULL);
+    timersub(&t1, &t0, &td);
+    fprintf(stderr, "xml2cbuf: %d * %d bytes: %lu.%06lu s\n",
+	    n, cbuf_len(cb), (unsigned long)td.tv_sec, (unsigned long)td.tv_usec);
+    if ((fd = open("/dev/null", O_WRONLY)) < 0){
+	clicon_err(OE_UNIX, errno, "open(/dev/null)");
+	goto done;
+    }
+    gettimeofday(&t0, NULL);
+    for (i=0; i<n; i++){
+	xc = NULL;
+	while ((xc = xml_child_each(xt, xc, -1)) != NULL) 
+	    if (clicon_xml2fd(fd, xc, 0, pretty) < 0)
+		goto done;
+    }
+    gettimeofday(&t1, NULL);
+    timersub(&t1, &t0, &td);
+    fprintf(stderr, "xml2fd: %d * %d bytes: %lu.%06lu s\n",
+	    n, cbuf_len(cb), (unsigned long)td.tv_sec, (unsigned long)td.tv_usec);
+    gettimeofday(&t0, NULL);
+    for (i=0; i<n; i++){
+	cbuf_reset(cb);
+	xc = NULL;
+	while ((xc = xml_child_each(xt, xc, CX_ELMNT)) != NULL) 
+	    if (xml2json_cbuf(cb, xc, pretty) < 0)
+		goto done;
+    }
+    gettimeofday(&t1, NULL);
+    timersub(&t1, &t0, &td);
+    fprintf(stderr, "xml2json: %d * %d bytes: %lu.%06lu s\n",
+	    n, cbuf_len(cb), (unsigned long)td.tv_sec, (unsigned long)td.tv_usec);
+    retval = 0;
+ done:
+    if (fd != -1)
+	close(fd);
+    if (cb)
+	cbuf_free(cb);
+    return retval;
+}
+
 static int
 usage(char *argv0)
 {
@@ -126,6 +195,8 @@ usage(char *argv0)
    	    "\t-t <file>\tXML top input file (where base tree is pasted to)\n"
 	    "\t-T <path>\tXPath to where in top input file base should be pasted\n"
 	    "\t-u \t\tTreat unknown XML as anydata\n"
+	    "\t-b <n> \tBenchmark: print tree n times, timing on stderr\n"
+	    "\t-S <impl> \tXML encoding scan: auto, scalar, sse2 or avx2\n"
 	    ,
 	    argv0);
     exit(0);
@@ -164,6 +235,7 @@ main(int    argc,
     cvec         *nsc = NULL; 
     yang_bind     yb;
     int           dbg = 0;
+    int           bench = 0;
 
     /* In the startup, logs to stderr & debug flag set later */
     clicon_log_init(__FILE__, LOG_INFO, CLICON_LOG_STDERR); 
@@ -226,6 +298,14 @@ main(int    argc,
 		goto done;
 	    xml_bind_yang_unknown_anydata(1);
 	    break;
+	case 'b':
+	    if (sscanf(optarg, "%d", &bench) != 1)
+		usage(argv[0]);
+	    break;
+	case 'S':
+	    if (xml_chardata_simd_set(optarg) < 0)
+		goto done;
+	    break;
 	default:
 	    usage(argv[0]);
 	    break;
@@ -332,6 +412,9 @@ main(int    argc,
 	if (validate_tree(h, xt, yspec) < 0)
 	    goto done;
     }
+    /* Benchmark printing */
+    if (bench > 0 && benchmark_tree(xt, bench, pretty) < 0)
+	goto done;
     /* 4. Output data (xml/json) */
     if (output){
 	xc = NULL;